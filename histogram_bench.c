@@ -0,0 +1,328 @@
+// histogram_bench.c
+// 跨后端基准测试：CPU（标量/SIMD/多线程）、OpenCL和FPGA核心模型在相同条件下统计同一组帧，
+// 每个配置重复多次试验，报告每帧时间的中位数、p5/p95和中位数的95%置信区间，结果写成JSON，
+// 可以与保存的基线比较检查性能回退
+//
+// 用法：histogram_bench [width height] [选项]
+//   --trials N          每个配置的试验次数（默认30）
+//   --frames N          每次试验统计的帧数（默认10，每帧时间 = 试验时间 / N）
+//   --warmup N          不计入结果的预热试验次数（默认3）
+//   --threads N         cpu-mt配置的线程数（默认0 = 全部CPU核）
+//   --backends LIST     逗号分隔的配置名前缀，例如 cpu,fpga（默认全部）
+//   --fpga-device DEV   FPGA设备字符串（默认HIST_FPGA_DEVICE，没有则为 "emu:core=v2"）
+//   --no-pin            不绑定线程到CPU
+//   --json FILE         结果文件（默认 output/bench.json）
+//   --baseline FILE     与基线比较，有回退时返回2
+//   --threshold PCT     回退阈值（默认5%）
+// histogram_bench --compare BASELINE CURRENT [--threshold PCT]  只比较两个结果文件
+//
+// 编译：gcc -O2 -pthread -Ilibhist histogram_bench.c libhist/*.c -o histogram_bench
+//   （加 -DHIST_WITH_OPENCL ... -lOpenCL 测试OpenCL，FPGA模型的编译见README）
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "hist.h"
+
+#define MAX_CASES 8
+
+typedef struct
+{
+    const char *name;
+    HistConfig config;
+    HistContext *ctx;
+    double *samples; // 每次试验的每帧时间(ms)
+} BenchCase;
+
+// 配置名是否被--backends选中（按前缀匹配，例如 "cpu" 选中 cpu-scalar/cpu-simd/cpu-mt）
+static int case_selected(const char *name, const char *backends)
+{
+    if (!backends)
+        return 1;
+    const char *p = backends;
+    while (*p)
+    {
+        size_t length = strcspn(p, ",");
+        if (length > 0 && strncmp(name, p, length) == 0)
+            return 1;
+        p += length;
+        if (*p == ',')
+            p++;
+    }
+    return 0;
+}
+
+static int compare_files(const char *baseline_file, const char *current_file, double threshold)
+{
+    HistBenchResult *baseline = NULL;
+    HistBenchResult *current = NULL;
+    int baseline_count = 0;
+    int current_count = 0;
+    if (hist_bench_read_json(baseline_file, &baseline, &baseline_count) != HIST_OK ||
+        hist_bench_read_json(current_file, &current, &current_count) != HIST_OK)
+    {
+        free(baseline);
+        return 1;
+    }
+    printf("Baseline: %s\nCurrent:  %s\nThreshold: %.1f%%\n\n", baseline_file, current_file, threshold * 100.0);
+    int regressions = hist_bench_compare(baseline, baseline_count, current, current_count, threshold, stdout);
+    printf("\n%d regression(s)\n", regressions);
+    free(baseline);
+    free(current);
+    return regressions > 0 ? 2 : 0;
+}
+
+int main(int argc, char **argv)
+{
+    int width = 1920;
+    int height = 1080;
+    int trials = 30;
+    int frames = 10;
+    int warmup = 3;
+    int threads = 0;
+    int pin = 1;
+    double threshold = 0.05;
+    const char *backends = NULL;
+    const char *fpga_device = getenv("HIST_FPGA_DEVICE") ? NULL : "emu:core=v2";
+    const char *json_file = "output/bench.json";
+    const char *baseline_file = NULL;
+    const char *compare[2] = {NULL, NULL};
+
+    int positional = 0;
+    for (int a = 1; a < argc; a++)
+    {
+        const char *value = a + 1 < argc ? argv[a + 1] : NULL;
+        if (strcmp(argv[a], "--trials") == 0 && value)
+            trials = atoi(argv[++a]);
+        else if (strcmp(argv[a], "--frames") == 0 && value)
+            frames = atoi(argv[++a]);
+        else if (strcmp(argv[a], "--warmup") == 0 && value)
+            warmup = atoi(argv[++a]);
+        else if (strcmp(argv[a], "--threads") == 0 && value)
+            threads = atoi(argv[++a]);
+        else if (strcmp(argv[a], "--backends") == 0 && value)
+            backends = argv[++a];
+        else if (strcmp(argv[a], "--fpga-device") == 0 && value)
+            fpga_device = argv[++a];
+        else if (strcmp(argv[a], "--no-pin") == 0)
+            pin = 0;
+        else if (strcmp(argv[a], "--json") == 0 && value)
+            json_file = argv[++a];
+        else if (strcmp(argv[a], "--baseline") == 0 && value)
+            baseline_file = argv[++a];
+        else if (strcmp(argv[a], "--threshold") == 0 && value)
+            threshold = atof(argv[++a]) / 100.0;
+        else if (strcmp(argv[a], "--compare") == 0 && a + 2 < argc)
+        {
+            compare[0] = argv[++a];
+            compare[1] = argv[++a];
+        }
+        else if (strncmp(argv[a], "--", 2) == 0)
+        {
+            fprintf(stderr, "Unknown option: %s\n", argv[a]);
+            fprintf(stderr, "Usage: %s [width height] [--trials N] [--frames N] [--warmup N] [--threads N] "
+                            "[--backends LIST] [--fpga-device DEV] [--no-pin] [--json FILE] [--baseline FILE] "
+                            "[--threshold PCT]\n       %s --compare BASELINE CURRENT [--threshold PCT]\n",
+                    argv[0], argv[0]);
+            return 1;
+        }
+        else if (positional == 0)
+        {
+            width = atoi(argv[a]);
+            positional++;
+        }
+        else if (positional == 1)
+        {
+            height = atoi(argv[a]);
+            positional++;
+        }
+    }
+    if (compare[0])
+    {
+        return compare_files(compare[0], compare[1], threshold);
+    }
+    if (trials <= 0 || frames <= 0 || warmup < 0)
+    {
+        fprintf(stderr, "Error: --trials and --frames must be positive\n");
+        return 1;
+    }
+
+    // 所有配置统计同一组帧：HIST_INPUT指定的文件（8位单通道），或合成的测试图像
+    HistInput *input = NULL;
+    if (hist_input_open(&input, NULL) != HIST_OK)
+    {
+        return 1;
+    }
+    if (input && (input->channels != 1 || input->pixel_bits != 8))
+    {
+        fprintf(stderr, "Error: the benchmark needs an 8-bit single-channel input\n");
+        hist_input_close(input);
+        return 1;
+    }
+    char input_description[600] = "synthetic";
+    if (input)
+    {
+        width = input->width;
+        height = input->height;
+        hist_input_describe(input, input_description, sizeof(input_description));
+    }
+    if (width <= 0 || height <= 0)
+    {
+        fprintf(stderr, "Error: invalid image size %dx%d\n", width, height);
+        hist_input_close(input);
+        return 1;
+    }
+    Image *img = input ? NULL : create_test_image(width, height);
+    int image_size = width * height;
+
+    printf("=== Histogram Benchmark ===\n");
+    printf("Image size: %dx%d (%.2f MP), input: %s\n", width, height, image_size / 1e6, input_description);
+    printf("Trials: %d x %d frames (+%d warmup), configurations interleaved\n", trials, frames, warmup);
+
+    // 调用线程绑定到CPU 0，多线程配置的worker t绑定到CPU t
+    if (pin)
+    {
+        pin = hist_pin_thread(0) == HIST_OK;
+    }
+    printf("Thread pinning: %s\n\n", pin ? "on" : "off");
+
+    BenchCase cases[MAX_CASES];
+    int num_cases = 0;
+    const char *names[] = {"cpu-scalar", "cpu-simd", "cpu-mt", "opencl", "fpga-model"};
+    for (int i = 0; i < (int)(sizeof(names) / sizeof(names[0])); i++)
+    {
+        if (!case_selected(names[i], backends))
+            continue;
+        BenchCase *c = &cases[num_cases];
+        memset(c, 0, sizeof(BenchCase));
+        c->name = names[i];
+        if (i <= 2)
+        {
+            hist_config_init(&c->config, HIST_BACKEND_CPU);
+            c->config.cpu_kernel = i == 0 ? HIST_CPU_SCALAR : HIST_CPU_SIMD;
+            c->config.num_threads = i == 2 ? threads : 1;
+            c->config.pin_threads = pin;
+        }
+        else if (i == 3)
+        {
+            hist_config_init(&c->config, HIST_BACKEND_OPENCL);
+        }
+        else
+        {
+            hist_config_init(&c->config, HIST_BACKEND_FPGA);
+            c->config.fpga_device = fpga_device;
+        }
+        int status = hist_create(&c->ctx, &c->config);
+        if (status != HIST_OK)
+        {
+            printf("%-12s skipped: %s\n", c->name, hist_strerror(status));
+            continue;
+        }
+        c->samples = (double *)malloc(trials * sizeof(double));
+        num_cases++;
+    }
+
+    // 计时之前先校验每个配置的结果
+    int ok = 1;
+    unsigned int reference[HISTOGRAM_BINS];
+    unsigned int histogram[HISTOGRAM_BINS];
+    const unsigned char *first_frame = input ? hist_input_frame(input, 0) : img->data;
+    compute_histogram_cpu(first_frame, image_size, reference);
+    for (int i = 0; i < num_cases; i++)
+    {
+        int status = hist_compute(cases[i].ctx, first_frame, image_size, histogram);
+        if (status != HIST_OK || memcmp(histogram, reference, sizeof(reference)) != 0)
+        {
+            fprintf(stderr, "Error: %s (%s) %s\n", cases[i].name, hist_describe(cases[i].ctx),
+                    status != HIST_OK ? hist_strerror(status) : "differs from the CPU reference");
+            ok = 0;
+        }
+    }
+
+    // 各配置交替进行试验，每轮换一个起始配置，系统负载、频率和温度的漂移对所有配置的影响相同
+    for (int t = -warmup; t < trials && ok && num_cases > 0; t++)
+    {
+        int round = t + warmup;
+        for (int k = 0; k < num_cases && ok; k++)
+        {
+            BenchCase *c = &cases[(round + k) % num_cases];
+            double start = get_time_ms();
+            for (int f = 0; f < frames; f++)
+            {
+                const unsigned char *frame = input ? hist_input_frame(input, round * frames + f) : img->data;
+                if (hist_compute(c->ctx, frame, image_size, histogram) != HIST_OK)
+                {
+                    fprintf(stderr, "Error: %s failed during the benchmark\n", c->name);
+                    ok = 0;
+                    break;
+                }
+            }
+            double elapsed = get_time_ms() - start;
+            if (t >= 0)
+            {
+                c->samples[t] = elapsed / frames;
+            }
+        }
+    }
+
+    HistBenchResult results[MAX_CASES];
+    int num_results = 0;
+    if (ok)
+    {
+        printf("%-12s %10s %10s %10s %23s %11s  %s\n", "Config", "Median ms", "p5 ms", "p95 ms", "95% CI (median)",
+               "MPixels/s", "Description");
+        for (int i = 0; i < num_cases; i++)
+        {
+            HistBenchResult *r = &results[num_results++];
+            memset(r, 0, sizeof(HistBenchResult));
+            snprintf(r->name, sizeof(r->name), "%s", cases[i].name);
+            snprintf(r->description, sizeof(r->description), "%s", hist_describe(cases[i].ctx));
+            r->width = width;
+            r->height = height;
+            r->frames = frames;
+            hist_bench_stats(cases[i].samples, trials, &r->stats);
+            r->throughput_mpixels = r->stats.median > 0.0 ? (image_size / 1e6) / (r->stats.median / 1000.0) : 0.0;
+            printf("%-12s %10.4f %10.4f %10.4f  [%9.4f, %9.4f] %11.2f  %s\n", r->name, r->stats.median, r->stats.p5,
+                   r->stats.p95, r->stats.ci_low, r->stats.ci_high, r->throughput_mpixels, r->description);
+        }
+
+        HistBenchMeta meta;
+        meta.input = input_description;
+        meta.cpus = get_num_cpus();
+        meta.pinned = pin;
+        meta.trials = trials;
+        meta.warmup = warmup;
+        if (hist_bench_write_json(json_file, &meta, results, num_results) == HIST_OK)
+        {
+            printf("\nResults saved to %s\n", json_file);
+        }
+    }
+
+    int exit_code = ok ? 0 : 1;
+    if (ok && baseline_file)
+    {
+        HistBenchResult *baseline = NULL;
+        int baseline_count = 0;
+        if (hist_bench_read_json(baseline_file, &baseline, &baseline_count) == HIST_OK)
+        {
+            printf("\n=== Comparison with %s (threshold %.1f%%) ===\n", baseline_file, threshold * 100.0);
+            int regressions = hist_bench_compare(baseline, baseline_count, results, num_results, threshold, stdout);
+            printf("\n%d regression(s)\n", regressions);
+            exit_code = regressions > 0 ? 2 : 0;
+            free(baseline);
+        }
+        else
+        {
+            exit_code = 1;
+        }
+    }
+
+    for (int i = 0; i < num_cases; i++)
+    {
+        hist_destroy(cases[i].ctx);
+        free(cases[i].samples);
+    }
+    free_image(img);
+    hist_input_close(input);
+    return exit_code;
+}
@@ -1,100 +1,425 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
-#include <time.h>
-#include <sys/time.h>
 
-#define HISTOGRAM_BINS 256
+#include "hist.h"
 
-typedef struct
+// 创建CPU context，失败时直接退出
+HistContext *create_cpu_context(int threads, HistCpuKernel kernel, HistSimdLevel simd_level)
 {
-    unsigned char *data;
-    int width;
-    int height;
-    int channels;
-} Image;
-
-// 生成测试图像
-Image *create_test_image(int width, int height)
+    HistConfig config;
+    hist_config_init(&config, HIST_BACKEND_CPU);
+    config.num_threads = threads;
+    config.cpu_kernel = kernel;
+    config.simd_level = simd_level;
+
+    HistContext *ctx = NULL;
+    int status = hist_create(&ctx, &config);
+    if (status != HIST_OK)
+    {
+        fprintf(stderr, "Error: cannot create CPU context: %s\n", hist_strerror(status));
+        exit(1);
+    }
+    return ctx;
+}
+
+// 线程扩展性测试：线程数按1,2,4,...翻倍直到max_threads，报告吞吐量和并行效率
+void report_thread_scaling(const unsigned char *image, int size, int max_threads, int iterations, HistSimdLevel simd_level)
 {
-    Image *img = (Image *)malloc(sizeof(Image));
-    img->width = width;
-    img->height = height;
-    img->channels = 1;
-    img->data = (unsigned char *)malloc(width * height);
+    int scaling_iterations = iterations / 10;
+    if (scaling_iterations < 1)
+        scaling_iterations = 1;
+    unsigned int histogram[HISTOGRAM_BINS];
+    double base_throughput = 0.0;
 
-    for (int i = 0; i < height; i++)
+    printf("\n=== Thread Scaling (%d iterations per point) ===\n", scaling_iterations);
+    printf("Threads  Time/iter(ms)  MPixels/s   Speedup  Efficiency\n");
+
+    for (int t = 1;; t *= 2)
     {
-        for (int j = 0; j < width; j++)
+        if (t > max_threads)
+            t = max_threads;
+
+        // 单线程点也使用SIMD kernel，与多线程时每个线程的kernel一致
+        HistContext *ctx = create_cpu_context(t, HIST_CPU_SIMD, simd_level);
+        hist_compute(ctx, image, size, histogram); // 预热
+
+        double start = get_time_ms();
+        for (int iter = 0; iter < scaling_iterations; iter++)
         {
-            // 添加一些随机性，让每张图像略有不同
-            img->data[i * width + j] = (i * 13 + j * 7) % 256;
+            hist_compute(ctx, image, size, histogram);
         }
+        double elapsed = get_time_ms() - start;
+        hist_destroy(ctx);
+
+        double throughput = ((long long)size * scaling_iterations / 1e6) / (elapsed / 1000.0);
+        if (t == 1)
+            base_throughput = throughput;
+        double speedup = throughput / base_throughput;
+        printf("%7d  %13.3f  %9.2f  %7.2fx  %9.1f%%\n",
+               t, elapsed / scaling_iterations, throughput, speedup, speedup / t * 100.0);
+
+        if (t == max_threads)
+            break;
     }
-    return img;
 }
 
-// CPU版本的直方图计算
-void compute_histogram_cpu(unsigned char *image, int size, unsigned int *histogram)
+// 数据分布对比：在uniform/gradient/constant三种图像上比较各单线程kernel
+void report_pattern_comparison(int width, int height, int iterations, HistSimdLevel simd_level)
 {
-    memset(histogram, 0, HISTOGRAM_BINS * sizeof(unsigned int));
+    int compare_iterations = iterations / 10;
+    if (compare_iterations < 1)
+        compare_iterations = 1;
+    int size = width * height;
+    unsigned int histogram[HISTOGRAM_BINS];
 
-    for (int i = 0; i < size; i++)
+    HistContext *contexts[3];
+    for (int k = HIST_CPU_SCALAR; k <= HIST_CPU_SIMD; k++)
     {
-        histogram[image[i]]++;
+        contexts[k] = create_cpu_context(1, (HistCpuKernel)k, simd_level);
+    }
+
+    printf("\n=== Kernel vs. Image Pattern (%d iterations per point) ===\n", compare_iterations);
+    printf("Pattern    Kernel        Time/iter(ms)  MPixels/s   Speedup\n");
+
+    for (int p = PATTERN_UNIFORM; p <= PATTERN_CONSTANT; p++)
+    {
+        Image *img = create_test_image_pattern(width, height, (ImagePattern)p);
+        double scalar_time = 0.0;
+
+        for (int k = HIST_CPU_SCALAR; k <= HIST_CPU_SIMD; k++)
+        {
+            hist_compute(contexts[k], img->data, size, histogram); // 预热
+
+            double start = get_time_ms();
+            for (int iter = 0; iter < compare_iterations; iter++)
+            {
+                hist_compute(contexts[k], img->data, size, histogram);
+            }
+            double elapsed = get_time_ms() - start;
+            if (k == HIST_CPU_SCALAR)
+                scalar_time = elapsed;
+
+            printf("%-9s  %-12s  %13.3f  %9.2f  %7.2fx\n",
+                   pattern_names[p], hist_describe(contexts[k]), elapsed / compare_iterations,
+                   ((long long)size * compare_iterations / 1e6) / (elapsed / 1000.0),
+                   scalar_time / elapsed);
+        }
+
+        free_image(img);
+    }
+
+    for (int k = HIST_CPU_SCALAR; k <= HIST_CPU_SIMD; k++)
+    {
+        hist_destroy(contexts[k]);
     }
 }
 
-// 保存直方图到文件
-void save_histogram_txt(unsigned int *histogram, const char *filename, double total_time, int width, int height, int iterations)
+// 硬件计数器（HIST_PERF=1时）：参考实现和各kernel变体的每像素周期数、IPC和cache/分支/store forwarding事件
+void report_hardware_counters(const unsigned char *image, int size, int threads, int iterations, HistSimdLevel simd_level)
 {
-    FILE *fp = fopen(filename, "w");
-    if (!fp)
+    int counter_iterations = iterations / 10;
+    if (counter_iterations < 1)
+        counter_iterations = 1;
+    unsigned int histogram[HISTOGRAM_BINS];
+    double pixels = (double)size * counter_iterations;
+
+    printf("\n=== Hardware Counters (perf_event_open, %d iterations per kernel) ===\n", counter_iterations);
+    HistPerf perf;
+    if (hist_perf_open(&perf) != HIST_OK)
     {
-        printf("Error: Cannot open file %s\n", filename);
+        printf("Unavailable: %s\n", perf.error);
         return;
     }
+    if (perf.error[0])
+    {
+        printf("Note: %s\n", perf.error);
+    }
+    hist_perf_close(&perf);
+    hist_perf_print_header(stdout);
 
-    fprintf(fp, "# Histogram Data (Bin, Count)\n");
-    fprintf(fp, "# Platform: CPU\n");
-    fprintf(fp, "# Image size: %dx%d\n", width, height);
-    fprintf(fp, "# Iterations: %d\n", iterations);
-    fprintf(fp, "# Total execution time: %.3f ms (%.3f seconds)\n", total_time, total_time / 1000.0);
-    for (int i = 0; i < HISTOGRAM_BINS; i++)
+    // 第0行是参考实现compute_histogram_cpu，之后是scalar/banked/simd单线程kernel，最后是多线程版本
+    int num_rows = threads > 1 ? HIST_CPU_SIMD + 3 : HIST_CPU_SIMD + 2;
+    for (int row = 0; row < num_rows; row++)
     {
-        fprintf(fp, "%d %u\n", i, histogram[i]);
+        // 先打开计数器再创建context，线程池的worker继承计数器
+        hist_perf_open(&perf);
+        HistContext *ctx = NULL;
+        if (row > HIST_CPU_SIMD + 1)
+            ctx = create_cpu_context(threads, HIST_CPU_SIMD, simd_level);
+        else if (row > 0)
+            ctx = create_cpu_context(1, (HistCpuKernel)(row - 1), simd_level);
+
+        char label[64];
+        snprintf(label, sizeof(label), "%s", ctx ? hist_describe(ctx) : "compute_histogram_cpu");
+        if (ctx)
+            hist_compute(ctx, image, size, histogram); // 预热
+        else
+            compute_histogram_cpu(image, size, histogram);
+
+        hist_perf_start(&perf);
+        for (int iter = 0; iter < counter_iterations; iter++)
+        {
+            if (ctx)
+                hist_compute(ctx, image, size, histogram);
+            else
+                compute_histogram_cpu(image, size, histogram);
+        }
+        hist_perf_stop(&perf);
+        // worker线程退出时计数才合并进来，先销毁context再读取
+        hist_destroy(ctx);
+        hist_perf_read(&perf);
+        hist_perf_print_row(&perf, label, pixels, stdout);
+        hist_perf_close(&perf);
     }
-    fclose(fp);
 }
 
-// 计时函数
-double get_time_ms()
+// 多通道图像：一次遍历统计交错的RGB/RGBA数据，对比先拆成单通道平面再逐个统计
+// source为输入文件的一帧（HIST_INPUT），NULL时使用合成的测试图像
+void report_channel_comparison(int width, int height, int channels, int threads, int iterations,
+                               HistSimdLevel simd_level, const Image *source)
 {
-    struct timeval tv;
-    gettimeofday(&tv, NULL);
-    return tv.tv_sec * 1000.0 + tv.tv_usec / 1000.0;
+    int compare_iterations = iterations / 10;
+    if (compare_iterations < 1)
+        compare_iterations = 1;
+    int num_pixels = width * height;
+    int num_bins = channels * HISTOGRAM_BINS;
+
+    HistConfig config;
+    hist_config_init(&config, HIST_BACKEND_CPU);
+    config.num_threads = threads;
+    config.cpu_kernel = HIST_CPU_SIMD;
+    config.simd_level = simd_level;
+    config.channels = channels;
+    HistContext *interleaved = NULL;
+    int status = hist_create(&interleaved, &config);
+    if (status != HIST_OK)
+    {
+        fprintf(stderr, "Error: cannot create %d-channel CPU context: %s\n", channels, hist_strerror(status));
+        exit(1);
+    }
+    HistContext *planar = create_cpu_context(threads, HIST_CPU_SIMD, simd_level);
+
+    Image *img = source ? NULL : create_test_image_channels(width, height, channels);
+    const unsigned char *data = source ? source->data : img->data;
+    unsigned char *plane = (unsigned char *)malloc((size_t)num_pixels);
+    unsigned int *reference = (unsigned int *)malloc(num_bins * sizeof(unsigned int));
+    unsigned int *histogram = (unsigned int *)malloc(num_bins * sizeof(unsigned int));
+    compute_histogram_cpu_channels(data, num_pixels, channels, reference);
+
+    printf("\n=== %d-Channel Interleaved Image (%d iterations per point) ===\n", channels, compare_iterations);
+    printf("Method                          Time/iter(ms)  MPixels/s   Speedup\n");
+
+    // 拆分通道：每个通道先复制成一个平面，再用单通道kernel统计
+    double planar_time = 0.0;
+    for (int iter = -1; iter < compare_iterations; iter++) // 第一次为预热
+    {
+        double start = get_time_ms();
+        for (int c = 0; c < channels; c++)
+        {
+            for (int p = 0; p < num_pixels; p++)
+            {
+                plane[p] = data[(size_t)p * channels + c];
+            }
+            hist_compute(planar, plane, num_pixels, histogram + c * HISTOGRAM_BINS);
+        }
+        if (iter >= 0)
+            planar_time += get_time_ms() - start;
+    }
+    int planar_correct = memcmp(histogram, reference, num_bins * sizeof(unsigned int)) == 0;
+
+    // 一次遍历：hist_compute直接处理交错数据，size是字节数
+    double one_pass_time = 0.0;
+    for (int iter = -1; iter < compare_iterations; iter++)
+    {
+        double start = get_time_ms();
+        hist_compute(interleaved, data, num_pixels * channels, histogram);
+        if (iter >= 0)
+            one_pass_time += get_time_ms() - start;
+    }
+    int one_pass_correct = memcmp(histogram, reference, num_bins * sizeof(unsigned int)) == 0;
+
+    printf("%-30s  %13.3f  %9.2f  %7.2fx%s\n", "deinterleave + per-channel",
+           planar_time / compare_iterations,
+           ((long long)num_pixels * compare_iterations / 1e6) / (planar_time / 1000.0), 1.0,
+           planar_correct ? "" : "  ✗ INCORRECT");
+    printf("%-30s  %13.3f  %9.2f  %7.2fx%s\n", hist_describe(interleaved),
+           one_pass_time / compare_iterations,
+           ((long long)num_pixels * compare_iterations / 1e6) / (one_pass_time / 1000.0),
+           planar_time / one_pass_time, one_pass_correct ? "" : "  ✗ INCORRECT");
+
+    HistRunInfo info;
+    memset(&info, 0, sizeof(info));
+    info.platform = "CPU (interleaved channels)";
+    info.width = width;
+    info.height = height;
+    info.iterations = compare_iterations;
+    info.threads = threads;
+    info.total_time_ms = one_pass_time;
+    if (save_histogram_channels_txt(histogram, channels, "output/histogram_cpu_channels.txt", &info) == 0)
+    {
+        printf("Channel histograms saved to output/histogram_cpu_channels.txt\n");
+    }
+
+    hist_destroy(interleaved);
+    hist_destroy(planar);
+    free_image(img);
+    free(plane);
+    free(reference);
+    free(histogram);
 }
 
-// 打印进度条
-void print_progress(int current, int total, double elapsed_time)
+// 高位深图像：参考循环、直接统计、cache分块（单线程）以及多线程自动选择，结果都与参考实现比对
+// source为输入文件的一帧（HIST_INPUT），NULL时使用合成的测试图像
+void report_wide_comparison(int width, int height, int pixel_bits, int bin_shift, int threads, int iterations,
+                            const Image *source)
 {
-    int barWidth = 50;
-    float progress = (float)current / total;
+    int compare_iterations = iterations / 10;
+    if (compare_iterations < 1)
+        compare_iterations = 1;
+    int num_pixels = width * height;
+    int num_bins = 1 << (pixel_bits - bin_shift);
+
+    Image *img = source ? NULL : create_test_image_u16(width, height, pixel_bits);
+    const unsigned short *pixels = (const unsigned short *)(source ? source->data : img->data);
+    unsigned int *reference = (unsigned int *)malloc(num_bins * sizeof(unsigned int));
+    unsigned int *histogram = (unsigned int *)malloc(num_bins * sizeof(unsigned int));
+    compute_histogram_cpu_u16(pixels, num_pixels, pixel_bits, bin_shift, reference);
 
-    printf("\r[");
-    int pos = barWidth * progress;
-    for (int i = 0; i < barWidth; ++i)
+    printf("\n=== %d-bit Image, %d Bins (%d iterations per point) ===\n", pixel_bits, num_bins, compare_iterations);
+    printf("Kernel                                      Time/iter(ms)  MPixels/s   Speedup\n");
+
+    // scalar = 参考循环，banked = cache分块，simd = 实测选择；最后一行是多线程
+    HistCpuKernel kernels[4] = {HIST_CPU_SCALAR, HIST_CPU_BANKED, HIST_CPU_SIMD, HIST_CPU_SIMD};
+    int num_configs = threads > 1 ? 4 : 3;
+    double scalar_time = 0.0;
+    for (int k = 0; k < num_configs; k++)
     {
-        if (i < pos)
-            printf("=");
-        else if (i == pos)
-            printf(">");
-        else
-            printf(" ");
+        HistConfig config;
+        hist_config_init(&config, HIST_BACKEND_CPU);
+        config.num_threads = k == 3 ? threads : 1;
+        config.cpu_kernel = kernels[k];
+        config.pixel_bits = pixel_bits;
+        config.bin_shift = bin_shift;
+        HistContext *ctx = NULL;
+        int status = hist_create(&ctx, &config);
+        if (status != HIST_OK)
+        {
+            fprintf(stderr, "Error: cannot create %d-bit CPU context: %s\n", pixel_bits, hist_strerror(status));
+            exit(1);
+        }
+
+        hist_compute_u16(ctx, pixels, num_pixels, histogram); // 预热
+        double start = get_time_ms();
+        for (int iter = 0; iter < compare_iterations; iter++)
+        {
+            hist_compute_u16(ctx, pixels, num_pixels, histogram);
+        }
+        double elapsed = get_time_ms() - start;
+        if (k == 0)
+            scalar_time = elapsed;
+        int correct = memcmp(histogram, reference, num_bins * sizeof(unsigned int)) == 0;
+
+        printf("%-42s  %13.3f  %9.2f  %7.2fx%s\n", hist_describe(ctx), elapsed / compare_iterations,
+               ((long long)num_pixels * compare_iterations / 1e6) / (elapsed / 1000.0), scalar_time / elapsed,
+               correct ? "" : "  ✗ INCORRECT");
+        hist_destroy(ctx);
+    }
+
+    HistRunInfo info;
+    memset(&info, 0, sizeof(info));
+    info.platform = "CPU (high bit depth)";
+    info.width = width;
+    info.height = height;
+    info.iterations = compare_iterations;
+    info.threads = threads;
+    if (save_histogram_bins_txt(histogram, num_bins, 1, "output/histogram_cpu_wide.txt", &info) == 0)
+    {
+        printf("%d-bin histogram saved to output/histogram_cpu_wide.txt\n", num_bins);
     }
-    printf("] %d/%d (%.1f%%) - %.2fs elapsed",
-           current, total, progress * 100.0, elapsed_time / 1000.0);
-    fflush(stdout);
+
+    free_image(img);
+    free(reference);
+    free(histogram);
+}
+
+// 分块直方图：8×8/16×16块、256/16个bin，比较逐块复制crop再调用compute_histogram_cpu（参考）和一次遍历的
+// hist_compute_tiled（单线程和多线程），块直方图与参考比对，顺带的整帧直方图与hist_compute比对。
+// 参考方法很慢，迭代次数是其他对比的1/100
+void report_tile_comparison(const unsigned char *image, int width, int height, int threads, int iterations)
+{
+    int compare_iterations = iterations / 100;
+    if (compare_iterations < 1)
+        compare_iterations = 1;
+    int tile_sizes[2] = {8, 16};
+    int bin_shifts[2] = {0, 4};
+    int num_tiles = hist_num_tiles(width, height, 8, 8);
+    unsigned int *reference = (unsigned int *)malloc((size_t)num_tiles * HISTOGRAM_BINS * sizeof(unsigned int));
+    unsigned int *tiles = (unsigned int *)malloc((size_t)num_tiles * HISTOGRAM_BINS * sizeof(unsigned int));
+    unsigned int frame_reference[HISTOGRAM_BINS];
+    unsigned int frame[HISTOGRAM_BINS];
+
+    printf("\n=== Tiled Histograms (%d iterations per point) ===\n", compare_iterations);
+    printf("Tile   Bins  Method                         Time/iter(ms)  MPixels/s   Speedup\n");
+
+    for (int s = 0; s < 2; s++)
+    {
+        for (int b = 0; b < 2; b++)
+        {
+            int tile = tile_sizes[s];
+            int num_bins = HISTOGRAM_BINS >> bin_shifts[b];
+            size_t tile_bins = (size_t)hist_num_tiles(width, height, tile, tile) * num_bins;
+
+            double start = get_time_ms();
+            for (int iter = 0; iter < compare_iterations; iter++)
+            {
+                compute_histogram_cpu_tiles(image, width, height, width, tile, tile, bin_shifts[b], reference);
+            }
+            double crop_time = get_time_ms() - start;
+            printf("%2dx%-2d  %4d  %-29s  %13.3f  %9.2f  %7.2fx\n", tile, tile, num_bins, "per-tile crops",
+                   crop_time / compare_iterations,
+                   ((long long)width * height * compare_iterations / 1e6) / (crop_time / 1000.0), 1.0);
+
+            int num_configs = threads > 1 ? 2 : 1;
+            for (int k = 0; k < num_configs; k++)
+            {
+                HistConfig config;
+                hist_config_init(&config, HIST_BACKEND_CPU);
+                config.num_threads = k == 0 ? 1 : threads;
+                config.bin_shift = bin_shifts[b];
+                HistContext *ctx = NULL;
+                int status = hist_create(&ctx, &config);
+                if (status != HIST_OK)
+                {
+                    fprintf(stderr, "Error: cannot create CPU context: %s\n", hist_strerror(status));
+                    exit(1);
+                }
+                hist_compute(ctx, image, width * height, frame_reference);
+
+                hist_compute_tiled(ctx, image, width, height, 0, tile, tile, tiles, frame); // 预热
+                start = get_time_ms();
+                for (int iter = 0; iter < compare_iterations; iter++)
+                {
+                    hist_compute_tiled(ctx, image, width, height, 0, tile, tile, tiles, frame);
+                }
+                double elapsed = get_time_ms() - start;
+                int correct = memcmp(tiles, reference, tile_bins * sizeof(unsigned int)) == 0 &&
+                              memcmp(frame, frame_reference, num_bins * sizeof(unsigned int)) == 0;
+
+                char label[64];
+                snprintf(label, sizeof(label), "one pass + frame, %d thread%s", config.num_threads,
+                         config.num_threads > 1 ? "s" : "");
+                printf("%2dx%-2d  %4d  %-29s  %13.3f  %9.2f  %7.2fx%s\n", tile, tile, num_bins, label,
+                       elapsed / compare_iterations,
+                       ((long long)width * height * compare_iterations / 1e6) / (elapsed / 1000.0),
+                       crop_time / elapsed, correct ? "" : "  ✗ INCORRECT");
+                hist_destroy(ctx);
+            }
+        }
+    }
+
+    free(reference);
+    free(tiles);
 }
 
 int main(int argc, char **argv)
@@ -102,6 +427,12 @@ int main(int argc, char **argv)
     int width = 3840;      // 4K width
     int height = 2160;     // 4K height
     int iterations = 1000; // 默认1000次迭代
+    int threads = 1;       // 1 = 原单线程版本，0 = 使用全部CPU核
+    HistCpuKernel kernel = HIST_CPU_SCALAR;
+    HistSimdLevel simd_level = HIST_SIMD_AUTO;
+    int channels = 1; // 3 = 交错RGB，4 = RGBA，大于1时额外测试多通道直方图
+    int pixel_bits = 8; // 10/12/16时额外测试高位深图像
+    int bin_shift = 0;  // 高位深图像重新分bin：bin = 像素 >> bin_shift
 
     // 可以通过命令行调整
     if (argc >= 3)
@@ -113,19 +444,114 @@ int main(int argc, char **argv)
     {
         iterations = atoi(argv[3]);
     }
+    if (argc >= 5)
+    {
+        threads = atoi(argv[4]);
+    }
+    if (argc >= 6)
+    {
+        for (int k = HIST_CPU_SCALAR; k <= HIST_CPU_SIMD; k++)
+        {
+            if (strcmp(argv[5], hist_cpu_kernel_names[k]) == 0)
+                kernel = (HistCpuKernel)k;
+        }
+        // 也可以直接指定SIMD级别，例如 avx2 / avx512 / neon
+        for (int l = HIST_SIMD_NEON; l <= HIST_SIMD_AVX512; l++)
+        {
+            if (strcmp(argv[5], hist_simd_level_names[l]) == 0)
+            {
+                kernel = HIST_CPU_SIMD;
+                simd_level = (HistSimdLevel)l;
+            }
+        }
+    }
+    if (argc >= 7)
+    {
+        channels = atoi(argv[6]);
+        if (channels < 1 || channels > HIST_MAX_CHANNELS)
+        {
+            fprintf(stderr, "Error: channels must be 1..%d\n", HIST_MAX_CHANNELS);
+            return 1;
+        }
+    }
+    if (argc >= 8)
+    {
+        pixel_bits = atoi(argv[7]);
+        if (argc >= 9)
+            bin_shift = atoi(argv[8]);
+        if ((pixel_bits != 8 && pixel_bits != 10 && pixel_bits != 12 && pixel_bits != 16) ||
+            bin_shift < 0 || bin_shift >= pixel_bits)
+        {
+            fprintf(stderr, "Error: pixel bits must be 8/10/12/16 and bin shift 0..bits-1\n");
+            return 1;
+        }
+    }
+    if (threads <= 0)
+    {
+        threads = get_num_cpus();
+    }
+
+    // HIST_INPUT指定了图像文件时用文件中的真实帧代替合成的测试图像，图像大小取自文件：
+    // 8位单通道（灰度PGM、Y4M/I420的亮度平面）用于主测试，多帧文件每次迭代换一帧；
+    // 多通道或高位深的文件用于对应的多通道/高位深对比（主测试仍使用合成图像）
+    HistInput *input = NULL;
+    if (hist_input_open(&input, NULL) != HIST_OK)
+    {
+        return 1;
+    }
+    Image input_frame;
+    int input_main = 0;
+    if (input)
+    {
+        width = input->width;
+        height = input->height;
+        input_frame = hist_input_image(input, 0);
+        input_main = input->channels == 1 && input->pixel_bits == 8;
+        if (input->channels > 1)
+            channels = input->channels;
+        if (input->pixel_bits > 8)
+        {
+            pixel_bits = input->pixel_bits;
+            if (bin_shift >= pixel_bits)
+                bin_shift = 0;
+        }
+    }
+
+    // HIST_SINK=frames.hbin[:lz4][:u64] 时把每次迭代的直方图追加到二进制文件（用histogram_dump转换回文本）
+    HistSink *sink = NULL;
+    if (hist_sink_open_spec(&sink, NULL, HISTOGRAM_BINS, 1, width, height) != HIST_OK)
+    {
+        hist_input_close(input);
+        return 1;
+    }
+
+    HistContext *ctx = create_cpu_context(threads, kernel, simd_level);
 
     printf("=== CPU Histogram Computation (Long Run) ===\n");
     printf("Image size: %dx%d (%.2f MP)\n", width, height, (width * height) / 1e6);
+    if (input)
+    {
+        char description[600];
+        hist_input_describe(input, description, sizeof(description));
+        printf("Input: %s%s\n", description, input_main ? "" : ", main benchmark uses the synthetic image");
+    }
     printf("Iterations: %d\n", iterations);
+    printf("Threads: %d%s\n", threads, threads == 1 ? " (single-thread)" : "");
+    printf("Kernel: %s\n", hist_describe(ctx));
 
     long long total_pixels = (long long)width * height;
     double total_data = (total_pixels * iterations) / (1024.0 * 1024.0 * 1024.0);
     printf("Total data to process: %.2f GB\n", total_data);
     printf("\n");
 
-    // 创建测试图像
-    printf("Generating test image...\n");
-    Image *img = create_test_image(width, height);
+    // 创建测试图像（输入文件的帧直接使用映射的文件内容）
+    Image *img = NULL;
+    if (!input_main)
+    {
+        printf("Generating test image...\n");
+        img = create_test_image(width, height);
+    }
+    const unsigned char *image = input_main ? input_frame.data : img->data;
     int image_size = width * height;
 
     // 分配直方图内存
@@ -133,16 +559,27 @@ int main(int argc, char **argv)
 
     // 预热
     printf("Warming up...\n");
-    compute_histogram_cpu(img->data, image_size, histogram);
+    hist_compute(ctx, image, image_size, histogram);
     printf("Starting benchmark...\n\n");
 
     // 主循环 - 运行多次
     double start_time = get_time_ms();
     double last_update = start_time;
+    double sink_time = 0.0;
 
     for (int iter = 0; iter < iterations; iter++)
     {
-        compute_histogram_cpu(img->data, image_size, histogram);
+        hist_compute(ctx, input_main ? hist_input_frame(input, iter) : image, image_size, histogram);
+        if (sink)
+        {
+            double sink_start = get_time_ms();
+            if (hist_sink_write(sink, (unsigned long long)iter, 0, histogram) != HIST_OK)
+            {
+                hist_sink_close(sink);
+                sink = NULL;
+            }
+            sink_time += get_time_ms() - sink_start;
+        }
 
         // 每100ms更新一次进度
         double current_time = get_time_ms();
@@ -168,9 +605,29 @@ int main(int argc, char **argv)
     printf("Throughput: %.2f MPixels/s\n", throughput_mpixels);
     printf("Data processed: %.2f GB in %.2f seconds\n", total_data, total_time / 1000.0);
     printf("Bandwidth: %.2f GB/s\n", total_data / (total_time / 1000.0));
+    if (sink)
+    {
+        double close_start = get_time_ms();
+        hist_sink_flush(sink);
+        sink_time += get_time_ms() - close_start;
+        char description[700];
+        hist_sink_describe(sink, description, sizeof(description));
+        printf("Sink: %s\n", description);
+        printf("Sink time: %.3f ms (%.1f%% of the run, included above)\n", sink_time,
+               100.0 * sink_time / total_time);
+        hist_sink_close(sink);
+    }
 
     // 保存最后一次结果
-    save_histogram_txt(histogram, "output/histogram_cpu.txt", total_time, width, height, iterations);
+    HistRunInfo info;
+    memset(&info, 0, sizeof(info));
+    info.platform = "CPU";
+    info.width = width;
+    info.height = height;
+    info.iterations = iterations;
+    info.threads = threads;
+    info.total_time_ms = total_time;
+    save_histogram_txt(histogram, "output/histogram_cpu.txt", &info);
     printf("\nHistogram saved to output/histogram_cpu.txt\n");
     printf("Total execution time: %.3f ms (%.3f seconds)\n", total_time, total_time / 1000.0);
 
@@ -188,14 +645,45 @@ int main(int argc, char **argv)
         sum += histogram[i];
     }
     printf("\nVerification: Total pixel count = %llu (expected: %d)\n", sum, image_size);
-    if (sum == image_size)
+    if (sum == (unsigned long long)image_size)
     {
         printf("✓ Result is CORRECT!\n");
     }
 
+    // 多线程时报告线程数扩展性
+    if (threads > 1)
+    {
+        report_thread_scaling(image, image_size, threads, iterations, simd_level);
+    }
+
+    // 附加对比默认不运行（HIST_COMPARE=patterns,tiles 或 all）
+    if (hist_compare_requested("patterns"))
+    {
+        report_pattern_comparison(width, height, iterations, simd_level);
+    }
+    if (hist_compare_requested("tiles"))
+    {
+        report_tile_comparison(image, width, height, threads, iterations);
+    }
+    if (hist_perf_requested())
+    {
+        report_hardware_counters(image, image_size, threads, iterations, simd_level);
+    }
+    if (channels > 1)
+    {
+        report_channel_comparison(width, height, channels, threads, iterations, simd_level,
+                                  input && input->channels > 1 ? &input_frame : NULL);
+    }
+    if (pixel_bits > 8)
+    {
+        report_wide_comparison(width, height, pixel_bits, bin_shift, threads, iterations,
+                               input && input->pixel_bits > 8 ? &input_frame : NULL);
+    }
+
     // 清理
-    free(img->data);
-    free(img);
+    hist_destroy(ctx);
+    free_image(img);
+    hist_input_close(input);
     free(histogram);
 
     printf("\n=== Summary ===\n");
@@ -205,4 +693,4 @@ int main(int argc, char **argv)
     printf("  Expected GPU time: %.2f seconds\n", total_time / 1000.0 / 100.0);
 
     return 0;
-}
\ No newline at end of file
+}
@@ -0,0 +1,162 @@
+// histogram_dump.c
+// 读取直方图二进制输出文件（HIST_SINK，格式见 libhist/hist.h），列出其中的帧，
+// 或者把帧转换回save_histogram_txt的文本格式，和其他程序的输出文件直接比较
+//
+// 用法：histogram_dump FILE                      打印文件头和每帧的帧号、时间戳、像素总数
+//       histogram_dump FILE --frame N [-o OUT]   第N条记录（从0数）转成文本（默认 output/histogram_frame_N.txt）
+//       histogram_dump FILE --all DIR            每条记录一个文本文件 DIR/frame_<帧号>.txt
+//
+// 编译：gcc -O2 -pthread -Ilibhist histogram_dump.c libhist/*.c -o histogram_dump
+//   （LZ4压缩的文件需要加 -DHIST_WITH_LZ4 -llz4）
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "hist.h"
+
+// 文本格式是u32，超出范围的bin（u64文件中的累计直方图）无法转换
+static int save_frame_txt(const unsigned long long *bins, unsigned int *counts, const HistSinkConfig *header,
+                          const char *file, unsigned long long frame_id, const char *filename)
+{
+    int count = header->num_bins * header->channels;
+    for (int i = 0; i < count; i++)
+    {
+        if (bins[i] > 0xFFFFFFFFULL)
+        {
+            fprintf(stderr, "Error: bin %d of frame %llu does not fit in the text format\n", i, frame_id);
+            return -1;
+        }
+        counts[i] = (unsigned int)bins[i];
+    }
+
+    char platform[600];
+    snprintf(platform, sizeof(platform), "%s, frame %llu", file, frame_id);
+    HistRunInfo info;
+    memset(&info, 0, sizeof(info));
+    info.platform = platform;
+    info.width = header->width;
+    info.height = header->height;
+    return save_histogram_bins_txt(counts, header->num_bins, header->channels, filename, &info);
+}
+
+int main(int argc, char **argv)
+{
+    const char *file = NULL;
+    const char *output = NULL;
+    const char *all_dir = NULL;
+    long long frame_index = -1;
+
+    for (int a = 1; a < argc; a++)
+    {
+        int value = a + 1 < argc;
+        if (strcmp(argv[a], "--frame") == 0 && value)
+            frame_index = atoll(argv[++a]);
+        else if (strcmp(argv[a], "-o") == 0 && value)
+            output = argv[++a];
+        else if (strcmp(argv[a], "--all") == 0 && value)
+            all_dir = argv[++a];
+        else if (argv[a][0] != '-' && !file)
+            file = argv[a];
+        else
+        {
+            file = NULL;
+            break;
+        }
+    }
+    if (!file)
+    {
+        fprintf(stderr, "Usage: %s FILE [--frame N [-o OUT] | --all DIR]\n", argv[0]);
+        return 1;
+    }
+
+    HistSinkReader *reader = NULL;
+    HistSinkConfig header;
+    if (hist_sink_reader_open(&reader, file, &header) != HIST_OK)
+    {
+        return 1;
+    }
+    int count = header.num_bins * header.channels;
+    unsigned long long *bins = (unsigned long long *)malloc(count * sizeof(unsigned long long));
+    unsigned int *counts = (unsigned int *)malloc(count * sizeof(unsigned int));
+
+    int listing = frame_index < 0 && !all_dir;
+    if (listing)
+    {
+        printf("File: %s\n", file);
+        printf("Histogram: %d bins x%d channels, u%d\n", header.num_bins, header.channels, header.bin_bytes * 8);
+        if (header.width > 0 && header.height > 0)
+            printf("Image size: %dx%d\n", header.width, header.height);
+        printf("\n%8s %12s %22s %16s\n", "Record", "Frame", "Timestamp (ns)", "Pixels");
+    }
+
+    unsigned long long frame_id, timestamp, first_timestamp = 0, last_timestamp = 0;
+    long long records = 0;
+    int status, failed = 0, found = 0;
+    while ((status = hist_sink_reader_next(reader, &frame_id, &timestamp, bins)) == 1)
+    {
+        if (records == 0)
+            first_timestamp = timestamp;
+        last_timestamp = timestamp;
+
+        if (listing)
+        {
+            unsigned long long pixels = 0;
+            for (int i = 0; i < count; i++)
+            {
+                pixels += bins[i];
+            }
+            printf("%8lld %12llu %22llu %16llu\n", records, frame_id, timestamp, pixels);
+        }
+        else if (all_dir)
+        {
+            char filename[1024];
+            snprintf(filename, sizeof(filename), "%s/frame_%llu.txt", all_dir, frame_id);
+            if (save_frame_txt(bins, counts, &header, file, frame_id, filename) != 0)
+            {
+                failed = 1;
+                break;
+            }
+        }
+        else if (records == frame_index)
+        {
+            char filename[1024];
+            if (output)
+                snprintf(filename, sizeof(filename), "%s", output);
+            else
+                snprintf(filename, sizeof(filename), "output/histogram_frame_%lld.txt", frame_index);
+            failed = save_frame_txt(bins, counts, &header, file, frame_id, filename) != 0;
+            if (!failed)
+                printf("Frame %llu saved to %s\n", frame_id, filename);
+            found = 1;
+            break;
+        }
+        records++;
+    }
+    // 末尾不完整的记录（写入时程序被中断）已经报告过，之前的帧仍然有效
+    if (status < 0 && records == 0)
+        failed = 1;
+
+    if (listing)
+    {
+        printf("\nRecords: %lld\n", records);
+        if (records > 1 && last_timestamp > first_timestamp)
+        {
+            double span = (last_timestamp - first_timestamp) / 1e9;
+            printf("Time span: %.3f s (%.1f frames/s)\n", span, (records - 1) / span);
+        }
+    }
+    else if (all_dir && !failed)
+    {
+        printf("%lld frames saved to %s\n", records, all_dir);
+    }
+    else if (frame_index >= 0 && !found && !failed)
+    {
+        fprintf(stderr, "Error: %s has only %lld records\n", file, records);
+        failed = 1;
+    }
+
+    hist_sink_reader_close(reader);
+    free(bins);
+    free(counts);
+    return failed ? 1 : 0;
+}
@@ -1,125 +1,168 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
-#include <time.h>
-#include <sys/time.h>
-
-#define HISTOGRAM_BINS 256
-
-// 简化版图像加载（可以替换为stb_image）
-typedef struct {
-    unsigned char *data;
-    int width;
-    int height;
-    int channels;
-} Image;
-
-// 生成测试图像
-Image* create_test_image(int width, int height) {
-    Image *img = (Image*)malloc(sizeof(Image));
-    img->width = width;
-    img->height = height;
-    img->channels = 1; // 灰度图
-    img->data = (unsigned char*)malloc(width * height);
-    
-    // 生成渐变图案用于测试
-    for (int i = 0; i < height; i++) {
-        for (int j = 0; j < width; j++) {
-            img->data[i * width + j] = (i + j) % 256;
-        }
+
+#include "hist.h"
+
+// 创建单线程CPU context，失败时直接退出
+static HistContext* create_ps_context(HistCpuKernel kernel) {
+    HistConfig config;
+    hist_config_init(&config, HIST_BACKEND_CPU);
+    config.num_threads = 1;
+    config.cpu_kernel = kernel;
+
+    HistContext *ctx = NULL;
+    int status = hist_create(&ctx, &config);
+    if (status != HIST_OK) {
+        fprintf(stderr, "Error: cannot create CPU context: %s\n", hist_strerror(status));
+        exit(1);
     }
-    return img;
+    return ctx;
 }
 
-// CPU版本的直方图计算（ARM Cortex-A53优化）
-void compute_histogram_cpu(unsigned char *image, int size, unsigned int *histogram) {
-    // 初始化直方图
-    memset(histogram, 0, HISTOGRAM_BINS * sizeof(unsigned int));
-    
-    // 统计每个像素值
-    // 使用简单的循环，ARM编译器会自动优化
-    for (int i = 0; i < size; i++) {
-        histogram[image[i]]++;
+// 多次运行取平均，返回单次平均时间(ms)；input非NULL时每次迭代换输入文件的下一帧
+static double time_context(HistContext *ctx, const HistInput *input, const unsigned char *image, int size,
+                           unsigned int *histogram, int iterations) {
+    // 预热
+    hist_compute(ctx, image, size, histogram);
+
+    double total_time = 0.0;
+    for (int iter = 0; iter < iterations; iter++) {
+        const unsigned char *frame = input ? hist_input_frame(input, iter) : image;
+        double start = get_time_ms();
+        hist_compute(ctx, frame, size, histogram);
+        double end = get_time_ms();
+        total_time += (end - start);
     }
+    return total_time / iterations;
 }
 
-// 保存直方图到文件
-void save_histogram_txt(unsigned int *histogram, const char *filename) {
-    FILE *fp = fopen(filename, "w");
-    if (!fp) {
-        printf("Error: Cannot open file %s\n", filename);
+// 硬件计数器（HIST_PERF=1时）：A53上解释标量循环和NEON kernel的每像素周期数、IPC和cache miss
+static void report_hardware_counters(const unsigned char *image, int size, int iterations) {
+    unsigned int histogram[HISTOGRAM_BINS];
+    HistPerf perf;
+
+    printf("\n=== Hardware Counters (perf_event_open, %d iterations per kernel) ===\n", iterations);
+    if (hist_perf_open(&perf) != HIST_OK) {
+        printf("Unavailable: %s\n", perf.error);
         return;
     }
-    
-    fprintf(fp, "# Histogram Data (Bin, Count)\n");
-    fprintf(fp, "# Platform: Kria (Zynq Ultrascale+) PS - ARM Cortex-A53\n");
-    for (int i = 0; i < HISTOGRAM_BINS; i++) {
-        fprintf(fp, "%d %u\n", i, histogram[i]);
+    if (perf.error[0]) {
+        printf("Note: %s\n", perf.error);
     }
-    fclose(fp);
-    printf("Histogram saved to %s\n", filename);
-}
+    hist_perf_close(&perf);
+    hist_perf_print_header(stdout);
+
+    // 第0行是参考实现，之后是标量和运行时选择的向量化kernel
+    for (int row = 0; row < 3; row++) {
+        hist_perf_open(&perf);
+        HistContext *ctx = row == 0 ? NULL : create_ps_context(row == 1 ? HIST_CPU_SCALAR : HIST_CPU_SIMD);
+        char label[64];
+        snprintf(label, sizeof(label), "%s", ctx ? hist_describe(ctx) : "compute_histogram_cpu");
 
-// 计时函数（Linux/ARM平台）
-double get_time_ms() {
-    struct timeval tv;
-    gettimeofday(&tv, NULL);
-    return tv.tv_sec * 1000.0 + tv.tv_usec / 1000.0;
+        hist_perf_start(&perf);
+        for (int iter = 0; iter < iterations; iter++) {
+            if (ctx) {
+                hist_compute(ctx, image, size, histogram);
+            } else {
+                compute_histogram_cpu(image, size, histogram);
+            }
+        }
+        hist_perf_stop(&perf);
+        hist_destroy(ctx);
+        hist_perf_read(&perf);
+        hist_perf_print_row(&perf, label, (double)size * iterations, stdout);
+        hist_perf_close(&perf);
+    }
 }
 
 int main(int argc, char **argv) {
     int width = 1920;
     int height = 1080;
-    
+
     if (argc >= 3) {
         width = atoi(argv[1]);
         height = atoi(argv[2]);
     }
-    
+
+    // HIST_INPUT指定了8位单通道图像文件（灰度PGM、Y4M/I420的亮度平面）时用文件中的帧代替测试图像
+    HistInput *input = NULL;
+    if (hist_input_open(&input, NULL) != HIST_OK) {
+        return 1;
+    }
+    if (input && (input->channels != 1 || input->pixel_bits != 8)) {
+        fprintf(stderr, "Error: the PS benchmark needs an 8-bit single-channel input\n");
+        hist_input_close(input);
+        return 1;
+    }
+    if (input) {
+        width = input->width;
+        height = input->height;
+    }
+
     printf("=== Kria PS (Cortex-A53) CPU Histogram Computation ===\n");
     printf("Platform: ARM Cortex-A53 (Zynq Ultrascale+)\n");
     printf("Image size: %dx%d\n", width, height);
-    
-    // 创建测试图像
-    Image *img = create_test_image(width, height);
+    if (input) {
+        char description[600];
+        hist_input_describe(input, description, sizeof(description));
+        printf("Input: %s\n", description);
+    }
+
+    // 创建测试图像（输入文件的帧直接使用映射的文件内容）
+    Image *img = input ? NULL : create_test_image(width, height);
+    const unsigned char *image = input ? hist_input_frame(input, 0) : img->data;
     int image_size = width * height;
-    
+
     // 分配直方图内存
     unsigned int *histogram = (unsigned int*)malloc(HISTOGRAM_BINS * sizeof(unsigned int));
-    
-    // 预热
-    compute_histogram_cpu(img->data, image_size, histogram);
-    
+    unsigned int *simd_histogram = (unsigned int*)malloc(HISTOGRAM_BINS * sizeof(unsigned int));
+
     // 多次运行取平均
     int iterations = 10;
-    double total_time = 0.0;
-    
-    for (int iter = 0; iter < iterations; iter++) {
-        double start = get_time_ms();
-        compute_histogram_cpu(img->data, image_size, histogram);
-        double end = get_time_ms();
-        total_time += (end - start);
-    }
-    
-    double avg_time = total_time / iterations;
+
+    // 标量版本（ARM编译器自动优化的简单循环）
+    HistContext *scalar_ctx = create_ps_context(HIST_CPU_SCALAR);
+    double avg_time = time_context(scalar_ctx, input, image, image_size, histogram, iterations);
     printf("Average execution time: %.3f ms\n", avg_time);
     printf("Throughput: %.2f MPixels/s\n", (image_size / 1e6) / (avg_time / 1000.0));
-    
+
+    // 运行时选择的向量化kernel（A53上通常是NEON）
+    HistContext *simd_ctx = create_ps_context(HIST_CPU_SIMD);
+    double simd_avg_time = time_context(simd_ctx, input, image, image_size, simd_histogram, iterations);
+    printf("\nDispatched kernel: %s\n", hist_describe(simd_ctx));
+    printf("Average execution time: %.3f ms\n", simd_avg_time);
+    printf("Throughput: %.2f MPixels/s\n", (image_size / 1e6) / (simd_avg_time / 1000.0));
+    printf("Speedup vs. scalar: %.2fx\n", avg_time / simd_avg_time);
+    if (memcmp(histogram, simd_histogram, HISTOGRAM_BINS * sizeof(unsigned int)) != 0) {
+        printf("Warning: dispatched kernel result differs from scalar result!\n");
+    }
+
+    if (hist_perf_requested()) {
+        report_hardware_counters(image, image_size, iterations);
+    }
+
     // 保存结果
-    save_histogram_txt(histogram, "histogram_kria_ps.txt");
-    
+    HistRunInfo info;
+    memset(&info, 0, sizeof(info));
+    info.platform = "Kria (Zynq Ultrascale+) PS - ARM Cortex-A53";
+    if (save_histogram_txt(histogram, "histogram_kria_ps.txt", &info) == 0) {
+        printf("Histogram saved to %s\n", "histogram_kria_ps.txt");
+    }
+
     // 打印部分统计信息
     printf("\nSample histogram values:\n");
     for (int i = 0; i < 10; i++) {
         printf("Bin %d: %u\n", i, histogram[i]);
     }
-    
+
     // 清理
-    free(img->data);
-    free(img);
+    hist_destroy(scalar_ctx);
+    hist_destroy(simd_ctx);
+    free_image(img);
+    hist_input_close(input);
     free(histogram);
-    
+    free(simd_histogram);
+
     return 0;
 }
-
-
@@ -0,0 +1,300 @@
+// histogram_core_model.h
+// 直方图核心（histogram_hls.h 中的 histogram_core）的软件模型，不需要Xilinx的头文件
+// 像素位宽、bin数、流宽度和通道数是运行时参数，可以在不综合的情况下估算新配置的吞吐
+//
+// 功能上与硬件逐位相同：
+//   - 每拍 STREAM_BITS / LANE_BITS 个lane，每个lane一个独立的32位累加器，输出时各lane的累加器相加（32位回绕）
+//   - TKEEP为0的lane（按lane第一个字节的keep位）不统计；pixel_count为0时以TLAST结束一帧，
+//     否则每帧正好 ceil(pixel_count * CHANNELS / lanes) 拍，忽略TLAST，超出的lane不统计
+//   - 多通道时lane所属的通道固定（lane数是通道数的倍数）或逐拍轮换，按通道、bin顺序输出 CHANNELS * BINS 个计数
+//   - ping-pong累加器：上一帧输出期间统计下一帧；统计组中的帧已经结束而输出组还没有输出完时不接收输入
+// 周期上近似：PROCESS_LOOP是II=1的流水线，每次迭代一个周期，模型按迭代计数，另外统计
+//   输入停顿（阻塞读没有数据）、输出停顿（输出流被反压）和每次函数启动的流水线填充开销（call_overhead，
+//   默认值是估计值，可以用co-sim的latency校准）
+//
+// 两种用法：
+//   push_beat / pop_output：只关心功能（主机驱动的模拟平台 histogram_fpga_host.cpp）
+//   step：逐周期模拟，由调用者决定每个周期输入是否有数据、输出是否就绪（histogram_model_test.cpp）
+#ifndef HISTOGRAM_CORE_MODEL_H
+#define HISTOGRAM_CORE_MODEL_H
+
+#include <stdint.h>
+#include <string.h>
+#include <vector>
+
+// 核心配置，与 histogram_core 的模板参数对应
+struct HistCoreParams {
+    int pixel_bits;     // 8/10/12/16
+    int bins;           // 2的幂，不超过 2^pixel_bits
+    int stream_bits;    // 32/64/128/256/512
+    int channels;       // 1..4
+    int call_overhead;  // 每次函数启动（PROCESS_LOOP开始前）的周期数
+
+    explicit HistCoreParams(int pixel_bits_ = 8, int bins_ = 256, int stream_bits_ = 32, int channels_ = 1)
+        : pixel_bits(pixel_bits_), bins(bins_), stream_bits(stream_bits_), channels(channels_), call_overhead(8) {}
+
+    int lane_bytes() const { return pixel_bits <= 8 ? 1 : 2; }
+    int beat_bytes() const { return stream_bits / 8; }
+    int lanes() const { return stream_bits / (8 * lane_bytes()); }
+    int bin_bits() const {
+        int b = 0;
+        while ((1 << b) < bins) {
+            b++;
+        }
+        return b;
+    }
+    int bin_shift() const { return pixel_bits - bin_bits(); }
+    bool fixed_lane_channels() const { return lanes() % channels == 0; }
+    int acc_depth() const { return fixed_lane_channels() ? bins : channels * bins; }
+    int output_words() const { return channels * bins; }
+
+    bool valid() const {
+        return (pixel_bits == 8 || pixel_bits == 10 || pixel_bits == 12 || pixel_bits == 16) &&
+               (stream_bits == 32 || stream_bits == 64 || stream_bits == 128 || stream_bits == 256 ||
+                stream_bits == 512) &&
+               bins >= 1 && (bins & (bins - 1)) == 0 && bin_shift() >= 0 && channels >= 1 && channels <= 4;
+    }
+};
+
+// 周期统计
+struct HistCoreCycles {
+    unsigned long long cycles;              // 总周期数（包括停顿和函数启动开销）
+    unsigned long long beats;               // 接收的输入拍数
+    unsigned long long drain_cycles;        // 输出直方图的周期（与接收重叠的也计入）
+    unsigned long long input_stall_cycles;  // 阻塞读等待输入
+    unsigned long long output_stall_cycles; // 输出流反压
+    unsigned long long input_blocked_cycles; // 输入有数据但核心不接收（统计组满，等输出组输出完）
+    unsigned long long idle_cycles;         // 函数已返回，输入没有数据
+    unsigned long long calls;               // 函数启动次数
+    unsigned long long frames;
+};
+
+// 逐周期模拟时输入流上的一拍
+struct HistBeat {
+    const unsigned char *data; // beat_bytes个字节，lane a从第 a * lane_bytes 个字节开始（小端）
+    uint64_t keep;             // 每字节一位
+    bool last;
+};
+
+class HistCoreModel {
+public:
+    explicit HistCoreModel(const HistCoreParams &params = HistCoreParams(), unsigned int pixel_count = 0)
+        : params_(params),
+          lanes_(params.lanes()),
+          lane_bytes_(params.lane_bytes()),
+          bin_shift_(params.bin_shift()),
+          bin_bits_(params.bin_bits()),
+          acc_depth_(params.acc_depth()),
+          bank_((size_t)2 * params.lanes() * params.acc_depth()) {
+        reset(pixel_count);
+    }
+
+    const HistCoreParams &params() const { return params_; }
+
+    // 上电/重新启动：两组累加器清零，pixel_count为0时以TLAST分帧，周期统计清零
+    void reset(unsigned int pixel_count) {
+        memset(&bank_[0], 0, bank_.size() * sizeof(uint32_t));
+        sample_count_ = pixel_count * (unsigned int)params_.channels;
+        acc_bank_ = 0;
+        draining_ = false;
+        drain_word_ = 0;
+        frame_full_ = false;
+        in_frame_ = false;
+        running_ = false;
+        beat_base_ = 0;
+        channel_phase_ = 0;
+        frame_samples_ = 0;
+        pixels_counted_ = 0;
+        memset(&cycles_, 0, sizeof(cycles_));
+    }
+
+    // ----- 功能接口 -----
+
+    // 输入的TREADY
+    bool ready() const { return !frame_full_; }
+
+    // 送入一拍，调用前ready()必须为true
+    void push_beat(const unsigned char *data, uint64_t keep, bool last) {
+        accumulate(data, keep, last);
+        swap_banks();
+    }
+
+    // 输出的TVALID
+    bool output_valid() const { return draining_; }
+
+    // 取出一个输出字（调用前output_valid()必须为true），last为TLAST
+    uint32_t pop_output(bool *last) {
+        uint32_t word = drain(last);
+        swap_banks();
+        return word;
+    }
+
+    // 最后一帧实际统计的像素数（v2的pixels_counted寄存器）
+    unsigned int pixels_counted() const { return pixels_counted_; }
+
+    // 没有正在统计、等待输出或正在输出的帧
+    bool idle() const { return !draining_ && !frame_full_ && !in_frame_; }
+
+    // ----- 逐周期接口 -----
+
+    // 模拟一个周期：input为NULL表示本周期输入没有数据（TVALID为0），output_ready为输出流的TREADY
+    // 返回是否接收了input；输出了一个字时 *out_valid 为true，字和TLAST通过 out_word / out_last 返回
+    bool step(const HistBeat *input, bool output_ready, uint32_t *out_word, bool *out_valid, bool *out_last) {
+        *out_valid = false;
+        cycles_.cycles++;
+        if (!running_) {
+            // 函数已返回：auto_restart下有数据时重新启动，启动开销计入周期
+            if (!input) {
+                cycles_.idle_cycles++;
+                return false;
+            }
+            running_ = true;
+            cycles_.calls++;
+            cycles_.cycles += params_.call_overhead;
+        }
+        // 不在输出时阻塞读；输出时写阻塞
+        if (!frame_full_ && !draining_ && !input) {
+            cycles_.input_stall_cycles++;
+            return false;
+        }
+        if (draining_ && !output_ready) {
+            cycles_.output_stall_cycles++;
+            return false;
+        }
+        bool have_beat = !frame_full_ && input;
+        if (frame_full_ && input) {
+            cycles_.input_blocked_cycles++;
+        }
+        if (have_beat) {
+            accumulate(input->data, input->keep, input->last);
+            cycles_.beats++;
+        }
+        if (draining_) {
+            *out_word = drain(out_last);
+            *out_valid = true;
+            cycles_.drain_cycles++;
+        }
+        swap_banks();
+        if (idle()) {
+            running_ = false;
+        }
+        return have_beat;
+    }
+
+    const HistCoreCycles &cycles() const { return cycles_; }
+
+private:
+    uint32_t &bank(int k, int lane, unsigned int addr) {
+        return bank_[((size_t)k * lanes_ + lane) * acc_depth_ + addr];
+    }
+
+    // 统计一拍（统计组），帧结束时标记frame_full
+    void accumulate(const unsigned char *data, uint64_t keep, bool last) {
+        unsigned int sample_count = sample_count_;
+        bool frame_end = sample_count != 0 ? beat_base_ + lanes_ >= sample_count : last;
+        for (int a = 0; a < lanes_; a++) {
+            bool valid = ((keep >> (a * lane_bytes_)) & 1) && (sample_count == 0 || beat_base_ + a < sample_count);
+            if (!valid) {
+                continue;
+            }
+            unsigned int pixel = data[a * lane_bytes_];
+            if (lane_bytes_ == 2) {
+                pixel |= (unsigned int)data[a * lane_bytes_ + 1] << 8;
+            }
+            pixel &= (1u << params_.pixel_bits) - 1;
+            unsigned int bin = pixel >> bin_shift_;
+            unsigned int channel = params_.fixed_lane_channels() ? (unsigned int)(a % params_.channels)
+                                                                : (channel_phase_ + a) % params_.channels;
+            unsigned int addr = params_.fixed_lane_channels() ? bin : (channel << bin_bits_) | bin;
+            bank(acc_bank_, a, addr)++;
+            frame_samples_++;
+        }
+        beat_base_ += lanes_;
+        channel_phase_ = (channel_phase_ + lanes_) % params_.channels;
+        in_frame_ = !frame_end;
+        if (frame_end) {
+            frame_full_ = true;
+            pixels_counted_ = frame_samples_ / params_.channels;
+            frame_samples_ = 0;
+            beat_base_ = 0;
+            channel_phase_ = 0;
+            cycles_.frames++;
+        }
+    }
+
+    // 输出组输出一个字（drain_word_：通道 = drain_word_ >> bin_bits），读出后清零
+    uint32_t drain(bool *last) {
+        int k = 1 - acc_bank_;
+        unsigned int channel = drain_word_ >> bin_bits_;
+        unsigned int addr = params_.fixed_lane_channels() ? (drain_word_ & (params_.bins - 1)) : drain_word_;
+        uint32_t sum = 0;
+        for (int a = 0; a < lanes_; a++) {
+            if (params_.fixed_lane_channels() && (unsigned int)(a % params_.channels) != channel) {
+                continue;
+            }
+            sum += bank(k, a, addr);
+            bank(k, a, addr) = 0;
+        }
+        *last = drain_word_ == (unsigned int)params_.output_words() - 1;
+        drain_word_++;
+        if (*last) {
+            draining_ = false;
+        }
+        return sum;
+    }
+
+    // 统计组中的帧已经结束且输出组空闲时交换
+    void swap_banks() {
+        if (frame_full_ && !draining_) {
+            acc_bank_ = 1 - acc_bank_;
+            draining_ = true;
+            drain_word_ = 0;
+            frame_full_ = false;
+        }
+    }
+
+    HistCoreParams params_;
+    int lanes_;
+    int lane_bytes_;
+    int bin_shift_;
+    int bin_bits_;
+    int acc_depth_;
+    std::vector<uint32_t> bank_;
+    unsigned int sample_count_;
+    int acc_bank_;
+    bool draining_;
+    unsigned int drain_word_;
+    bool frame_full_;
+    bool in_frame_;
+    bool running_;
+    unsigned int beat_base_;
+    unsigned int channel_phase_;
+    unsigned int frame_samples_;
+    unsigned int pixels_counted_;
+    HistCoreCycles cycles_;
+};
+
+// 理想的输入输出（每个周期都有输入、输出从不反压）下连续处理frames帧、每帧beats_per_frame拍的周期统计
+// 数据不影响周期数，这里送全0的拍；pixel_count为0时每帧最后一拍带TLAST
+inline HistCoreCycles hist_model_ideal_cycles(const HistCoreParams &params, unsigned int pixel_count,
+                                              unsigned long beats_per_frame, int frames) {
+    HistCoreModel core(params, pixel_count);
+    std::vector<unsigned char> zero(params.beat_bytes(), 0);
+    HistBeat beat;
+    beat.data = &zero[0];
+    beat.keep = ~0ull;
+    unsigned long long total = (unsigned long long)beats_per_frame * frames;
+    unsigned long long sent = 0;
+    uint32_t word;
+    bool out_valid;
+    bool out_last;
+    while (sent < total || !core.idle()) {
+        beat.last = (sent + 1) % beats_per_frame == 0;
+        if (core.step(sent < total ? &beat : NULL, true, &word, &out_valid, &out_last)) {
+            sent++;
+        }
+    }
+    return core.cycles();
+}
+
+#endif // HISTOGRAM_CORE_MODEL_H
@@ -0,0 +1,182 @@
+// histogram_fpga.c
+// PL直方图核心的原生主机程序：通过libhist的FPGA后端（histogram_fpga_host.cpp）直接驱动AXI DMA
+//
+// 用法：histogram_fpga [width height [iterations [device]]]
+//   设置HIST_INPUT（见hist.h）时宽高取自图像文件，hist_compute逐帧循环使用文件中的帧
+//   device见 histogram_fpga_host.h，例如 "emu"、"emu:core=v2"、"uio:dma=dma,buf=udmabuf0,core=Hanwenip,irq"
+// 编译（C程序和C++驱动一起用g++链接，libhist的源文件见README）：
+//   g++ -O2 -DHIST_WITH_FPGA -Ilibhist -Ihls -x c hls/histogram_fpga.c libhist/*.c
+//       -x none hls/histogram_fpga_host.cpp -pthread -o histogram_fpga
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "hist.h"
+#include "histogram_fpga_host.h"
+
+typedef struct {
+    double avg_ms;
+    double min_ms;
+} FrameTiming;
+
+static int check_histogram(const unsigned int *histogram, const unsigned int *reference, const char *label) {
+    if (memcmp(histogram, reference, HISTOGRAM_BINS * sizeof(unsigned int)) == 0) {
+        return 1;
+    }
+    printf("Error: %s result differs from the CPU reference\n", label);
+    for (int i = 0, shown = 0; i < HISTOGRAM_BINS && shown < 10; i++) {
+        if (histogram[i] != reference[i]) {
+            printf("  bin %3d: FPGA=%u CPU=%u\n", i, histogram[i], reference[i]);
+            shown++;
+        }
+    }
+    return 0;
+}
+
+static void print_timing(const char *label, FrameTiming timing, int image_size) {
+    printf("%s\n", label);
+    printf("  Average latency: %.3f ms (min %.3f ms)\n", timing.avg_ms, timing.min_ms);
+    printf("  Throughput:      %.2f MPixels/s (= MB/s at 8 bits per pixel)\n",
+           (image_size / 1e6) / (timing.avg_ms / 1000.0));
+}
+
+int main(int argc, char **argv) {
+    int width = 1920;
+    int height = 1080;
+    int iterations = 100;
+    const char *device = NULL;
+
+    if (argc >= 3) {
+        width = atoi(argv[1]);
+        height = atoi(argv[2]);
+    }
+    if (argc >= 4) {
+        iterations = atoi(argv[3]);
+    }
+    if (argc >= 5) {
+        device = argv[4];
+    }
+    HistInput *input = NULL;
+    if (hist_input_open(&input, NULL) != HIST_OK) {
+        return 1;
+    }
+    if (input && (input->channels != 1 || input->pixel_bits != 8)) {
+        fprintf(stderr, "Error: the PL core needs an 8-bit single-channel input\n");
+        hist_input_close(input);
+        return 1;
+    }
+    if (input) {
+        width = input->width;
+        height = input->height;
+    }
+    if (width <= 0 || height <= 0 || iterations <= 0) {
+        fprintf(stderr, "Usage: %s [width height [iterations [device]]]\n", argv[0]);
+        hist_input_close(input);
+        return 1;
+    }
+
+    printf("=== FPGA (PL) Histogram Computation - native host ===\n");
+    printf("Image size: %dx%d\n", width, height);
+    if (input) {
+        char description[600];
+        hist_input_describe(input, description, sizeof(description));
+        printf("Input: %s\n", description);
+    }
+
+    Image *img = input ? NULL : create_test_image(width, height);
+    const unsigned char *image = input ? hist_input_frame(input, 0) : img->data;
+    const unsigned char *last_image = input ? hist_input_frame(input, iterations) : image;
+    int image_size = width * height;
+    unsigned int reference[HISTOGRAM_BINS];
+    unsigned int last_reference[HISTOGRAM_BINS];
+    unsigned int histogram[HISTOGRAM_BINS];
+    compute_histogram_cpu(image, image_size, reference);
+    compute_histogram_cpu(last_image, image_size, last_reference);
+
+    // --- libhist FPGA后端：每帧先复制到DMA缓冲区 ---
+    HistConfig config;
+    hist_config_init(&config, HIST_BACKEND_FPGA);
+    config.fpga_device = device;
+    HistContext *ctx = NULL;
+    int status = hist_create(&ctx, &config);
+    if (status != HIST_OK) {
+        fprintf(stderr, "Error: cannot create FPGA context: %s\n", hist_strerror(status));
+        free_image(img);
+        hist_input_close(input);
+        return 1;
+    }
+    char device_name[256];
+    snprintf(device_name, sizeof(device_name), "%s", hist_describe(ctx));
+    printf("Device: %s\n", device_name);
+
+    int ok = 1;
+    FrameTiming copy_timing = {0.0, 1e30};
+    for (int iter = 0; iter <= iterations && ok; iter++) {
+        const unsigned char *pixels = input ? hist_input_frame(input, iter) : image;
+        double start = get_time_ms();
+        status = hist_compute(ctx, pixels, image_size, histogram);
+        double elapsed = get_time_ms() - start;
+        if (status != HIST_OK) {
+            fprintf(stderr, "Error: hist_compute failed: %s\n", hist_strerror(status));
+            ok = 0;
+        } else if (iter == 0) {
+            ok = check_histogram(histogram, reference, "first frame"); // 第一帧用于预热，不计时
+        } else {
+            copy_timing.avg_ms += elapsed / iterations;
+            copy_timing.min_ms = elapsed < copy_timing.min_ms ? elapsed : copy_timing.min_ms;
+        }
+    }
+    ok = ok && check_histogram(histogram, last_reference, "last frame");
+    hist_destroy(ctx);
+    if (!ok) {
+        free_image(img);
+        hist_input_close(input);
+        return 1;
+    }
+    print_timing("\nhist_compute (copy into the DMA buffer):", copy_timing, image_size);
+
+    // --- 零拷贝：帧直接放在DMA缓冲区中，只剩寄存器编程和DMA本身 ---
+    FpgaHost *host = NULL;
+    status = fpga_host_open(&host, device);
+    unsigned char *frame = status == FPGA_HOST_OK ? fpga_host_frame_buffer(host, image_size) : NULL;
+    if (frame) {
+        memcpy(frame, image, image_size);
+        FrameTiming zero_copy_timing = {0.0, 1e30};
+        for (int iter = 0; iter <= iterations && ok; iter++) {
+            double start = get_time_ms();
+            status = fpga_host_histogram(host, frame, image_size, histogram);
+            double elapsed = get_time_ms() - start;
+            if (status != FPGA_HOST_OK) {
+                fprintf(stderr, "Error: %s\n", fpga_host_strerror(status));
+                ok = 0;
+            } else if (iter > 0) {
+                zero_copy_timing.avg_ms += elapsed / iterations;
+                zero_copy_timing.min_ms = elapsed < zero_copy_timing.min_ms ? elapsed : zero_copy_timing.min_ms;
+            }
+        }
+        ok = ok && check_histogram(histogram, reference, "zero-copy");
+        if (ok) {
+            print_timing("\nZero-copy (frame in the DMA buffer):", zero_copy_timing, image_size);
+        }
+    }
+    fpga_host_close(host);
+
+    if (ok) {
+        printf("\nResult matches the CPU reference\n");
+        HistRunInfo info;
+        memset(&info, 0, sizeof(info));
+        info.platform = device_name;
+        info.width = width;
+        info.height = height;
+        info.iterations = iterations;
+        info.total_time_ms = copy_timing.avg_ms * iterations;
+        info.throughput_mpixels = (image_size / 1e6) / (copy_timing.avg_ms / 1000.0);
+        if (save_histogram_txt(histogram, "output/histogram_fpga.txt", &info) == 0) {
+            printf("Histogram saved to output/histogram_fpga.txt\n");
+        }
+    }
+
+    free_image(img);
+    hist_input_close(input);
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,752 @@
+// histogram_fpga_host.cpp
+// PL直方图核心的原生主机驱动：AXI DMA寄存器编程，以及UIO/u-dma-buf平台和软件模拟平台
+//
+// 编译（板上，或任何Linux上使用emu平台）：
+//   g++ -O2 -c hls/histogram_fpga_host.cpp
+#include "histogram_fpga_host.h"
+#include "histogram_core_model.h"
+
+#include <dirent.h>
+#include <fcntl.h>
+#include <new>
+#include <poll.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <sys/mman.h>
+#include <time.h>
+#include <unistd.h>
+#include <utility>
+#include <vector>
+
+// AXI DMA simple模式寄存器（PG021）
+#define DMA_MM2S_DMACR 0x00
+#define DMA_MM2S_DMASR 0x04
+#define DMA_MM2S_SA 0x18
+#define DMA_MM2S_SA_MSB 0x1C
+#define DMA_MM2S_LENGTH 0x28
+#define DMA_S2MM_DMACR 0x30
+#define DMA_S2MM_DMASR 0x34
+#define DMA_S2MM_DA 0x48
+#define DMA_S2MM_DA_MSB 0x4C
+#define DMA_S2MM_LENGTH 0x58
+#define DMA_REG_SPACE 0x60
+
+#define DMA_CR_RUN 0x1
+#define DMA_CR_RESET 0x4
+#define DMA_CR_IOC_IRQ_EN 0x1000
+#define DMA_SR_HALTED 0x1
+#define DMA_SR_IDLE 0x2
+#define DMA_SR_INT_ERR 0x10
+#define DMA_SR_DEC_ERR 0x40
+#define DMA_SR_ERRORS 0x70 // DMAIntErr / DMASlvErr / DMADecErr
+#define DMA_SR_IOC_IRQ 0x1000
+
+// Hanwenip_v2_0_HLS 的AXI-Lite寄存器（Vitis HLS生成的control bundle）
+#define CORE_REG_CTRL 0x00
+#define CORE_REG_PIXEL_COUNT 0x10
+#define CORE_REG_PIXELS_COUNTED 0x18
+#define CORE_CTRL_START 0x01
+#define CORE_CTRL_IDLE 0x04
+#define CORE_CTRL_AUTO_RESTART 0x80
+
+#define HOST_DEFAULT_DEVICE "uio:dma=dma,buf=udmabuf0"
+#define HOST_DEFAULT_MAX_TRANSFER ((1 << 14) - 1)
+#define HOST_BYTES_PER_BEAT 4
+#define HOST_OUTPUT_BYTES (FPGA_HOST_BINS * 4)
+// DMA缓冲区布局：开头是直方图输出，帧从下一页开始
+#define HOST_OUTPUT_OFFSET 0
+#define HOST_FRAME_OFFSET 4096
+#define HOST_TIMEOUT_MS 1000
+
+#define EMU_DEFAULT_BUFFER_SIZE (32u << 20)
+#define EMU_PHYS_BASE 0x70000000ull
+
+struct FpgaHost {
+    FpgaPlatform *platform;
+    size_t max_transfer;
+    unsigned int pixel_count; // v2：核心启动时写入的pixel_count，0 = 还没有启动
+    char description[160];
+};
+
+static double host_time_ms() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000.0 + ts.tv_nsec / 1e6;
+}
+
+// ===== 设备字符串 =====
+
+typedef std::vector<std::pair<std::string, std::string> > DeviceOptions;
+
+// "kind:key=value,flag,..." -> kind和选项列表（flag的值为空字符串）
+static void parse_device(const char *device, std::string *kind, DeviceOptions *options) {
+    const char *colon = strchr(device, ':');
+    *kind = colon ? std::string(device, colon - device) : std::string(device);
+    if (!colon) {
+        return;
+    }
+    std::string rest(colon + 1);
+    size_t start = 0;
+    while (start <= rest.size()) {
+        size_t end = rest.find(',', start);
+        if (end == std::string::npos) {
+            end = rest.size();
+        }
+        std::string item = rest.substr(start, end - start);
+        if (!item.empty()) {
+            size_t eq = item.find('=');
+            if (eq == std::string::npos) {
+                options->push_back(std::make_pair(item, std::string()));
+            } else {
+                options->push_back(std::make_pair(item.substr(0, eq), item.substr(eq + 1)));
+            }
+        }
+        start = end + 1;
+    }
+}
+
+static const char *device_option(const DeviceOptions &options, const char *key) {
+    for (size_t i = 0; i < options.size(); i++) {
+        if (options[i].first == key) {
+            return options[i].second.c_str();
+        }
+    }
+    return NULL;
+}
+
+// ===== 模拟平台：AXI DMA（simple模式）+ 核心模型 =====
+
+class EmulatedPlatform : public FpgaPlatform {
+public:
+    EmulatedPlatform(bool v2, size_t buffer_size, bool irq)
+        : buffer_(buffer_size), v2_(v2), irq_(irq), core_(HistCoreParams(), 0) {
+        snprintf(name_, sizeof(name_), "emu %s (AXI DMA model)%s", v2 ? "v2" : "v1", irq ? " irq" : "");
+        memset(core_regs_, 0, sizeof(core_regs_));
+        reset_dma();
+        // v1是ap_ctrl_none，上电就运行；v2等待ap_start
+        core_running_ = !v2;
+    }
+
+    const char *name() const { return name_; }
+
+    uint32_t dma_read(uint32_t offset) {
+        if (offset == DMA_MM2S_DMASR) {
+            return status_[0];
+        }
+        if (offset == DMA_S2MM_DMASR) {
+            return status_[1];
+        }
+        return offset < DMA_REG_SPACE ? regs_[offset / 4] : 0;
+    }
+
+    void dma_write(uint32_t offset, uint32_t value) {
+        if (offset >= DMA_REG_SPACE) {
+            return;
+        }
+        switch (offset) {
+        case DMA_MM2S_DMACR:
+        case DMA_S2MM_DMACR: {
+            // 任何一个通道的Reset位都复位整个DMA
+            if (value & DMA_CR_RESET) {
+                reset_dma();
+                return;
+            }
+            int ch = offset == DMA_MM2S_DMACR ? 0 : 1;
+            regs_[offset / 4] = value;
+            if (value & DMA_CR_RUN) {
+                status_[ch] &= ~DMA_SR_HALTED;
+            } else {
+                status_[ch] |= DMA_SR_HALTED;
+            }
+            break;
+        }
+        case DMA_MM2S_DMASR:
+        case DMA_S2MM_DMASR:
+            // 中断位写1清零
+            status_[offset == DMA_MM2S_DMASR ? 0 : 1] &= ~(value & 0x7000);
+            break;
+        case DMA_MM2S_LENGTH:
+            regs_[offset / 4] = value;
+            start_transfer(0, ((uint64_t)regs_[DMA_MM2S_SA_MSB / 4] << 32) | regs_[DMA_MM2S_SA / 4], value);
+            break;
+        case DMA_S2MM_LENGTH:
+            regs_[offset / 4] = value;
+            start_transfer(1, ((uint64_t)regs_[DMA_S2MM_DA_MSB / 4] << 32) | regs_[DMA_S2MM_DA / 4], value);
+            break;
+        default:
+            regs_[offset / 4] = value;
+            break;
+        }
+        pump();
+    }
+
+    bool has_core() const { return v2_; }
+
+    uint32_t core_read(uint32_t offset) {
+        if (offset == CORE_REG_CTRL) {
+            return (core_regs_[0] & CORE_CTRL_AUTO_RESTART) | (core_running_ ? 0 : CORE_CTRL_IDLE);
+        }
+        if (offset == CORE_REG_PIXELS_COUNTED) {
+            return core_.pixels_counted();
+        }
+        return offset < sizeof(core_regs_) ? core_regs_[offset / 4] : 0;
+    }
+
+    void core_write(uint32_t offset, uint32_t value) {
+        if (offset >= sizeof(core_regs_)) {
+            return;
+        }
+        core_regs_[offset / 4] = value;
+        // ap_start：核心空闲时启动，锁存pixel_count
+        if (offset == CORE_REG_CTRL && (value & CORE_CTRL_START) && core_.idle()) {
+            core_.reset(core_regs_[CORE_REG_PIXEL_COUNT / 4]);
+            core_running_ = true;
+        }
+        pump();
+    }
+
+    unsigned char *buffer() { return &buffer_[0]; }
+    uint64_t buffer_phys() const { return EMU_PHYS_BASE; }
+    size_t buffer_size() const { return buffer_.size(); }
+
+    bool irq_enabled() const { return irq_; }
+    int irq_wait(int timeout_ms) {
+        (void)timeout_ms;
+        pump();
+        return (status_[1] & DMA_SR_IOC_IRQ) && (regs_[DMA_S2MM_DMACR / 4] & DMA_CR_IOC_IRQ_EN) ? 1 : 0;
+    }
+
+private:
+    void reset_dma() {
+        memset(regs_, 0, sizeof(regs_));
+        status_[0] = status_[1] = DMA_SR_HALTED;
+        active_[0] = active_[1] = false;
+    }
+
+    // 写LENGTH启动一次传输；地址不在缓冲区内时是DMADecErr
+    void start_transfer(int ch, uint64_t address, uint32_t length) {
+        if ((status_[ch] & DMA_SR_HALTED) || length == 0) {
+            return;
+        }
+        if (address < EMU_PHYS_BASE || address - EMU_PHYS_BASE + length > buffer_.size()) {
+            status_[ch] |= DMA_SR_DEC_ERR | DMA_SR_HALTED;
+            return;
+        }
+        status_[ch] &= ~DMA_SR_IDLE;
+        active_[ch] = true;
+        offset_[ch] = (size_t)(address - EMU_PHYS_BASE);
+        length_[ch] = length;
+        done_[ch] = 0;
+    }
+
+    void complete(int ch, uint32_t length) {
+        active_[ch] = false;
+        status_[ch] |= DMA_SR_IDLE | DMA_SR_IOC_IRQ;
+        if (ch == 1) {
+            regs_[DMA_S2MM_LENGTH / 4] = length; // S2MM的LENGTH读回实际收到的字节数
+        }
+    }
+
+    // 在MM2S、核心和S2MM之间搬数据，直到没有进展（输入被反压或S2MM没有准备好）
+    void pump() {
+        bool progressed = true;
+        while (progressed) {
+            progressed = false;
+            while (core_.output_valid() && active_[1]) {
+                if (done_[1] + 4 > length_[1]) {
+                    // 包比S2MM的LENGTH长
+                    active_[1] = false;
+                    status_[1] |= DMA_SR_INT_ERR | DMA_SR_HALTED;
+                    break;
+                }
+                bool last;
+                uint32_t word = core_.pop_output(&last);
+                memcpy(&buffer_[offset_[1] + done_[1]], &word, 4);
+                done_[1] += 4;
+                progressed = true;
+                if (last) {
+                    complete(1, done_[1]);
+                }
+            }
+            while (active_[0] && core_running_ && core_.ready()) {
+                size_t n = length_[0] - done_[0];
+                if (n > HOST_BYTES_PER_BEAT) {
+                    n = HOST_BYTES_PER_BEAT;
+                }
+                unsigned char beat[HOST_BYTES_PER_BEAT] = {0};
+                memcpy(beat, &buffer_[offset_[0] + done_[0]], n);
+                done_[0] += n;
+                bool last = done_[0] == length_[0]; // 每次传输结尾TLAST，最后一拍TKEEP只覆盖剩余字节
+                core_.push_beat(beat, (1u << n) - 1, last);
+                progressed = true;
+                if (last) {
+                    complete(0, length_[0]);
+                }
+            }
+        }
+    }
+
+    std::vector<unsigned char> buffer_;
+    bool v2_;
+    bool irq_;
+    char name_[64];
+    uint32_t regs_[DMA_REG_SPACE / 4];
+    uint32_t status_[2];
+    bool active_[2];
+    size_t offset_[2];
+    size_t length_[2];
+    size_t done_[2];
+    uint32_t core_regs_[8];
+    bool core_running_;
+    HistCoreModel core_;
+};
+
+// ===== UIO + u-dma-buf平台 =====
+
+static bool read_sysfs(const std::string &path, char *value, size_t size) {
+    FILE *file = fopen(path.c_str(), "r");
+    if (!file) {
+        return false;
+    }
+    bool ok = fgets(value, (int)size, file) != NULL;
+    fclose(file);
+    if (ok) {
+        value[strcspn(value, "\n")] = '\0';
+    }
+    return ok;
+}
+
+// UIO设备：路径直接使用，否则在 /sys/class/uio/uio*/name 中查找包含spec的设备
+static std::string find_uio(const char *spec) {
+    if (spec[0] == '/') {
+        return spec;
+    }
+    std::string found;
+    DIR *dir = opendir("/sys/class/uio");
+    if (!dir) {
+        return found;
+    }
+    struct dirent *entry;
+    while ((entry = readdir(dir)) != NULL && found.empty()) {
+        if (strncmp(entry->d_name, "uio", 3) != 0) {
+            continue;
+        }
+        char name[128];
+        if (read_sysfs(std::string("/sys/class/uio/") + entry->d_name + "/name", name, sizeof(name)) &&
+            strstr(name, spec)) {
+            found = std::string("/dev/") + entry->d_name;
+        }
+    }
+    closedir(dir);
+    return found;
+}
+
+struct UioMap {
+    int fd;
+    volatile uint32_t *regs;
+    size_t size;
+    std::string path;
+};
+
+static int map_uio(const char *spec, UioMap *map) {
+    map->path = find_uio(spec);
+    if (map->path.empty()) {
+        fprintf(stderr, "FPGA host: no UIO device matches '%s'\n", spec);
+        return FPGA_HOST_ERR_DEVICE;
+    }
+    // 寄存器空间大小：/sys/class/uio/uioN/maps/map0/size
+    const char *base = strrchr(map->path.c_str(), '/') + 1;
+    char value[64];
+    map->size = 0x10000;
+    if (read_sysfs(std::string("/sys/class/uio/") + base + "/maps/map0/size", value, sizeof(value))) {
+        map->size = (size_t)strtoull(value, NULL, 0);
+    }
+    map->fd = open(map->path.c_str(), O_RDWR | O_SYNC);
+    if (map->fd < 0) {
+        perror(map->path.c_str());
+        return FPGA_HOST_ERR_DEVICE;
+    }
+    void *regs = mmap(NULL, map->size, PROT_READ | PROT_WRITE, MAP_SHARED, map->fd, 0);
+    if (regs == MAP_FAILED) {
+        perror("mmap UIO");
+        close(map->fd);
+        map->fd = -1;
+        return FPGA_HOST_ERR_DEVICE;
+    }
+    map->regs = (volatile uint32_t *)regs;
+    return FPGA_HOST_OK;
+}
+
+static void unmap_uio(UioMap *map) {
+    if (map->regs) {
+        munmap((void *)map->regs, map->size);
+    }
+    if (map->fd >= 0) {
+        close(map->fd);
+    }
+}
+
+class UioPlatform : public FpgaPlatform {
+public:
+    UioPlatform() : has_core_(false), irq_(false), buf_fd_(-1), buf_(NULL), buf_phys_(0), buf_size_(0) {
+        dma_.fd = core_.fd = -1;
+        dma_.regs = core_.regs = NULL;
+        name_[0] = '\0';
+    }
+
+    ~UioPlatform() {
+        if (buf_) {
+            munmap(buf_, buf_size_);
+        }
+        if (buf_fd_ >= 0) {
+            close(buf_fd_);
+        }
+        unmap_uio(&dma_);
+        unmap_uio(&core_);
+    }
+
+    int open_devices(const char *dma, const char *buf, const char *core, bool irq) {
+        int status = map_uio(dma, &dma_);
+        if (status == FPGA_HOST_OK && core) {
+            status = map_uio(core, &core_);
+            has_core_ = status == FPGA_HOST_OK;
+        }
+        if (status == FPGA_HOST_OK) {
+            status = map_udmabuf(buf);
+        }
+        if (status != FPGA_HOST_OK) {
+            return status;
+        }
+        irq_ = irq;
+        snprintf(name_, sizeof(name_), "uio %s %s%s", has_core_ ? "v2" : "v1", dma_.path.c_str(),
+                 irq ? " irq" : "");
+        return FPGA_HOST_OK;
+    }
+
+    const char *name() const { return name_; }
+
+    uint32_t dma_read(uint32_t offset) { return dma_.regs[offset / 4]; }
+    void dma_write(uint32_t offset, uint32_t value) { dma_.regs[offset / 4] = value; }
+
+    bool has_core() const { return has_core_; }
+    uint32_t core_read(uint32_t offset) { return core_.regs[offset / 4]; }
+    void core_write(uint32_t offset, uint32_t value) { core_.regs[offset / 4] = value; }
+
+    unsigned char *buffer() { return buf_; }
+    uint64_t buffer_phys() const { return buf_phys_; }
+    size_t buffer_size() const { return buf_size_; }
+
+    bool irq_enabled() const { return irq_; }
+
+    // UIO：写1重新打开中断，read/poll等待下一次中断
+    void irq_arm() {
+        uint32_t enable = 1;
+        if (write(dma_.fd, &enable, sizeof(enable)) != (ssize_t)sizeof(enable)) {
+            perror("UIO irq enable");
+        }
+    }
+
+    int irq_wait(int timeout_ms) {
+        struct pollfd pfd;
+        pfd.fd = dma_.fd;
+        pfd.events = POLLIN;
+        pfd.revents = 0;
+        int ready = poll(&pfd, 1, timeout_ms);
+        if (ready <= 0) {
+            return ready;
+        }
+        uint32_t count;
+        return read(dma_.fd, &count, sizeof(count)) == (ssize_t)sizeof(count) ? 1 : -1;
+    }
+
+private:
+    // u-dma-buf：/dev/<name>用O_SYNC打开（uncached映射，DMA前后不需要同步缓存），
+    // 物理地址和大小从 /sys/class/u-dma-buf/<name>/（旧版驱动为 /sys/class/udmabuf/<name>/）读取
+    int map_udmabuf(const char *spec) {
+        const char *slash = strrchr(spec, '/');
+        std::string name = slash ? slash + 1 : spec;
+        char phys[64], size[64];
+        const char *classes[] = {"/sys/class/u-dma-buf/", "/sys/class/udmabuf/"};
+        bool found = false;
+        for (int i = 0; i < 2 && !found; i++) {
+            found = read_sysfs(classes[i] + name + "/phys_addr", phys, sizeof(phys)) &&
+                    read_sysfs(classes[i] + name + "/size", size, sizeof(size));
+        }
+        if (!found) {
+            fprintf(stderr, "FPGA host: u-dma-buf '%s' not found (is the u-dma-buf module loaded?)\n", name.c_str());
+            return FPGA_HOST_ERR_DEVICE;
+        }
+        buf_phys_ = strtoull(phys, NULL, 0);
+        buf_size_ = (size_t)strtoull(size, NULL, 0);
+        std::string path = "/dev/" + name;
+        buf_fd_ = open(path.c_str(), O_RDWR | O_SYNC);
+        if (buf_fd_ < 0) {
+            perror(path.c_str());
+            return FPGA_HOST_ERR_DEVICE;
+        }
+        void *mapped = mmap(NULL, buf_size_, PROT_READ | PROT_WRITE, MAP_SHARED, buf_fd_, 0);
+        if (mapped == MAP_FAILED) {
+            perror("mmap u-dma-buf");
+            return FPGA_HOST_ERR_DEVICE;
+        }
+        buf_ = (unsigned char *)mapped;
+        return FPGA_HOST_OK;
+    }
+
+    UioMap dma_;
+    UioMap core_;
+    bool has_core_;
+    bool irq_;
+    int buf_fd_;
+    unsigned char *buf_;
+    uint64_t buf_phys_;
+    size_t buf_size_;
+    char name_[160];
+};
+
+// ===== AXI DMA驱动 =====
+
+// 复位DMA并启动两个通道（S2MM打开完成中断时由UIO通知）
+static void dma_reset(FpgaPlatform *platform) {
+    platform->dma_write(DMA_MM2S_DMACR, DMA_CR_RESET);
+    double deadline = host_time_ms() + HOST_TIMEOUT_MS;
+    while ((platform->dma_read(DMA_MM2S_DMACR) & DMA_CR_RESET) && host_time_ms() < deadline) {
+    }
+    platform->dma_write(DMA_MM2S_DMACR, DMA_CR_RUN);
+    platform->dma_write(DMA_S2MM_DMACR, DMA_CR_RUN | (platform->irq_enabled() ? DMA_CR_IOC_IRQ_EN : 0));
+}
+
+// 等待通道完成（DMASR的Idle位）或出错；每1024次轮询才检查一次超时，小帧的轮询不调用clock_gettime
+static int dma_wait(FpgaPlatform *platform, uint32_t dmasr, bool use_irq) {
+    if (use_irq) {
+        int ready = platform->irq_wait(HOST_TIMEOUT_MS);
+        platform->dma_write(dmasr, DMA_SR_IOC_IRQ);
+        if (ready < 0) {
+            return FPGA_HOST_ERR_DEVICE;
+        }
+    }
+    double deadline = 0.0;
+    for (unsigned long spin = 0;; spin++) {
+        uint32_t status = platform->dma_read(dmasr);
+        if (status & DMA_SR_ERRORS) {
+            fprintf(stderr, "FPGA host: DMA error, %s DMASR = 0x%08x\n",
+                    dmasr == DMA_MM2S_DMASR ? "MM2S" : "S2MM", (unsigned int)status);
+            return FPGA_HOST_ERR_DMA;
+        }
+        if (status & DMA_SR_IDLE) {
+            return FPGA_HOST_OK;
+        }
+        if ((spin & 1023) == 1023) {
+            double now = host_time_ms();
+            if (deadline == 0.0) {
+                deadline = now + HOST_TIMEOUT_MS;
+            } else if (now > deadline) {
+                fprintf(stderr, "FPGA host: %s timeout, DMASR = 0x%08x\n",
+                        dmasr == DMA_MM2S_DMASR ? "MM2S" : "S2MM", (unsigned int)status);
+                return FPGA_HOST_ERR_TIMEOUT;
+            }
+        }
+    }
+}
+
+static void dma_start(FpgaPlatform *platform, uint32_t address_reg, uint32_t length_reg, uint64_t address,
+                      size_t length) {
+    platform->dma_write(address_reg, (uint32_t)address);
+    platform->dma_write(address_reg + 4, (uint32_t)(address >> 32));
+    platform->dma_write(length_reg, (uint32_t)length); // 写LENGTH启动传输
+}
+
+int fpga_host_open_platform(FpgaHost **out, FpgaPlatform *platform, size_t max_transfer) {
+    if (!out || !platform || max_transfer < HOST_BYTES_PER_BEAT ||
+        platform->buffer_size() <= HOST_FRAME_OFFSET) {
+        delete platform;
+        return FPGA_HOST_ERR_INVALID;
+    }
+    FpgaHost *host = new (std::nothrow) FpgaHost;
+    if (!host) {
+        delete platform;
+        return FPGA_HOST_ERR_DEVICE;
+    }
+    host->platform = platform;
+    host->max_transfer = max_transfer;
+    host->pixel_count = 0;
+    snprintf(host->description, sizeof(host->description), "%s", platform->name());
+    dma_reset(platform);
+    *out = host;
+    return FPGA_HOST_OK;
+}
+
+int fpga_host_open(FpgaHost **out, const char *device) {
+    if (!out) {
+        return FPGA_HOST_ERR_INVALID;
+    }
+    *out = NULL;
+    if (!device || !*device) {
+        device = getenv("HIST_FPGA_DEVICE");
+    }
+    if (!device || !*device) {
+        device = HOST_DEFAULT_DEVICE;
+    }
+
+    std::string kind;
+    DeviceOptions options;
+    parse_device(device, &kind, &options);
+    size_t max_transfer = HOST_DEFAULT_MAX_TRANSFER;
+    if (const char *value = device_option(options, "max_transfer")) {
+        max_transfer = (size_t)strtoull(value, NULL, 0);
+    }
+    bool irq = device_option(options, "irq") != NULL;
+
+    FpgaPlatform *platform = NULL;
+    if (kind == "emu") {
+        const char *core = device_option(options, "core");
+        if (core && strcmp(core, "v1") != 0 && strcmp(core, "v2") != 0) {
+            fprintf(stderr, "FPGA host: unknown emulated core '%s' (v1 or v2)\n", core);
+            return FPGA_HOST_ERR_INVALID;
+        }
+        size_t buffer_size = EMU_DEFAULT_BUFFER_SIZE;
+        if (const char *value = device_option(options, "buf_size")) {
+            buffer_size = (size_t)strtoull(value, NULL, 0);
+        }
+        platform = new (std::nothrow) EmulatedPlatform(core && strcmp(core, "v2") == 0, buffer_size, irq);
+    } else if (kind == "uio") {
+        const char *dma = device_option(options, "dma");
+        const char *buf = device_option(options, "buf");
+        if (!dma || !buf || !*dma || !*buf) {
+            fprintf(stderr, "FPGA host: uio device needs dma=<UIO> and buf=<u-dma-buf>\n");
+            return FPGA_HOST_ERR_INVALID;
+        }
+        UioPlatform *uio = new (std::nothrow) UioPlatform;
+        if (uio) {
+            int status = uio->open_devices(dma, buf, device_option(options, "core"), irq);
+            if (status != FPGA_HOST_OK) {
+                delete uio;
+                return status;
+            }
+        }
+        platform = uio;
+    } else {
+        fprintf(stderr, "FPGA host: unknown device '%s' (emu or uio)\n", device);
+        return FPGA_HOST_ERR_INVALID;
+    }
+    if (!platform) {
+        return FPGA_HOST_ERR_DEVICE;
+    }
+    return fpga_host_open_platform(out, platform, max_transfer);
+}
+
+void fpga_host_close(FpgaHost *host) {
+    if (!host) {
+        return;
+    }
+    if (host->platform->has_core()) {
+        host->platform->core_write(CORE_REG_CTRL, 0); // 关闭auto_restart，当前帧结束后核心停止
+    }
+    delete host->platform;
+    delete host;
+}
+
+unsigned char *fpga_host_frame_buffer(FpgaHost *host, size_t size) {
+    if (!host || size > host->platform->buffer_size() - HOST_FRAME_OFFSET) {
+        return NULL;
+    }
+    return host->platform->buffer() + HOST_FRAME_OFFSET;
+}
+
+int fpga_host_histogram(FpgaHost *host, const unsigned char *data, size_t size, unsigned int *histogram) {
+    if (!host || !histogram || (!data && size > 0) || size > 0xFFFFFFFFu) {
+        return FPGA_HOST_ERR_INVALID;
+    }
+    // 长度为0的DMA传输不合法，空帧不经过硬件
+    if (size == 0) {
+        memset(histogram, 0, HOST_OUTPUT_BYTES);
+        return FPGA_HOST_OK;
+    }
+    FpgaPlatform *platform = host->platform;
+    unsigned char *frame = fpga_host_frame_buffer(host, size);
+    if (!frame) {
+        fprintf(stderr, "FPGA host: %zu-byte frame does not fit the %zu-byte DMA buffer\n", size,
+                platform->buffer_size());
+        return FPGA_HOST_ERR_INVALID;
+    }
+    bool v2 = platform->has_core();
+    if (!v2 && size > host->max_transfer) {
+        fprintf(stderr, "FPGA host: v1 core needs one DMA transfer per frame, %zu bytes > %zu bytes\n", size,
+                host->max_transfer);
+        return FPGA_HOST_ERR_UNSUPPORTED;
+    }
+    if (v2) {
+        if (host->pixel_count == 0) {
+            platform->core_write(CORE_REG_PIXEL_COUNT, (uint32_t)size);
+            platform->core_write(CORE_REG_CTRL, CORE_CTRL_START | CORE_CTRL_AUTO_RESTART);
+            host->pixel_count = (unsigned int)size;
+        } else if (host->pixel_count != size) {
+            fprintf(stderr, "FPGA host: v2 core was started with pixel_count %u, frame has %zu pixels\n",
+                    host->pixel_count, size);
+            return FPGA_HOST_ERR_UNSUPPORTED;
+        }
+    }
+
+    if (data != frame) {
+        memcpy(frame, data, size);
+    }
+    platform->sync_for_device(HOST_FRAME_OFFSET, size);
+
+    // 先准备接收直方图，再发送帧
+    uint64_t phys = platform->buffer_phys();
+    if (platform->irq_enabled()) {
+        platform->irq_arm();
+    }
+    dma_start(platform, DMA_S2MM_DA, DMA_S2MM_LENGTH, phys + HOST_OUTPUT_OFFSET, HOST_OUTPUT_BYTES);
+
+    // v1：一次传输，结尾TLAST结束一帧；v2：按pixel_count分帧，分块边界对齐到拍
+    // （核心按拍累加像素序号，拍中间断开会让帧结束的位置错位）
+    size_t chunk = v2 ? host->max_transfer - host->max_transfer % HOST_BYTES_PER_BEAT : size;
+    int status = FPGA_HOST_OK;
+    for (size_t offset = 0; offset < size && status == FPGA_HOST_OK; offset += chunk) {
+        size_t length = size - offset < chunk ? size - offset : chunk;
+        dma_start(platform, DMA_MM2S_SA, DMA_MM2S_LENGTH, phys + HOST_FRAME_OFFSET + offset, length);
+        status = dma_wait(platform, DMA_MM2S_DMASR, false);
+    }
+    if (status == FPGA_HOST_OK) {
+        status = dma_wait(platform, DMA_S2MM_DMASR, platform->irq_enabled());
+    }
+    if (status != FPGA_HOST_OK) {
+        dma_reset(platform);
+        return status;
+    }
+
+    platform->sync_for_cpu(HOST_OUTPUT_OFFSET, HOST_OUTPUT_BYTES);
+    memcpy(histogram, platform->buffer() + HOST_OUTPUT_OFFSET, HOST_OUTPUT_BYTES);
+    if (v2 && platform->core_read(CORE_REG_PIXELS_COUNTED) != size) {
+        fprintf(stderr, "FPGA host: core counted %u pixels, frame has %zu\n",
+                (unsigned int)platform->core_read(CORE_REG_PIXELS_COUNTED), size);
+        return FPGA_HOST_ERR_DMA;
+    }
+    return FPGA_HOST_OK;
+}
+
+const char *fpga_host_describe(const FpgaHost *host) {
+    return host ? host->description : "";
+}
+
+const char *fpga_host_strerror(int status) {
+    switch (status) {
+    case FPGA_HOST_OK:
+        return "success";
+    case FPGA_HOST_ERR_INVALID:
+        return "invalid argument";
+    case FPGA_HOST_ERR_DEVICE:
+        return "cannot open device";
+    case FPGA_HOST_ERR_UNSUPPORTED:
+        return "not supported by this core";
+    case FPGA_HOST_ERR_DMA:
+        return "DMA error";
+    case FPGA_HOST_ERR_TIMEOUT:
+        return "DMA timeout";
+    default:
+        return "unknown error";
+    }
+}
@@ -0,0 +1,104 @@
+// histogram_fpga_host.h
+// PL直方图核心（Hanwenip_v1_0_HLS / Hanwenip_v2_0_HLS）的原生主机驱动：
+// 直接读写AXI DMA（simple模式）的寄存器，不经过PYNQ，每帧的软件开销只有几次寄存器读写
+//
+// 寄存器和DMA缓冲区由可替换的平台（FpgaPlatform）提供：
+//   uio  通过UIO映射AXI DMA（和v2核心）的寄存器，通过u-dma-buf映射物理连续的DMA缓冲区，轮询DMASR或等待UIO中断
+//   emu  软件模拟的AXI DMA + 核心的逐位精确模型（histogram_core_model.h），在普通Linux上测试主机代码
+// 设备字符串：
+//   "emu"                            模拟v1核心（TLAST分帧）
+//   "emu:core=v2"                    模拟v2核心（pixel_count寄存器）
+//   "uio:dma=<UIO>,buf=<u-dma-buf>[,core=<UIO>][,irq]"
+//       UIO是设备路径（/dev/uio0）或设备树节点名的一部分（在 /sys/class/uio/uio*/name 中查找），
+//       例如 "uio:dma=dma,buf=udmabuf0,core=Hanwenip,irq"；irq表示等待S2MM完成中断（UIO的中断接S2MM的introut）
+//   两种平台都可以加 max_transfer=<字节>：DMA的buffer length寄存器决定的单次传输上限（默认16383）
+//   NULL时使用环境变量HIST_FPGA_DEVICE，没有则为 "uio:dma=dma,buf=udmabuf0"
+// v1核心每帧一次传输（以TLAST结束），帧不能超过max_transfer；v2核心按pixel_count分帧，
+// 大帧在4字节的拍边界分成多次传输。v2的pixel_count在核心启动时锁存，同一个host的帧大小不能改变
+#ifndef HISTOGRAM_FPGA_HOST_H
+#define HISTOGRAM_FPGA_HOST_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define FPGA_HOST_BINS 256
+
+typedef enum {
+    FPGA_HOST_OK = 0,
+    FPGA_HOST_ERR_INVALID = -1,     // 参数或设备字符串错误
+    FPGA_HOST_ERR_DEVICE = -2,      // 打开/映射UIO或u-dma-buf失败
+    FPGA_HOST_ERR_UNSUPPORTED = -3, // 当前核心不支持（例如v1核心的帧超过单次传输上限）
+    FPGA_HOST_ERR_DMA = -4,         // DMA报告错误（DMASR的错误位）或帧长度不对
+    FPGA_HOST_ERR_TIMEOUT = -5      // DMA没有在超时时间内完成
+} FpgaHostStatus;
+
+typedef struct FpgaHost FpgaHost;
+
+int fpga_host_open(FpgaHost **out, const char *device);
+void fpga_host_close(FpgaHost *host);
+
+// 统计size个8位像素，结果写入histogram[FPGA_HOST_BINS]
+// data可以是fpga_host_frame_buffer返回的DMA缓冲区（零拷贝），否则先复制到DMA缓冲区
+int fpga_host_histogram(FpgaHost *host, const unsigned char *data, size_t size, unsigned int *histogram);
+
+// DMA缓冲区中放一帧的区域，调用者直接把像素写到这里可以省去一次复制；size超过缓冲区时返回NULL
+unsigned char *fpga_host_frame_buffer(FpgaHost *host, size_t size);
+
+// 例如 "emu v1 (AXI DMA model)"、"uio v2 /dev/uio0 irq"
+const char *fpga_host_describe(const FpgaHost *host);
+const char *fpga_host_strerror(int status);
+
+#ifdef __cplusplus
+}
+
+// 平台接口：AXI DMA和核心的寄存器、物理连续的DMA缓冲区、中断
+class FpgaPlatform {
+public:
+    virtual ~FpgaPlatform() {}
+    virtual const char *name() const = 0;
+
+    // AXI DMA寄存器（偏移见PG021）
+    virtual uint32_t dma_read(uint32_t offset) = 0;
+    virtual void dma_write(uint32_t offset, uint32_t value) = 0;
+
+    // v2核心的AXI-Lite寄存器，v1核心（ap_ctrl_none）没有寄存器，has_core()返回false
+    virtual bool has_core() const = 0;
+    virtual uint32_t core_read(uint32_t offset) = 0;
+    virtual void core_write(uint32_t offset, uint32_t value) = 0;
+
+    // 物理连续的DMA缓冲区
+    virtual unsigned char *buffer() = 0;
+    virtual uint64_t buffer_phys() const = 0;
+    virtual size_t buffer_size() const = 0;
+
+    // cached映射的缓冲区在DMA读之前写回、DMA写之后失效，uncached映射时什么也不做
+    virtual void sync_for_device(size_t offset, size_t size) {
+        (void)offset;
+        (void)size;
+    }
+    virtual void sync_for_cpu(size_t offset, size_t size) {
+        (void)offset;
+        (void)size;
+    }
+
+    // S2MM完成中断：irq_enabled()为false时驱动轮询DMASR
+    // irq_arm在启动传输前调用（UIO要重新打开中断），irq_wait返回1 = 收到中断，0 = 超时，-1 = 错误
+    virtual bool irq_enabled() const {
+        return false;
+    }
+    virtual void irq_arm() {}
+    virtual int irq_wait(int timeout_ms) {
+        (void)timeout_ms;
+        return -1;
+    }
+};
+
+// 使用自定义平台创建host（接管platform的所有权，失败时也会释放）
+int fpga_host_open_platform(FpgaHost **out, FpgaPlatform *platform, size_t max_transfer);
+#endif
+
+#endif // HISTOGRAM_FPGA_HOST_H
@@ -1,100 +1,49 @@
 // Histogram Computation using Vitis HLS
 // 针对 FPGA/PL 加速器的直方图计算实现
-#include "ap_int.h"
-#include "ap_axi_sdata.h"
-#include "hls_stream.h"
+// 核心逻辑在 histogram_hls.h 的 histogram_core 模板中，这里只实例化顶层函数：
+//   Hanwenip_v1_0_HLS  ap_ctrl_none，以TLAST结束一帧（已部署的版本）
+//   Hanwenip_v2_0_HLS  AXI-Lite控制，pixel_count寄存器指定每帧像素数，支持任意帧大小
+// 两个版本都按TKEEP忽略最后一拍的padding，都用ping-pong累加器让背靠背的帧之间没有空拍
+//
+// 默认配置（8位像素、256 bin、32位流、4个累加器）与已部署的比特流相同。
+// 生成其他配置的核心时在综合脚本里加编译选项，例如把128位HP口跑满（每拍16个像素、16个累加器）：
+//   add_files histogram_hls.cpp -cflags "-DHIST_HLS_STREAM_BITS=128"
+// 12位传感器数据统计到1024个bin（右移2位）：
+//   add_files histogram_hls.cpp -cflags "-DHIST_HLS_PIXEL_BITS=12 -DHIST_HLS_BINS=1024 -DHIST_HLS_STREAM_BITS=128"
+// 交错的RGBA相机数据，每帧输出4×256个计数（R、G、B、A依次排列），32位流的4个lane正好对应4个通道：
+//   add_files histogram_hls.cpp -cflags "-DHIST_HLS_CHANNELS=4"
+#include "histogram_hls.h"
 
-#define HISTOGRAM_BINS 256
+#ifndef __SYNTHESIS__
+unsigned long hist_csim_loop_iterations = 0;
+#endif
 
-// 使用 AXI Stream 接口的版本
 void Hanwenip_v1_0_HLS(
-    hls::stream<ap_axiu<32, 0, 0, 0> >& image_stream,
-    hls::stream<ap_axiu<32, 0, 0, 0> >& histogram_stream,
-    int image_size
-);
-
-// Histogram Computation using Vitis HLS
-// 优化版：32x32小图像，使用ap_ctrl_none自动运行
-#include "ap_int.h"
-#include "ap_axi_sdata.h"
-#include "hls_stream.h"
-
-#define HISTOGRAM_BINS 256
-
-void Hanwenip_v1_0_HLS(
-    hls::stream<ap_axiu<32, 0, 0, 0> >& image_stream,
+    hls::stream<ap_axiu<HIST_HLS_STREAM_BITS, 0, 0, 0> >& image_stream,
     hls::stream<ap_axiu<32, 0, 0, 0> >& histogram_stream
 ) {
     // 使用 ap_ctrl_none：自动运行，不需要启动信号
     #pragma HLS INTERFACE ap_ctrl_none port=return
     #pragma HLS INTERFACE axis port=image_stream
     #pragma HLS INTERFACE axis port=histogram_stream
-    
-    // 4个独立的累加器（避免写冲突）
-    unsigned int hist_acc0[HISTOGRAM_BINS];
-    unsigned int hist_acc1[HISTOGRAM_BINS];
-    unsigned int hist_acc2[HISTOGRAM_BINS];
-    unsigned int hist_acc3[HISTOGRAM_BINS];
-    
-    // 部分分区（平衡资源和性能）
-    #pragma HLS ARRAY_PARTITION variable=hist_acc0 cyclic factor=16
-    #pragma HLS ARRAY_PARTITION variable=hist_acc1 cyclic factor=16
-    #pragma HLS ARRAY_PARTITION variable=hist_acc2 cyclic factor=16
-    #pragma HLS ARRAY_PARTITION variable=hist_acc3 cyclic factor=16
-    
-    // 初始化累加器
-    INIT_LOOP: for (int i = 0; i < HISTOGRAM_BINS; i++) {
-        #pragma HLS PIPELINE II=1
-        hist_acc0[i] = 0;
-        hist_acc1[i] = 0;
-        hist_acc2[i] = 0;
-        hist_acc3[i] = 0;
-    }
-    
-    // 处理输入数据流，直到检测到TLAST
-    PROCESS_LOOP: while(true) {
-        #pragma HLS PIPELINE II=1
-        #pragma HLS DEPENDENCE variable=hist_acc0 inter false
-        #pragma HLS DEPENDENCE variable=hist_acc1 inter false
-        #pragma HLS DEPENDENCE variable=hist_acc2 inter false
-        #pragma HLS DEPENDENCE variable=hist_acc3 inter false
-        
-        // 读取一个32位数据（包含4个像素）
-        ap_axiu<32, 0, 0, 0> data = image_stream.read();
-        ap_uint<32> pixel_data = data.data;
-        
-        // 提取4个像素
-        ap_uint<8> pixel0 = pixel_data.range(7, 0);
-        ap_uint<8> pixel1 = pixel_data.range(15, 8);
-        ap_uint<8> pixel2 = pixel_data.range(23, 16);
-        ap_uint<8> pixel3 = pixel_data.range(31, 24);
-        
-        // 使用独立累加器避免冲突
-        hist_acc0[pixel0]++;
-        hist_acc1[pixel1]++;
-        hist_acc2[pixel2]++;
-        hist_acc3[pixel3]++;
-        
-        // 检测TLAST信号（数据流结束）
-        if (data.last) {
-            break;
-        }
-    }
-    
-    // 合并累加器并输出结果
-    OUTPUT_LOOP: for (int i = 0; i < HISTOGRAM_BINS; i++) {
-        #pragma HLS PIPELINE II=1
-        
-        // 合并4个累加器
-        unsigned int sum = hist_acc0[i] + hist_acc1[i] + 
-                          hist_acc2[i] + hist_acc3[i];
-        
-        // 输出直方图值
-        ap_axiu<32, 0, 0, 0> output_data;
-        output_data.data = sum;
-        output_data.last = (i == HISTOGRAM_BINS - 1);
-        output_data.keep = -1;
-        output_data.strb = -1;
-        histogram_stream.write(output_data);
-    }
+
+    histogram_core<HIST_HLS_PIXEL_BITS, HIST_HLS_BINS, HIST_HLS_STREAM_BITS, HIST_HLS_CHANNELS>(
+        image_stream, histogram_stream);
+}
+
+// 任意帧大小的版本：像素数通过AXI-Lite写入，ap_ctrl_hs（PYNQ中设置auto_restart后连续处理每一帧）
+void Hanwenip_v2_0_HLS(
+    hls::stream<ap_axiu<HIST_HLS_STREAM_BITS, 0, 0, 0> >& image_stream,
+    hls::stream<ap_axiu<32, 0, 0, 0> >& histogram_stream,
+    unsigned int pixel_count,
+    unsigned int& pixels_counted
+) {
+    #pragma HLS INTERFACE s_axilite port=pixel_count bundle=control
+    #pragma HLS INTERFACE s_axilite port=pixels_counted bundle=control
+    #pragma HLS INTERFACE s_axilite port=return bundle=control
+    #pragma HLS INTERFACE axis port=image_stream
+    #pragma HLS INTERFACE axis port=histogram_stream
+
+    pixels_counted = histogram_core<HIST_HLS_PIXEL_BITS, HIST_HLS_BINS, HIST_HLS_STREAM_BITS, HIST_HLS_CHANNELS>(
+        image_stream, histogram_stream, pixel_count);
 }
@@ -0,0 +1,325 @@
+// histogram_hls.h
+// 参数化的直方图HLS核心：像素位宽、bin数和AXI Stream位宽都是模板参数
+// 同一份代码可以生成32位流的小核心，也可以生成把HP口（128位）或更宽的流跑满的核心
+#ifndef HISTOGRAM_HLS_H
+#define HISTOGRAM_HLS_H
+
+#include "ap_int.h"
+#include "ap_axi_sdata.h"
+#include "hls_stream.h"
+
+#define HISTOGRAM_BINS 256
+
+// 顶层核心的配置，可以在综合时用 -D 修改（见 Hanwenip_v1_0_HLS），默认值就是已部署的8位/256 bin/32位流核心
+#ifndef HIST_HLS_PIXEL_BITS
+#define HIST_HLS_PIXEL_BITS 8 // 8/10/12/16
+#endif
+#ifndef HIST_HLS_BINS
+#define HIST_HLS_BINS HISTOGRAM_BINS // 2的幂，不超过 2^PIXEL_BITS
+#endif
+#ifndef HIST_HLS_STREAM_BITS
+#define HIST_HLS_STREAM_BITS 32 // 32/64/128/256/512
+#endif
+#ifndef HIST_HLS_CHANNELS
+#define HIST_HLS_CHANNELS 1 // 1 = 灰度，3 = RGB，4 = RGBA（交错存储）
+#endif
+
+// 顶层核心每个累加器的项数达到这个值时（例如16位像素全分辨率的65536个bin）累加器放在URAM里：
+// 每块BRAM只有1K×36位，65536项的累加器要64块BRAM，一块URAM是4K×72位，只要16块
+// 只对顶层配置（HIST_HLS_*宏）生效，测试平台里其他模板配置的C仿真不受影响
+#ifndef HIST_HLS_URAM_MIN_BINS
+#define HIST_HLS_URAM_MIN_BINS 4096
+#endif
+#define HIST_HLS_USE_URAM (HIST_HLS_BINS * HIST_HLS_CHANNELS >= HIST_HLS_URAM_MIN_BINS)
+
+// read-modify-write转发深度：II=1时同一个累加器从读出到写回跨越的拍数（BRAM读延迟 + 加法 + 写回）
+// 这几拍内对同一个bin的读取拿到的是旧值，必须从转发寄存器取最新值；URAM的读延迟多一拍
+#ifndef HIST_HLS_RMW_DEPTH
+#if HIST_HLS_USE_URAM
+#define HIST_HLS_RMW_DEPTH 4
+#else
+#define HIST_HLS_RMW_DEPTH 3
+#endif
+#endif
+
+// 编译期log2（N为2的幂）
+template <int N>
+struct hist_log2 {
+    static const int value = 1 + hist_log2<N / 2>::value;
+};
+template <>
+struct hist_log2<1> {
+    static const int value = 0;
+};
+
+// 由模板参数推导出的核心参数
+template <int PIXEL_BITS, int BINS, int STREAM_BITS, int CHANNELS = 1>
+struct HistCoreConfig {
+    // 8位像素每个占1字节，10/12/16位像素每个占2字节（低位对齐）
+    static const int LANE_BITS = PIXEL_BITS <= 8 ? 8 : 16;
+    static const int LANE_BYTES = LANE_BITS / 8;
+    static const int PIXELS_PER_BEAT = STREAM_BITS / LANE_BITS;
+    // bin量化：像素右移BIN_SHIFT位得到bin号，例如12位像素统计到256个bin时右移4位
+    static const int BIN_BITS = hist_log2<BINS>::value;
+    static const int BIN_SHIFT = PIXEL_BITS - BIN_BITS;
+    // 每个lane一个独立累加器，流越宽累加器越多
+    static const int ACCUMULATORS = PIXELS_PER_BEAT;
+    // 多通道时每个通道输出BINS个计数，通道c在输出的第 c*BINS 个字开始
+    // 通道数整除每拍的lane数时，每个lane固定属于一个通道（RGBA：lane a就是通道a），累加器只需要BINS项；
+    // 否则（例如32位流上的RGB）lane所属的通道逐拍轮换，每个累加器按 (通道 << BIN_BITS) | bin 统计所有通道
+    static const bool FIXED_LANE_CHANNELS = PIXELS_PER_BEAT % CHANNELS == 0;
+    static const int ACC_ADDR_BITS = FIXED_LANE_CHANNELS ? BIN_BITS : BIN_BITS + 2;
+    static const int ACC_DEPTH = FIXED_LANE_CHANNELS ? BINS : CHANNELS * BINS;
+    static const int OUTPUT_WORDS = CHANNELS * BINS;
+
+    static_assert(PIXEL_BITS == 8 || PIXEL_BITS == 10 || PIXEL_BITS == 12 || PIXEL_BITS == 16,
+                  "PIXEL_BITS must be 8, 10, 12 or 16");
+    static_assert(STREAM_BITS == 32 || STREAM_BITS == 64 || STREAM_BITS == 128 ||
+                      STREAM_BITS == 256 || STREAM_BITS == 512,
+                  "STREAM_BITS must be 32, 64, 128, 256 or 512");
+    static_assert((BINS & (BINS - 1)) == 0 && BIN_SHIFT >= 0, "BINS must be a power of two <= 2^PIXEL_BITS");
+    static_assert(CHANNELS >= 1 && CHANNELS <= 4, "CHANNELS must be 1..4");
+};
+
+// 像素所在的bin（lane为拍内像素序号）
+template <int PIXEL_BITS, int BINS, int STREAM_BITS>
+ap_uint<HistCoreConfig<PIXEL_BITS, BINS, STREAM_BITS>::BIN_BITS> hist_lane_bin(
+    const ap_uint<STREAM_BITS> &beat, int lane)
+{
+#pragma HLS INLINE
+    typedef HistCoreConfig<PIXEL_BITS, BINS, STREAM_BITS> Cfg;
+    ap_uint<PIXEL_BITS> pixel = beat.range(lane * Cfg::LANE_BITS + PIXEL_BITS - 1, lane * Cfg::LANE_BITS);
+    return pixel >> Cfg::BIN_SHIFT;
+}
+
+#ifndef __SYNTHESIS__
+// C仿真统计：PROCESS_LOOP的迭代次数（= 硬件的周期数），测试平台用它检查背靠背的帧之间没有空拍
+extern unsigned long hist_csim_loop_iterations;
+#endif
+
+// 直方图核心：每帧按通道、bin顺序输出 CHANNELS*BINS 个32位计数（最后一个带TLAST），返回最后一帧实际统计的像素数
+// 多通道时输入是交错的样本（RGBRGB... / RGBARGBA...），每个lane是一个样本，一次遍历统计所有通道
+// pixel_count为0时每帧以TLAST结束；非0时每帧正好 ceil(pixel_count * CHANNELS / PIXELS_PER_BEAT) 拍，
+// 忽略TLAST（大帧可以分成多次DMA传输），超出pixel_count的lane不统计
+// TKEEP为0的lane（最后一拍的padding）在两种模式下都不统计
+//
+// 两组（ping-pong）累加器在同一个II=1的循环里交替使用：一组统计当前帧，另一组同时按bin输出上一帧并清零，
+// 所以背靠背的帧之间没有清零和输出的空拍（原来每帧多 2*BINS 拍）。一次调用一直运行到输入空闲：
+// 上一帧输出期间用非阻塞读接收下一帧，输出完且没有收到新的一帧时返回。
+// 只有帧短于 CHANNELS*BINS 拍时，下一帧要等上一帧输出完才能开始（输出流每拍一个bin，本来就是瓶颈）。
+template <int PIXEL_BITS, int BINS, int STREAM_BITS, int CHANNELS = 1>
+unsigned int histogram_core(
+    hls::stream<ap_axiu<STREAM_BITS, 0, 0, 0> >& image_stream,
+    hls::stream<ap_axiu<32, 0, 0, 0> >& histogram_stream,
+    unsigned int pixel_count = 0
+) {
+    typedef HistCoreConfig<PIXEL_BITS, BINS, STREAM_BITS, CHANNELS> Cfg;
+    typedef ap_uint<Cfg::ACC_ADDR_BITS> AccAddr;
+    const int ACC = Cfg::ACCUMULATORS;
+
+    // hist_bank[组][lane][地址]：每个lane一个独立的累加器（避免写冲突），每组、每个lane一块双口BRAM，
+    // 每拍一个读口一个写口：统计组做read-modify-write，输出组读出后写0
+    // static：返回时两组都已经输出并清零，下次调用不需要INIT_LOOP（上电时为初始值0）
+    static unsigned int hist_bank[2][ACC][Cfg::ACC_DEPTH];
+    #pragma HLS ARRAY_PARTITION variable=hist_bank complete dim=1
+    #pragma HLS ARRAY_PARTITION variable=hist_bank complete dim=2
+#if HIST_HLS_USE_URAM
+    #pragma HLS BIND_STORAGE variable=hist_bank type=ram_s2p impl=uram
+#endif
+
+    // 转发寄存器：每组每个lane最近HIST_HLS_RMW_DEPTH次写入的地址和新值，[0]最新
+    AccAddr recent_bin[2][ACC][HIST_HLS_RMW_DEPTH];
+    unsigned int recent_count[2][ACC][HIST_HLS_RMW_DEPTH];
+    bool recent_valid[2][ACC][HIST_HLS_RMW_DEPTH];
+    #pragma HLS ARRAY_PARTITION variable=recent_bin complete dim=0
+    #pragma HLS ARRAY_PARTITION variable=recent_count complete dim=0
+    #pragma HLS ARRAY_PARTITION variable=recent_valid complete dim=0
+    for (int k = 0; k < 2; k++) {
+        #pragma HLS UNROLL
+        for (int a = 0; a < ACC; a++) {
+            #pragma HLS UNROLL
+            for (int h = 0; h < HIST_HLS_RMW_DEPTH; h++) {
+                #pragma HLS UNROLL
+                recent_valid[k][a][h] = false;
+            }
+        }
+    }
+
+    int acc_bank = 0;        // 统计当前帧的组，另一组是输出组
+    bool draining = false;   // 输出组中有一帧正在输出
+    unsigned int drain_word = 0; // 输出组正在输出的字：通道 = drain_word >> BIN_BITS
+    bool frame_full = false; // 统计组中有一帧已经结束，等输出组空出来再交换
+    bool in_frame = false;   // 已经收到当前帧的一部分
+    unsigned int beat_base = 0; // 本拍第一个样本在帧中的序号
+    unsigned int channel_phase = 0; // 本拍第一个样本的通道（beat_base % CHANNELS）
+    unsigned int frame_samples = 0;
+    unsigned int pixels_counted = 0;
+    unsigned int sample_count = pixel_count * CHANNELS;
+
+    PROCESS_LOOP: while (true) {
+        #pragma HLS PIPELINE II=1
+        // 转发窗口内的读写冲突由recent_*寄存器处理，窗口外BRAM里已经是最新值，所以可以声明没有跨迭代依赖
+        #pragma HLS DEPENDENCE variable=hist_bank inter false
+#ifndef __SYNTHESIS__
+        hist_csim_loop_iterations++;
+#endif
+
+        // 读取一拍数据（包含PIXELS_PER_BEAT个像素）；输出上一帧时不能阻塞，否则输出要等下一帧到来
+        ap_axiu<STREAM_BITS, 0, 0, 0> data;
+        bool have_beat = false;
+        if (!frame_full) {
+            if (draining) {
+                have_beat = image_stream.read_nb(data);
+            } else {
+                data = image_stream.read();
+                have_beat = true;
+            }
+        }
+
+        ap_uint<ACC> lane_valid;
+        for (int a = 0; a < ACC; a++) {
+            #pragma HLS UNROLL
+            lane_valid[a] = have_beat && data.keep[a * Cfg::LANE_BYTES] &&
+                            (pixel_count == 0 || beat_base + a < sample_count);
+        }
+        // 检测帧结束：TLAST（数据流结束）；指定了像素数时以像素数为准
+        bool frame_end = have_beat && (pixel_count != 0 ? beat_base + ACC >= sample_count : (bool)data.last);
+
+        unsigned int drain_channel = drain_word >> Cfg::BIN_BITS;
+        unsigned int drain_sum = 0;
+        for (int a = 0; a < ACC; a++) {
+            #pragma HLS UNROLL
+            ap_uint<Cfg::BIN_BITS> bin = hist_lane_bin<PIXEL_BITS, BINS, STREAM_BITS>(data.data, a);
+            // lane所属的通道：FIXED_LANE_CHANNELS时是常数 a % CHANNELS
+            unsigned int channel = Cfg::FIXED_LANE_CHANNELS ? (unsigned int)(a % CHANNELS)
+                                                            : (channel_phase + a) % CHANNELS;
+            AccAddr acc_addr = Cfg::FIXED_LANE_CHANNELS ? (AccAddr)bin
+                                                        : (AccAddr)((channel << Cfg::BIN_BITS) | bin);
+            // 输出组中这个lane是否有drain_word所在通道的计数
+            bool drain_lane = !Cfg::FIXED_LANE_CHANNELS || (unsigned int)(a % CHANNELS) == drain_channel;
+            AccAddr drain_addr = Cfg::FIXED_LANE_CHANNELS ? (AccAddr)(drain_word & (BINS - 1)) : (AccAddr)drain_word;
+
+            for (int k = 0; k < 2; k++) {
+                #pragma HLS UNROLL
+                // 统计组：读出样本所在的bin加1；输出组：读出drain_word累加到输出，再写0
+                bool accumulate = (k == acc_bank);
+                AccAddr addr = accumulate ? acc_addr : drain_addr;
+
+                // BRAM读出的值可能还不包含最近几拍的写入：从旧到新比较，最新的匹配优先
+                unsigned int count = hist_bank[k][a][addr];
+                for (int h = HIST_HLS_RMW_DEPTH - 1; h >= 0; h--) {
+                    #pragma HLS UNROLL
+                    if (recent_valid[k][a][h] && recent_bin[k][a][h] == addr) {
+                        count = recent_count[k][a][h];
+                    }
+                }
+
+                bool write;
+                if (accumulate) {
+                    count++;
+                    write = lane_valid[a];
+                } else {
+                    if (drain_lane) {
+                        drain_sum += count;
+                        count = 0;
+                    }
+                    write = draining && drain_lane;
+                }
+
+#ifdef __SYNTHESIS__
+                if (write) {
+                    hist_bank[k][a][addr] = count;
+                }
+#else
+                // C仿真模拟写回延迟：写入在移出转发窗口时才落到数组里，
+                // 这样转发逻辑有错误时，常数图像和长游程图像在C仿真中就会丢计数
+                if (recent_valid[k][a][HIST_HLS_RMW_DEPTH - 1]) {
+                    hist_bank[k][a][recent_bin[k][a][HIST_HLS_RMW_DEPTH - 1]] =
+                        recent_count[k][a][HIST_HLS_RMW_DEPTH - 1];
+                }
+#endif
+                for (int h = HIST_HLS_RMW_DEPTH - 1; h > 0; h--) {
+                    #pragma HLS UNROLL
+                    recent_bin[k][a][h] = recent_bin[k][a][h - 1];
+                    recent_count[k][a][h] = recent_count[k][a][h - 1];
+                    recent_valid[k][a][h] = recent_valid[k][a][h - 1];
+                }
+                recent_bin[k][a][0] = addr;
+                recent_count[k][a][0] = count;
+                recent_valid[k][a][0] = write;
+            }
+            frame_samples += lane_valid[a] ? 1 : 0;
+        }
+
+        // 合并累加器并输出上一帧的一个bin
+        if (draining) {
+            ap_axiu<32, 0, 0, 0> output_data;
+            output_data.data = drain_sum;
+            output_data.last = (drain_word == (unsigned int)(Cfg::OUTPUT_WORDS - 1));
+            output_data.keep = -1;
+            output_data.strb = -1;
+            histogram_stream.write(output_data);
+            if (drain_word == (unsigned int)(Cfg::OUTPUT_WORDS - 1)) {
+                draining = false;
+            }
+            drain_word++;
+        }
+
+        if (have_beat) {
+            beat_base += ACC;
+            channel_phase = (channel_phase + ACC) % CHANNELS;
+            in_frame = !frame_end;
+        }
+        if (frame_end) {
+            frame_full = true;
+            pixels_counted = frame_samples / CHANNELS;
+            frame_samples = 0;
+            beat_base = 0;
+            channel_phase = 0;
+        }
+        // 上一帧输出完后交换：刚结束的帧开始输出，另一组（已清零）开始统计下一帧
+        if (frame_full && !draining) {
+            acc_bank = 1 - acc_bank;
+            draining = true;
+            drain_word = 0;
+            frame_full = false;
+        }
+        // 输出完且没有收到下一帧的数据：输入空闲，返回
+        if (!draining && !frame_full && !in_frame) {
+            break;
+        }
+    }
+
+#ifndef __SYNTHESIS__
+    // C仿真：把还在转发窗口里的写入按从旧到新的顺序落到数组
+    for (int k = 0; k < 2; k++) {
+        for (int a = 0; a < ACC; a++) {
+            for (int h = HIST_HLS_RMW_DEPTH - 1; h >= 0; h--) {
+                if (recent_valid[k][a][h]) {
+                    hist_bank[k][a][recent_bin[k][a][h]] = recent_count[k][a][h];
+                }
+            }
+        }
+    }
+#endif
+    return pixels_counted;
+}
+
+// 顶层函数（HLS top），配置由 HIST_HLS_PIXEL_BITS / HIST_HLS_BINS / HIST_HLS_STREAM_BITS / HIST_HLS_CHANNELS 决定
+
+// v1：ap_ctrl_none，自动运行，每帧以TLAST结束
+void Hanwenip_v1_0_HLS(
+    hls::stream<ap_axiu<HIST_HLS_STREAM_BITS, 0, 0, 0> >& image_stream,
+    hls::stream<ap_axiu<32, 0, 0, 0> >& histogram_stream
+);
+
+// v2：AXI-Lite控制接口，pixel_count寄存器给出每帧像素数（0 = 以TLAST结束），
+// pixels_counted返回（最后一帧）实际统计的像素数，主机可以用它检查帧长度
+void Hanwenip_v2_0_HLS(
+    hls::stream<ap_axiu<HIST_HLS_STREAM_BITS, 0, 0, 0> >& image_stream,
+    hls::stream<ap_axiu<32, 0, 0, 0> >& histogram_stream,
+    unsigned int pixel_count,
+    unsigned int& pixels_counted
+);
+
+#endif // HISTOGRAM_HLS_H
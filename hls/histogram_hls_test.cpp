@@ -1,151 +1,381 @@
 // HLS Testbench for Histogram Computation
 // 用于 Vitis HLS 综合和仿真的测试平台
+// 先测试顶层函数（当前编译选项下的配置），再直接测试 histogram_core 的其他模板配置
+//
+// 编译选项：
+//   -DHIST_TB_SMALL_ONLY   跳过1080p/4K帧（co-sim时逐拍仿真，大帧很慢）
+//   -DHIST_TB_COSIM_FRAME=1080 / 2160  co-sim时只在顶层v2上跑一帧该大小的图像，用于测量吞吐（见 run_hls.tcl）
 
-#include <stdio.h>
-#include <stdlib.h>
-#include <string.h>
-#include "hls_stream.h"
-
-#define TEST_IMAGE_WIDTH 1920
-#define TEST_IMAGE_HEIGHT 1080
-
-#include "ap_int.h"
-#include "ap_axi_sdata.h"
-#include "hls_stream.h"
-
-#define HISTOGRAM_BINS 256
-
-
-
-// Testbench for Histogram HLS
-#include "ap_int.h"
-#include "ap_axi_sdata.h"
-#include "hls_stream.h"
+#include "histogram_hls.h"
+#include "histogram_core_model.h"
 #include <iostream>
+#include <cstdio>
 #include <cstdlib>
+#include <vector>
 
-#define HISTOGRAM_BINS 256
 #define IMAGE_WIDTH 32
 #define IMAGE_HEIGHT 32
-#define IMAGE_SIZE (IMAGE_WIDTH * IMAGE_HEIGHT)
+#define IMAGE_SIZE (IMAGE_WIDTH * IMAGE_HEIGHT) // 64的倍数，最宽的512位流（64像素/拍）也没有padding
 
-// 函数声明
-void Hanwenip_v1_0_HLS(
-    hls::stream<ap_axiu<32, 0, 0, 0> >& image_stream,
-    hls::stream<ap_axiu<32, 0, 0, 0> >& histogram_stream
-);
+// 不是每拍像素数整数倍的帧，最后一拍只有一部分有效
+#define ODD_WIDTH 37
+#define ODD_HEIGHT 29
 
-int main() {
-    std::cout << "=== Histogram HLS Testbench ===" << std::endl;
-    std::cout << "Image size: " << IMAGE_WIDTH << "x" << IMAGE_HEIGHT 
-              << " = " << IMAGE_SIZE << " pixels" << std::endl;
-    
-    // 创建测试图像
-    unsigned char test_image[IMAGE_SIZE];
-    for (int i = 0; i < IMAGE_HEIGHT; i++) {
-        for (int j = 0; j < IMAGE_WIDTH; j++) {
-            test_image[i * IMAGE_WIDTH + j] = (i * 13 + j * 7) % 256;
+#define PADDING_VALUE 0xABCD // padding lane填入非0值，被错误统计时会落到一个非0的bin里
+#define COUNT_NOT_REPORTED 0xFFFFFFFFu
+
+// 测试图像类型：后几种专门制造同一个累加器在相邻几拍内命中同一个bin的情况（read-modify-write冲突）
+enum TestPattern {
+    PATTERN_DEFAULT,  // 与CPU/GPU/PYNQ版本相同的测试图像
+    PATTERN_CONSTANT, // 所有像素相同：每个lane每拍都命中同一个bin
+    PATTERN_RUNS,     // 随机长度（1~64）的游程
+    PATTERN_PERIOD2,  // 整拍的像素相同，每2拍重复一次（冲突距离2）
+    PATTERN_PERIOD3,  // 每3拍重复一次（冲突距离3，正好是转发窗口的边界）
+    PATTERN_PERIOD4   // 每4拍重复一次（冲突距离超出转发窗口，由BRAM本身提供最新值）
+};
+static const char* pattern_names[] = {"default", "constant", "runs", "period-2", "period-3", "period-4"};
+#define NUM_PATTERNS 6
+
+// 帧的结束方式
+enum FrameMode {
+    FRAME_TLAST,   // TLAST结束，最后一拍的padding lane TKEEP为0
+    FRAME_COUNTED  // pixel_count给出像素数，TKEEP全1，padding lane只能靠像素数排除
+};
+static const char* frame_mode_names[] = {"TLAST+TKEEP", "pixel_count"};
+
+// 生成测试图像：默认图像8位时为 (i * 13 + j * 7) % 256，更宽的像素乘一个奇数把值分散到整个范围
+static void create_test_image(std::vector<unsigned short>& image, int width, int height, int pixel_bits,
+                              int pixels_per_beat, TestPattern pattern) {
+    int range = 1 << pixel_bits;
+    int scale = pixel_bits == 8 ? 1 : 97;
+    unsigned int seed = 2463534242u;
+    int run_left = 0;
+    unsigned short run_value = 0;
+    image.resize((size_t)width * height);
+    for (int i = 0; i < height; i++) {
+        for (int j = 0; j < width; j++) {
+            int idx = i * width + j;
+            int beat = idx / pixels_per_beat;
+            unsigned short value;
+            if (pattern == PATTERN_CONSTANT) {
+                value = (unsigned short)(range / 2 + 1);
+            } else if (pattern == PATTERN_RUNS) {
+                if (run_left == 0) {
+                    // xorshift32，保证每次运行生成相同的图像
+                    seed ^= seed << 13;
+                    seed ^= seed >> 17;
+                    seed ^= seed << 5;
+                    run_left = 1 + (int)(seed % 64);
+                    run_value = (unsigned short)((seed >> 8) % range);
+                }
+                run_left--;
+                value = run_value;
+            } else if (pattern >= PATTERN_PERIOD2) {
+                int period = 2 + (pattern - PATTERN_PERIOD2);
+                value = (unsigned short)(((beat % period) * 37 * scale) % range);
+            } else {
+                value = (unsigned short)(((i * 13 + j * 7) * scale) % range);
+            }
+            image[idx] = value;
         }
     }
-    
+}
+
+// 顶层函数包装成与 histogram_core 相同的调用形式
+typedef hls::stream<ap_axiu<HIST_HLS_STREAM_BITS, 0, 0, 0> > TopImageStream;
+static unsigned int run_top_v1(TopImageStream& image_stream, hls::stream<ap_axiu<32, 0, 0, 0> >& histogram_stream,
+                               unsigned int pixel_count) {
+    (void)pixel_count;
+    Hanwenip_v1_0_HLS(image_stream, histogram_stream);
+    return COUNT_NOT_REPORTED;
+}
+static unsigned int run_top_v2(TopImageStream& image_stream, hls::stream<ap_axiu<32, 0, 0, 0> >& histogram_stream,
+                               unsigned int pixel_count) {
+    unsigned int pixels_counted = 0;
+    Hanwenip_v2_0_HLS(image_stream, histogram_stream, pixel_count, pixels_counted);
+    return pixels_counted;
+}
+
+// 多通道配置在输出中的标记
+static const char* channel_suffix(int channels) {
+    return channels == 4 ? " RGBA" : channels == 3 ? " RGB" : channels == 2 ? " 2ch" : "";
+}
+
+// 生成一帧测试图像，写入输入流，并计算CPU参考结果
+// 多通道时图像是交错的样本，每行 width * CHANNELS 个样本，样本i属于通道 i % CHANNELS
+template <int PIXEL_BITS, int BINS, int STREAM_BITS, int CHANNELS>
+void push_frame(hls::stream<ap_axiu<STREAM_BITS, 0, 0, 0> >& image_stream, std::vector<unsigned int>& cpu_histogram,
+                TestPattern pattern, FrameMode mode, int width, int height) {
+    typedef HistCoreConfig<PIXEL_BITS, BINS, STREAM_BITS, CHANNELS> Cfg;
+    int num_pixels = width * height * CHANNELS; // 样本数
+
+    std::vector<unsigned short> image;
+    create_test_image(image, width * CHANNELS, height, PIXEL_BITS, Cfg::PIXELS_PER_BEAT, pattern);
+
     // 计算CPU参考结果
-    unsigned int cpu_histogram[HISTOGRAM_BINS] = {0};
-    for (int i = 0; i < IMAGE_SIZE; i++) {
-        cpu_histogram[test_image[i]]++;
+    cpu_histogram.assign(Cfg::OUTPUT_WORDS, 0);
+    for (int i = 0; i < num_pixels; i++) {
+        cpu_histogram[(i % CHANNELS) * BINS + (image[i] >> Cfg::BIN_SHIFT)]++;
     }
-    
-    // 准备输入流
-    hls::stream<ap_axiu<32, 0, 0, 0> > image_stream;
-    hls::stream<ap_axiu<32, 0, 0, 0> > histogram_stream;
-    
-    int pixels_per_word = 4;
-    int num_words = (IMAGE_SIZE + pixels_per_word - 1) / pixels_per_word;
-    
-    std::cout << "Preparing input stream: " << num_words << " words" << std::endl;
-    
-    for (int i = 0; i < num_words; i++) {
-        ap_axiu<32, 0, 0, 0> data;
-        
-        // 打包4个像素到1个32位数据
-        int base_idx = i * pixels_per_word;
-        ap_uint<32> packed = 0;
-        
-        for (int j = 0; j < pixels_per_word; j++) {
-            int idx = base_idx + j;
-            if (idx < IMAGE_SIZE) {
-                packed.range((j+1)*8-1, j*8) = test_image[idx];
-            } else {
-                packed.range((j+1)*8-1, j*8) = 0;  // padding
+
+    // 准备输入流：每拍PIXELS_PER_BEAT个像素，每个像素占LANE_BITS位
+    int num_beats = (num_pixels + Cfg::PIXELS_PER_BEAT - 1) / Cfg::PIXELS_PER_BEAT;
+    unsigned short padding = (unsigned short)(PADDING_VALUE & ((1 << PIXEL_BITS) - 1));
+    for (int i = 0; i < num_beats; i++) {
+        ap_axiu<STREAM_BITS, 0, 0, 0> data;
+        ap_uint<STREAM_BITS> packed = 0;
+        data.keep = -1;
+        for (int j = 0; j < Cfg::PIXELS_PER_BEAT; j++) {
+            int idx = i * Cfg::PIXELS_PER_BEAT + j;
+            packed.range((j + 1) * Cfg::LANE_BITS - 1, j * Cfg::LANE_BITS) = idx < num_pixels ? image[idx] : padding;
+            if (idx >= num_pixels && mode == FRAME_TLAST) {
+                data.keep.range((j + 1) * Cfg::LANE_BYTES - 1, j * Cfg::LANE_BYTES) = 0;
             }
         }
-        
         data.data = packed;
-        data.last = (i == num_words - 1) ? 1 : 0;  // 最后一个数据设置TLAST
-        data.keep = -1;
-        data.strb = -1;
+        data.strb = data.keep;
+        // 最后一拍设置TLAST；pixel_count模式下核心不看TLAST，这里故意不设置
+        data.last = (mode == FRAME_TLAST && i == num_beats - 1) ? 1 : 0;
         image_stream.write(data);
     }
-    
-    // 调用HLS函数
-    std::cout << "Calling HLS function..." << std::endl;
-    Hanwenip_v1_0_HLS(image_stream, histogram_stream);
-    
-    // 读取并验证结果
-    std::cout << "Verifying results..." << std::endl;
+}
+
+// 读取一帧的WORDS个输出（CHANNELS*BINS）并与CPU参考结果比较，返回错误数
+template <int WORDS>
+int check_histogram(hls::stream<ap_axiu<32, 0, 0, 0> >& histogram_stream,
+                    const std::vector<unsigned int>& cpu_histogram, bool show_bins) {
     int errors = 0;
-    
-    for (int i = 0; i < HISTOGRAM_BINS; i++) {
+    if (histogram_stream.size() < (size_t)WORDS) {
+        std::cout << "Error: only " << histogram_stream.size() << " histogram words written" << std::endl;
+        return 1;
+    }
+    if (show_bins) {
+        std::cout << "\nFirst 10 histogram values:" << std::endl;
+        std::cout << "Bin\tHW\tCPU\tMatch" << std::endl;
+    }
+    for (int i = 0; i < WORDS; i++) {
         ap_axiu<32, 0, 0, 0> output_data = histogram_stream.read();
         unsigned int hw_value = output_data.data;
-        unsigned int cpu_value = cpu_histogram[i];
-        
-        if (hw_value != cpu_value) {
+        if (show_bins && i < 10) {
+            std::cout << i << "\t" << hw_value << "\t" << cpu_histogram[i]
+                      << "\t" << (hw_value == cpu_histogram[i] ? "✓" : "✗") << std::endl;
+        }
+        if (hw_value != cpu_histogram[i]) {
             if (errors < 10) {
-                std::cout << "Error at bin " << i << ": HW=" << hw_value 
-                         << ", CPU=" << cpu_value << std::endl;
+                std::cout << "Error at bin " << i << ": HW=" << hw_value
+                          << ", CPU=" << cpu_histogram[i] << std::endl;
             }
             errors++;
         }
-    }
-    
-    // 显示前10个结果
-    std::cout << "\nFirst 10 histogram values:" << std::endl;
-    std::cout << "Bin\tHW\tCPU\tMatch" << std::endl;
-    
-    // 重新运行以获取结果显示
-    for (int i = 0; i < num_words; i++) {
-        ap_axiu<32, 0, 0, 0> data;
-        int base_idx = i * pixels_per_word;
-        ap_uint<32> packed = 0;
-        
-        for (int j = 0; j < pixels_per_word; j++) {
-            int idx = base_idx + j;
-            if (idx < IMAGE_SIZE) {
-                packed.range((j+1)*8-1, j*8) = test_image[idx];
-            }
+        if ((output_data.last == 1) != (i == WORDS - 1)) {
+            std::cout << "Error: TLAST at bin " << i << std::endl;
+            errors++;
         }
-        
-        data.data = packed;
-        data.last = (i == num_words - 1) ? 1 : 0;
-        data.keep = -1;
-        data.strb = -1;
-        image_stream.write(data);
     }
-    
-    Hanwenip_v1_0_HLS(image_stream, histogram_stream);
-    
-    for (int i = 0; i < 10; i++) {
-        ap_axiu<32, 0, 0, 0> output_data = histogram_stream.read();
-        unsigned int hw_value = output_data.data;
-        std::cout << i << "\t" << hw_value << "\t" << cpu_histogram[i] 
-                 << "\t" << (hw_value == cpu_histogram[i] ? "✓" : "✗") << std::endl;
+    return errors;
+}
+
+// 打包像素 -> 运行核心 -> 与CPU参考结果比较，返回错误数
+template <int PIXEL_BITS, int BINS, int STREAM_BITS, int CHANNELS = 1, typename Core>
+int test_config(Core core, const char* name, TestPattern pattern, FrameMode mode, int width, int height,
+                bool show_bins) {
+    typedef HistCoreConfig<PIXEL_BITS, BINS, STREAM_BITS, CHANNELS> Cfg;
+    int num_pixels = width * height;
+
+    hls::stream<ap_axiu<STREAM_BITS, 0, 0, 0> > image_stream;
+    hls::stream<ap_axiu<32, 0, 0, 0> > histogram_stream;
+    std::vector<unsigned int> cpu_histogram;
+    push_frame<PIXEL_BITS, BINS, STREAM_BITS, CHANNELS>(image_stream, cpu_histogram, pattern, mode, width, height);
+
+    unsigned int pixels_counted = core(image_stream, histogram_stream,
+                                       mode == FRAME_COUNTED ? (unsigned int)num_pixels : 0u);
+
+    // 读取并验证结果
+    int errors = check_histogram<Cfg::OUTPUT_WORDS>(histogram_stream, cpu_histogram, show_bins);
+    if (pixels_counted != COUNT_NOT_REPORTED && pixels_counted != (unsigned int)num_pixels) {
+        std::cout << "Error: pixels_counted=" << pixels_counted << ", expected " << num_pixels << std::endl;
+        errors++;
+    }
+    if (!image_stream.empty()) {
+        std::cout << "Error: " << image_stream.size() << " input beats left unread" << std::endl;
+        errors++;
+    }
+
+    printf("  %-18s %2d-bit, %4d bins%-5s, %3d-bit (%2d px/beat), %4dx%-4d %-8s %-11s: %s\n",
+           name, PIXEL_BITS, BINS, channel_suffix(CHANNELS), STREAM_BITS, Cfg::PIXELS_PER_BEAT, width, height,
+           pattern_names[pattern],
+           frame_mode_names[mode], errors == 0 ? "PASS" : "FAIL");
+    return errors;
+}
+
+// 一个配置在所有测试图像上运行，再测试两种结束方式下不是整拍的帧
+template <int PIXEL_BITS, int BINS, int STREAM_BITS, int CHANNELS = 1, typename Core>
+int test_config_all(Core core, const char* name, bool counted) {
+    int errors = 0;
+    for (int p = 0; p < NUM_PATTERNS; p++) {
+        errors += test_config<PIXEL_BITS, BINS, STREAM_BITS, CHANNELS>(core, name, (TestPattern)p, FRAME_TLAST,
+                                                             IMAGE_WIDTH, IMAGE_HEIGHT, false);
     }
-    
-    // 清空剩余数据
-    for (int i = 10; i < HISTOGRAM_BINS; i++) {
-        histogram_stream.read();
+    errors += test_config<PIXEL_BITS, BINS, STREAM_BITS, CHANNELS>(core, name, PATTERN_DEFAULT, FRAME_TLAST,
+                                                         ODD_WIDTH, ODD_HEIGHT, false);
+    if (counted) {
+        errors += test_config<PIXEL_BITS, BINS, STREAM_BITS, CHANNELS>(core, name, PATTERN_DEFAULT, FRAME_COUNTED,
+                                                             ODD_WIDTH, ODD_HEIGHT, false);
+        errors += test_config<PIXEL_BITS, BINS, STREAM_BITS, CHANNELS>(core, name, PATTERN_CONSTANT, FRAME_COUNTED,
+                                                             ODD_WIDTH, ODD_HEIGHT, false);
+    }
+    return errors;
+}
+
+// 背靠背的帧：一次写入num_frames帧（轮流使用各种测试图像），核心一次调用处理完，逐帧检查结果，
+// 并检查PROCESS_LOOP的迭代次数：上一帧的输出与下一帧的统计重叠，只有帧短于BINS拍时才等待输出
+template <int PIXEL_BITS, int BINS, int STREAM_BITS, int CHANNELS = 1, typename Core>
+int test_back_to_back(Core core, const char* name, FrameMode mode, int width, int height, int num_frames) {
+    typedef HistCoreConfig<PIXEL_BITS, BINS, STREAM_BITS, CHANNELS> Cfg;
+    int num_pixels = width * height;
+    unsigned long num_beats = ((unsigned long)num_pixels * CHANNELS + Cfg::PIXELS_PER_BEAT - 1) / Cfg::PIXELS_PER_BEAT;
+
+    hls::stream<ap_axiu<STREAM_BITS, 0, 0, 0> > image_stream;
+    hls::stream<ap_axiu<32, 0, 0, 0> > histogram_stream;
+    std::vector<std::vector<unsigned int> > cpu_histograms(num_frames);
+    for (int f = 0; f < num_frames; f++) {
+        push_frame<PIXEL_BITS, BINS, STREAM_BITS, CHANNELS>(image_stream, cpu_histograms[f],
+                                                            (TestPattern)(f % NUM_PATTERNS), mode, width, height);
     }
-    
+
+    unsigned long start_iterations = hist_csim_loop_iterations;
+    unsigned int pixels_counted = core(image_stream, histogram_stream,
+                                       mode == FRAME_COUNTED ? (unsigned int)num_pixels : 0u);
+    unsigned long iterations = hist_csim_loop_iterations - start_iterations;
+
+    int errors = 0;
+    for (int f = 0; f < num_frames; f++) {
+        errors += check_histogram<Cfg::OUTPUT_WORDS>(histogram_stream, cpu_histograms[f], false);
+    }
+    if (pixels_counted != COUNT_NOT_REPORTED && pixels_counted != (unsigned int)num_pixels) {
+        std::cout << "Error: pixels_counted=" << pixels_counted << ", expected " << num_pixels << std::endl;
+        errors++;
+    }
+    if (!image_stream.empty() || !histogram_stream.empty()) {
+        std::cout << "Error: " << image_stream.size() << " input beats / " << histogram_stream.size()
+                  << " output words left" << std::endl;
+        errors++;
+    }
+    unsigned long words = Cfg::OUTPUT_WORDS;
+    unsigned long frame_period = num_beats > words ? num_beats : words;
+    unsigned long expected = num_beats + (num_frames - 1) * frame_period + words;
+    if (iterations != expected) {
+        std::cout << "Error: " << iterations << " loop iterations, expected " << expected << std::endl;
+        errors++;
+    }
+    // 周期模型（histogram_core_model.h）在理想输入输出下预测的迭代次数应与C仿真相同
+    HistCoreParams params(PIXEL_BITS, BINS, STREAM_BITS, CHANNELS);
+    HistCoreCycles model = hist_model_ideal_cycles(params, mode == FRAME_COUNTED ? (unsigned int)num_pixels : 0u,
+                                                   num_beats, num_frames);
+    unsigned long long model_iterations = model.cycles - model.calls * params.call_overhead;
+    if (model_iterations != iterations) {
+        std::cout << "Error: cycle model predicts " << model_iterations << " loop iterations" << std::endl;
+        errors++;
+    }
+
+    printf("  %-18s %2d-bit, %4d bins%-5s, %3d-bit (%2d px/beat), %4dx%-4d x%-2d %-11s: %lu cycles (%lu/frame) %s\n",
+           name, PIXEL_BITS, BINS, channel_suffix(CHANNELS), STREAM_BITS, Cfg::PIXELS_PER_BEAT, width, height,
+           num_frames,
+           frame_mode_names[mode], iterations, frame_period, errors == 0 ? "PASS" : "FAIL");
+    return errors;
+}
+
+int main() {
+    std::cout << "=== Histogram HLS Testbench ===" << std::endl;
+    int errors = 0;
+
+#ifdef HIST_TB_COSIM_FRAME
+    // co-sim吞吐测量：只跑一帧，延迟（周期数）见co-sim报告，吞吐 = 像素数 / (周期数 / 时钟频率)
+    int height = HIST_TB_COSIM_FRAME;
+    int width = height * 16 / 9;
+    std::cout << "Co-sim frame: " << width << "x" << height << std::endl;
+    errors += test_config<HIST_HLS_PIXEL_BITS, HIST_HLS_BINS, HIST_HLS_STREAM_BITS, HIST_HLS_CHANNELS>(
+        run_top_v2, "Hanwenip_v2_0_HLS", PATTERN_DEFAULT, FRAME_COUNTED, width, height, false);
+#else
+    std::cout << "Image size: " << IMAGE_WIDTH << "x" << IMAGE_HEIGHT
+              << " = " << IMAGE_SIZE << " pixels" << std::endl;
+
+    // 顶层函数：默认图像显示前10个bin，再跑一遍所有冲突图像和不是整拍的帧
+    // C仿真中累加器的写回被推迟到移出转发窗口之后（见histogram_core），冲突图像能验证II=1下的转发逻辑
+    std::cout << "\nTop-level cores:" << std::endl;
+    errors += test_config<HIST_HLS_PIXEL_BITS, HIST_HLS_BINS, HIST_HLS_STREAM_BITS, HIST_HLS_CHANNELS>(
+        run_top_v1, "Hanwenip_v1_0_HLS", PATTERN_DEFAULT, FRAME_TLAST, IMAGE_WIDTH, IMAGE_HEIGHT, true);
+    errors += test_config_all<HIST_HLS_PIXEL_BITS, HIST_HLS_BINS, HIST_HLS_STREAM_BITS, HIST_HLS_CHANNELS>(
+        run_top_v1, "Hanwenip_v1_0_HLS", false);
+    errors += test_config_all<HIST_HLS_PIXEL_BITS, HIST_HLS_BINS, HIST_HLS_STREAM_BITS, HIST_HLS_CHANNELS>(
+        run_top_v2, "Hanwenip_v2_0_HLS", true);
+
+    // 背靠背的帧：帧比BINS拍长、正好BINS拍、比BINS拍短
+    std::cout << "\nBack-to-back frames:" << std::endl;
+    errors += test_back_to_back<HIST_HLS_PIXEL_BITS, HIST_HLS_BINS, HIST_HLS_STREAM_BITS, HIST_HLS_CHANNELS>(
+        run_top_v1, "Hanwenip_v1_0_HLS", FRAME_TLAST, 64, 64, 8);
+    errors += test_back_to_back<HIST_HLS_PIXEL_BITS, HIST_HLS_BINS, HIST_HLS_STREAM_BITS, HIST_HLS_CHANNELS>(
+        run_top_v1, "Hanwenip_v1_0_HLS", FRAME_TLAST, IMAGE_WIDTH, IMAGE_HEIGHT, 8);
+    errors += test_back_to_back<HIST_HLS_PIXEL_BITS, HIST_HLS_BINS, HIST_HLS_STREAM_BITS, HIST_HLS_CHANNELS>(
+        run_top_v1, "Hanwenip_v1_0_HLS", FRAME_TLAST, 8, 8, 8);
+    errors += test_back_to_back<HIST_HLS_PIXEL_BITS, HIST_HLS_BINS, HIST_HLS_STREAM_BITS, HIST_HLS_CHANNELS>(
+        run_top_v2, "Hanwenip_v2_0_HLS", FRAME_COUNTED, ODD_WIDTH, ODD_HEIGHT, 8);
+    errors += test_back_to_back<HIST_HLS_PIXEL_BITS, HIST_HLS_BINS, HIST_HLS_STREAM_BITS, HIST_HLS_CHANNELS>(
+        run_top_v2, "Hanwenip_v2_0_HLS", FRAME_COUNTED, 1, 1, 4);
+    errors += test_back_to_back<8, 256, 128>(histogram_core<8, 256, 128>, "histogram_core", FRAME_TLAST,
+                                             ODD_WIDTH, ODD_HEIGHT, 6);
+    errors += test_back_to_back<12, 4096, 128>(histogram_core<12, 4096, 128>, "histogram_core", FRAME_COUNTED,
+                                               256, 256, 3);
+
+#ifndef HIST_TB_SMALL_ONLY
+    // 多兆像素帧：1080p和4K，两种结束方式
+    std::cout << "\nLarge frames:" << std::endl;
+    errors += test_config<HIST_HLS_PIXEL_BITS, HIST_HLS_BINS, HIST_HLS_STREAM_BITS, HIST_HLS_CHANNELS>(
+        run_top_v2, "Hanwenip_v2_0_HLS", PATTERN_DEFAULT, FRAME_COUNTED, 1920, 1080, false);
+    errors += test_config<HIST_HLS_PIXEL_BITS, HIST_HLS_BINS, HIST_HLS_STREAM_BITS, HIST_HLS_CHANNELS>(
+        run_top_v2, "Hanwenip_v2_0_HLS", PATTERN_DEFAULT, FRAME_COUNTED, 3840, 2160, false);
+    errors += test_config<HIST_HLS_PIXEL_BITS, HIST_HLS_BINS, HIST_HLS_STREAM_BITS, HIST_HLS_CHANNELS>(
+        run_top_v1, "Hanwenip_v1_0_HLS", PATTERN_CONSTANT, FRAME_TLAST, 3840, 2160, false);
+#endif
+
+    // 其他模板配置：流宽度从32到512位，像素8/10/12/16位，带bin量化
+    std::cout << "\nTemplate configurations (histogram_core):" << std::endl;
+    errors += test_config_all<8, 256, 32>(histogram_core<8, 256, 32>, "histogram_core", true);
+    errors += test_config_all<8, 256, 64>(histogram_core<8, 256, 64>, "histogram_core", true);
+    errors += test_config_all<8, 256, 128>(histogram_core<8, 256, 128>, "histogram_core", true);
+    errors += test_config_all<8, 256, 256>(histogram_core<8, 256, 256>, "histogram_core", true);
+    errors += test_config_all<8, 256, 512>(histogram_core<8, 256, 512>, "histogram_core", true);
+    errors += test_config_all<8, 64, 128>(histogram_core<8, 64, 128>, "histogram_core", true);
+    errors += test_config_all<10, 1024, 64>(histogram_core<10, 1024, 64>, "histogram_core", true);
+    errors += test_config_all<10, 256, 128>(histogram_core<10, 256, 128>, "histogram_core", true);
+    errors += test_config_all<12, 4096, 128>(histogram_core<12, 4096, 128>, "histogram_core", true);
+    errors += test_config_all<12, 256, 256>(histogram_core<12, 256, 256>, "histogram_core", true);
+    errors += test_config_all<16, 256, 512>(histogram_core<16, 256, 512>, "histogram_core", true);
+
+    // 高位深全分辨率：16位像素65536个bin（作为顶层配置时累加器放在URAM里），12/16位量化到4096个bin
+    // 65536个bin时每帧输出65536拍，比256x256的帧（32768拍）还长，背靠背测试的下一帧要等输出
+    std::cout << "\nHigh bit depth configurations (histogram_core):" << std::endl;
+    errors += test_config_all<16, 65536, 32>(histogram_core<16, 65536, 32>, "histogram_core", true);
+    errors += test_config_all<16, 65536, 128>(histogram_core<16, 65536, 128>, "histogram_core", true);
+    errors += test_config_all<16, 4096, 64>(histogram_core<16, 4096, 64>, "histogram_core", true);
+    errors += test_config_all<12, 4096, 32>(histogram_core<12, 4096, 32>, "histogram_core", true);
+    errors += test_back_to_back<16, 65536, 32>(histogram_core<16, 65536, 32>, "histogram_core", FRAME_COUNTED,
+                                               256, 256, 3);
+
+    // 多通道（交错的RGB/RGBA）：通道数整除lane数时lane固定属于一个通道，否则通道逐拍轮换
+    std::cout << "\nMulti-channel configurations (histogram_core):" << std::endl;
+    errors += test_config_all<8, 256, 32, 4>(histogram_core<8, 256, 32, 4>, "histogram_core", true);
+    errors += test_config_all<8, 256, 32, 3>(histogram_core<8, 256, 32, 3>, "histogram_core", true);
+    errors += test_config_all<8, 256, 64, 2>(histogram_core<8, 256, 64, 2>, "histogram_core", true);
+    errors += test_config_all<8, 256, 128, 3>(histogram_core<8, 256, 128, 3>, "histogram_core", true);
+    errors += test_config_all<8, 256, 512, 4>(histogram_core<8, 256, 512, 4>, "histogram_core", true);
+    errors += test_config_all<10, 1024, 64, 3>(histogram_core<10, 1024, 64, 3>, "histogram_core", true);
+    errors += test_back_to_back<8, 256, 32, 3>(histogram_core<8, 256, 32, 3>, "histogram_core", FRAME_COUNTED,
+                                               ODD_WIDTH, ODD_HEIGHT, 6);
+    errors += test_back_to_back<8, 256, 32, 4>(histogram_core<8, 256, 32, 4>, "histogram_core", FRAME_TLAST,
+                                               64, 64, 6);
+#endif
+
     // 显示结果
     if (errors == 0) {
         std::cout << "\n==================================" << std::endl;
@@ -159,4 +389,4 @@ int main() {
         std::cout << "==================================" << std::endl;
         return 1;
     }
-}
\ No newline at end of file
+}
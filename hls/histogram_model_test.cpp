@@ -0,0 +1,542 @@
+// histogram_model_test.cpp
+// 直方图核心软件模型（histogram_core_model.h）的随机差分测试和吞吐估算，不需要Vitis HLS
+//
+// 用法：
+//   histogram_model_test [cases [seed]]
+//       随机测试（默认2000个用例）：随机的核心配置、图像尺寸、像素分布、分帧方式、背靠背帧数、
+//       输入间隙和输出反压，每帧与libhist的CPU参考实现逐bin比较，并检查拍数、输出周期和理想情况下的总周期数
+//   histogram_model_test --predict [选项]
+//       估算一种配置处理背靠背帧的周期数和吞吐：
+//       --pixel-bits N --bins N --stream-bits N --channels N   核心配置（默认 8 256 32 1）
+//       --width N --height N --frames N                        帧大小和帧数（默认 1920 1080 4）
+//       --clock-mhz F                                          核心时钟（默认100）
+//       --input-bytes-per-cycle F                              输入带宽上限，例如DMA的HP口，默认不限
+//       --counted                                              pixel_count分帧（v2），默认TLAST分帧（v1）
+//       --call-overhead N                                      每次函数启动的周期数（用co-sim的latency校准）
+// 编译：
+//   g++ -O2 -Wall -Ilibhist -Ihls hls/histogram_model_test.cpp -x c libhist/*.c -pthread -o histogram_model_test
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+
+#include "hist.h"
+#include "histogram_core_model.h"
+
+#define PADDING_VALUE 0xABCD // padding lane填入非0值，被错误统计时会落到一个非0的bin里
+
+// xorshift64*，结果只依赖种子
+struct Rng {
+    uint64_t state;
+    explicit Rng(uint64_t seed) : state(seed ? seed : 0x9E3779B97F4A7C15ull) {}
+    uint64_t next() {
+        state ^= state >> 12;
+        state ^= state << 25;
+        state ^= state >> 27;
+        return state * 2685821657736338717ull;
+    }
+    unsigned int below(unsigned int n) { return (unsigned int)(next() % n); }
+    double uniform() { return (next() >> 11) * (1.0 / 9007199254740992.0); }
+};
+
+// 像素分布
+enum Distribution {
+    DIST_UNIFORM,   // 均匀随机
+    DIST_CONSTANT,  // 所有像素相同
+    DIST_RUNS,      // 随机长度的游程
+    DIST_GRADIENT,  // (i * 13 + j * 7)，与其他版本的测试图像相同
+    DIST_NORMAL,    // 4个均匀分布的和，集中在中间的bin
+    DIST_SPARSE,    // 99%是同一个值，少数随机值
+    DIST_EXTREMES,  // 只有0和最大值
+    DIST_HIGH_BITS  // 均匀随机，lane中高于pixel_bits的位也是随机的（核心和参考实现都应忽略）
+};
+static const char *dist_names[] = {"uniform", "constant", "runs", "gradient", "normal", "sparse", "extremes",
+                                   "high-bits"};
+#define NUM_DISTRIBUTIONS 8
+
+// 输入流上的一帧
+struct PackedFrame {
+    std::vector<unsigned char> data; // beats * beat_bytes
+    std::vector<uint64_t> keep;
+    std::vector<char> last;
+    size_t beats() const { return keep.size(); }
+};
+
+// 输入输出的流量：每个周期输入有数据、输出就绪的概率，输入带宽上限（0为不限），每帧之后的空闲周期
+struct Traffic {
+    double input_valid;
+    double output_ready;
+    double input_bytes_per_cycle;
+    int gap_cycles;
+};
+
+struct RunResult {
+    std::vector<std::vector<uint32_t> > outputs;       // 每帧的输出字
+    std::vector<unsigned long long> frame_done_cycle; // 每帧最后一个输出字所在的周期
+    bool hang;
+};
+
+static const char *channel_suffix(int channels) {
+    return channels == 4 ? " RGBA" : channels == 3 ? " RGB" : channels == 2 ? " 2ch" : "";
+}
+
+static void print_params(const HistCoreParams &p) {
+    printf("%2d-bit, %5d bins%-5s, %3d-bit (%2d px/beat)", p.pixel_bits, p.bins, channel_suffix(p.channels),
+           p.stream_bits, p.lanes());
+}
+
+static unsigned short sample_value(Distribution dist, Rng &rng, int index, int width, int lane_bits,
+                                   int pixel_bits, unsigned short constant, int *run_left, unsigned short *run_value) {
+    unsigned int range = 1u << pixel_bits;
+    switch (dist) {
+    case DIST_CONSTANT:
+        return constant;
+    case DIST_RUNS:
+        if (*run_left == 0) {
+            *run_left = 1 + (int)rng.below(64);
+            *run_value = (unsigned short)rng.below(range);
+        }
+        (*run_left)--;
+        return *run_value;
+    case DIST_GRADIENT:
+        return (unsigned short)(((index / width) * 13 + (index % width) * 7) % range);
+    case DIST_NORMAL:
+        return (unsigned short)((rng.below(range) + rng.below(range) + rng.below(range) + rng.below(range)) / 4);
+    case DIST_SPARSE:
+        return rng.below(100) == 0 ? (unsigned short)rng.below(range) : constant;
+    case DIST_EXTREMES:
+        return rng.below(2) ? (unsigned short)(range - 1) : 0;
+    case DIST_HIGH_BITS:
+        return (unsigned short)rng.below(1u << lane_bits);
+    default:
+        return (unsigned short)rng.below(range);
+    }
+}
+
+// 生成一帧交错的样本（width * height * channels 个）
+static void create_samples(const HistCoreParams &p, Distribution dist, int width, int height, Rng &rng,
+                           std::vector<unsigned short> &samples) {
+    int row = width * p.channels;
+    size_t count = (size_t)row * height;
+    unsigned short constant = (unsigned short)rng.below(1u << p.pixel_bits);
+    int run_left = 0;
+    unsigned short run_value = 0;
+    samples.resize(count);
+    for (size_t i = 0; i < count; i++) {
+        samples[i] = sample_value(dist, rng, (int)i, row, 8 * p.lane_bytes(), p.pixel_bits, constant, &run_left,
+                                  &run_value);
+    }
+}
+
+// 参考结果：libhist的CPU参考实现，按通道、bin顺序
+static void reference_histogram(const HistCoreParams &p, const std::vector<unsigned short> &samples,
+                                std::vector<unsigned int> &reference) {
+    int num_pixels = (int)(samples.size() / p.channels);
+    reference.assign(p.output_words(), 0);
+    if (p.pixel_bits == 8 && p.bins == 256) {
+        std::vector<unsigned char> bytes(samples.size());
+        for (size_t i = 0; i < samples.size(); i++) {
+            bytes[i] = (unsigned char)samples[i];
+        }
+        if (p.channels == 1) {
+            compute_histogram_cpu(bytes.empty() ? NULL : &bytes[0], num_pixels, &reference[0]);
+        } else {
+            compute_histogram_cpu_channels(bytes.empty() ? NULL : &bytes[0], num_pixels, p.channels, &reference[0]);
+        }
+        return;
+    }
+    std::vector<unsigned short> plane(num_pixels);
+    for (int c = 0; c < p.channels; c++) {
+        for (int i = 0; i < num_pixels; i++) {
+            plane[i] = samples[(size_t)i * p.channels + c];
+        }
+        compute_histogram_cpu_u16(plane.empty() ? NULL : &plane[0], num_pixels, p.pixel_bits, p.bin_shift(),
+                                  &reference[(size_t)c * p.bins]);
+    }
+}
+
+// 把样本打包成拍：TLAST分帧时最后一拍的TKEEP只覆盖剩余的样本（与DMA一样按字节）；
+// pixel_count分帧时TKEEP全1，TLAST在随机大小的DMA传输结尾（核心不看TLAST）
+static void pack_frame(const HistCoreParams &p, const std::vector<unsigned short> &samples, bool counted, Rng &rng,
+                       PackedFrame &frame) {
+    int lanes = p.lanes();
+    int lane_bytes = p.lane_bytes();
+    int beat_bytes = p.beat_bytes();
+    size_t count = samples.size();
+    size_t beats = (count + lanes - 1) / lanes;
+    uint64_t full_keep = beat_bytes == 64 ? ~0ull : (1ull << beat_bytes) - 1;
+    unsigned short padding = (unsigned short)(PADDING_VALUE & ((1u << (8 * lane_bytes)) - 1));
+    size_t chunk_beats = 1 + rng.below(4096);
+    frame.data.assign(beats * beat_bytes, 0);
+    frame.keep.assign(beats, full_keep);
+    frame.last.assign(beats, 0);
+    for (size_t b = 0; b < beats; b++) {
+        unsigned char *beat = &frame.data[b * beat_bytes];
+        for (int a = 0; a < lanes; a++) {
+            size_t idx = b * lanes + a;
+            unsigned short value = idx < count ? samples[idx] : padding;
+            beat[a * lane_bytes] = (unsigned char)value;
+            if (lane_bytes == 2) {
+                beat[a * lane_bytes + 1] = (unsigned char)(value >> 8);
+            }
+            if (idx >= count && !counted) {
+                frame.keep[b] &= ~(((1ull << lane_bytes) - 1) << (a * lane_bytes));
+            }
+        }
+        frame.last[b] = counted ? (b + 1) % chunk_beats == 0 : b == beats - 1;
+    }
+}
+
+// 按流量逐周期运行核心，直到所有帧都已输入且核心空闲
+static void run_core(HistCoreModel &core, const std::vector<const PackedFrame *> &frames, const Traffic &traffic,
+                     Rng &rng, RunResult &result) {
+    int beat_bytes = core.params().beat_bytes();
+    size_t f = 0;
+    size_t b = 0;
+    int gap_left = 0;
+    double credit = beat_bytes;
+    unsigned long long limit = 1000000;
+    for (size_t i = 0; i < frames.size(); i++) {
+        limit += (frames[i]->beats() + core.params().output_words()) * 64ull;
+    }
+    result.outputs.assign(1, std::vector<uint32_t>());
+    result.frame_done_cycle.clear();
+    result.hang = false;
+    while (f < frames.size() || !core.idle()) {
+        if (core.cycles().cycles > limit) {
+            result.hang = true;
+            break;
+        }
+        bool available = f < frames.size() && gap_left == 0;
+        if (traffic.input_bytes_per_cycle > 0) {
+            credit += traffic.input_bytes_per_cycle;
+            if (credit > 2.0 * beat_bytes) {
+                credit = 2.0 * beat_bytes;
+            }
+            available = available && credit >= beat_bytes;
+        }
+        available = available && (traffic.input_valid >= 1.0 || rng.uniform() < traffic.input_valid);
+        bool output_ready = traffic.output_ready >= 1.0 || rng.uniform() < traffic.output_ready;
+        if (gap_left > 0) {
+            gap_left--;
+        }
+
+        HistBeat beat;
+        if (available) {
+            beat.data = &frames[f]->data[b * beat_bytes];
+            beat.keep = frames[f]->keep[b];
+            beat.last = frames[f]->last[b] != 0;
+        }
+        uint32_t word = 0;
+        bool out_valid = false;
+        bool out_last = false;
+        if (core.step(available ? &beat : NULL, output_ready, &word, &out_valid, &out_last)) {
+            credit -= beat_bytes;
+            if (++b == frames[f]->beats()) {
+                f++;
+                b = 0;
+                gap_left = traffic.gap_cycles;
+            }
+        }
+        if (out_valid) {
+            result.outputs.back().push_back(word);
+            if (out_last) {
+                result.frame_done_cycle.push_back(core.cycles().cycles);
+                result.outputs.push_back(std::vector<uint32_t>());
+            }
+        }
+    }
+    result.outputs.pop_back(); // 最后一帧之后的空帧（或者没有输出完的帧，这时帧数不对）
+}
+
+// ===== 随机差分测试 =====
+
+struct ConfigStats {
+    HistCoreParams params;
+    int cases;
+    int frames;
+    int errors;
+};
+
+// 随机配置：前几种是HLS测试平台覆盖的模板配置，其余随机组合
+static HistCoreParams random_params(Rng &rng) {
+    static const int fixed[][4] = {{8, 256, 32, 1},   {8, 256, 128, 1},  {8, 256, 512, 1}, {8, 64, 128, 1},
+                                   {10, 1024, 64, 1}, {12, 4096, 128, 1}, {16, 256, 512, 1}, {8, 256, 32, 3},
+                                   {8, 256, 32, 4},   {8, 256, 128, 3},  {10, 1024, 64, 3}};
+    static const int pixel_bits[] = {8, 10, 12, 16};
+    static const int stream_bits[] = {32, 64, 128, 256, 512};
+    int n = (int)(sizeof(fixed) / sizeof(fixed[0]));
+    unsigned int pick = rng.below(n + 4);
+    if ((int)pick < n) {
+        return HistCoreParams(fixed[pick][0], fixed[pick][1], fixed[pick][2], fixed[pick][3]);
+    }
+    int bits = pixel_bits[rng.below(4)];
+    int bin_bits = bits - (int)rng.below(bits < 12 ? bits - 1 : bits - 6); // 16位时最多4096个bin，用例不至于太慢
+    if (bin_bits > 12) {
+        bin_bits = 12;
+    }
+    return HistCoreParams(bits, 1 << bin_bits, stream_bits[rng.below(5)], 1 + (int)rng.below(4));
+}
+
+static int find_config(std::vector<ConfigStats> &stats, const HistCoreParams &p) {
+    for (size_t i = 0; i < stats.size(); i++) {
+        const HistCoreParams &q = stats[i].params;
+        if (q.pixel_bits == p.pixel_bits && q.bins == p.bins && q.stream_bits == p.stream_bits &&
+            q.channels == p.channels) {
+            return (int)i;
+        }
+    }
+    ConfigStats s;
+    s.params = p;
+    s.cases = 0;
+    s.frames = 0;
+    s.errors = 0;
+    stats.push_back(s);
+    return (int)stats.size() - 1;
+}
+
+// 一个随机用例，返回错误数
+static int run_case(int index, Rng &rng, std::vector<ConfigStats> &stats) {
+    HistCoreParams p = random_params(rng);
+    // 图像尺寸：大多是小帧（比输出的bin数短或长），偶尔是兆像素帧
+    int width;
+    int height;
+    unsigned int size_class = rng.below(20);
+    if (size_class == 0) {
+        width = 512 + (int)rng.below(1500);
+        height = 256 + (int)rng.below(800);
+    } else if (size_class < 4) {
+        width = 1 + (int)rng.below(8);
+        height = 1 + (int)rng.below(8);
+    } else {
+        width = 1 + (int)rng.below(700);
+        height = 1 + (int)rng.below(120);
+    }
+    Distribution dist = (Distribution)rng.below(NUM_DISTRIBUTIONS);
+    bool counted = rng.below(2) != 0;
+    int num_frames = 1 + (int)rng.below(4);
+    Traffic traffic;
+    traffic.input_valid = rng.below(2) ? 1.0 : 0.3 + 0.7 * rng.uniform();
+    traffic.output_ready = rng.below(2) ? 1.0 : 0.3 + 0.7 * rng.uniform();
+    traffic.input_bytes_per_cycle = rng.below(4) ? 0.0 : 1.0 + rng.below(64);
+    traffic.gap_cycles = rng.below(3) ? 0 : (int)rng.below(3 * p.output_words());
+    bool ideal = traffic.input_valid >= 1.0 && traffic.output_ready >= 1.0 && traffic.input_bytes_per_cycle == 0.0 &&
+                 traffic.gap_cycles == 0;
+
+    unsigned int num_pixels = (unsigned int)width * height;
+    std::vector<PackedFrame> packed(num_frames);
+    std::vector<const PackedFrame *> frames(num_frames);
+    std::vector<std::vector<unsigned int> > references(num_frames);
+    std::vector<unsigned short> samples;
+    for (int f = 0; f < num_frames; f++) {
+        create_samples(p, dist, width, height, rng, samples);
+        reference_histogram(p, samples, references[f]);
+        pack_frame(p, samples, counted, rng, packed[f]);
+        frames[f] = &packed[f];
+    }
+
+    HistCoreModel core(p, counted ? num_pixels : 0u);
+    RunResult result;
+    run_core(core, frames, traffic, rng, result);
+
+    int errors = 0;
+    const HistCoreCycles &cycles = core.cycles();
+    unsigned long long beats = packed[0].beats();
+    unsigned long long words = p.output_words();
+    if (result.hang) {
+        printf("    core did not finish\n");
+        errors++;
+    } else if ((int)result.outputs.size() != num_frames) {
+        printf("    %d histograms for %d frames\n", (int)result.outputs.size(), num_frames);
+        errors++;
+    }
+    for (int f = 0; f < (int)result.outputs.size() && f < num_frames && errors == 0; f++) {
+        const std::vector<uint32_t> &out = result.outputs[f];
+        if (out.size() != words) {
+            printf("    frame %d: %d words, expected %d\n", f, (int)out.size(), (int)words);
+            errors++;
+            continue;
+        }
+        for (size_t i = 0; i < words; i++) {
+            if (out[i] != references[f][i]) {
+                if (errors < 5) {
+                    printf("    frame %d bin %d: model=%u CPU=%u\n", f, (int)i, out[i], references[f][i]);
+                }
+                errors++;
+            }
+        }
+    }
+    if (errors == 0 && core.pixels_counted() != num_pixels) {
+        printf("    pixels_counted=%u, expected %u\n", core.pixels_counted(), num_pixels);
+        errors++;
+    }
+    if (errors == 0 && (cycles.beats != beats * num_frames || cycles.drain_cycles != words * num_frames ||
+                        cycles.frames != (unsigned long long)num_frames)) {
+        printf("    %llu beats / %llu drain cycles / %llu frames, expected %llu / %llu / %d\n", cycles.beats,
+               cycles.drain_cycles, cycles.frames, beats * num_frames, words * num_frames, num_frames);
+        errors++;
+    }
+    // 理想流量下与HLS测试平台检查的迭代次数相同：输出与下一帧的统计重叠，只有帧短于输出时才等待
+    if (errors == 0 && ideal) {
+        unsigned long long period = beats > words ? beats : words;
+        unsigned long long expected = p.call_overhead + beats + (num_frames - 1) * period + words;
+        if (cycles.cycles != expected || cycles.calls != 1) {
+            printf("    %llu cycles in %llu calls, expected %llu in 1\n", cycles.cycles, cycles.calls, expected);
+            errors++;
+        }
+    }
+
+    int s = find_config(stats, p);
+    stats[s].cases++;
+    stats[s].frames += num_frames;
+    stats[s].errors += errors ? 1 : 0;
+    if (errors) {
+        printf("  case %d: ", index);
+        print_params(p);
+        printf(", %dx%d x%d %s %s, in=%.2f out=%.2f bw=%.0f gap=%d: FAIL\n", width, height, num_frames,
+               dist_names[dist], counted ? "pixel_count" : "TLAST+TKEEP", traffic.input_valid,
+               traffic.output_ready, traffic.input_bytes_per_cycle, traffic.gap_cycles);
+    }
+    return errors ? 1 : 0;
+}
+
+static int run_random(int cases, uint64_t seed) {
+    printf("=== Histogram core model: randomized differential test ===\n");
+    printf("Cases: %d, seed: %llu\n", cases, (unsigned long long)seed);
+    Rng rng(seed);
+    std::vector<ConfigStats> stats;
+    int failed = 0;
+    for (int i = 0; i < cases; i++) {
+        failed += run_case(i, rng, stats);
+    }
+    printf("\nConfigurations:\n");
+    for (size_t i = 0; i < stats.size(); i++) {
+        printf("  ");
+        print_params(stats[i].params);
+        printf(": %4d cases, %5d frames: %s\n", stats[i].cases, stats[i].frames,
+               stats[i].errors == 0 ? "PASS" : "FAIL");
+    }
+    if (failed == 0) {
+        printf("\nAll %d cases match the CPU reference\n", cases);
+        return 0;
+    }
+    printf("\n%d of %d cases FAILED\n", failed, cases);
+    return 1;
+}
+
+// ===== 吞吐估算 =====
+
+static int run_predict(int argc, char **argv) {
+    HistCoreParams p;
+    int width = 1920;
+    int height = 1080;
+    int num_frames = 4;
+    double clock_mhz = 100.0;
+    bool counted = false;
+    Traffic traffic;
+    traffic.input_valid = 1.0;
+    traffic.output_ready = 1.0;
+    traffic.input_bytes_per_cycle = 0.0;
+    traffic.gap_cycles = 0;
+    for (int i = 2; i < argc; i++) {
+        const char *opt = argv[i];
+        if (strcmp(opt, "--counted") == 0) {
+            counted = true;
+            continue;
+        }
+        if (i + 1 >= argc) {
+            fprintf(stderr, "Error: %s needs a value\n", opt);
+            return 1;
+        }
+        const char *value = argv[++i];
+        if (strcmp(opt, "--pixel-bits") == 0) {
+            p.pixel_bits = atoi(value);
+        } else if (strcmp(opt, "--bins") == 0) {
+            p.bins = atoi(value);
+        } else if (strcmp(opt, "--stream-bits") == 0) {
+            p.stream_bits = atoi(value);
+        } else if (strcmp(opt, "--channels") == 0) {
+            p.channels = atoi(value);
+        } else if (strcmp(opt, "--call-overhead") == 0) {
+            p.call_overhead = atoi(value);
+        } else if (strcmp(opt, "--width") == 0) {
+            width = atoi(value);
+        } else if (strcmp(opt, "--height") == 0) {
+            height = atoi(value);
+        } else if (strcmp(opt, "--frames") == 0) {
+            num_frames = atoi(value);
+        } else if (strcmp(opt, "--clock-mhz") == 0) {
+            clock_mhz = atof(value);
+        } else if (strcmp(opt, "--input-bytes-per-cycle") == 0) {
+            traffic.input_bytes_per_cycle = atof(value);
+        } else {
+            fprintf(stderr, "Error: unknown option %s\n", opt);
+            return 1;
+        }
+    }
+    if (!p.valid() || width <= 0 || height <= 0 || num_frames <= 0 || clock_mhz <= 0 || p.call_overhead < 0) {
+        fprintf(stderr, "Error: invalid configuration\n");
+        return 1;
+    }
+
+    printf("=== Histogram core model: throughput prediction ===\n");
+    printf("Core:   ");
+    print_params(p);
+    printf(", %d output words\n", p.output_words());
+    printf("Frames: %dx%d x%d back-to-back, %s\n", width, height, num_frames,
+           counted ? "pixel_count (v2)" : "TLAST (v1)");
+    if (traffic.input_bytes_per_cycle > 0) {
+        printf("Input:  %.2f bytes/cycle (%.1f MB/s)\n", traffic.input_bytes_per_cycle,
+               traffic.input_bytes_per_cycle * clock_mhz);
+    }
+
+    // 帧的内容不影响周期数，所有帧用同一幅图像
+    Rng rng(1);
+    std::vector<unsigned short> samples;
+    create_samples(p, DIST_GRADIENT, width, height, rng, samples);
+    PackedFrame frame;
+    pack_frame(p, samples, counted, rng, frame);
+    std::vector<const PackedFrame *> frames(num_frames, &frame);
+    unsigned int num_pixels = (unsigned int)width * height;
+    HistCoreModel core(p, counted ? num_pixels : 0u);
+    RunResult result;
+    run_core(core, frames, traffic, rng, result);
+    if (result.hang || (int)result.frame_done_cycle.size() != num_frames) {
+        fprintf(stderr, "Error: the model did not finish\n");
+        return 1;
+    }
+
+    const HistCoreCycles &c = core.cycles();
+    // 稳态：相邻两帧输出完成之间的周期数；只有一帧时就是这一帧的延迟
+    unsigned long long first = result.frame_done_cycle[0];
+    double period = num_frames > 1 ? (double)(result.frame_done_cycle[num_frames - 1] - first) / (num_frames - 1)
+                                   : (double)first;
+    printf("\nBeats per frame:        %llu\n", (unsigned long long)frame.beats());
+    printf("Total cycles:           %llu\n", c.cycles);
+    printf("  function starts:      %llu x %d cycles\n", c.calls, p.call_overhead);
+    printf("  drain cycles:         %llu (overlapped with the next frame except after the last)\n",
+           c.drain_cycles);
+    printf("  input stall cycles:   %llu\n", c.input_stall_cycles);
+    printf("  input blocked cycles: %llu (frame finished, previous histogram still draining)\n",
+           c.input_blocked_cycles);
+    printf("  output stall cycles:  %llu\n", c.output_stall_cycles);
+    printf("First frame latency:    %llu cycles (%.3f ms)\n", first, first / (clock_mhz * 1000.0));
+    printf("Cycles per frame:       %.0f (%.3f ms, %.1f frames/s)\n", period, period / (clock_mhz * 1000.0),
+           clock_mhz * 1e6 / period);
+    printf("Throughput @ %.0f MHz:  %.2f MPixels/s, %.2f MB/s input\n", clock_mhz, num_pixels * clock_mhz / period,
+           (double)num_pixels * p.channels * p.lane_bytes() * clock_mhz / period);
+    return 0;
+}
+
+int main(int argc, char **argv) {
+    if (argc >= 2 && strcmp(argv[1], "--predict") == 0) {
+        return run_predict(argc, argv);
+    }
+    int cases = argc >= 2 ? atoi(argv[1]) : 2000;
+    uint64_t seed = argc >= 3 ? strtoull(argv[2], NULL, 10) : 20240611ull;
+    if (cases <= 0) {
+        fprintf(stderr, "Usage: %s [cases [seed]] | --predict [options]\n", argv[0]);
+        return 1;
+    }
+    return run_random(cases, seed);
+}
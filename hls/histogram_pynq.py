@@ -1,31 +1,68 @@
 
-from pynq import Overlay, allocate
+import argparse
 import numpy as np
 import time
 
+# 由load_pynq设置：板上用pynq，--mock时用软件模拟（pynq_mock.py）
+Overlay = None
+allocate = None
+
 # 配置常量
 HISTOGRAM_BINS = 256
-IMAGE_WIDTH = 32
-IMAGE_HEIGHT = 32
-IMAGE_SIZE = IMAGE_WIDTH * IMAGE_HEIGHT  # 1024 pixels
+DEFAULT_WIDTH = 1920
+DEFAULT_HEIGHT = 1080
+
+# AXI DMA单次传输的最大字节数：由DMA IP的"Width of Buffer Length Register"决定（默认14位 = 16383字节，
+# 最大26位 = 64MB）。帧比这个大时分成多次传输，v2核心按pixel_count计数，不依赖每次传输结尾的TLAST
+DMA_MAX_TRANSFER_BYTES = (1 << 14) - 1
+
+# Hanwenip_v2_0_HLS 的AXI-Lite寄存器（Vitis HLS生成的control bundle）
+HLS_REG_CTRL = 0x00            # bit0 ap_start, bit1 ap_done, bit2 ap_idle, bit7 auto_restart
+HLS_REG_PIXEL_COUNT = 0x10
+HLS_REG_PIXELS_COUNTED = 0x18
+HLS_CTRL_START_AUTO_RESTART = 0x81
+
+# AXI DMA的寄存器和scatter-gather描述符（PG021），批处理模式在DMA IP打开C_INCLUDE_SG时使用
+DMA_MM2S_DMACR = 0x00
+DMA_S2MM_DMACR = 0x30
+DMA_REG_DMASR = 0x04           # 相对DMACR的偏移
+DMA_REG_CURDESC = 0x08         # CURDESC_MSB在+0x04
+DMA_REG_TAILDESC = 0x10        # TAILDESC_MSB在+0x04，写低32位时DMA开始处理
+DMA_CR_RUN = 0x1
+DMA_CR_RESET = 0x4
+DMA_SR_SG_INCLUDED = 0x8
+DMA_SR_ERRORS = 0x770          # DMAIntErr/SlvErr/DecErr + SGIntErr/SlvErr/DecErr
+DESC_WORDS = 16                # 每个描述符64字节（地址要64字节对齐）
+DESC_NXTDESC = 0
+DESC_BUFFER = 2
+DESC_CONTROL = 6
+DESC_STATUS = 7
+DESC_SOF = 1 << 27             # MM2S：包的第一个描述符
+DESC_EOF = 1 << 26             # MM2S：包的最后一个描述符，结尾输出TLAST
+DESC_CMPLT = 1 << 31
+
+BYTES_PER_BEAT = 4             # 32位AXI-Stream
+DMA_TIMEOUT_S = 5.0
+
+def load_pynq(use_mock):
+    """板上使用pynq，--mock时使用软件模拟的DMA和核心"""
+    global Overlay, allocate
+    if use_mock:
+        import pynq_mock as backend
+    else:
+        import pynq as backend
+    Overlay = backend.Overlay
+    allocate = backend.allocate
 
 def create_test_image(width, height):
     """生成测试图像（和HLS testbench相同的模式）"""
-    image_size = width * height
-    image_data = np.zeros(image_size, dtype=np.uint8)
-    
-    for i in range(height):
-        for j in range(width):
-            image_data[i * width + j] = (i * 13 + j * 7) % 256
-    
-    return image_data
+    i = np.arange(height, dtype=np.uint32).reshape(-1, 1)
+    j = np.arange(width, dtype=np.uint32).reshape(1, -1)
+    return ((i * 13 + j * 7) % 256).astype(np.uint8).ravel()
 
 def compute_histogram_cpu(image_data):
     """CPU参考实现"""
-    histogram = np.zeros(HISTOGRAM_BINS, dtype=np.uint32)
-    for pixel in image_data:
-        histogram[pixel] += 1
-    return histogram
+    return np.bincount(image_data, minlength=HISTOGRAM_BINS).astype(np.uint32)
 
 def pack_uint8_to_uint32(image_data):
     """将uint8打包成uint32"""
@@ -33,32 +70,307 @@ def pack_uint8_to_uint32(image_data):
     image_size = len(image_data)
     num_words = (image_size + pixels_per_word - 1) // pixels_per_word
     
-    # Padding到4的倍数
-    padded_size = num_words * pixels_per_word
-    if len(image_data) < padded_size:
-        padding = padded_size - len(image_data)
-        image_data = np.append(image_data, np.zeros(padding, dtype=np.uint8))
+    # Padding到4的倍数（padding字节不会被统计：v2按pixel_count，v1按DMA最后一拍的TKEEP）
+    padded = np.zeros(num_words * pixels_per_word, dtype=np.uint8)
+    padded[:image_size] = image_data
     
     # 转换为uint32
-    packed_data = image_data.view(np.uint32)
+    packed_data = padded.view(np.uint32)
     return packed_data, num_words
 
-def main(iterations=1000):
+def find_histogram_ip(overlay):
+    """查找v2核心（AXI-Lite控制），没有则返回None，使用v1（ap_ctrl_none，以TLAST结束一帧）"""
+    for name in overlay.ip_dict:
+        if 'Hanwenip_v2_0' in name:
+            return getattr(overlay, name)
+    return None
+
+def start_histogram_ip(hist_ip, image_size):
+    """写入每帧像素数并以auto_restart方式启动，之后每帧都按这个像素数统计"""
+    hist_ip.write(HLS_REG_PIXEL_COUNT, image_size)
+    hist_ip.write(HLS_REG_CTRL, HLS_CTRL_START_AUTO_RESTART)
+
+def split_transfers(offset, nbytes, max_transfer):
+    """把[offset, offset+nbytes)按DMA单次传输上限切分。
+    切分点对齐到拍：v2核心按拍累加像素序号，拍中间断开（TKEEP不满）会让帧结束的位置错位"""
+    chunk = max_transfer - max_transfer % BYTES_PER_BEAT
+    return [(start, min(chunk, offset + nbytes - start))
+            for start in range(offset, offset + nbytes, chunk)]
+
+def send_frame(dma, tx_buffer, image_size, max_transfer):
+    """发送一帧，超过DMA单次传输上限时分块发送（只用于v2核心）"""
+    for start, nbytes in split_transfers(0, image_size, max_transfer):
+        dma.sendchannel.transfer(tx_buffer, start=start, nbytes=nbytes)
+        dma.sendchannel.wait()
+
+def buffer_address(buffer):
+    """DMA看到的物理地址（pynq 3.x为device_address，2.x为physical_address）"""
+    address = getattr(buffer, 'device_address', None)
+    return address if address is not None else buffer.physical_address
+
+class FrameBatches:
+    """两组连续的批缓冲区（ping-pong）。每组frames_per_batch帧，帧起点对齐到拍，
+    第f帧的像素加上帧序号（按256回绕），帧的顺序或边界错了都能在验证时发现"""
+
+    def __init__(self, image_data, cpu_histogram, frames_per_batch):
+        self.frame_bytes = len(image_data)
+        self.stride = (self.frame_bytes + BYTES_PER_BEAT - 1) // BYTES_PER_BEAT * BYTES_PER_BEAT
+        self.frames = frames_per_batch
+        self.tx = [allocate(shape=(frames_per_batch * self.stride,), dtype=np.uint8) for _ in range(2)]
+        self.rx = [allocate(shape=(frames_per_batch, HISTOGRAM_BINS), dtype=np.uint32) for _ in range(2)]
+        self.expected = []
+        for slot in range(2):
+            expected = np.empty((frames_per_batch, HISTOGRAM_BINS), dtype=np.uint32)
+            for f in range(frames_per_batch):
+                offset = (slot * frames_per_batch + f) % HISTOGRAM_BINS
+                base = f * self.stride
+                np.add(image_data, np.uint8(offset), out=self.tx[slot][base:base + self.frame_bytes])
+                expected[f] = np.roll(cpu_histogram, offset)
+            self.tx[slot].flush()
+            self.expected.append(expected)
+
+    def frame_transfers(self, frame, max_transfer):
+        """一帧在批缓冲区中的传输（偏移、字节数）"""
+        return split_transfers(frame * self.stride, self.frame_bytes, max_transfer)
+
+    def verify(self, slot):
+        """返回这组中结果错误的帧数，并清零输出缓冲区（下一批没有写入时不会误判为正确）"""
+        self.rx[slot].invalidate()
+        errors = int(np.count_nonzero((self.rx[slot] != self.expected[slot]).any(axis=1)))
+        self.rx[slot][:] = 0
+        self.rx[slot].flush()
+        return errors
+
+    def free(self):
+        for buffer in self.tx + self.rx:
+            buffer.freebuffer()
+
+class SgRing:
+    """一个DMA通道的描述符环：每个批缓冲区一组描述符，首尾相连。
+    submit()把TAILDESC推进到这一组的最后一个描述符，DMA处理完前一组后直接接着处理，不需要等CPU"""
+
+    def __init__(self, dma, dmacr, groups):
+        self.dma = dma
+        self.dmacr = dmacr
+        total = sum(len(group) for group in groups)
+        self.desc = allocate(shape=(total * DESC_WORDS,), dtype=np.uint32)
+        base = buffer_address(self.desc)
+        self.ranges = []
+        index = 0
+        for group in groups:
+            first = index
+            for address, nbytes, control in group:
+                words = self.desc[index * DESC_WORDS:(index + 1) * DESC_WORDS]
+                next_desc = base + (index + 1) % total * DESC_WORDS * 4
+                words[DESC_NXTDESC] = next_desc & 0xFFFFFFFF
+                words[DESC_NXTDESC + 1] = next_desc >> 32
+                words[DESC_BUFFER] = address & 0xFFFFFFFF
+                words[DESC_BUFFER + 1] = address >> 32
+                words[DESC_CONTROL] = control | nbytes
+                index += 1
+            self.ranges.append((first, index))
+        self.base = base
+        self.desc.flush()
+
+        # 复位通道，从第一个描述符开始运行（此时TAILDESC还没写，DMA不会取描述符）
+        dma.write(dmacr, DMA_CR_RESET)
+        while dma.read(dmacr) & DMA_CR_RESET:
+            pass
+        dma.write(dmacr + DMA_REG_CURDESC, base & 0xFFFFFFFF)
+        dma.write(dmacr + DMA_REG_CURDESC + 4, base >> 32)
+        dma.write(dmacr, DMA_CR_RUN)
+
+    def submit(self, group):
+        first, end = self.ranges[group]
+        # DMA取到Cmplt已置位的描述符会报SGIntErr，重新提交前清零状态
+        self.desc[first * DESC_WORDS + DESC_STATUS:end * DESC_WORDS:DESC_WORDS] = 0
+        self.desc.flush()
+        tail = self.base + (end - 1) * DESC_WORDS * 4
+        self.dma.write(self.dmacr + DMA_REG_TAILDESC + 4, tail >> 32)
+        self.dma.write(self.dmacr + DMA_REG_TAILDESC, tail & 0xFFFFFFFF)
+
+    def done(self, group):
+        """这一组的最后一个描述符完成时整组都已完成（DMA按顺序处理）"""
+        _, end = self.ranges[group]
+        self.desc.invalidate()
+        return bool(self.desc[(end - 1) * DESC_WORDS + DESC_STATUS] & DESC_CMPLT)
+
+    def status(self):
+        return self.dma.read(self.dmacr + DMA_REG_DMASR)
+
+    def free(self):
+        self.dma.write(self.dmacr, DMA_CR_RESET)
+        self.desc.freebuffer()
+
+def run_batches_sg(dma, batches, num_batches, max_transfer, on_batch):
+    """scatter-gather：每帧是一个包（SOF..EOF，结尾TLAST），每帧的直方图一个S2MM描述符。
+    两组批缓冲区同时排队，CPU只在每批结束时验证并重新提交这一组"""
+    tx_groups = []
+    rx_groups = []
+    for slot in range(2):
+        tx_base = buffer_address(batches.tx[slot])
+        rx_base = buffer_address(batches.rx[slot])
+        tx_group = []
+        for f in range(batches.frames):
+            pieces = batches.frame_transfers(f, max_transfer)
+            for p, (offset, nbytes) in enumerate(pieces):
+                control = (DESC_SOF if p == 0 else 0) | (DESC_EOF if p == len(pieces) - 1 else 0)
+                tx_group.append((tx_base + offset, nbytes, control))
+        tx_groups.append(tx_group)
+        rx_groups.append([(rx_base + f * HISTOGRAM_BINS * 4, HISTOGRAM_BINS * 4, 0)
+                          for f in range(batches.frames)])
+    rx_ring = SgRing(dma, DMA_S2MM_DMACR, rx_groups)
+    tx_ring = SgRing(dma, DMA_MM2S_DMACR, tx_groups)
+
+    try:
+        for slot in range(min(2, num_batches)):
+            rx_ring.submit(slot)
+            tx_ring.submit(slot)
+        for k in range(num_batches):
+            slot = k % 2
+            deadline = time.time() + DMA_TIMEOUT_S
+            while not (rx_ring.done(slot) and tx_ring.done(slot)):
+                status = tx_ring.status() | rx_ring.status()
+                if status & DMA_SR_ERRORS:
+                    raise RuntimeError(f"DMA error (MM2S DMASR=0x{tx_ring.status():x}, "
+                                       f"S2MM DMASR=0x{rx_ring.status():x})")
+                if time.time() > deadline:
+                    raise RuntimeError(f"DMA timeout in batch {k}")
+                time.sleep(0.0001)
+            on_batch(k, slot)
+            if k + 2 < num_batches:
+                rx_ring.submit(slot)
+                tx_ring.submit(slot)
+    finally:
+        tx_ring.free()
+        rx_ring.free()
+
+def run_batches_simple(dma, batches, num_batches, max_transfer, on_batch, tlast_per_frame):
+    """simple模式的DMA每个通道一次只能有一个传输：轮询两个通道的idle，哪个空闲就立即提交下一个。
+    MM2S发送一批时S2MM逐帧接收前面的直方图，下一批的缓冲区在前一批发送完后立即开始发送。
+    v2核心按pixel_count分帧，整批连续发送（按传输上限分块）；v1核心需要每帧一个传输（结尾TLAST）"""
+    tx_jobs = []
+    for k in range(num_batches):
+        slot = k % 2
+        if tlast_per_frame:
+            frames = [batches.frame_transfers(f, max_transfer)[0] for f in range(batches.frames)]
+        else:
+            frames = split_transfers(0, batches.frames * batches.stride, max_transfer)
+        tx_jobs.extend((k, slot, start, nbytes) for start, nbytes in frames)
+
+    total_frames = num_batches * batches.frames
+    next_tx = 0
+    tx_busy = False
+    rx_frame = 0
+    rx_busy = False
+    batches_done = 0
+    deadline = time.time() + DMA_TIMEOUT_S
+    while batches_done < num_batches:
+        progressed = False
+        if tx_busy and dma.sendchannel.idle:
+            tx_busy = False
+        # 最多领先两批（两组缓冲区），等前面的批验证完才复用这一组
+        if not tx_busy and next_tx < len(tx_jobs) and tx_jobs[next_tx][0] < batches_done + 2:
+            _, slot, start, nbytes = tx_jobs[next_tx]
+            dma.sendchannel.transfer(batches.tx[slot], start=start, nbytes=nbytes)
+            tx_busy = True
+            next_tx += 1
+            progressed = True
+        if rx_busy and dma.recvchannel.idle:
+            rx_busy = False
+            rx_frame += 1
+            progressed = True
+            if rx_frame % batches.frames == 0:
+                on_batch(batches_done, batches_done % 2)
+                batches_done += 1
+        if not rx_busy and rx_frame < total_frames and rx_frame // batches.frames < batches_done + 2:
+            k, f = divmod(rx_frame, batches.frames)
+            dma.recvchannel.transfer(batches.rx[k % 2], start=f * HISTOGRAM_BINS * 4,
+                                     nbytes=HISTOGRAM_BINS * 4)
+            rx_busy = True
+            progressed = True
+        if progressed:
+            deadline = time.time() + DMA_TIMEOUT_S
+        else:
+            status = dma.read(DMA_MM2S_DMACR + DMA_REG_DMASR) | dma.read(DMA_S2MM_DMACR + DMA_REG_DMASR)
+            if status & DMA_SR_ERRORS:
+                raise RuntimeError(f"DMA error (DMASR=0x{status:x})")
+            if time.time() > deadline:
+                raise RuntimeError(f"DMA timeout at frame {rx_frame}")
+            time.sleep(0)
+
+def dma_has_sg(dma):
+    return bool(dma.read(DMA_MM2S_DMACR + DMA_REG_DMASR) & DMA_SR_SG_INCLUDED)
+
+def run_batched(dma, hist_ip, image_data, cpu_histogram, frames_per_batch, iterations,
+                max_transfer, dma_mode):
+    """批处理模式：返回错误帧数"""
+    image_size = len(image_data)
+    num_batches = (iterations + frames_per_batch - 1) // frames_per_batch
+    sg_included = dma_has_sg(dma)
+    if dma_mode == 'auto':
+        dma_mode = 'sg' if sg_included else 'simple'
+    if dma_mode == 'sg' and not sg_included:
+        print("✗ Error: the DMA was built without scatter-gather (C_INCLUDE_SG=0)")
+        return -1
+
+    print("\n" + "="*70)
+    print(f"Batched submission: {num_batches} batches x {frames_per_batch} frames, "
+          f"{'scatter-gather' if dma_mode == 'sg' else 'simple'} DMA")
+    print("="*70)
+    batches = FrameBatches(image_data, cpu_histogram, frames_per_batch)
+    print(f"✓ TX batch buffers: 2 x {batches.tx[0].nbytes} bytes (frame stride {batches.stride})")
+    print(f"✓ RX batch buffers: 2 x {batches.rx[0].nbytes} bytes")
+
+    errors = [0]
+    def on_batch(k, slot):
+        errors[0] += batches.verify(slot)
+
+    if hist_ip is not None:
+        start_histogram_ip(hist_ip, image_size)
+    start_time = time.time()
+    try:
+        if dma_mode == 'sg':
+            run_batches_sg(dma, batches, num_batches, max_transfer, on_batch)
+        else:
+            run_batches_simple(dma, batches, num_batches, max_transfer, on_batch,
+                               tlast_per_frame=hist_ip is None)
+    except RuntimeError as e:
+        print(f"✗ {e}")
+        errors[0] += 1
+    elapsed = time.time() - start_time
+    if hist_ip is not None:
+        hist_ip.write(HLS_REG_CTRL, 0)
+    batches.free()
+
+    frames = num_batches * frames_per_batch
+    print(f"\nFrames:          {frames} ({frames * image_size} bytes)")
+    print(f"Elapsed:         {elapsed:.3f} s ({elapsed / frames * 1e6:.1f} us/frame)")
+    print(f"Sustained:       {frames * image_size / elapsed / 1e6:.2f} MB/s "
+          f"(8-bit pixels: MPixels/s), {frames / elapsed:.1f} frames/s")
+    print(f"Frames with wrong histograms: {errors[0]}")
+    return errors[0]
+
+def main(iterations=1000, width=DEFAULT_WIDTH, height=DEFAULT_HEIGHT, batch=0,
+         dma_mode='auto', bitstream_path='/home/ubuntu/finalProject/hyx.bit'):
     """
     主函数
     
     参数:
         iterations: 迭代次数（默认1000次）
+        width, height: 图像大小（默认1920x1080，任意大小）
+        batch: 每批的帧数，0为逐帧传输（每帧等待DMA完成）
+        dma_mode: 批处理使用的DMA模式：auto / sg / simple
     """
+    IMAGE_SIZE = width * height
     print("\n" + "="*70)
     print("     Histogram Computation - Performance Test")
     print("="*70)
-    print(f"Image size: {IMAGE_WIDTH}x{IMAGE_HEIGHT} = {IMAGE_SIZE} pixels")
+    print(f"Image size: {width}x{height} = {IMAGE_SIZE} pixels")
     print(f"Iterations: {iterations}")
     
     # --- 加载overlay ---
     print("\nLoading overlay...")
-    bitstream_path = '/home/ubuntu/finalProject/hyx.bit'
     
     try:
         overlay = Overlay(bitstream_path)
@@ -77,10 +389,27 @@ def main(iterations=1000):
         print("  Available components:", [x for x in dir(overlay) if not x.startswith('_')])
         return False
     
+    # DMA长度寄存器决定单次传输上限（pynq的DMA驱动提供buffer_max_size）
+    max_transfer = getattr(dma, 'buffer_max_size', DMA_MAX_TRANSFER_BYTES)
+    
+    # --- 获取直方图核心 ---
+    hist_ip = find_histogram_ip(overlay)
+    if hist_ip is not None:
+        print("✓ Hanwenip_v2_0_HLS found (pixel_count register)")
+    else:
+        print("✓ Hanwenip_v2_0_HLS not found, using Hanwenip_v1_0_HLS (TLAST)")
+        # scatter-gather批处理时一帧可以由多个描述符组成，只在结尾输出TLAST
+        sg_batches = batch > 0 and dma_mode != 'simple' and dma_has_sg(dma)
+        if IMAGE_SIZE > max_transfer and not sg_batches:
+            print(f"✗ Error: v1 core needs one DMA transfer per frame, "
+                  f"{IMAGE_SIZE} bytes > {max_transfer} bytes")
+            print("  Use the v2 core or increase the DMA buffer length register width")
+            return False
+    
     # --- 生成测试图像 ---
     print("\n" + "-"*70)
     print("Generating test image...")
-    image_data = create_test_image(IMAGE_WIDTH, IMAGE_HEIGHT)
+    image_data = create_test_image(width, height)
     print(f"✓ Generated {IMAGE_SIZE} pixels")
     
     # --- CPU参考计算（只做一次）---
@@ -90,13 +419,18 @@ def main(iterations=1000):
     cpu_time = time.time() - start_time
     print(f"✓ CPU time: {cpu_time:.6f} seconds")
     
+    if batch > 0:
+        return run_batched(dma, hist_ip, image_data, cpu_histogram, batch, iterations,
+                           max_transfer, dma_mode) == 0
+    
     # --- 数据打包 ---
     print("\nPacking data (uint8 -> uint32)...")
     packed_data, num_words = pack_uint8_to_uint32(image_data)
-    transfer_size = num_words * 4
+    transfer_size = IMAGE_SIZE  # 只发送实际像素，最后一拍的padding由TKEEP标记
     print(f"✓ Original: {IMAGE_SIZE} pixels (uint8)")
     print(f"✓ Packed: {num_words} words (uint32)")
-    print(f"✓ Transfer size: {transfer_size} bytes")
+    print(f"✓ Transfer size: {transfer_size} bytes "
+          f"({(transfer_size + max_transfer - 1) // max_transfer} DMA transfer(s))")
     
     # --- 分配DMA缓冲区 ---
     print("\nAllocating DMA buffers...")
@@ -110,6 +444,9 @@ def main(iterations=1000):
     tx_buffer[:] = packed_data[:]
     print("✓ Data copied to buffers")
     
+    if hist_ip is not None:
+        start_histogram_ip(hist_ip, IMAGE_SIZE)
+    
     # --- 迭代测试 ---
     print("\n" + "="*70)
     print(f"Starting FPGA acceleration ({iterations} iterations)...")
@@ -130,10 +467,12 @@ def main(iterations=1000):
         start_time = time.time()
         
         try:
-            dma.sendchannel.transfer(tx_buffer)
             dma.recvchannel.transfer(rx_buffer)
-            
-            dma.sendchannel.wait()
+            if hist_ip is not None:
+                send_frame(dma, tx_buffer, IMAGE_SIZE, max_transfer)
+            else:
+                dma.sendchannel.transfer(tx_buffer, nbytes=transfer_size)
+                dma.sendchannel.wait()
             dma.recvchannel.wait()
             
             hw_time = time.time() - start_time
@@ -184,6 +523,7 @@ def main(iterations=1000):
     print(f"\nThroughput:")
     print(f"  Average:   {IMAGE_SIZE / avg_hw_time / 1e6:.2f} MPixels/s")
     print(f"  Peak:      {IMAGE_SIZE / min_hw_time / 1e6:.2f} MPixels/s")
+    print(f"  Sustained: {IMAGE_SIZE * success_count / np.sum(hw_times) / 1e6:.2f} MB/s")
     
     # --- 验证最后一次结果 ---
     print("\n" + "="*70)
@@ -226,6 +566,15 @@ def main(iterations=1000):
     
     match = "✓" if total_cpu == total_fpga == IMAGE_SIZE else "✗"
     print(f"Total count match:   {match}")
+    if total_fpga != IMAGE_SIZE:
+        errors += 1
+    
+    if hist_ip is not None:
+        pixels_counted = hist_ip.read(HLS_REG_PIXELS_COUNTED)
+        print(f"pixels_counted:      {pixels_counted}")
+        if pixels_counted != IMAGE_SIZE:
+            print("  ✗ pixels_counted does not match the frame size")
+            errors += 1
     
     # --- 最终结果 ---
     print("\n" + "="*70)
@@ -252,7 +601,7 @@ def main(iterations=1000):
             print("\nNote: FPGA slower than CPU due to:")
             print("  - DMA transfer overhead dominates for small images")
             print("  - CPU benefits from cache for repeated operations")
-            print("  - Try larger images (e.g., 256x256 or 512x512) for better speedup")
+            print("  - Try larger images (e.g., 1920x1080 or 3840x2160) for better speedup")
         else:
             print("\n✓ FPGA is faster than CPU!")
     
@@ -262,6 +611,8 @@ def main(iterations=1000):
     print(f"Average time per iteration: {avg_hw_time * 1000:.3f} ms")
     
     # --- 清理 ---
+    if hist_ip is not None:
+        hist_ip.write(HLS_REG_CTRL, 0)  # 关闭auto_restart，当前帧结束后核心停止
     tx_buffer.freebuffer()
     rx_buffer.freebuffer()
     
@@ -272,8 +623,23 @@ if __name__ == "__main__":
     # 可以修改这个数字来改变迭代次数
     ITERATIONS = 10000 # 运行1000次
     
-    
-    success = main(iterations=ITERATIONS)
+    # python3 histogram_pynq.py [width height] [--batch N] [--mock]
+    parser = argparse.ArgumentParser(description="Histogram FPGA test on PYNQ")
+    parser.add_argument('width', type=int, nargs='?', default=DEFAULT_WIDTH)
+    parser.add_argument('height', type=int, nargs='?', default=DEFAULT_HEIGHT)
+    parser.add_argument('--iterations', type=int, default=ITERATIONS)
+    parser.add_argument('--batch', type=int, default=0,
+                        help="frames per batch (double-buffered, pipelined DMA); 0 = one blocking transfer per frame")
+    parser.add_argument('--dma-mode', choices=['auto', 'sg', 'simple'], default='auto',
+                        help="batched DMA mode; auto uses scatter-gather when the DMA includes it")
+    parser.add_argument('--mock', action='store_true',
+                        help="run against the software model of the DMA and core (pynq_mock.py)")
+    parser.add_argument('--bitstream', default='/home/ubuntu/finalProject/hyx.bit')
+    args = parser.parse_args()
+    load_pynq(args.mock)
+    
+    success = main(iterations=args.iterations, width=args.width, height=args.height,
+                   batch=args.batch, dma_mode=args.dma_mode, bitstream_path=args.bitstream)
     
     if success:
         print("\n" + "="*70)
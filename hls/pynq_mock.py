@@ -0,0 +1,410 @@
+"""pynq_mock.py
+PYNQ的软件模拟：Overlay、allocate、AXI DMA（simple模式和scatter-gather模式）以及直方图核心
+不在板子上时用 python3 histogram_pynq.py --mock 测试主机代码的流程和正确性
+
+模拟的行为与硬件一致的部分：
+  - 每次DMA传输（SG模式是每个TXEOF结尾的包）结尾带TLAST，最后一拍按字节数给出TKEEP
+  - 核心按拍（4字节）处理：v2按pixel_count计数，拍中TKEEP为0的lane不统计但仍占用像素序号；v1以TLAST结束一帧
+  - 每帧输出256个计数（1KB，结尾TLAST），simple模式的S2MM传输在TLAST处结束
+  - 输出没有被S2MM取走时核心最多再完成一帧（ping-pong累加器），之后反压输入，MM2S停住
+  - 硬件线程按拍数计时（默认32位流、100MHz，即400MB/s），DMA在真正读取时才读缓冲区的内容
+可以用环境变量修改：
+  HIST_MOCK_CORE=v1          只有v1核心（TLAST）
+  HIST_MOCK_SG=1             DMA带scatter-gather（C_INCLUDE_SG=1），此时simple模式的transfer不可用
+  HIST_MOCK_MAX_TRANSFER=N   buffer length寄存器决定的单次传输上限（默认16383字节）
+  HIST_MOCK_CLOCK_HZ=N       核心时钟（默认100MHz）
+"""
+
+import os
+import sys
+import threading
+import time
+from collections import deque
+
+import numpy as np
+
+HISTOGRAM_BINS = 256
+BYTES_PER_BEAT = 4
+OUTPUT_FIFO_FRAMES = 2  # 统计组里的一帧 + 输出组里的一帧
+TIMEOUT_S = 5.0
+
+# AXI DMA寄存器（PG021）
+MM2S_DMACR, MM2S_DMASR, MM2S_CURDESC, MM2S_TAILDESC = 0x00, 0x04, 0x08, 0x10
+S2MM_DMACR, S2MM_DMASR, S2MM_CURDESC, S2MM_TAILDESC = 0x30, 0x34, 0x38, 0x40
+DMACR_RS, DMACR_RESET = 0x1, 0x4
+DMASR_HALTED, DMASR_IDLE, DMASR_SG_INCLUDED, DMASR_INTERNAL_ERROR = 0x1, 0x2, 0x8, 0x10
+DESC_CONTROL, DESC_STATUS = 6, 7  # 描述符中的字序号
+DESC_SOF, DESC_EOF, DESC_CMPLT = 1 << 27, 1 << 26, 1 << 31
+DESC_LENGTH_MASK = (1 << 26) - 1
+
+
+# ===== 内存 =====
+
+_memory_lock = threading.Lock()
+_memory = []  # (物理地址, 缓冲区)
+_next_address = 0x10000000
+
+
+class MockBuffer(np.ndarray):
+    """allocate() 返回的连续缓冲区，带物理地址"""
+
+    def freebuffer(self):
+        with _memory_lock:
+            _memory[:] = [(a, b) for a, b in _memory if b is not self]
+
+    def flush(self):
+        pass
+
+    def invalidate(self):
+        pass
+
+    def close(self):
+        self.freebuffer()
+
+
+def allocate(shape, dtype=np.uint32, **kwargs):
+    global _next_address
+    buffer = np.zeros(shape, dtype=dtype).view(MockBuffer)
+    with _memory_lock:
+        buffer.physical_address = _next_address
+        buffer.device_address = _next_address
+        _memory.append((_next_address, buffer))
+        _next_address += (buffer.nbytes + 4095) & ~4095
+    return buffer
+
+
+def _phys_view(address, nbytes):
+    """物理地址 -> 缓冲区的uint8视图（不复制）"""
+    with _memory_lock:
+        for base, buffer in _memory:
+            if base <= address and address + nbytes <= base + buffer.nbytes:
+                offset = address - base
+                return buffer.reshape(-1).view(np.uint8)[offset:offset + nbytes]
+    raise RuntimeError(f"mock DMA: address 0x{address:x} (+{nbytes}) is not in an allocated buffer")
+
+
+# ===== 直方图核心 =====
+
+class MockHistogramIP:
+    """Hanwenip_v2_0_HLS 的AXI-Lite寄存器"""
+
+    def __init__(self):
+        self.regs = {0x00: 0x4, 0x10: 0, 0x18: 0}
+
+    def write(self, offset, value):
+        self.regs[offset] = value
+
+    def read(self, offset):
+        return self.regs.get(offset, 0)
+
+
+class _Channel:
+    """pynq simple模式DMA通道的接口：transfer / wait / idle"""
+
+    def __init__(self, engine, is_send):
+        self._engine = engine
+        self._is_send = is_send
+        self._busy = False
+        self.running = True
+
+    @property
+    def idle(self):
+        return not self._busy
+
+    def start(self):
+        self.running = True
+
+    def stop(self):
+        self.running = False
+
+    def transfer(self, array, start=0, nbytes=0):
+        if self._engine.sg:
+            raise RuntimeError("mock DMA: simple transfers are not available with scatter-gather enabled")
+        if self._busy:
+            raise RuntimeError("DMA channel not idle")
+        if nbytes == 0:
+            nbytes = array.nbytes - start
+        if nbytes > self._engine.max_transfer:
+            raise ValueError(f"Transferring {nbytes} bytes, which exceeds the maximum DMA buffer size "
+                             f"{self._engine.max_transfer}")
+        view = array.reshape(-1).view(np.uint8)[start:start + nbytes]
+        self._busy = True
+        if self._is_send:
+            self._engine.queue_packet([view], self._done)
+        else:
+            self._engine.queue_slot(view, self._done)
+
+    def _done(self):
+        self._busy = False
+
+    def wait(self):
+        deadline = time.time() + TIMEOUT_S
+        while self._busy:
+            self._engine.check_error()
+            if time.time() > deadline:
+                raise RuntimeError("mock DMA: transfer timed out (core stalled waiting for output?)")
+            time.sleep(0.0001)
+
+
+class _SgWalker:
+    """一个通道的描述符链：从CURDESC开始，处理完TAILDESC指向的描述符后空闲，写TAILDESC后继续（tail pointer模式）"""
+
+    def __init__(self):
+        self.running = False
+        self.current = 0
+        self.tail = None
+        self.idle = True
+        self.last_done = None  # 最后一个已取出的描述符
+
+    def next_descriptor(self):
+        if not self.running or self.idle:
+            return None
+        address = self.current if self.last_done is None else int(_desc_words(self.last_done)[0])
+        self.last_done = address
+        self.idle = address == self.tail
+        return address
+
+
+def _desc_words(address):
+    return _phys_view(address, 64).view(np.uint32)
+
+
+class MockDMA:
+    def __init__(self, core_version, sg, max_transfer, clock_hz):
+        self.core_version = core_version
+        self.sg = sg
+        self.max_transfer = max_transfer
+        self.buffer_max_size = max_transfer
+        self.clock_hz = clock_hz
+        self.core = MockHistogramIP()
+        self.sendchannel = _Channel(self, True)
+        self.recvchannel = _Channel(self, False)
+        self.mm2s = _SgWalker()
+        self.s2mm = _SgWalker()
+        self.regs = {}
+
+        self._lock = threading.Lock()
+        self._packets = deque()  # 待发送的包：(视图列表, 完成回调)
+        self._slots = deque()    # simple模式armed的S2MM传输
+        self._out_fifo = deque()
+        self._error = None
+        self._packet = None
+        self._busy_until = time.time()
+        self._reset_frame()
+        self._stop = False
+        self._thread = threading.Thread(target=self._run, daemon=True)
+        self._thread.start()
+
+    # --- pynq DefaultIP接口 ---
+    def read(self, offset):
+        with self._lock:
+            if offset in (MM2S_DMASR, S2MM_DMASR):
+                walker = self.mm2s if offset == MM2S_DMASR else self.s2mm
+                status = DMASR_SG_INCLUDED if self.sg else 0
+                if self._error:
+                    status |= DMASR_INTERNAL_ERROR
+                if not walker.running:
+                    status |= DMASR_HALTED
+                elif walker.idle and (offset == S2MM_DMASR or self._packet is None):
+                    status |= DMASR_IDLE
+                return status
+            return self.regs.get(offset, 0)
+
+    def write(self, offset, value):
+        with self._lock:
+            self.regs[offset] = value
+            walker = self.mm2s if offset < S2MM_DMACR else self.s2mm
+            if offset in (MM2S_DMACR, S2MM_DMACR):
+                if value & DMACR_RESET:
+                    walker.__init__()
+                    self.regs[offset] = 0
+                else:
+                    walker.running = bool(value & DMACR_RS)
+            elif offset in (MM2S_CURDESC, S2MM_CURDESC):
+                walker.current = value
+                walker.last_done = None
+            elif offset in (MM2S_TAILDESC, S2MM_TAILDESC):
+                if not self.sg:
+                    raise RuntimeError("mock DMA: TAILDESC written but scatter-gather is not included")
+                walker.tail = value
+                walker.idle = False
+
+    def check_error(self):
+        if self._error:
+            raise RuntimeError(self._error)
+
+    def close(self):
+        self._stop = True
+        self._thread.join()
+
+    # --- simple模式 ---
+    def queue_packet(self, views, done):
+        with self._lock:
+            self._packets.append((views, done))
+
+    def queue_slot(self, view, done):
+        with self._lock:
+            self._slots.append((view, done))
+
+    # --- 硬件线程 ---
+    def _reset_frame(self):
+        self._hist = np.zeros(HISTOGRAM_BINS, dtype=np.uint32)
+        self._beat_base = 0
+        self._counted = 0
+
+    def _fetch_sg_packet(self):
+        """SG模式：从MM2S描述符链取出一个完整的包（直到TXEOF）"""
+        rollback = self.mm2s.last_done
+        descriptors = []
+        while True:
+            address = self.mm2s.next_descriptor()
+            if address is None:
+                # 包还不完整：退回已取出的描述符，等主机补上TAILDESC
+                if descriptors:
+                    self.mm2s.last_done = rollback
+                    self.mm2s.idle = False
+                return None
+            words = _desc_words(address)
+            if words[DESC_STATUS] & DESC_CMPLT:
+                raise RuntimeError("mock DMA: MM2S fetched a descriptor that is already complete (SGIntErr)")
+            length = int(words[DESC_CONTROL]) & DESC_LENGTH_MASK
+            if length > self.max_transfer:
+                raise RuntimeError(f"mock DMA: descriptor length {length} exceeds {self.max_transfer}")
+            descriptors.append((address, int(words[2]) | (int(words[3]) << 32), length))
+            if words[DESC_CONTROL] & DESC_EOF:
+                break
+
+        def done():
+            for address, _, length in descriptors:
+                _desc_words(address)[DESC_STATUS] = DESC_CMPLT | length
+        return [(buffer, length) for _, buffer, length in descriptors], done
+
+    def _next_packet(self):
+        with self._lock:
+            if self.sg:
+                if not self.mm2s.running:
+                    return None
+                packet = self._fetch_sg_packet()
+                if packet is None:
+                    return None
+                # DMA在开始处理这个包时才读内存
+                addresses, done = packet
+                return np.concatenate([_phys_view(a, n) for a, n in addresses]), done
+            if not self._packets:
+                return None
+            views, done = self._packets.popleft()
+            return np.concatenate(views), done
+
+    def _next_slot(self):
+        with self._lock:
+            if self.sg:
+                address = self.s2mm.next_descriptor()
+                if address is None:
+                    return None
+                words = _desc_words(address)
+                if words[DESC_STATUS] & DESC_CMPLT:
+                    raise RuntimeError("mock DMA: S2MM fetched a descriptor that is already complete (SGIntErr)")
+                length = int(words[DESC_CONTROL]) & DESC_LENGTH_MASK
+                view = _phys_view(int(words[2]) | (int(words[3]) << 32), length)
+
+                def done(w=words):
+                    w[DESC_STATUS] = DESC_CMPLT | DESC_SOF | DESC_EOF | (HISTOGRAM_BINS * 4)
+                return view, done
+            return self._slots.popleft() if self._slots else None
+
+    def _emit(self):
+        """输出FIFO中的直方图写入下一个S2MM传输/描述符"""
+        if not self._out_fifo:
+            return False
+        slot = self._next_slot()
+        if slot is None:
+            return False
+        view, done = slot
+        if len(view) < HISTOGRAM_BINS * 4:
+            raise RuntimeError(f"mock DMA: S2MM buffer of {len(view)} bytes is shorter than one histogram")
+        view[:HISTOGRAM_BINS * 4] = self._out_fifo.popleft().view(np.uint8)
+        done()
+        return True
+
+    def _consume(self):
+        """处理当前包直到一帧结束或包结束，返回是否有进展"""
+        if self._packet is None:
+            if self.core_version == 2 and not (self.core.regs[0x00] & 0x1):
+                return False  # 核心没有启动，不接收数据
+            packet = self._next_packet()
+            if packet is None:
+                return False
+            self._packet = [packet[0], 0, packet[1]]
+        data, pos, done = self._packet
+        n = len(data)
+
+        if self.core_version == 2:
+            pixel_count = self.core.regs[0x10]
+            if pixel_count == 0:
+                raise RuntimeError("mock core: pixel_count is 0")
+            remaining = pixel_count - self._beat_base
+            beats_to_end = (remaining + BYTES_PER_BEAT - 1) // BYTES_PER_BEAT
+            beats_in_packet = (n - pos + BYTES_PER_BEAT - 1) // BYTES_PER_BEAT
+            take_beats = min(beats_to_end, beats_in_packet)
+            frame_end = take_beats == beats_to_end
+        else:
+            remaining = n - pos
+            take_beats = (n - pos + BYTES_PER_BEAT - 1) // BYTES_PER_BEAT
+            frame_end = True  # 包结尾的TLAST
+        if frame_end and len(self._out_fifo) >= OUTPUT_FIFO_FRAMES:
+            return False  # 反压：输出没有被取走
+
+        take_bytes = min(take_beats * BYTES_PER_BEAT, n - pos)
+        valid = min(take_bytes, remaining)
+        self._hist += np.bincount(data[pos:pos + valid], minlength=HISTOGRAM_BINS).astype(np.uint32)
+        self._counted += valid
+        self._beat_base += take_beats * BYTES_PER_BEAT
+        pos += take_beats * BYTES_PER_BEAT
+        self._packet[1] = pos
+
+        # 按拍数计时
+        now = time.time()
+        self._busy_until = max(self._busy_until, now) + take_beats / self.clock_hz
+        if self._busy_until - now > 0.001:
+            time.sleep(self._busy_until - now)
+
+        if frame_end:
+            self._out_fifo.append(self._hist)
+            self.core.regs[0x18] = self._counted
+            self._reset_frame()
+        if pos >= n:
+            with self._lock:
+                done()
+            self._packet = None
+        return True
+
+    def _run(self):
+        while not self._stop:
+            try:
+                progressed = self._emit()
+                progressed = self._consume() or progressed
+            except Exception as e:  # 错误通过DMASR和wait()报告给主机
+                self._error = str(e)
+                print(f"mock DMA: {e}", file=sys.stderr)
+                return
+            if not progressed:
+                time.sleep(0.0001)
+
+
+class Overlay:
+    """只有一个AXI DMA（axi_dma_0）和一个直方图核心的overlay"""
+
+    def __init__(self, bitfile_name=None, **kwargs):
+        core = os.environ.get("HIST_MOCK_CORE", "v2")
+        sg = os.environ.get("HIST_MOCK_SG", "0") == "1"
+        max_transfer = int(os.environ.get("HIST_MOCK_MAX_TRANSFER", str((1 << 14) - 1)))
+        clock_hz = float(os.environ.get("HIST_MOCK_CLOCK_HZ", "100e6"))
+        # 主机轮询DMA状态时一直持有GIL，缩短切换间隔让硬件线程及时运行（真实硬件不受影响）
+        sys.setswitchinterval(1e-5)
+        self.axi_dma_0 = MockDMA(2 if core == "v2" else 1, sg, max_transfer, clock_hz)
+        self.ip_dict = {"axi_dma_0": {}}
+        if core == "v2":
+            self.ip_dict["Hanwenip_v2_0_HLS_0"] = {}
+            self.Hanwenip_v2_0_HLS_0 = self.axi_dma_0.core
+        else:
+            self.ip_dict["Hanwenip_v1_0_HLS_0"] = {}
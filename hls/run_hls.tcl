@@ -0,0 +1,64 @@
+# run_hls.tcl
+# Vitis HLS 脚本：C仿真、综合、C/RTL联合仿真
+#   vitis_hls -f run_hls.tcl
+# 可以用环境变量修改配置：
+#   HIST_TOP         顶层函数（默认 Hanwenip_v2_0_HLS，已部署的旧核心是 Hanwenip_v1_0_HLS）
+#   HIST_CFLAGS      核心配置，例如 "-DHIST_HLS_STREAM_BITS=128"
+#   HIST_COSIM_FRAME 设为1080（1920x1080）或2160（3840x2160）时测试平台只跑这一帧，并加上cosim步骤
+#   HIST_STEPS       要运行的步骤（默认 "csim csynth"，设置了HIST_COSIM_FRAME时为 "csim csynth cosim"）
+# 测量1080p吞吐：
+#   HIST_COSIM_FRAME=1080 vitis_hls -f run_hls.tcl
+
+proc env_or {name default} {
+    if {[info exists ::env($name)] && $::env($name) ne ""} {
+        return $::env($name)
+    }
+    return $default
+}
+
+set top          [env_or HIST_TOP Hanwenip_v2_0_HLS]
+set core_cflags  [env_or HIST_CFLAGS ""]
+set cosim_frame  [env_or HIST_COSIM_FRAME ""]
+if {$cosim_frame ne ""} {
+    set steps    [env_or HIST_STEPS "csim csynth cosim"]
+    set tb_cflags "-DHIST_TB_COSIM_FRAME=$cosim_frame"
+} else {
+    set steps    [env_or HIST_STEPS "csim csynth"]
+    set tb_cflags ""
+}
+set part         [env_or HIST_PART xck26-sfvc784-2LV-c]
+set clock_ns     [env_or HIST_CLOCK_NS 10]
+
+open_project -reset hist_hls_prj
+set_top $top
+add_files histogram_hls.cpp -cflags "-std=c++11 $core_cflags"
+add_files -tb histogram_hls_test.cpp -cflags "-std=c++11 $core_cflags $tb_cflags"
+
+open_solution -reset "solution_${top}" -flow_target vivado
+set_part $part
+create_clock -period $clock_ns -name default
+
+# C仿真：没有HIST_COSIM_FRAME时是完整测试平台（所有模板配置、奇数帧大小、1080p/4K大帧）
+if {[lsearch $steps csim] >= 0} {
+    csim_design
+}
+
+if {[lsearch $steps csynth] >= 0} {
+    csynth_design
+}
+
+# 联合仿真只跑一帧：测试平台在 HIST_TB_COSIM_FRAME 下只向v2核心送一帧大图，完整测试平台做RTL仿真太慢
+# 吞吐率 = 像素数 / (latency周期数 * 时钟周期)，32位流4像素/拍，100MHz下约400 MPixels/s
+# 例如1920x1080：2073600 / 4 = 518400拍，单帧再加上输出直方图的256拍（背靠背的帧之间输出与统计重叠）
+if {[lsearch $steps cosim] >= 0} {
+    if {$top ne "Hanwenip_v2_0_HLS" || $cosim_frame eq ""} {
+        puts "cosim: set HIST_COSIM_FRAME and use the Hanwenip_v2_0_HLS top, skipping"
+    } else {
+        cosim_design -trace_level none
+        set pixels [expr {$cosim_frame == 2160 ? 3840 * 2160 : 1920 * 1080}]
+        puts "cosim frame: $pixels pixels; see solution_${top}/sim/report for the latency in cycles"
+        puts "throughput (MPixels/s) = $pixels / (latency_cycles * $clock_ns ns) * 1000"
+    }
+}
+
+exit
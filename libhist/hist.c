@@ -0,0 +1,483 @@
+// hist.c
+// libhist：通用工具函数和context接口
+#if defined(__linux__) && !defined(_GNU_SOURCE)
+#define _GNU_SOURCE // sched_setaffinity / CPU_SET
+#endif
+#ifdef __linux__
+#include <sched.h>
+#endif
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <sys/time.h>
+#ifdef _WIN32
+#include <windows.h>
+#include <malloc.h>
+#else
+#include <unistd.h>
+#endif
+
+#include "hist_internal.h"
+
+const char *pattern_names[] = {"uniform", "gradient", "constant"};
+
+// 生成测试图像
+Image *create_test_image(int width, int height)
+{
+    Image *img = (Image *)malloc(sizeof(Image));
+    img->width = width;
+    img->height = height;
+    img->channels = 1;
+    img->pixel_bits = 8;
+    img->data = (unsigned char *)malloc((size_t)width * height);
+
+    for (int i = 0; i < height; i++)
+    {
+        for (int j = 0; j < width; j++)
+        {
+            img->data[(size_t)i * width + j] = (i * 13 + j * 7) % 256;
+        }
+    }
+    return img;
+}
+
+Image *create_test_image_pattern(int width, int height, ImagePattern pattern)
+{
+    Image *img = (Image *)malloc(sizeof(Image));
+    img->width = width;
+    img->height = height;
+    img->channels = 1;
+    img->pixel_bits = 8;
+    img->data = (unsigned char *)malloc((size_t)width * height);
+
+    unsigned int seed = 2463534242u;
+    for (int i = 0; i < height; i++)
+    {
+        for (int j = 0; j < width; j++)
+        {
+            unsigned char value;
+            if (pattern == PATTERN_UNIFORM)
+            {
+                // xorshift32，保证每次运行生成相同的图像
+                seed ^= seed << 13;
+                seed ^= seed >> 17;
+                seed ^= seed << 5;
+                value = (unsigned char)(seed >> 24);
+            }
+            else if (pattern == PATTERN_GRADIENT)
+            {
+                value = (unsigned char)((long long)j * HISTOGRAM_BINS / width);
+            }
+            else
+            {
+                value = 128;
+            }
+            img->data[(size_t)i * width + j] = value;
+        }
+    }
+    return img;
+}
+
+Image *create_test_image_channels(int width, int height, int channels)
+{
+    Image *img = (Image *)malloc(sizeof(Image));
+    img->width = width;
+    img->height = height;
+    img->channels = channels;
+    img->pixel_bits = 8;
+    img->data = (unsigned char *)malloc((size_t)width * height * channels);
+
+    for (int i = 0; i < height; i++)
+    {
+        for (int j = 0; j < width; j++)
+        {
+            unsigned char *pixel = img->data + ((size_t)i * width + j) * channels;
+            for (int c = 0; c < channels; c++)
+            {
+                pixel[c] = (i * 13 + j * 7 + c * 85) % 256;
+            }
+        }
+    }
+    return img;
+}
+
+Image *create_test_image_u16(int width, int height, int pixel_bits)
+{
+    Image *img = (Image *)malloc(sizeof(Image));
+    img->width = width;
+    img->height = height;
+    img->channels = 1;
+    img->pixel_bits = pixel_bits;
+    img->data = (unsigned char *)malloc((size_t)width * height * sizeof(unsigned short));
+
+    unsigned short *pixels = (unsigned short *)img->data;
+    int range = 1 << pixel_bits;
+    for (int i = 0; i < height; i++)
+    {
+        for (int j = 0; j < width; j++)
+        {
+            pixels[(size_t)i * width + j] = (unsigned short)(((long long)(i * 13 + j * 7) * 97) % range);
+        }
+    }
+    return img;
+}
+
+void free_image(Image *img)
+{
+    if (img)
+    {
+        free(img->data);
+        free(img);
+    }
+}
+
+// 计时函数：POSIX上使用单调时钟，不受系统时间调整影响
+double get_time_ms(void)
+{
+#if defined(_WIN32) || !defined(CLOCK_MONOTONIC)
+    struct timeval tv;
+    gettimeofday(&tv, NULL);
+    return tv.tv_sec * 1000.0 + tv.tv_usec / 1000.0;
+#else
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000.0 + ts.tv_nsec / 1e6;
+#endif
+}
+
+// 打印进度条
+void print_progress(int current, int total, double elapsed_time)
+{
+    int barWidth = 50;
+    float progress = (float)current / total;
+
+    printf("\r[");
+    int pos = barWidth * progress;
+    for (int i = 0; i < barWidth; ++i)
+    {
+        if (i < pos)
+            printf("=");
+        else if (i == pos)
+            printf(">");
+        else
+            printf(" ");
+    }
+    printf("] %d/%d (%.1f%%) - %.2fs elapsed",
+           current, total, progress * 100.0, elapsed_time / 1000.0);
+    fflush(stdout);
+}
+
+// 获取在线CPU核数
+int get_num_cpus(void)
+{
+#ifdef _WIN32
+    SYSTEM_INFO info;
+    GetSystemInfo(&info);
+    return (int)info.dwNumberOfProcessors;
+#else
+    long n = sysconf(_SC_NPROCESSORS_ONLN);
+    return n > 0 ? (int)n : 1;
+#endif
+}
+
+// 绑定调用线程到一个CPU，避免基准测试中线程在核之间迁移
+int hist_pin_thread(int cpu)
+{
+    int cpus = get_num_cpus();
+    cpu = ((cpu % cpus) + cpus) % cpus;
+#if defined(__linux__)
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(cpu, &set);
+    return sched_setaffinity(0, sizeof(set), &set) == 0 ? HIST_OK : HIST_ERR_BACKEND;
+#elif defined(_WIN32)
+    return SetThreadAffinityMask(GetCurrentThread(), (DWORD_PTR)1 << cpu) != 0 ? HIST_OK : HIST_ERR_BACKEND;
+#else
+    (void)cpu;
+    return HIST_ERR_UNSUPPORTED;
+#endif
+}
+
+// 按alignment（2的幂）对齐分配内存，必须用hist_aligned_free释放
+void *hist_aligned_alloc(size_t size, size_t alignment)
+{
+#ifdef _WIN32
+    return _aligned_malloc(size, alignment);
+#else
+    void *ptr = NULL;
+    if (posix_memalign(&ptr, alignment, size) != 0)
+        return NULL;
+    return ptr;
+#endif
+}
+
+void hist_aligned_free(void *ptr)
+{
+#ifdef _WIN32
+    _aligned_free(ptr);
+#else
+    free(ptr);
+#endif
+}
+
+int hist_compare_requested(const char *report)
+{
+    const char *value = getenv("HIST_COMPARE");
+    if (!value || value[0] == '\0' || strcmp(value, "0") == 0)
+        return 0;
+    if (strcmp(value, "1") == 0 || strcmp(value, "all") == 0)
+        return 1;
+
+    size_t length = strlen(report);
+    for (const char *p = value; *p;)
+    {
+        const char *end = strchr(p, ',');
+        size_t token = end ? (size_t)(end - p) : strlen(p);
+        if (token == length && strncmp(p, report, length) == 0)
+            return 1;
+        if (!end)
+            break;
+        p = end + 1;
+    }
+    return 0;
+}
+
+// 保存直方图到文件
+int save_histogram_txt(const unsigned int *histogram, const char *filename, const HistRunInfo *info)
+{
+    return save_histogram_channels_txt(histogram, 1, filename, info);
+}
+
+int save_histogram_channels_txt(const unsigned int *histogram, int channels, const char *filename,
+                                const HistRunInfo *info)
+{
+    return save_histogram_bins_txt(histogram, HISTOGRAM_BINS, channels, filename, info);
+}
+
+int save_histogram_bins_txt(const unsigned int *histogram, int num_bins, int channels, const char *filename,
+                            const HistRunInfo *info)
+{
+    FILE *fp = fopen(filename, "w");
+    if (!fp)
+    {
+        printf("Error: Cannot open file %s\n", filename);
+        return -1;
+    }
+
+    if (channels > 1)
+        fprintf(fp, "# Histogram Data (Bin, Count per channel, %d channels)\n", channels);
+    else
+        fprintf(fp, "# Histogram Data (Bin, Count)\n");
+    if (info)
+    {
+        if (info->platform)
+            fprintf(fp, "# Platform: %s\n", info->platform);
+        if (info->width > 0 && info->height > 0)
+            fprintf(fp, "# Image size: %dx%d\n", info->width, info->height);
+        if (info->iterations > 0)
+            fprintf(fp, "# Iterations: %d\n", info->iterations);
+        if (info->threads > 0)
+            fprintf(fp, "# Threads: %d\n", info->threads);
+        if (info->kernel)
+            fprintf(fp, "# Kernel: %s\n", info->kernel);
+        if (info->startup_time_ms > 0.0)
+            fprintf(fp, "# Startup time: %.3f ms\n", info->startup_time_ms);
+        if (info->total_time_ms > 0.0)
+            fprintf(fp, "# Total execution time: %.3f ms (%.3f seconds)\n", info->total_time_ms, info->total_time_ms / 1000.0);
+        if (info->throughput_mpixels > 0.0)
+            fprintf(fp, "# Throughput: %.2f MPixels/s\n", info->throughput_mpixels);
+    }
+    for (int i = 0; i < num_bins; i++)
+    {
+        fprintf(fp, "%d", i);
+        for (int c = 0; c < channels; c++)
+        {
+            fprintf(fp, " %u", histogram[c * num_bins + i]);
+        }
+        fprintf(fp, "\n");
+    }
+    fclose(fp);
+    return 0;
+}
+
+// ===== context =====
+
+void hist_config_init(HistConfig *config, HistBackend backend)
+{
+    memset(config, 0, sizeof(HistConfig));
+    config->backend = backend;
+    config->num_threads = 1;
+    config->cpu_kernel = HIST_CPU_SIMD;
+    config->simd_level = HIST_SIMD_AUTO;
+    config->channels = 1;
+    config->pixel_bits = 8;
+    config->bin_shift = 0;
+    config->cl_kernel = 0;
+    config->cl_kernel_path = NULL;
+    config->fpga_device = NULL;
+}
+
+int hist_create(HistContext **out, const HistConfig *config)
+{
+    if (!out || !config)
+        return HIST_ERR_INVALID;
+    *out = NULL;
+
+    if (config->channels < 1 || config->channels > HIST_MAX_CHANNELS)
+        return HIST_ERR_INVALID;
+    if ((config->pixel_bits != 8 && config->pixel_bits != 10 && config->pixel_bits != 12 &&
+         config->pixel_bits != 16) ||
+        config->bin_shift < 0 || config->bin_shift >= config->pixel_bits)
+        return HIST_ERR_INVALID;
+    // 高位深的多通道图像还没有实现
+    if (config->pixel_bits > 8 && config->channels > 1)
+        return HIST_ERR_UNSUPPORTED;
+
+    const HistBackendOps *ops = NULL;
+    switch (config->backend)
+    {
+    case HIST_BACKEND_CPU:
+        ops = &hist_cpu_ops;
+        break;
+    case HIST_BACKEND_OPENCL:
+        ops = &hist_opencl_ops;
+        break;
+    case HIST_BACKEND_FPGA:
+        ops = &hist_fpga_ops;
+        break;
+    default:
+        return HIST_ERR_INVALID;
+    }
+
+    HistContext *ctx = (HistContext *)calloc(1, sizeof(HistContext));
+    if (!ctx)
+        return HIST_ERR_NOMEM;
+    ctx->config = *config;
+    ctx->ops = ops;
+
+    if (config->pixel_bits == 8 && config->bin_shift > 0)
+    {
+        ctx->rebin_scratch = (unsigned int *)malloc((size_t)config->channels * HISTOGRAM_BINS * sizeof(unsigned int));
+        if (!ctx->rebin_scratch)
+        {
+            free(ctx);
+            return HIST_ERR_NOMEM;
+        }
+    }
+
+    int status = ops->create(ctx);
+    if (status != HIST_OK)
+    {
+        free(ctx->rebin_scratch);
+        free(ctx);
+        return status;
+    }
+    *out = ctx;
+    return HIST_OK;
+}
+
+int hist_compute(HistContext *ctx, const unsigned char *data, size_t size, unsigned int *histogram)
+{
+    if (!ctx || !histogram || (!data && size > 0) || size > 0x7FFFFFFF ||
+        size % (size_t)ctx->config.channels != 0 || (ctx->config.pixel_bits > 8 && size % 2 != 0))
+        return HIST_ERR_INVALID;
+    if (!ctx->rebin_scratch)
+        return ctx->ops->compute(ctx, data, size, histogram);
+
+    // 8位图像重新分bin：256个bin的直方图很小，后端照常统计，再把相邻的 2^bin_shift 个bin相加
+    int status = ctx->ops->compute(ctx, data, size, ctx->rebin_scratch);
+    if (status != HIST_OK)
+        return status;
+    int shift = ctx->config.bin_shift;
+    int num_bins = HISTOGRAM_BINS >> shift;
+    memset(histogram, 0, (size_t)ctx->config.channels * num_bins * sizeof(unsigned int));
+    for (int c = 0; c < ctx->config.channels; c++)
+    {
+        for (int b = 0; b < HISTOGRAM_BINS; b++)
+        {
+            histogram[c * num_bins + (b >> shift)] += ctx->rebin_scratch[c * HISTOGRAM_BINS + b];
+        }
+    }
+    return HIST_OK;
+}
+
+int hist_compute_u16(HistContext *ctx, const unsigned short *data, size_t num_pixels, unsigned int *histogram)
+{
+    if (!ctx || ctx->config.pixel_bits == 8 || num_pixels > 0x7FFFFFFF / sizeof(unsigned short))
+        return HIST_ERR_INVALID;
+    return hist_compute(ctx, (const unsigned char *)data, num_pixels * sizeof(unsigned short), histogram);
+}
+
+int hist_num_bins(const HistConfig *config)
+{
+    return config->channels << (config->pixel_bits - config->bin_shift);
+}
+
+int hist_num_tiles(int width, int height, int tile_width, int tile_height)
+{
+    if (width <= 0 || height <= 0 || tile_width <= 0 || tile_height <= 0)
+        return 0;
+    return ((width + tile_width - 1) / tile_width) * ((height + tile_height - 1) / tile_height);
+}
+
+int hist_compute_tiled(HistContext *ctx, const unsigned char *image, int width, int height, int stride,
+                       int tile_width, int tile_height, unsigned int *tiles, unsigned int *histogram)
+{
+    if (stride == 0)
+        stride = width;
+    if (!ctx || !image || !tiles || stride < width || hist_num_tiles(width, height, tile_width, tile_height) == 0 ||
+        (long long)stride * height > 0x7FFFFFFF)
+        return HIST_ERR_INVALID;
+    if (ctx->config.channels != 1 || ctx->config.pixel_bits != 8 || !ctx->ops->compute_tiled)
+        return HIST_ERR_UNSUPPORTED;
+
+    // 8位图像的bin_shift由后端在统计时直接处理，不经过rebin_scratch（每个块都合并一次太贵）
+    HistTileJob job;
+    job.image = image;
+    job.width = width;
+    job.height = height;
+    job.stride = stride;
+    job.tile_width = tile_width;
+    job.tile_height = tile_height;
+    job.tiles_x = (width + tile_width - 1) / tile_width;
+    job.tiles_y = (height + tile_height - 1) / tile_height;
+    job.bin_shift = ctx->config.bin_shift;
+    job.num_bins = HISTOGRAM_BINS >> ctx->config.bin_shift;
+    job.tiles = tiles;
+    job.histogram = histogram;
+    return ctx->ops->compute_tiled(ctx, &job);
+}
+
+void hist_destroy(HistContext *ctx)
+{
+    if (!ctx)
+        return;
+    ctx->ops->destroy(ctx);
+    free(ctx->rebin_scratch);
+    free(ctx);
+}
+
+const char *hist_describe(const HistContext *ctx)
+{
+    return ctx ? ctx->description : "";
+}
+
+const char *hist_strerror(int status)
+{
+    switch (status)
+    {
+    case HIST_OK:
+        return "success";
+    case HIST_ERR_INVALID:
+        return "invalid argument";
+    case HIST_ERR_NOMEM:
+        return "out of memory";
+    case HIST_ERR_UNSUPPORTED:
+        return "backend not supported in this build";
+    case HIST_ERR_BACKEND:
+        return "backend error";
+    default:
+        return "unknown error";
+    }
+}
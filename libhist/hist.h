@@ -0,0 +1,673 @@
+// hist.h
+// libhist：图像直方图计算库（CPU / OpenCL / FPGA 后端共用一套接口）
+//
+// 用法：
+//   HistConfig cfg;
+//   hist_config_init(&cfg, HIST_BACKEND_CPU);
+//   cfg.num_threads = 0;                 // 使用全部CPU核
+//   HistContext *ctx = NULL;
+//   if (hist_create(&ctx, &cfg) != HIST_OK) { ... }
+//   for (每一帧)
+//       hist_compute(ctx, frame, frame_size, histogram);
+//   hist_destroy(ctx);
+//
+// context创建时完成线程池、OpenCL程序编译、设备缓冲区等一次性初始化，
+// 之后每帧调用 hist_compute 复用这些资源。
+//
+// 编译选项：
+//   -DHIST_WITH_OPENCL  启用OpenCL后端（需要链接 -lOpenCL）
+//   -DHIST_WITH_FPGA    启用FPGA后端（-Ihls，需要链接 hls/histogram_fpga_host.cpp）
+#ifndef HIST_H
+#define HIST_H
+
+#include <stddef.h>
+#include <stdio.h>
+
+#ifdef HIST_WITH_OPENCL
+#ifdef __APPLE__
+#include <OpenCL/opencl.h>
+#else
+#include <CL/cl.h>
+#endif
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define HISTOGRAM_BINS 256
+
+// 多通道图像（交错存储的RGB/RGBA等）最多的通道数，每个通道一个HISTOGRAM_BINS的直方图
+#define HIST_MAX_CHANNELS 4
+
+// 高位深图像（10/12/16位传感器数据）：每个像素占2字节（小端uint16，与HLS核心的16位lane相同），
+// 超出位宽的高位被忽略；全分辨率时有 2^pixel_bits 个bin（16位为65536个）
+#define HIST_MAX_PIXEL_BITS 16
+#define HIST_MAX_BINS (1 << HIST_MAX_PIXEL_BITS)
+
+// ===== 通用工具 =====
+
+typedef struct
+{
+    unsigned char *data; // channels > 1 时按像素交错存储（RGBRGB... / RGBARGBA...）
+    int width;
+    int height;
+    int channels;
+    int pixel_bits; // 8 = 每个样本1字节，10/12/16 = 每个样本2字节（data实际是unsigned short数组）
+} Image;
+
+// 测试图像类型，用于比较不同数据分布下各kernel的表现
+typedef enum
+{
+    PATTERN_UNIFORM,  // 均匀随机分布，相邻像素几乎不会落在同一个bin
+    PATTERN_GRADIENT, // 水平渐变，相邻像素大多落在同一个bin（低熵图像）
+    PATTERN_CONSTANT  // 常数图像，所有像素落在同一个bin（最坏情况）
+} ImagePattern;
+
+extern const char *pattern_names[];
+
+// 默认测试图像：(i * 13 + j * 7) % 256，与HLS testbench和PYNQ脚本相同
+Image *create_test_image(int width, int height);
+Image *create_test_image_pattern(int width, int height, ImagePattern pattern);
+// 交错的多通道测试图像：通道c为 (i * 13 + j * 7 + c * 85) % 256，通道0与create_test_image相同
+Image *create_test_image_channels(int width, int height, int channels);
+// 高位深测试图像：((i * 13 + j * 7) * 97) % 2^pixel_bits，与HLS testbench相同
+Image *create_test_image_u16(int width, int height, int pixel_bits);
+void free_image(Image *img);
+
+// 计时函数
+double get_time_ms(void);
+
+// 打印进度条
+void print_progress(int current, int total, double elapsed_time);
+
+// 获取在线CPU核数
+int get_num_cpus(void);
+
+// 把调用线程绑定到第cpu个CPU（按在线CPU数取模），成功返回HIST_OK，平台不支持时返回HIST_ERR_UNSUPPORTED
+int hist_pin_thread(int cpu);
+
+// 对齐内存分配（例如页对齐的零拷贝帧缓冲区），用hist_aligned_free释放
+void *hist_aligned_alloc(size_t size, size_t alignment);
+void hist_aligned_free(void *ptr);
+
+// 基准程序的附加对比测试（例如 "patterns"、"tiles"）默认不运行，由环境变量HIST_COMPARE打开：
+// 1或all打开全部，也可以是逗号分隔的名字列表（例如 HIST_COMPARE=patterns,tiles）
+int hist_compare_requested(const char *report);
+
+// 保存直方图文本文件时写入的头部信息，值为0/NULL的字段不写
+typedef struct
+{
+    const char *platform;
+    int width;
+    int height;
+    int iterations;
+    int threads;
+    const char *kernel;
+    double startup_time_ms;
+    double total_time_ms;
+    double throughput_mpixels;
+} HistRunInfo;
+
+// 保存直方图到文本文件（"bin count" 每行一个），成功返回0
+int save_histogram_txt(const unsigned int *histogram, const char *filename, const HistRunInfo *info);
+// 多通道直方图（histogram[c * HISTOGRAM_BINS + bin]），每行 "bin count0 count1 ..."
+int save_histogram_channels_txt(const unsigned int *histogram, int channels, const char *filename,
+                                const HistRunInfo *info);
+// 任意bin数的直方图（histogram[c * num_bins + bin]），例如16位图像的65536个bin
+int save_histogram_bins_txt(const unsigned int *histogram, int num_bins, int channels, const char *filename,
+                            const HistRunInfo *info);
+
+// 参考实现：单线程标量循环，也是校验其他后端结果的基准
+void compute_histogram_cpu(const unsigned char *image, int size, unsigned int *histogram);
+// 多通道参考实现：num_pixels个交错像素，结果写入histogram[channels * HISTOGRAM_BINS]
+void compute_histogram_cpu_channels(const unsigned char *image, int num_pixels, int channels, unsigned int *histogram);
+// 高位深参考实现：bin = (像素 & (2^pixel_bits - 1)) >> bin_shift，结果写入histogram[2^(pixel_bits - bin_shift)]
+void compute_histogram_cpu_u16(const unsigned short *image, int size, int pixel_bits, int bin_shift,
+                               unsigned int *histogram);
+// 分块直方图参考实现（布局见 hist_compute_tiled）：每个块先复制成连续的crop再调用compute_histogram_cpu，
+// 然后按bin_shift合并bin
+void compute_histogram_cpu_tiles(const unsigned char *image, int width, int height, int stride, int tile_width,
+                                 int tile_height, int bin_shift, unsigned int *tiles);
+
+// ===== 图像文件输入 =====
+// 内存映射的真实图像文件（代替合成的测试图像），帧直接指向映射的文件内容，不复制；
+// 映射时预读（MAP_POPULATE / madvise），计时循环里不会发生缺页
+// spec：
+//   "frames.pgm"                     PGM（P5），可以是多幅相同大小的图像首尾相连；maxval > 255 时为16位，
+//                                    PGM的16位样本是大端，打开时转换成小端（唯一需要复制的情况）
+//   "video.y4m"                      YUV4MPEG2，每帧取亮度（Y）平面；C420p10等高位深格式为16位小端样本
+//   "frames.raw:1920x1080[x3][@12]"  原始交错帧（xC为通道数，@bits为10/12/16时每个样本2字节小端），
+//                                    帧数 = 文件大小 / 帧大小
+//   "video.yuv:1920x1080[@10]"       原始I420（YUV 4:2:0平面）视频，每帧取亮度平面
+// 程序通过环境变量HIST_INPUT指定输入文件，例如 HIST_INPUT=video.y4m ./histogram_cpu.exe
+
+typedef enum
+{
+    HIST_INPUT_RAW,
+    HIST_INPUT_PGM,
+    HIST_INPUT_Y4M,
+    HIST_INPUT_YUV
+} HistInputFormat;
+
+typedef struct
+{
+    HistInputFormat format;
+    int width;
+    int height;
+    int channels;
+    int pixel_bits;    // 8，或10/12/16（每个样本2字节小端）
+    int num_frames;
+    size_t frame_size; // 每帧的字节数（传给hist_compute的size）：width * height * channels * (pixel_bits > 8 ? 2 : 1)
+
+    // 内部字段
+    unsigned char *map;     // 映射的文件
+    size_t map_size;
+    size_t *frame_offsets;  // 每帧在map（或converted）中的偏移
+    unsigned char *converted; // 16位PGM转换成小端后的帧，其他格式为NULL
+    char path[512];
+} HistInput;
+
+// 打开并映射输入文件，spec为NULL时使用环境变量HIST_INPUT；没有设置时返回HIST_OK，*out为NULL（使用合成的测试图像）
+int hist_input_open(HistInput **out, const char *spec);
+void hist_input_close(HistInput *input);
+
+// 第index帧（按num_frames取模，多帧文件可以循环读取），指向映射的文件内容
+const unsigned char *hist_input_frame(const HistInput *input, int index);
+
+// 第index帧的Image视图：data指向映射的文件，不能用free_image释放
+Image hist_input_image(const HistInput *input, int index);
+
+// 例如 "video.y4m (Y4M luma 1920x1080 8-bit, 300 frames)"
+void hist_input_describe(const HistInput *input, char *buffer, size_t size);
+
+// ===== 直方图二进制输出 =====
+// 逐帧归档直方图时代替save_histogram_txt：只追加的二进制文件，所有整数都是小端
+//   文件头（40字节）：magic "HISTBIN1"，u32 version，u32 flags，u32 num_bins，u32 channels，
+//                    u32 bin_bytes（4 = u32，8 = u64），u32 width，u32 height，u32 header_size
+//   每帧一条记录：u64 frame_id，u64 timestamp_ns，u32 payload_bytes，u32 flags（bit0 = LZ4压缩），
+//                 之后是payload：num_bins * channels个bin（通道c的直方图在 [c * num_bins]），压缩时为LZ4块
+// 记录先攒在写缓冲区里，满了再用一次writev写出；大于半个缓冲区的记录不经过复制，直接和缓冲区一起写出。
+// 打开已存在的文件时追加（文件头必须一致），末尾不完整的记录（写入中途崩溃）被截掉
+
+#define HIST_SINK_MAGIC "HISTBIN1"
+#define HIST_SINK_VERSION 1
+#define HIST_SINK_HEADER_SIZE 40
+#define HIST_SINK_RECORD_HEADER_SIZE 24
+#define HIST_SINK_RECORD_LZ4 1
+
+typedef struct
+{
+    int num_bins;       // 每个通道的bin数
+    int channels;
+    int bin_bytes;      // 4 = u32，8 = u64
+    int compress;       // 非0时每帧用LZ4压缩（需要 -DHIST_WITH_LZ4 -llz4），压缩后不更小的帧原样保存
+    int width;          // 只记录在文件头中，0 = 未知
+    int height;
+    size_t buffer_size; // 写缓冲区大小，0 = 默认1MB
+} HistSinkConfig;
+
+typedef struct HistSink HistSink;
+typedef struct HistSinkReader HistSinkReader;
+
+void hist_sink_config_init(HistSinkConfig *config, int num_bins, int channels);
+
+// 打开（或追加到）输出文件
+int hist_sink_open(HistSink **out, const char *path, const HistSinkConfig *config);
+// 按spec打开："frames.hbin[:lz4][:u64]"；spec为NULL时使用环境变量HIST_SINK，没有设置时返回HIST_OK，*out为NULL
+int hist_sink_open_spec(HistSink **out, const char *spec, int num_bins, int channels, int width, int height);
+
+// 追加一帧（num_bins * channels个bin）；timestamp_ns为0时使用当前时间（hist_timestamp_ns）
+// u64的值写入u32文件时超出范围返回HIST_ERR_INVALID
+int hist_sink_write(HistSink *sink, unsigned long long frame_id, unsigned long long timestamp_ns,
+                    const unsigned int *histogram);
+int hist_sink_write_u64(HistSink *sink, unsigned long long frame_id, unsigned long long timestamp_ns,
+                        const unsigned long long *histogram);
+int hist_sink_flush(HistSink *sink);
+// 写出缓冲区中剩余的记录并关闭，sink为NULL时什么都不做
+int hist_sink_close(HistSink *sink);
+
+// 例如 "frames.hbin (256 bins, u32, lz4): 1000 frames, 1.02 MB -> 0.13 MB, 2.1 ms in writes"
+void hist_sink_describe(const HistSink *sink, char *buffer, size_t size);
+
+// 自1970年以来的纳秒数（CLOCK_REALTIME），记录的默认时间戳
+unsigned long long hist_timestamp_ns(void);
+
+// 读取：打开时返回文件头中的配置，之后逐帧读取
+int hist_sink_reader_open(HistSinkReader **out, const char *path, HistSinkConfig *header);
+// 读取下一帧，bins[num_bins * channels]统一为u64；返回1，文件结束返回0，
+// 出错或末尾的记录不完整时返回HIST_ERR_INVALID等错误码
+int hist_sink_reader_next(HistSinkReader *reader, unsigned long long *frame_id, unsigned long long *timestamp_ns,
+                          unsigned long long *bins);
+void hist_sink_reader_close(HistSinkReader *reader);
+
+// ===== 硬件性能计数器 =====
+// Linux perf_event_open的计数器（其他平台上打开返回HIST_ERR_UNSUPPORTED），用来解释CPU kernel的时间花在哪里：
+// 每像素周期数、IPC、L1D/LLC miss、分支预测失败，以及（Intel上）store forwarding阻塞——
+// 直方图中相邻像素落在同一个bin时，计数的读-改-写依赖前一次写入，是标量循环的主要瓶颈。
+// 程序设置环境变量HIST_PERF（非空且不为0）时才打开计数器
+
+typedef enum
+{
+    HIST_PERF_TASK_CLOCK,    // 软件计数器：线程运行的时间(ns)，没有硬件计数器的虚拟机上也可用
+    HIST_PERF_CYCLES,
+    HIST_PERF_INSTRUCTIONS,
+    HIST_PERF_L1D_MISSES,    // L1D读miss
+    HIST_PERF_LLC_MISSES,    // 最后一级cache的读miss
+    HIST_PERF_BRANCH_MISSES,
+    HIST_PERF_STORE_FORWARD, // Intel LD_BLOCKS.STORE_FORWARD，其他CPU上不可用
+    HIST_PERF_NUM_EVENTS
+} HistPerfEvent;
+
+extern const char *hist_perf_event_names[];
+
+typedef struct
+{
+    int fd[HIST_PERF_NUM_EVENTS];                   // -1 = 当前CPU/内核不支持
+    unsigned long long count[HIST_PERF_NUM_EVENTS]; // hist_perf_read的结果（计数器被复用时按运行时间比例放大）
+    char error[128];                                // 一个计数器都打不开时的原因
+} HistPerf;
+
+// 环境变量HIST_PERF是否要求打开计数器
+int hist_perf_requested(void);
+
+// 打开计数器（初始为停止状态），统计调用线程以及之后由它创建的线程（例如线程池的worker）；
+// 一个都打不开时返回HIST_ERR_UNSUPPORTED，原因在perf->error中
+int hist_perf_open(HistPerf *perf);
+void hist_perf_close(HistPerf *perf);
+
+// 清零并开始计数 / 停止计数；start和stop对继承的worker线程同样生效
+void hist_perf_start(HistPerf *perf);
+void hist_perf_stop(HistPerf *perf);
+// 读取计数到perf->count。worker线程的计数在线程退出时才合并到调用线程的计数器，
+// 统计线程池时先销毁context再读取
+void hist_perf_read(HistPerf *perf);
+
+// 表格输出：每像素周期数、IPC、每千像素的miss和阻塞次数，不可用的计数器显示为 "-"
+void hist_perf_print_header(FILE *out);
+void hist_perf_print_row(const HistPerf *perf, const char *label, double pixels, FILE *out);
+
+// ===== 直方图context =====
+
+typedef enum
+{
+    HIST_OK = 0,
+    HIST_ERR_INVALID = -1,     // 参数错误
+    HIST_ERR_NOMEM = -2,       // 内存分配失败
+    HIST_ERR_UNSUPPORTED = -3, // 后端未编译进库或当前平台不支持
+    HIST_ERR_BACKEND = -4      // 后端运行时错误（OpenCL/设备错误等）
+} HistStatus;
+
+typedef enum
+{
+    HIST_BACKEND_CPU,
+    HIST_BACKEND_OPENCL,
+    HIST_BACKEND_FPGA
+} HistBackend;
+
+typedef enum
+{
+    HIST_CPU_SCALAR, // 原始单直方图循环
+    HIST_CPU_BANKED, // 多bank交错子直方图
+    HIST_CPU_SIMD    // 运行时检测到的最快向量化kernel（AVX-512/AVX2/NEON）
+} HistCpuKernel;
+
+typedef enum
+{
+    HIST_SIMD_AUTO, // 启动时自动校准选择
+    HIST_SIMD_NEON,
+    HIST_SIMD_AVX2,
+    HIST_SIMD_AVX512
+} HistSimdLevel;
+
+typedef struct
+{
+    HistBackend backend;
+
+    // CPU后端
+    int num_threads;          // 1 = 单线程，0 = 全部CPU核
+    HistCpuKernel cpu_kernel; // 单线程时使用的kernel；多线程时每个线程使用SIMD kernel
+    HistSimdLevel simd_level; // 强制指定SIMD级别，默认自动
+    int pin_threads;          // 非0时线程池的第t个worker绑定到CPU t；调用线程是0号worker，需要时自己调用hist_pin_thread(0)
+
+    // 所有后端：每个像素的通道数（1 = 灰度，3 = RGB，4 = RGBA，交错存储），最多HIST_MAX_CHANNELS
+    int channels;
+
+    // 所有后端：像素位宽（8，或10/12/16，此时每个像素2字节、只支持单通道）和重新分bin：bin = 像素 >> bin_shift
+    // 输出 2^(pixel_bits - bin_shift) 个bin，bin_shift = 0 为全分辨率，例如16位、bin_shift = 4 为4096个bin
+    int pixel_bits;
+    int bin_shift;
+
+    // OpenCL后端
+    int cl_kernel;              // 1..HIST_CL_NUM_KERNELS，对应 hist_cl_kernel_names；0 = 默认（local memory版本）
+                                // 高位深图像：0 = 按bin分区的local直方图，HIST_CL_WIDE_GLOBAL = global atomic
+    const char *cl_kernel_path; // NULL = 在默认路径中查找 histogram.cl
+
+    // FPGA后端：主机驱动的设备字符串（"emu"、"uio:dma=...,buf=..."，见 hls/histogram_fpga_host.h），
+    // NULL = 环境变量HIST_FPGA_DEVICE
+    const char *fpga_device;
+} HistConfig;
+
+typedef struct HistContext HistContext;
+
+extern const char *hist_cpu_kernel_names[];
+extern const char *hist_simd_level_names[];
+
+// 用默认值填充配置
+void hist_config_init(HistConfig *config, HistBackend backend);
+
+// 创建context，成功返回HIST_OK并通过out返回
+int hist_create(HistContext **out, const HistConfig *config);
+
+// 统计size个8位像素，结果写入histogram[HISTOGRAM_BINS]（调用前无需清零）
+// 多通道时size是字节数（像素数 × channels，必须是channels的整数倍），
+// 一次遍历交错数据，通道c的直方图写入 histogram[c * HISTOGRAM_BINS]，共 channels * HISTOGRAM_BINS 个
+// pixel_bits > 8 时size也是字节数（像素数 × 2），设置了bin_shift时输出 hist_num_bins 个bin
+int hist_compute(HistContext *ctx, const unsigned char *data, size_t size, unsigned int *histogram);
+// 高位深图像的便捷接口：num_pixels个16位像素
+int hist_compute_u16(HistContext *ctx, const unsigned short *data, size_t num_pixels, unsigned int *histogram);
+
+// hist_compute输出的计数个数：channels × 2^(pixel_bits - bin_shift)
+int hist_num_bins(const HistConfig *config);
+
+// 分块直方图：一次按行遍历width×height的8位单通道图像（相邻两行相距stride字节，0 = width），
+// 输出每个tile_width×tile_height块的直方图 tiles[(ty * tiles_x + tx) * num_bins + bin]，
+// num_bins = hist_num_bins(config)，tiles_x = ceil(width / tile_width)，右边和下边不满的块只统计图像内的像素。
+// histogram非NULL时同时输出整帧直方图（在同一次遍历中得到，不再读一遍图像）。
+// context需要channels = 1、pixel_bits = 8，FPGA后端返回HIST_ERR_UNSUPPORTED
+int hist_compute_tiled(HistContext *ctx, const unsigned char *image, int width, int height, int stride,
+                       int tile_width, int tile_height, unsigned int *tiles, unsigned int *histogram);
+// 块数 ceil(width / tile_width) × ceil(height / tile_height)，参数错误时返回0
+int hist_num_tiles(int width, int height, int tile_width, int tile_height);
+
+void hist_destroy(HistContext *ctx);
+
+// context的简短描述，例如 "CPU avx2 x8 threads"
+const char *hist_describe(const HistContext *ctx);
+
+const char *hist_strerror(int status);
+
+// ===== 基准测试统计 =====
+// histogram_bench.c 使用：每个配置重复多次试验，统计每帧时间的分布，结果写成JSON，
+// 之后可以与保存的基线文件比较，检查性能回退
+
+// 样本分布（单位与输入相同，histogram_bench中为每帧ms）
+typedef struct
+{
+    int count;
+    double min;
+    double max;
+    double mean;
+    double stddev;
+    double median;
+    double p5;
+    double p95;
+    double ci_low; // 中位数的95%置信区间（按次序统计量，不假设正态分布）
+    double ci_high;
+} HistBenchStats;
+
+// 一个配置的结果，比较时按name匹配
+typedef struct
+{
+    char name[64];         // 例如 "cpu-simd"、"opencl"、"fpga-model"
+    char description[256]; // hist_describe的输出
+    int width;
+    int height;
+    int frames; // 每次试验统计的帧数
+    HistBenchStats stats;
+    double throughput_mpixels; // 按中位数计算
+} HistBenchResult;
+
+// 运行环境，写在JSON文件的开头
+typedef struct
+{
+    const char *input; // 图像来源，例如 "synthetic" 或 hist_input_describe的输出
+    int cpus;
+    int pinned;
+    int trials;
+    int warmup;
+} HistBenchMeta;
+
+// 计算count个样本的统计量（samples不会被修改）
+void hist_bench_stats(const double *samples, int count, HistBenchStats *stats);
+
+// 写入/读取JSON结果文件，成功返回HIST_OK；read分配的*results用free释放
+int hist_bench_write_json(const char *filename, const HistBenchMeta *meta, const HistBenchResult *results, int count);
+int hist_bench_read_json(const char *filename, HistBenchResult **results, int *count);
+
+// 逐个配置比较中位数并把表格打印到out：变慢超过threshold（例如0.05 = 5%）且两次的置信区间不重叠时算回退，
+// 返回回退的配置数
+int hist_bench_compare(const HistBenchResult *baseline, int baseline_count, const HistBenchResult *current,
+                       int current_count, double threshold, FILE *out);
+
+// ===== OpenCL辅助接口 =====
+// OpenCL后端内部使用，也供 opencl/histogram_gpu.c 这样需要直接控制命令队列的基准程序使用
+
+#ifdef HIST_WITH_OPENCL
+
+// 8位kernel编号（HistConfig.cl_kernel、HistClTuning.kernel_choice、命令行的kernel参数），
+// 对应 hist_cl_kernel_names[编号 - 1]
+#define HIST_CL_NAIVE_KERNEL 1      // histogram_naive：每个像素一次global atomic
+#define HIST_CL_LOCAL_KERNEL 2      // histogram_local：local memory直方图，每个work-item固定处理几个像素
+#define HIST_CL_PRIVATE_KERNEL 3    // histogram_private：每个work-item处理连续的一段像素
+#define HIST_CL_VECTORIZED_KERNEL 4 // histogram_vectorized：uchar4加载
+#define HIST_CL_ULTRA_KERNEL 5      // histogram_ultra：自适应每个work-item的像素数
+#define HIST_CL_REPLICATED_KERNEL 6 // histogram_replicated：多份local直方图副本 + uchar16 grid-stride
+#define HIST_CL_CHANNELS_KERNEL 7   // histogram_channels：交错多通道图像（灰度图像也可以用，channels = 1）
+#define HIST_CL_NUM_KERNELS 7
+#define HIST_CL_DEFAULT_KERNEL HIST_CL_LOCAL_KERNEL
+
+// 高位深图像（16位像素）的kernel，参数与上面的8位kernel不同，单独编号
+#define HIST_CL_WIDE_GLOBAL 1      // histogram_wide_global：每个像素一次global atomic
+#define HIST_CL_WIDE_PARTITIONED 2 // histogram_wide_partitioned：按bin分区，每个分区的local直方图放得进local memory
+#define HIST_CL_NUM_WIDE_KERNELS 2
+
+extern const char *hist_cl_kernel_names[];
+extern const char *hist_cl_kernel_descriptions[];
+
+// 平台、设备、context、命令队列和编译好的程序
+typedef struct
+{
+    cl_platform_id platform;
+    cl_device_id device;
+    cl_context context;
+    cl_command_queue queue;
+    cl_program program;
+    cl_kernel clear_kernel; // histogram_clear，设备端清零直方图
+    char *source;           // histogram.cl源码，用不同编译选项重新编译时使用
+    char build_options[256];
+
+    char device_name[128];
+    char device_vendor[128];
+    char driver_version[128];
+    cl_uint compute_units;
+    size_t max_work_group_size;
+    cl_ulong global_mem_size;
+    cl_ulong local_mem_size;
+
+    int program_from_cache; // 程序是否从二进制缓存加载
+    double startup_time_ms; // 从选择设备到程序可用的时间
+} HistClEnv;
+
+// 选择设备（优先GPU，没有则CPU），创建命令队列并编译 histogram.cl
+// kernel_path为NULL时依次尝试默认路径
+// 编译结果缓存在 HIST_CL_CACHE_DIR（默认 .hist_cl_cache/）中，
+// 以设备名、驱动版本和kernel源码哈希为key，下次启动直接加载二进制
+int hist_cl_env_init(HistClEnv *env, const char *kernel_path, cl_command_queue_properties queue_properties);
+void hist_cl_env_release(HistClEnv *env);
+void hist_cl_print_device_info(const HistClEnv *env);
+
+// 用新的编译选项（例如 "-DLOCAL_PIXELS_PER_ITEM=8"）重新编译程序，选项不变时直接返回
+// 已经创建的kernel仍然引用旧程序，可以继续使用
+int hist_cl_env_rebuild(HistClEnv *env, const char *build_options);
+
+// 在设备上把buffer的前count个unsigned int清零，不需要从主机传输zeros
+int hist_cl_enqueue_clear(const HistClEnv *env, cl_command_queue queue, cl_mem buffer, int count,
+                          cl_uint num_wait_events, const cl_event *wait_events, cl_event *event);
+
+// 在CL_QUEUE_PROFILING_ENABLE的队列上运行一次kernel并等待完成，返回kernel执行时间(ms，START到END)；
+// clear_buffer非NULL时先清零其前clear_bins个计数（不计入时间）。任何OpenCL调用失败时返回负值
+double hist_cl_time_kernel(const HistClEnv *env, cl_command_queue queue, cl_kernel kernel, cl_uint dims,
+                           const size_t *global_size, const size_t *local_size, cl_mem clear_buffer, int clear_bins);
+
+// 一个kernel及其工作组配置
+typedef struct
+{
+    int kernel_choice; // 1..HIST_CL_NUM_KERNELS
+    cl_kernel kernel;
+    size_t global_size;
+    size_t local_size;
+    int image_size;
+    int pixels_per_workitem; // histogram_private
+    int num_vectors;         // histogram_vectorized
+    int replicas;            // histogram_replicated的local直方图副本数
+    int channels;            // histogram_channels的通道数（image_size为像素数），0 = 1
+
+    // 调优参数，0 = 使用默认值
+    size_t tuned_local_size;
+    int tuned_pixels_per_item; // histogram_local / histogram_ultra 编译时的每work-item像素数
+} HistClLaunch;
+
+// 创建kernel并按设备能力和图像大小计算工作组配置
+int hist_cl_launch_init(HistClLaunch *launch, const HistClEnv *env, int kernel_choice, int image_size);
+
+// 图像大小变化时重新计算工作组配置
+void hist_cl_launch_configure(HistClLaunch *launch, const HistClEnv *env, int image_size);
+
+// 设置kernel参数（图像缓冲区、直方图缓冲区、像素数）
+int hist_cl_launch_set_args(HistClLaunch *launch, cl_mem image, cl_mem histogram);
+
+void hist_cl_launch_release(HistClLaunch *launch);
+
+extern const char *hist_cl_wide_kernel_names[];
+
+// 高位深kernel及其配置：2D NDRange，第1维是grid-stride的像素，第2维是bin分区
+// 65536个bin × 4字节 = 256KB，放不进local memory（通常32~64KB），
+// histogram_wide_partitioned让每个work-group只统计一个bin分区，整幅图像按分区数读多遍
+typedef struct
+{
+    int kernel_choice; // HIST_CL_WIDE_*
+    cl_kernel kernel;
+    int num_pixels;
+    int pixel_bits;
+    int bin_shift;
+    int num_bins;
+    unsigned int pixel_mask;
+    int partition_bins; // 每个分区（local直方图）的bin数
+    int num_partitions;
+    size_t global_size[2];
+    size_t local_size[2];
+} HistClWideLaunch;
+
+int hist_cl_wide_launch_init(HistClWideLaunch *launch, const HistClEnv *env, int kernel_choice, int pixel_bits,
+                             int bin_shift, int num_pixels);
+void hist_cl_wide_launch_configure(HistClWideLaunch *launch, const HistClEnv *env, int num_pixels);
+// 设置kernel参数（16位图像缓冲区、num_bins个计数的直方图缓冲区）
+int hist_cl_wide_launch_set_args(HistClWideLaunch *launch, cl_mem image, cl_mem histogram);
+void hist_cl_wide_launch_release(HistClWideLaunch *launch);
+
+// 分块直方图kernel（histogram_tiled）及其配置：2D NDRange，第2维是块行，
+// 第1维的每个work-group负责一行块中连续的tiles_per_group个块，这些块的直方图放在local memory里，
+// work-group逐行读取自己那一段像素（合并访存）；块直方图只由一个work-group写，不需要清零和global atomic
+typedef struct
+{
+    cl_kernel kernel;
+    int width;
+    int height;
+    int stride;
+    int tile_width;
+    int tile_height;
+    int tiles_x;
+    int tiles_y;
+    int bin_shift;
+    int num_bins;        // 256 >> bin_shift
+    int tiles_per_group; // 每个work-group的块数，块直方图不超过一半local memory
+    size_t global_size[2];
+    size_t local_size[2];
+} HistClTileLaunch;
+
+int hist_cl_tile_launch_init(HistClTileLaunch *launch, const HistClEnv *env, int bin_shift);
+void hist_cl_tile_launch_configure(HistClTileLaunch *launch, const HistClEnv *env, int width, int height, int stride,
+                                   int tile_width, int tile_height);
+// 设置kernel参数（图像缓冲区、tiles_x * tiles_y * num_bins个计数的块直方图缓冲区、num_bins个计数的整帧直方图缓冲区）；
+// 整帧直方图由各work-group的块直方图相加后atomic_add得到，需要先清零
+int hist_cl_tile_launch_set_args(HistClTileLaunch *launch, cl_mem image, cl_mem tiles, cl_mem histogram);
+void hist_cl_tile_launch_release(HistClTileLaunch *launch);
+
+// ===== 自动调优 =====
+
+// 一组调优参数及其测量结果
+typedef struct
+{
+    int kernel_choice;
+    size_t local_size;     // 0 = 默认
+    int pixels_per_item;   // 只对histogram_local和histogram_ultra有效，0 = 默认
+    int image_size;        // 调优时的图像像素数
+    double kernel_time_ms; // kernel执行时间的中位数（profiling事件）
+} HistClTuning;
+
+// 按调优参数创建kernel（必要时用对应的编译选项重新编译程序），值为0的参数使用默认配置
+int hist_cl_launch_init_tuned(HistClLaunch *launch, HistClEnv *env, const HistClTuning *tuning, int image_size);
+
+// 扫描kernel、local size和每work-item像素数，用profiling事件计时，结果与CPU参考实现校验
+// verbose非0时打印每个候选配置的时间
+int hist_cl_autotune(HistClEnv *env, const unsigned char *image, int image_size, HistClTuning *best, int verbose);
+
+// 调优结果保存在缓存目录下的 tuning_<hash>.txt 中，hash由设备名、驱动版本和kernel源码决定
+// 每个图像大小一行；path非NULL时返回文件路径
+// load找不到对应图像大小的记录时返回HIST_ERR_INVALID，缓存目录被关闭时返回HIST_ERR_UNSUPPORTED
+int hist_cl_tuning_load(const HistClEnv *env, int image_size, HistClTuning *tuning, char *path, size_t path_size);
+int hist_cl_tuning_save(const HistClEnv *env, const HistClTuning *tuning, char *path, size_t path_size);
+
+// 打印OpenCL错误，返回HIST_ERR_BACKEND（err为CL_SUCCESS时返回HIST_OK）
+int hist_cl_check(cl_int err, const char *operation);
+
+// ===== 事件profiling =====
+// 命令队列用CL_QUEUE_PROFILING_ENABLE创建时，每条命令的事件带有四个时间戳：
+// QUEUED（主机入队）-> SUBMIT（提交给设备）-> START -> END。按阶段收集已完成的事件，
+// 可以区分瓶颈是传输、launch开销（排队和提交延迟）还是kernel本身
+
+typedef enum
+{
+    HIST_CL_STAGE_WRITE,  // 主机 -> 设备的图像上传
+    HIST_CL_STAGE_CLEAR,  // 设备端直方图清零
+    HIST_CL_STAGE_KERNEL, // 直方图kernel
+    HIST_CL_STAGE_READ,   // 设备 -> 主机的结果回读
+    HIST_CL_NUM_STAGES
+} HistClStage;
+
+extern const char *hist_cl_stage_names[];
+
+// 一个阶段的样本（单位us），每个事件一个
+typedef struct
+{
+    int count;
+    int capacity;
+    double *queued;    // QUEUED -> SUBMIT：在主机队列中等待
+    double *submitted; // SUBMIT -> START：已提交，等待设备开始执行
+    double *executed;  // START -> END：执行时间（传输或kernel本身）
+} HistClStageProfile;
+
+typedef struct
+{
+    HistClStageProfile stages[HIST_CL_NUM_STAGES];
+    cl_ulong first_queued; // 所有事件中最早的QUEUED和最晚的END，设备忙碌比例的分母
+    cl_ulong last_end;
+} HistClProfile;
+
+void hist_cl_profile_init(HistClProfile *profile);
+void hist_cl_profile_release(HistClProfile *profile);
+
+// 记录一个已完成的事件（event为NULL时忽略），不释放event
+int hist_cl_profile_add(HistClProfile *profile, HistClStage stage, cl_event event);
+
+// 打印每个阶段的总时间、每帧时间、各段延迟的中位数/p95、执行时间的分布直方图，以及判断出的瓶颈
+void hist_cl_profile_print(const HistClProfile *profile, int frames, FILE *out);
+
+#endif // HIST_WITH_OPENCL
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // HIST_H
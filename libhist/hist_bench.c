@@ -0,0 +1,369 @@
+// hist_bench.c
+// libhist：基准测试的统计量、JSON结果文件和与基线的比较
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "hist_internal.h"
+
+static int compare_doubles(const void *a, const void *b)
+{
+    double x = *(const double *)a;
+    double y = *(const double *)b;
+    return x < y ? -1 : (x > y ? 1 : 0);
+}
+
+// 牛顿迭代求平方根，库的其他部分都不需要libm，不为标准差单独链接 -lm
+static double bench_sqrt(double x)
+{
+    if (x <= 0.0)
+        return 0.0;
+    double r = x > 1.0 ? x : 1.0;
+    for (int i = 0; i < 64; i++)
+    {
+        double next = 0.5 * (r + x / r);
+        if (next >= r)
+            break;
+        r = next;
+    }
+    return r;
+}
+
+// 线性插值的分位数（sorted已排序，q在0..1之间）
+static double percentile(const double *sorted, int count, double q)
+{
+    double position = q * (count - 1);
+    int lower = (int)position;
+    if (lower >= count - 1)
+        return sorted[count - 1];
+    double fraction = position - lower;
+    return sorted[lower] + (sorted[lower + 1] - sorted[lower]) * fraction;
+}
+
+void hist_bench_stats(const double *samples, int count, HistBenchStats *stats)
+{
+    memset(stats, 0, sizeof(HistBenchStats));
+    if (count <= 0)
+        return;
+
+    double *sorted = (double *)malloc(count * sizeof(double));
+    if (!sorted)
+        return;
+    memcpy(sorted, samples, count * sizeof(double));
+    qsort(sorted, count, sizeof(double), compare_doubles);
+
+    double sum = 0.0;
+    for (int i = 0; i < count; i++)
+    {
+        sum += sorted[i];
+    }
+    double mean = sum / count;
+    double squares = 0.0;
+    for (int i = 0; i < count; i++)
+    {
+        squares += (sorted[i] - mean) * (sorted[i] - mean);
+    }
+
+    stats->count = count;
+    stats->min = sorted[0];
+    stats->max = sorted[count - 1];
+    stats->mean = mean;
+    stats->stddev = count > 1 ? bench_sqrt(squares / (count - 1)) : 0.0;
+    stats->median = percentile(sorted, count, 0.5);
+    stats->p5 = percentile(sorted, count, 0.05);
+    stats->p95 = percentile(sorted, count, 0.95);
+
+    // 中位数的95%置信区间：落在中位数以下的样本数服从B(n, 1/2)，
+    // 用正态近似取第 n/2 - 0.98·sqrt(n) 和 1 + n/2 + 0.98·sqrt(n) 个（从1数）次序统计量（1.96 / 2 = 0.98），
+    // 样本太少时退化为[min, max]
+    double half_width = 0.98 * bench_sqrt((double)count);
+    int low = (int)(count / 2.0 - half_width);
+    int high = (int)(count / 2.0 + half_width);
+    if (low < 0)
+        low = 0;
+    if (high > count - 1)
+        high = count - 1;
+    stats->ci_low = sorted[low];
+    stats->ci_high = sorted[high];
+
+    free(sorted);
+}
+
+// ===== JSON =====
+
+static void write_json_string(FILE *fp, const char *text)
+{
+    fputc('"', fp);
+    for (const char *c = text ? text : ""; *c; c++)
+    {
+        if (*c == '"' || *c == '\\')
+            fprintf(fp, "\\%c", *c);
+        else if ((unsigned char)*c < 0x20)
+            fprintf(fp, "\\u%04x", (unsigned char)*c);
+        else
+            fputc(*c, fp);
+    }
+    fputc('"', fp);
+}
+
+int hist_bench_write_json(const char *filename, const HistBenchMeta *meta, const HistBenchResult *results, int count)
+{
+    FILE *fp = fopen(filename, "w");
+    if (!fp)
+    {
+        fprintf(stderr, "Error: Cannot open file %s\n", filename);
+        return HIST_ERR_INVALID;
+    }
+
+    fprintf(fp, "{\n  \"version\": 1,\n  \"input\": ");
+    write_json_string(fp, meta ? meta->input : NULL);
+    if (meta)
+    {
+        fprintf(fp, ",\n  \"cpus\": %d,\n  \"pinned\": %d,\n  \"trials\": %d,\n  \"warmup\": %d",
+                meta->cpus, meta->pinned, meta->trials, meta->warmup);
+    }
+    fprintf(fp, ",\n  \"results\": [");
+    for (int i = 0; i < count; i++)
+    {
+        const HistBenchResult *r = &results[i];
+        const HistBenchStats *s = &r->stats;
+        fprintf(fp, "%s\n    {\"name\": ", i > 0 ? "," : "");
+        write_json_string(fp, r->name);
+        fprintf(fp, ", \"description\": ");
+        write_json_string(fp, r->description);
+        fprintf(fp, ", \"width\": %d, \"height\": %d, \"frames\": %d, \"samples\": %d,\n", r->width, r->height,
+                r->frames, s->count);
+        fprintf(fp, "     \"median_ms\": %.6f, \"mean_ms\": %.6f, \"stddev_ms\": %.6f, \"min_ms\": %.6f, \"max_ms\": %.6f,\n",
+                s->median, s->mean, s->stddev, s->min, s->max);
+        fprintf(fp, "     \"p5_ms\": %.6f, \"p95_ms\": %.6f, \"ci_low_ms\": %.6f, \"ci_high_ms\": %.6f, "
+                    "\"throughput_mpixels\": %.3f}",
+                s->p5, s->p95, s->ci_low, s->ci_high, r->throughput_mpixels);
+    }
+    fprintf(fp, "\n  ]\n}\n");
+    fclose(fp);
+    return HIST_OK;
+}
+
+// 读取只需要处理hist_bench_write_json写出的结构：results数组中的平坦对象（字符串和数字字段）
+
+// 跳过字符串（p指向开头的引号），返回结束引号之后的位置
+static const char *skip_json_string(const char *p, const char *end)
+{
+    for (p++; p < end && *p != '"'; p++)
+    {
+        if (*p == '\\' && p + 1 < end)
+            p++;
+    }
+    return p < end ? p + 1 : end;
+}
+
+// 在对象 [begin, end) 中查找 "key": 并返回值的起始位置，找不到返回NULL
+static const char *find_json_value(const char *begin, const char *end, const char *key)
+{
+    size_t key_length = strlen(key);
+    for (const char *p = begin; p < end;)
+    {
+        if (*p != '"')
+        {
+            p++;
+            continue;
+        }
+        const char *name_end = skip_json_string(p, end);
+        const char *value = name_end;
+        while (value < end && (*value == ' ' || *value == '\t' || *value == '\r' || *value == '\n'))
+            value++;
+        if (value < end && *value == ':')
+        {
+            if ((size_t)(name_end - p - 2) == key_length && memcmp(p + 1, key, key_length) == 0)
+            {
+                for (value++; value < end && (*value == ' ' || *value == '\n' || *value == '\t' || *value == '\r');)
+                    value++;
+                return value;
+            }
+        }
+        p = name_end;
+    }
+    return NULL;
+}
+
+static void read_json_string(const char *begin, const char *end, const char *key, char *out, size_t size)
+{
+    size_t length = 0;
+    const char *p = find_json_value(begin, end, key);
+    if (p && *p == '"')
+    {
+        for (p++; p < end && *p != '"' && length + 1 < size; p++)
+        {
+            char c = *p;
+            if (c == '\\' && p + 1 < end)
+            {
+                c = *++p;
+                if (c == 'u' && p + 4 < end)
+                {
+                    char hex[5] = {p[1], p[2], p[3], p[4], '\0'};
+                    c = (char)strtol(hex, NULL, 16);
+                    p += 4;
+                }
+                else if (c == 'n')
+                    c = '\n';
+                else if (c == 't')
+                    c = '\t';
+            }
+            out[length++] = c;
+        }
+    }
+    out[length] = '\0';
+}
+
+static double read_json_number(const char *begin, const char *end, const char *key)
+{
+    const char *p = find_json_value(begin, end, key);
+    return p ? strtod(p, NULL) : 0.0;
+}
+
+int hist_bench_read_json(const char *filename, HistBenchResult **results, int *count)
+{
+    *results = NULL;
+    *count = 0;
+    FILE *fp = fopen(filename, "rb");
+    if (!fp)
+    {
+        fprintf(stderr, "Error: Cannot open file %s\n", filename);
+        return HIST_ERR_INVALID;
+    }
+    fseek(fp, 0, SEEK_END);
+    long file_size = ftell(fp);
+    fseek(fp, 0, SEEK_SET);
+    char *text = (char *)malloc(file_size > 0 ? file_size + 1 : 1);
+    if (!text)
+    {
+        fclose(fp);
+        return HIST_ERR_NOMEM;
+    }
+    size_t length = file_size > 0 ? fread(text, 1, file_size, fp) : 0;
+    text[length] = '\0';
+    fclose(fp);
+
+    const char *end = text + length;
+    const char *p = find_json_value(text, end, "results");
+    if (!p || *p != '[')
+    {
+        fprintf(stderr, "Error: %s is not a benchmark result file\n", filename);
+        free(text);
+        return HIST_ERR_INVALID;
+    }
+
+    int capacity = 0;
+    HistBenchResult *list = NULL;
+    for (p++; p < end && *p != ']';)
+    {
+        if (*p != '{')
+        {
+            p++;
+            continue;
+        }
+        // 对象结束位置：跳过字符串中的括号
+        const char *object_end = p + 1;
+        while (object_end < end && *object_end != '}')
+        {
+            object_end = *object_end == '"' ? skip_json_string(object_end, end) : object_end + 1;
+        }
+        if (*count == capacity)
+        {
+            capacity = capacity ? capacity * 2 : 16;
+            HistBenchResult *grown = (HistBenchResult *)realloc(list, capacity * sizeof(HistBenchResult));
+            if (!grown)
+            {
+                free(list);
+                free(text);
+                return HIST_ERR_NOMEM;
+            }
+            list = grown;
+        }
+        HistBenchResult *r = &list[(*count)++];
+        memset(r, 0, sizeof(HistBenchResult));
+        read_json_string(p, object_end, "name", r->name, sizeof(r->name));
+        read_json_string(p, object_end, "description", r->description, sizeof(r->description));
+        r->width = (int)read_json_number(p, object_end, "width");
+        r->height = (int)read_json_number(p, object_end, "height");
+        r->frames = (int)read_json_number(p, object_end, "frames");
+        r->stats.count = (int)read_json_number(p, object_end, "samples");
+        r->stats.median = read_json_number(p, object_end, "median_ms");
+        r->stats.mean = read_json_number(p, object_end, "mean_ms");
+        r->stats.stddev = read_json_number(p, object_end, "stddev_ms");
+        r->stats.min = read_json_number(p, object_end, "min_ms");
+        r->stats.max = read_json_number(p, object_end, "max_ms");
+        r->stats.p5 = read_json_number(p, object_end, "p5_ms");
+        r->stats.p95 = read_json_number(p, object_end, "p95_ms");
+        r->stats.ci_low = read_json_number(p, object_end, "ci_low_ms");
+        r->stats.ci_high = read_json_number(p, object_end, "ci_high_ms");
+        r->throughput_mpixels = read_json_number(p, object_end, "throughput_mpixels");
+        p = object_end < end ? object_end + 1 : end;
+    }
+    free(text);
+    *results = list;
+    return HIST_OK;
+}
+
+// ===== 与基线比较 =====
+
+int hist_bench_compare(const HistBenchResult *baseline, int baseline_count, const HistBenchResult *current,
+                       int current_count, double threshold, FILE *out)
+{
+    int regressions = 0;
+    fprintf(out, "%-20s %12s %12s %9s  %s\n", "Config", "Baseline ms", "Current ms", "Change", "Verdict");
+    for (int i = 0; i < current_count; i++)
+    {
+        const HistBenchResult *cur = &current[i];
+        const HistBenchResult *base = NULL;
+        for (int j = 0; j < baseline_count && !base; j++)
+        {
+            if (strcmp(baseline[j].name, cur->name) == 0)
+                base = &baseline[j];
+        }
+        if (!base)
+        {
+            fprintf(out, "%-20s %12s %12.4f %9s  new\n", cur->name, "-", cur->stats.median, "-");
+            continue;
+        }
+        if (base->width != cur->width || base->height != cur->height || base->stats.median <= 0.0)
+        {
+            fprintf(out, "%-20s %12.4f %12.4f %9s  not comparable (%dx%d vs %dx%d)\n", cur->name, base->stats.median,
+                    cur->stats.median, "-", base->width, base->height, cur->width, cur->height);
+            continue;
+        }
+
+        // 中位数变化超过阈值且置信区间不重叠才算显著，否则视为噪声
+        double change = cur->stats.median / base->stats.median - 1.0;
+        const char *verdict = "same";
+        if (change > threshold)
+        {
+            if (cur->stats.ci_low > base->stats.ci_high)
+            {
+                verdict = "REGRESSION";
+                regressions++;
+            }
+            else
+            {
+                verdict = "slower (within noise)";
+            }
+        }
+        else if (change < -threshold)
+        {
+            verdict = cur->stats.ci_high < base->stats.ci_low ? "faster" : "faster (within noise)";
+        }
+        fprintf(out, "%-20s %12.4f %12.4f %+8.1f%%  %s\n", cur->name, base->stats.median, cur->stats.median,
+                change * 100.0, verdict);
+    }
+    for (int j = 0; j < baseline_count; j++)
+    {
+        int found = 0;
+        for (int i = 0; i < current_count && !found; i++)
+        {
+            found = strcmp(baseline[j].name, current[i].name) == 0;
+        }
+        if (!found)
+            fprintf(out, "%-20s %12.4f %12s %9s  missing\n", baseline[j].name, baseline[j].stats.median, "-", "-");
+    }
+    return regressions;
+}
@@ -0,0 +1,942 @@
+// hist_cpu.c
+// libhist CPU后端：标量/多bank/向量化kernel，以及多线程引擎
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+
+#include "hist_internal.h"
+#include "hist_simd.h"
+
+#define CACHE_LINE_SIZE 64
+#define MAX_THREADS 256
+
+// 多bank标量kernel的bank数（编译期选择4或8），例如 -DHIST_BANKS=8
+#ifndef HIST_BANKS
+#define HIST_BANKS 4
+#endif
+#if HIST_BANKS != 4 && HIST_BANKS != 8
+#error "HIST_BANKS must be 4 or 8"
+#endif
+
+// 高位深cache分块kernel：每个bin分片的大小（默认8192个bin = 32KB，放得进L1）和输入块的像素数
+// （默认4K像素，块缓冲区8KB），分片大小必须是2的幂、不超过65536
+#ifndef HIST_CPU_SLICE_BINS
+#define HIST_CPU_SLICE_BINS 8192
+#endif
+#ifndef HIST_CPU_BLOCK_PIXELS
+#define HIST_CPU_BLOCK_PIXELS 4096
+#endif
+
+const char *hist_cpu_kernel_names[] = {"scalar", "banked", "simd"};
+const char *hist_simd_level_names[] = {"auto", "neon", "avx2", "avx512"};
+
+// CPU版本的直方图计算
+void compute_histogram_cpu(const unsigned char *image, int size, unsigned int *histogram)
+{
+    memset(histogram, 0, HISTOGRAM_BINS * sizeof(unsigned int));
+
+    for (int i = 0; i < size; i++)
+    {
+        histogram[image[i]]++;
+    }
+}
+
+// 多bank标量版本：相邻像素交错统计到HIST_BANKS个子直方图，最后合并
+// 相邻像素落在同一个bin时，单一直方图的 histogram[image[i]]++ 会因store-to-load
+// forwarding串行化；分bank后相邻的读-改-写访问不同地址，可以并行执行
+// （与HLS版本中 hist_acc0..3 的思路相同）
+static void compute_histogram_cpu_banked(const unsigned char *image, int size, unsigned int *histogram)
+{
+    unsigned int banks[HIST_BANKS][HISTOGRAM_BINS];
+    memset(banks, 0, sizeof(banks));
+
+    int i = 0;
+    for (; i + HIST_BANKS <= size; i += HIST_BANKS)
+    {
+        banks[0][image[i]]++;
+        banks[1][image[i + 1]]++;
+        banks[2][image[i + 2]]++;
+        banks[3][image[i + 3]]++;
+#if HIST_BANKS == 8
+        banks[4][image[i + 4]]++;
+        banks[5][image[i + 5]]++;
+        banks[6][image[i + 6]]++;
+        banks[7][image[i + 7]]++;
+#endif
+    }
+    // 处理剩余像素
+    for (; i < size; i++)
+    {
+        banks[0][image[i]]++;
+    }
+
+    simd_merge_banks(&banks[0][0], HIST_BANKS, histogram);
+}
+
+// ===== 多通道kernel =====
+// 交错的多通道图像一次遍历统计所有通道，不需要先在主机上拆成单通道平面（省掉一次完整的内存读写）
+// 与单通道kernel的接口相同，但size是像素数，结果写入histogram[channels * HISTOGRAM_BINS]
+
+void compute_histogram_cpu_channels(const unsigned char *image, int num_pixels, int channels, unsigned int *histogram)
+{
+    memset(histogram, 0, (size_t)channels * HISTOGRAM_BINS * sizeof(unsigned int));
+
+    for (int p = 0; p < num_pixels; p++)
+    {
+        const unsigned char *pixel = image + (size_t)p * channels;
+        for (int c = 0; c < channels; c++)
+        {
+            histogram[c * HISTOGRAM_BINS + pixel[c]]++;
+        }
+    }
+}
+
+// 通道数整除8（2/4通道）：每次读一个64位字统计到8个bank，bank k固定属于通道 k % channels
+// （与HLS核心中RGBA每个lane固定属于一个通道相同），同一通道相邻像素也落在不同bank
+static void compute_histogram_cpu_words(const unsigned char *image, int num_pixels, int channels, unsigned int *histogram)
+{
+    unsigned int banks[8][HISTOGRAM_BINS];
+    memset(banks, 0, sizeof(banks));
+
+    size_t size = (size_t)num_pixels * channels;
+    size_t i = 0;
+    for (; i + 8 <= size; i += 8)
+    {
+        uint64_t w;
+        memcpy(&w, image + i, sizeof(w));
+        SIMD_COUNT_WORD(banks, w);
+    }
+    // 剩余字节：i是8的倍数，字节位置不变
+    for (; i < size; i++)
+    {
+        banks[i % 8][image[i]]++;
+    }
+
+    for (int c = 0; c < channels; c++)
+    {
+        for (int b = 0; b < HISTOGRAM_BINS; b++)
+        {
+            unsigned int sum = 0;
+            for (int k = c; k < 8; k += channels)
+            {
+                sum += banks[k][b];
+            }
+            histogram[c * HISTOGRAM_BINS + b] = sum;
+        }
+    }
+}
+
+static void compute_histogram_cpu_2ch(const unsigned char *image, int num_pixels, unsigned int *histogram)
+{
+    compute_histogram_cpu_words(image, num_pixels, 2, histogram);
+}
+
+static void compute_histogram_cpu_rgba(const unsigned char *image, int num_pixels, unsigned int *histogram)
+{
+    compute_histogram_cpu_words(image, num_pixels, 4, histogram);
+}
+
+// RGB：每次处理两个像素（6字节），两个像素的R/G/B分别统计到6个bank
+static void compute_histogram_cpu_rgb(const unsigned char *image, int num_pixels, unsigned int *histogram)
+{
+    unsigned int banks[6][HISTOGRAM_BINS];
+    memset(banks, 0, sizeof(banks));
+
+    int p = 0;
+    for (; p + 2 <= num_pixels; p += 2)
+    {
+        const unsigned char *px = image + (size_t)p * 3;
+        banks[0][px[0]]++;
+        banks[1][px[1]]++;
+        banks[2][px[2]]++;
+        banks[3][px[3]]++;
+        banks[4][px[4]]++;
+        banks[5][px[5]]++;
+    }
+    if (p < num_pixels)
+    {
+        const unsigned char *px = image + (size_t)p * 3;
+        banks[0][px[0]]++;
+        banks[1][px[1]]++;
+        banks[2][px[2]]++;
+    }
+
+    for (int c = 0; c < 3; c++)
+    {
+        for (int b = 0; b < HISTOGRAM_BINS; b++)
+        {
+            histogram[c * HISTOGRAM_BINS + b] = banks[c][b] + banks[c + 3][b];
+        }
+    }
+}
+
+static const char *channel_kernel_names[] = {"", "", "2ch", "rgb", "rgba"};
+
+static histogram_fn channel_kernel(int channels)
+{
+    if (channels == 2)
+        return compute_histogram_cpu_2ch;
+    if (channels == 3)
+        return compute_histogram_cpu_rgb;
+    return compute_histogram_cpu_rgba;
+}
+
+// ===== 高位深kernel =====
+// 16位像素（pixel_bits = 10/12/16），bin = (像素 & mask) >> shift
+// 全分辨率的16位直方图有65536个bin（256KB）：放不进L1，在Cortex-A53这样的小核上连L2都放不下，
+// 8位kernel的多bank技巧（每个bank一份完整直方图）在这里只会让情况更糟
+
+typedef struct
+{
+    unsigned int mask;
+    int shift;
+    int num_bins;
+} WideParams;
+
+typedef void (*wide_histogram_fn)(const unsigned short *image, int size, const WideParams *params,
+                                  unsigned int *histogram);
+
+void compute_histogram_cpu_u16(const unsigned short *image, int size, int pixel_bits, int bin_shift,
+                               unsigned int *histogram)
+{
+    unsigned int mask = (1u << pixel_bits) - 1;
+    memset(histogram, 0, ((size_t)1 << (pixel_bits - bin_shift)) * sizeof(unsigned int));
+
+    for (int i = 0; i < size; i++)
+    {
+        histogram[(image[i] & mask) >> bin_shift]++;
+    }
+}
+
+// 直接统计到一份直方图，4路展开；直方图在L2里时最快
+static void compute_histogram_wide_direct(const unsigned short *image, int size, const WideParams *params,
+                                          unsigned int *histogram)
+{
+    unsigned int mask = params->mask;
+    int shift = params->shift;
+    memset(histogram, 0, params->num_bins * sizeof(unsigned int));
+
+    int i = 0;
+    for (; i + 4 <= size; i += 4)
+    {
+        histogram[(image[i] & mask) >> shift]++;
+        histogram[(image[i + 1] & mask) >> shift]++;
+        histogram[(image[i + 2] & mask) >> shift]++;
+        histogram[(image[i + 3] & mask) >> shift]++;
+    }
+    for (; i < size; i++)
+    {
+        histogram[(image[i] & mask) >> shift]++;
+    }
+}
+
+// cache分块：bin空间切成HIST_CPU_SLICE_BINS个bin一片，输入按HIST_CPU_BLOCK_PIXELS个像素分块，
+// 每块先按分片做一次计数排序（分片内的bin号按分片顺序写进块缓冲区，顺序写），再逐个分片统计，
+// 随机的read-modify-write只落在L1里的一个分片上；块缓冲区和分片计数都在L1里
+static void compute_histogram_wide_blocked(const unsigned short *image, int size, const WideParams *params,
+                                           unsigned int *histogram)
+{
+    if (params->num_bins <= HIST_CPU_SLICE_BINS)
+    {
+        compute_histogram_wide_direct(image, size, params, histogram);
+        return;
+    }
+
+    unsigned int mask = params->mask;
+    int shift = params->shift;
+    int slice_bits = 0;
+    while ((1 << slice_bits) < HIST_CPU_SLICE_BINS)
+        slice_bits++;
+    int num_slices = params->num_bins >> slice_bits;
+    memset(histogram, 0, params->num_bins * sizeof(unsigned int));
+
+    unsigned short bucket[HIST_CPU_BLOCK_PIXELS];
+    int slice_end[HIST_MAX_BINS / HIST_CPU_SLICE_BINS + 1];
+    for (int block = 0; block < size; block += HIST_CPU_BLOCK_PIXELS)
+    {
+        const unsigned short *pixels = image + block;
+        int count = size - block < HIST_CPU_BLOCK_PIXELS ? size - block : HIST_CPU_BLOCK_PIXELS;
+
+        memset(slice_end, 0, sizeof(slice_end));
+        for (int i = 0; i < count; i++)
+        {
+            slice_end[(((pixels[i] & mask) >> shift) >> slice_bits) + 1]++;
+        }
+        for (int k = 1; k <= num_slices; k++)
+        {
+            slice_end[k] += slice_end[k - 1];
+        }
+        // 之后slice_end[k]是分片k的写位置，写完后正好是分片k的结束位置
+        for (int i = 0; i < count; i++)
+        {
+            unsigned int bin = (pixels[i] & mask) >> shift;
+            bucket[slice_end[bin >> slice_bits]++] = (unsigned short)(bin & (HIST_CPU_SLICE_BINS - 1));
+        }
+
+        int begin = 0;
+        for (int k = 0; k < num_slices; k++)
+        {
+            unsigned int *slice = histogram + ((size_t)k << slice_bits);
+            for (int i = begin; i < slice_end[k]; i++)
+            {
+                slice[bucket[i]]++;
+            }
+            begin = slice_end[k];
+        }
+    }
+}
+
+static void compute_histogram_wide_reference(const unsigned short *image, int size, const WideParams *params,
+                                             unsigned int *histogram)
+{
+    memset(histogram, 0, params->num_bins * sizeof(unsigned int));
+    for (int i = 0; i < size; i++)
+    {
+        histogram[(image[i] & params->mask) >> params->shift]++;
+    }
+}
+
+// 直接统计和分块哪个快取决于直方图和cache的大小，创建context时在1M个均匀分布的像素上各测两次，选快的
+static wide_histogram_fn select_wide_kernel(const WideParams *params, const char **name)
+{
+    *name = "direct";
+    if (params->num_bins <= HIST_CPU_SLICE_BINS)
+        return compute_histogram_wide_direct;
+
+    int size = 1 << 20;
+    unsigned short *image = (unsigned short *)malloc(size * sizeof(unsigned short));
+    unsigned int *histogram = (unsigned int *)malloc(params->num_bins * sizeof(unsigned int));
+    if (!image || !histogram)
+    {
+        free(image);
+        free(histogram);
+        return compute_histogram_wide_direct;
+    }
+    unsigned int seed = 2463534242u;
+    for (int i = 0; i < size; i++)
+    {
+        seed ^= seed << 13;
+        seed ^= seed >> 17;
+        seed ^= seed << 5;
+        image[i] = (unsigned short)(seed >> 16);
+    }
+
+    wide_histogram_fn candidates[2] = {compute_histogram_wide_direct, compute_histogram_wide_blocked};
+    double best[2] = {0.0, 0.0};
+    for (int run = 0; run < 2; run++)
+    {
+        for (int k = 0; k < 2; k++)
+        {
+            double start = get_time_ms();
+            candidates[k](image, size, params, histogram);
+            double elapsed = get_time_ms() - start;
+            if (run == 0 || elapsed < best[k])
+                best[k] = elapsed;
+        }
+    }
+    free(image);
+    free(histogram);
+
+    if (best[1] < best[0])
+    {
+        *name = "blocked";
+        return compute_histogram_wide_blocked;
+    }
+    return compute_histogram_wide_direct;
+}
+
+// ===== SIMD kernel选择 =====
+
+// 自动校准只做一次，结果在所有context之间共享
+static pthread_once_t simd_once = PTHREAD_ONCE_INIT;
+static SimdLevel simd_best_level = SIMD_NONE;
+
+static void simd_calibrate(void)
+{
+    simd_best_level = simd_detect_best(compute_histogram_cpu_banked);
+}
+
+// 返回SIMD kernel；强制指定的级别不支持时退回自动选择，*unsupported设为该级别的名字（否则为NULL）
+static histogram_fn select_simd_kernel(HistSimdLevel requested, SimdLevel *level, const char **unsupported)
+{
+    *unsupported = NULL;
+    if (requested != HIST_SIMD_AUTO)
+    {
+        SimdLevel forced = (SimdLevel)requested; // 两个枚举的取值一一对应
+        histogram_fn fn = simd_kernel_fn(forced);
+        if (fn)
+        {
+            *level = forced;
+            return fn;
+        }
+        *unsupported = simd_level_names[forced];
+    }
+
+    pthread_once(&simd_once, simd_calibrate);
+    histogram_fn fn = simd_kernel_fn(simd_best_level);
+    *level = fn ? simd_best_level : SIMD_NONE;
+    return fn ? fn : compute_histogram_cpu_banked;
+}
+
+// ===== 分块直方图 =====
+// 每个tile_width×tile_height块一份直方图（例如局部对比度、分区曝光、变化检测），布局见 hist_compute_tiled
+
+void compute_histogram_cpu_tiles(const unsigned char *image, int width, int height, int stride, int tile_width,
+                                 int tile_height, int bin_shift, unsigned int *tiles)
+{
+    int tiles_x = (width + tile_width - 1) / tile_width;
+    int tiles_y = (height + tile_height - 1) / tile_height;
+    int num_bins = HISTOGRAM_BINS >> bin_shift;
+    unsigned char *crop = (unsigned char *)malloc((size_t)tile_width * tile_height);
+    unsigned int histogram[HISTOGRAM_BINS];
+
+    for (int ty = 0; ty < tiles_y; ty++)
+    {
+        for (int tx = 0; tx < tiles_x; tx++)
+        {
+            int x0 = tx * tile_width;
+            int y0 = ty * tile_height;
+            int w = x0 + tile_width < width ? tile_width : width - x0;
+            int h = y0 + tile_height < height ? tile_height : height - y0;
+            for (int y = 0; y < h; y++)
+            {
+                memcpy(crop + (size_t)y * w, image + (size_t)(y0 + y) * stride + x0, w);
+            }
+            compute_histogram_cpu(crop, w * h, histogram);
+
+            unsigned int *tile = tiles + ((size_t)ty * tiles_x + tx) * num_bins;
+            memset(tile, 0, num_bins * sizeof(unsigned int));
+            for (int b = 0; b < HISTOGRAM_BINS; b++)
+            {
+                tile[b >> bin_shift] += histogram[b];
+            }
+        }
+    }
+    free(crop);
+}
+
+// 统计第first_row..last_row-1行块：每行像素只读一次，按顺序加到这一行经过的各个块的直方图上，
+// 一行块的直方图（tiles_x × num_bins）在处理这行块期间一直在cache里。
+// frame非NULL时同时得到整帧直方图：块不小于bin数时，每行块结束后把刚写完（还在cache里）的块直方图按bin相加，
+// 每像素只多了 num_bins / 块像素数 次连续的加法（可以向量化）；块比bin数小时（例如8×8块、256个bin）
+// 归约比逐像素统计还贵，改为趁这一行还在L1里再统计一遍
+static void compute_tile_rows(const HistTileJob *job, int first_row, int last_row, unsigned int *frame)
+{
+    int num_bins = job->num_bins;
+    int shift = job->bin_shift;
+    size_t band_bins = (size_t)job->tiles_x * num_bins;
+    int reduce = frame && num_bins <= job->tile_width * job->tile_height;
+    int count = frame && !reduce;
+    if (frame)
+        memset(frame, 0, num_bins * sizeof(unsigned int));
+
+    for (int ty = first_row; ty < last_row; ty++)
+    {
+        unsigned int *band = job->tiles + (size_t)ty * band_bins;
+        memset(band, 0, band_bins * sizeof(unsigned int));
+        int y_end = (ty + 1) * job->tile_height < job->height ? (ty + 1) * job->tile_height : job->height;
+        for (int y = ty * job->tile_height; y < y_end; y++)
+        {
+            const unsigned char *row = job->image + (size_t)y * job->stride;
+            unsigned int *hist = band;
+            for (int x = 0; x < job->width; x += job->tile_width, hist += num_bins)
+            {
+                int end = x + job->tile_width < job->width ? x + job->tile_width : job->width;
+                for (int i = x; i < end; i++)
+                {
+                    hist[row[i] >> shift]++;
+                }
+            }
+            if (count)
+            {
+                for (int i = 0; i < job->width; i++)
+                {
+                    frame[row[i] >> shift]++;
+                }
+            }
+        }
+
+        if (reduce)
+        {
+            for (int t = 0; t < job->tiles_x; t++)
+            {
+                const unsigned int *hist = band + (size_t)t * num_bins;
+                for (int b = 0; b < num_bins; b++)
+                {
+                    frame[b] += hist[b];
+                }
+            }
+        }
+    }
+}
+
+// ===== 多线程引擎 =====
+// 每个线程统计到自己私有的直方图，最后再归约，避免线程之间的原子操作和false sharing
+
+// 线程私有直方图：按cache line对齐，每个通道256个bin正好是16个cache line
+typedef struct
+{
+    unsigned int bins[HIST_MAX_CHANNELS * HISTOGRAM_BINS];
+} ThreadHistogram;
+
+typedef struct HistogramThreadPool HistogramThreadPool;
+
+typedef struct
+{
+    HistogramThreadPool *pool;
+    int index;
+} WorkerArg;
+
+// 常驻线程池：线程只创建一次，每次计算通过generation计数唤醒
+struct HistogramThreadPool
+{
+    int num_threads; // 包括调用线程本身
+    int channels;    // 每个像素的字节数，kernel的size参数是像素数
+    int pin_threads; // worker t绑定到CPU t
+    histogram_fn kernel;
+
+    // 高位深（wide_kernel非NULL时）：每个线程一份num_bins个bin的私有直方图，
+    // 线程数 × 65536个bin时归约不能再忽略，按bin切块由所有线程并行完成
+    wide_histogram_fn wide_kernel;
+    WideParams wide;
+    unsigned int *wide_hists; // num_threads × wide_stride个计数
+    int wide_stride;          // 按cache line对齐的私有直方图长度
+    void *wide_hists_raw;
+
+    pthread_t *threads;
+    WorkerArg *args;
+    ThreadHistogram *private_hists;
+    void *private_hists_raw;
+
+    pthread_mutex_t lock;
+    pthread_cond_t work_cond;
+    pthread_cond_t done_cond;
+    unsigned long generation;
+    int pending;
+    int shutdown;
+
+    // 当前任务
+    const unsigned char *image;
+    int size; // 像素数
+    int reduce_phase; // 1 = 高位深的归约阶段，每个线程把一段bin跨所有私有直方图相加
+    unsigned int *output;
+    const HistTileJob *tile_job; // 非NULL时是分块直方图：按块行分给各线程
+};
+
+// 计算第index个线程负责的像素范围，分块边界按cache line对齐
+static void thread_chunk(int size, int num_threads, int index, int *start, int *end)
+{
+    int chunk = (size + num_threads - 1) / num_threads;
+    chunk = (chunk + CACHE_LINE_SIZE - 1) / CACHE_LINE_SIZE * CACHE_LINE_SIZE;
+
+    long long s = (long long)chunk * index;
+    long long e = s + chunk;
+    *start = s < size ? (int)s : size;
+    *end = e < size ? (int)e : size;
+}
+
+static void process_chunk(HistogramThreadPool *pool, int index)
+{
+    int start, end;
+    if (pool->tile_job)
+    {
+        // 每行块的输出只由一个线程写；整帧直方图各线程先归约到自己的私有直方图
+        const HistTileJob *job = pool->tile_job;
+        int rows = (job->tiles_y + pool->num_threads - 1) / pool->num_threads;
+        start = index * rows < job->tiles_y ? index * rows : job->tiles_y;
+        end = start + rows < job->tiles_y ? start + rows : job->tiles_y;
+        compute_tile_rows(job, start, end, job->histogram ? pool->private_hists[index].bins : NULL);
+        return;
+    }
+    if (pool->reduce_phase)
+    {
+        // bin块也按cache line（16个bin）对齐，相邻线程不会写同一条cache line
+        thread_chunk(pool->wide.num_bins, pool->num_threads, index, &start, &end);
+        if (start >= end)
+            return;
+        memcpy(pool->output + start, pool->wide_hists + start, (end - start) * sizeof(unsigned int));
+        for (int t = 1; t < pool->num_threads; t++)
+        {
+            const unsigned int *hist = pool->wide_hists + (size_t)t * pool->wide_stride;
+            for (int b = start; b < end; b++)
+            {
+                pool->output[b] += hist[b];
+            }
+        }
+        return;
+    }
+
+    thread_chunk(pool->size, pool->num_threads, index, &start, &end);
+    if (pool->wide_kernel)
+    {
+        pool->wide_kernel((const unsigned short *)pool->image + start, end - start, &pool->wide,
+                          pool->wide_hists + (size_t)index * pool->wide_stride);
+        return;
+    }
+    pool->kernel(pool->image + (size_t)start * pool->channels, end - start, pool->private_hists[index].bins);
+}
+
+static void *histogram_worker(void *arg)
+{
+    WorkerArg *worker = (WorkerArg *)arg;
+    HistogramThreadPool *pool = worker->pool;
+    unsigned long seen_generation = 0;
+    if (pool->pin_threads)
+    {
+        hist_pin_thread(worker->index);
+    }
+
+    while (1)
+    {
+        pthread_mutex_lock(&pool->lock);
+        while (!pool->shutdown && pool->generation == seen_generation)
+        {
+            pthread_cond_wait(&pool->work_cond, &pool->lock);
+        }
+        if (pool->shutdown)
+        {
+            pthread_mutex_unlock(&pool->lock);
+            break;
+        }
+        seen_generation = pool->generation;
+        pthread_mutex_unlock(&pool->lock);
+
+        process_chunk(pool, worker->index);
+
+        pthread_mutex_lock(&pool->lock);
+        if (--pool->pending == 0)
+        {
+            pthread_cond_signal(&pool->done_cond);
+        }
+        pthread_mutex_unlock(&pool->lock);
+    }
+    return NULL;
+}
+
+static void histogram_pool_destroy(HistogramThreadPool *pool);
+
+static HistogramThreadPool *histogram_pool_create(int num_threads, histogram_fn kernel, int channels, int pin_threads)
+{
+    HistogramThreadPool *pool = (HistogramThreadPool *)calloc(1, sizeof(HistogramThreadPool));
+    if (!pool)
+        return NULL;
+    pool->num_threads = num_threads;
+    pool->pin_threads = pin_threads;
+    pool->channels = channels;
+    pool->kernel = kernel;
+
+    // 手动对齐到cache line，保证每个线程的直方图不与其他线程共享cache line
+    pool->private_hists_raw = malloc(num_threads * sizeof(ThreadHistogram) + CACHE_LINE_SIZE);
+    pool->threads = (pthread_t *)malloc(num_threads * sizeof(pthread_t));
+    pool->args = (WorkerArg *)malloc(num_threads * sizeof(WorkerArg));
+    if (!pool->private_hists_raw || !pool->threads || !pool->args)
+    {
+        free(pool->private_hists_raw);
+        free(pool->threads);
+        free(pool->args);
+        free(pool);
+        return NULL;
+    }
+    size_t addr = (size_t)pool->private_hists_raw;
+    addr = (addr + CACHE_LINE_SIZE - 1) & ~(size_t)(CACHE_LINE_SIZE - 1);
+    pool->private_hists = (ThreadHistogram *)addr;
+
+    pthread_mutex_init(&pool->lock, NULL);
+    pthread_cond_init(&pool->work_cond, NULL);
+    pthread_cond_init(&pool->done_cond, NULL);
+
+    // 调用线程自己作为第0号worker，只需要额外创建num_threads-1个线程
+    for (int t = 1; t < num_threads; t++)
+    {
+        pool->args[t].pool = pool;
+        pool->args[t].index = t;
+        if (pthread_create(&pool->threads[t], NULL, histogram_worker, &pool->args[t]) != 0)
+        {
+            // 只停止并join已经启动的worker，否则histogram_pool_run会一直等没有线程处理的块
+            pool->num_threads = t;
+            histogram_pool_destroy(pool);
+            return NULL;
+        }
+    }
+    return pool;
+}
+
+// 高位深的线程池：每个线程的私有直方图有num_bins个bin，单独分配
+static HistogramThreadPool *histogram_pool_create_wide(int num_threads, wide_histogram_fn kernel,
+                                                       const WideParams *params, int pin_threads)
+{
+    HistogramThreadPool *pool = histogram_pool_create(num_threads, NULL, 1, pin_threads);
+    if (!pool)
+        return NULL;
+    pool->wide_kernel = kernel;
+    pool->wide = *params;
+    pool->wide_stride = (params->num_bins + CACHE_LINE_SIZE / 4 - 1) / (CACHE_LINE_SIZE / 4) * (CACHE_LINE_SIZE / 4);
+    pool->wide_hists_raw = malloc((size_t)num_threads * pool->wide_stride * sizeof(unsigned int) + CACHE_LINE_SIZE);
+    if (!pool->wide_hists_raw)
+    {
+        histogram_pool_destroy(pool);
+        return NULL;
+    }
+    size_t addr = (size_t)pool->wide_hists_raw;
+    addr = (addr + CACHE_LINE_SIZE - 1) & ~(size_t)(CACHE_LINE_SIZE - 1);
+    pool->wide_hists = (unsigned int *)addr;
+    return pool;
+}
+
+static void histogram_pool_destroy(HistogramThreadPool *pool)
+{
+    pthread_mutex_lock(&pool->lock);
+    pool->shutdown = 1;
+    pthread_cond_broadcast(&pool->work_cond);
+    pthread_mutex_unlock(&pool->lock);
+
+    for (int t = 1; t < pool->num_threads; t++)
+    {
+        pthread_join(pool->threads[t], NULL);
+    }
+
+    pthread_mutex_destroy(&pool->lock);
+    pthread_cond_destroy(&pool->work_cond);
+    pthread_cond_destroy(&pool->done_cond);
+    free(pool->threads);
+    free(pool->args);
+    free(pool->private_hists_raw);
+    free(pool->wide_hists_raw);
+    free(pool);
+}
+
+// 唤醒所有worker执行当前任务，调用线程处理第0块，等所有线程完成
+static void histogram_pool_run(HistogramThreadPool *pool)
+{
+    pthread_mutex_lock(&pool->lock);
+    pool->pending = pool->num_threads - 1;
+    pool->generation++;
+    pthread_cond_broadcast(&pool->work_cond);
+    pthread_mutex_unlock(&pool->lock);
+
+    process_chunk(pool, 0);
+
+    pthread_mutex_lock(&pool->lock);
+    while (pool->pending > 0)
+    {
+        pthread_cond_wait(&pool->done_cond, &pool->lock);
+    }
+    pthread_mutex_unlock(&pool->lock);
+}
+
+// 多线程直方图计算：图像按线程数切块，各线程统计私有直方图后归约
+static void compute_histogram_cpu_mt(HistogramThreadPool *pool, const unsigned char *image, int size, unsigned int *histogram)
+{
+    int num_threads = pool->num_threads;
+
+    pool->image = image;
+    pool->size = size;
+    pool->reduce_phase = 0;
+    histogram_pool_run(pool);
+
+    // 高位深：65536个bin × 线程数的归约比统计一帧小图还慢，再唤醒一次所有线程，每个线程负责一段bin
+    if (pool->wide_kernel)
+    {
+        pool->output = histogram;
+        pool->reduce_phase = 1;
+        histogram_pool_run(pool);
+        return;
+    }
+
+    // 归约：256个bin × 通道数 × 线程数，开销可以忽略
+    int num_bins = pool->channels * HISTOGRAM_BINS;
+    memcpy(histogram, pool->private_hists[0].bins, num_bins * sizeof(unsigned int));
+    for (int t = 1; t < num_threads; t++)
+    {
+        unsigned int *hist = pool->private_hists[t].bins;
+        for (int b = 0; b < num_bins; b++)
+        {
+            histogram[b] += hist[b];
+        }
+    }
+}
+
+// ===== 后端接口 =====
+
+typedef struct
+{
+    HistogramThreadPool *pool; // 单线程时为NULL
+    histogram_fn kernel;       // 单线程时使用的kernel
+    int channels;
+    wide_histogram_fn wide_kernel; // 高位深时使用，此时kernel为NULL
+    WideParams wide;
+} CpuState;
+
+static int cpu_create(HistContext *ctx)
+{
+    HistConfig *config = &ctx->config;
+    int threads = config->num_threads;
+    if (threads <= 0)
+        threads = get_num_cpus();
+    if (threads > MAX_THREADS)
+        threads = MAX_THREADS;
+    config->num_threads = threads;
+
+    CpuState *state = (CpuState *)calloc(1, sizeof(CpuState));
+    if (!state)
+        return HIST_ERR_NOMEM;
+
+    state->channels = config->channels;
+
+    if (config->pixel_bits > 8)
+    {
+        // 高位深：scalar为参考循环，banked强制使用cache分块kernel，simd在直接统计和分块之间实测选择
+        state->wide.mask = (1u << config->pixel_bits) - 1;
+        state->wide.shift = config->bin_shift;
+        state->wide.num_bins = 1 << (config->pixel_bits - config->bin_shift);
+        const char *wide_name = "direct";
+        if (config->cpu_kernel == HIST_CPU_SCALAR && threads == 1)
+        {
+            state->wide_kernel = compute_histogram_wide_reference;
+            wide_name = "scalar";
+        }
+        else if (config->cpu_kernel == HIST_CPU_BANKED)
+        {
+            state->wide_kernel = compute_histogram_wide_blocked;
+            wide_name = state->wide.num_bins > HIST_CPU_SLICE_BINS ? "blocked" : "direct";
+        }
+        else
+        {
+            state->wide_kernel = select_wide_kernel(&state->wide, &wide_name);
+        }
+
+        if (threads > 1)
+        {
+            state->pool = histogram_pool_create_wide(threads, state->wide_kernel, &state->wide, config->pin_threads);
+            if (!state->pool)
+            {
+                free(state);
+                return HIST_ERR_NOMEM;
+            }
+            snprintf(ctx->description, sizeof(ctx->description), "CPU %d-bit/%d bins %s x%d threads",
+                     config->pixel_bits, state->wide.num_bins, wide_name, threads);
+        }
+        else
+        {
+            snprintf(ctx->description, sizeof(ctx->description), "CPU %d-bit/%d bins %s",
+                     config->pixel_bits, state->wide.num_bins, wide_name);
+        }
+        ctx->state = state;
+        return HIST_OK;
+    }
+
+    SimdLevel level = SIMD_NONE;
+    const char *unsupported;
+    histogram_fn simd_fn = select_simd_kernel(config->simd_level, &level, &unsupported);
+    const char *simd_name = level == SIMD_NONE ? "banked" : simd_level_names[level];
+    if (state->channels > 1)
+    {
+        // 多通道图像不区分scalar/banked/simd，都用按通道分bank的kernel
+        simd_fn = channel_kernel(state->channels);
+        simd_name = channel_kernel_names[state->channels];
+    }
+
+    int uses_simd = state->channels == 1 && threads > 1;
+    if (threads > 1)
+    {
+        // 多线程时每个线程使用最快的kernel
+        state->pool = histogram_pool_create(threads, simd_fn, state->channels, config->pin_threads);
+        if (!state->pool)
+        {
+            free(state);
+            return HIST_ERR_NOMEM;
+        }
+        snprintf(ctx->description, sizeof(ctx->description), "CPU %s x%d threads", simd_name, threads);
+    }
+    else
+    {
+        if (state->channels > 1)
+        {
+            state->kernel = simd_fn;
+        }
+        else if (config->cpu_kernel == HIST_CPU_SCALAR)
+        {
+            state->kernel = compute_histogram_cpu;
+            simd_name = "scalar";
+        }
+        else if (config->cpu_kernel == HIST_CPU_BANKED)
+        {
+            state->kernel = compute_histogram_cpu_banked;
+            simd_name = "banked";
+        }
+        else
+        {
+            state->kernel = simd_fn;
+            uses_simd = 1;
+        }
+        snprintf(ctx->description, sizeof(ctx->description), "CPU %s", simd_name);
+    }
+    // 退回自动选择的情况通过hist_describe报告，库不向stdout打印
+    if (unsupported && uses_simd)
+    {
+        size_t length = strlen(ctx->description);
+        snprintf(ctx->description + length, sizeof(ctx->description) - length, " (%s unsupported)", unsupported);
+    }
+
+    ctx->state = state;
+    return HIST_OK;
+}
+
+static int cpu_compute(HistContext *ctx, const unsigned char *data, size_t size, unsigned int *histogram)
+{
+    CpuState *state = (CpuState *)ctx->state;
+    if (state->wide_kernel)
+    {
+        int num_pixels = (int)(size / sizeof(unsigned short));
+        if (state->pool)
+            compute_histogram_cpu_mt(state->pool, data, num_pixels, histogram);
+        else
+            state->wide_kernel((const unsigned short *)data, num_pixels, &state->wide, histogram);
+        return HIST_OK;
+    }
+    int num_pixels = (int)(size / (size_t)state->channels);
+    if (state->pool)
+        compute_histogram_cpu_mt(state->pool, data, num_pixels, histogram);
+    else
+        state->kernel(data, num_pixels, histogram);
+    return HIST_OK;
+}
+
+static int cpu_compute_tiled(HistContext *ctx, const HistTileJob *job)
+{
+    CpuState *state = (CpuState *)ctx->state;
+    HistogramThreadPool *pool = state->pool;
+    if (!pool)
+    {
+        compute_tile_rows(job, 0, job->tiles_y, job->histogram);
+        return HIST_OK;
+    }
+
+    pool->tile_job = job;
+    histogram_pool_run(pool);
+    pool->tile_job = NULL;
+    if (job->histogram)
+    {
+        memcpy(job->histogram, pool->private_hists[0].bins, job->num_bins * sizeof(unsigned int));
+        for (int t = 1; t < pool->num_threads; t++)
+        {
+            const unsigned int *hist = pool->private_hists[t].bins;
+            for (int b = 0; b < job->num_bins; b++)
+            {
+                job->histogram[b] += hist[b];
+            }
+        }
+    }
+    return HIST_OK;
+}
+
+static void cpu_destroy(HistContext *ctx)
+{
+    CpuState *state = (CpuState *)ctx->state;
+    if (state->pool)
+        histogram_pool_destroy(state->pool);
+    free(state);
+}
+
+const HistBackendOps hist_cpu_ops = {cpu_create, cpu_compute, cpu_destroy, cpu_compute_tiled};
@@ -0,0 +1,90 @@
+// hist_fpga.c
+// libhist FPGA后端（PL上的 Hanwenip_v1_0_HLS / v2 直方图核 + AXI DMA）
+//
+// 只有定义了HIST_WITH_FPGA时才编译，需要链接 hls/histogram_fpga_host.cpp（-Ihls，C程序用g++链接）
+// HistConfig.fpga_device 是主机驱动的设备字符串（见 histogram_fpga_host.h），例如：
+//   "emu"                              软件模拟的DMA和核心，在没有板子的机器上测试
+//   "uio:dma=dma,buf=udmabuf0,irq"     板上通过UIO和u-dma-buf直接驱动AXI DMA
+//   NULL                               使用环境变量HIST_FPGA_DEVICE
+#include <stdio.h>
+
+#include "hist_internal.h"
+
+#ifdef HIST_WITH_FPGA
+
+#include "histogram_fpga_host.h"
+
+static int fpga_status(int status)
+{
+    switch (status)
+    {
+    case FPGA_HOST_OK:
+        return HIST_OK;
+    case FPGA_HOST_ERR_INVALID:
+        return HIST_ERR_INVALID;
+    case FPGA_HOST_ERR_UNSUPPORTED:
+        return HIST_ERR_UNSUPPORTED;
+    default:
+        return HIST_ERR_BACKEND;
+    }
+}
+
+static int fpga_create(HistContext *ctx)
+{
+    // 已部署的核心只统计8位单通道像素（8位图像的bin_shift在hist.c中合并）
+    if (ctx->config.channels != 1 || ctx->config.pixel_bits != 8)
+    {
+        fprintf(stderr, "FPGA backend: the core counts 8-bit single-channel pixels only\n");
+        return HIST_ERR_UNSUPPORTED;
+    }
+
+    FpgaHost *host = NULL;
+    int status = fpga_host_open(&host, ctx->config.fpga_device);
+    if (status != FPGA_HOST_OK)
+    {
+        fprintf(stderr, "FPGA backend: %s\n", fpga_host_strerror(status));
+        return status == FPGA_HOST_ERR_INVALID ? HIST_ERR_INVALID : HIST_ERR_BACKEND;
+    }
+    ctx->state = host;
+    snprintf(ctx->description, sizeof(ctx->description), "FPGA %s", fpga_host_describe(host));
+    return HIST_OK;
+}
+
+static int fpga_compute(HistContext *ctx, const unsigned char *data, size_t size, unsigned int *histogram)
+{
+    return fpga_status(fpga_host_histogram((FpgaHost *)ctx->state, data, size, histogram));
+}
+
+static void fpga_destroy(HistContext *ctx)
+{
+    fpga_host_close((FpgaHost *)ctx->state);
+}
+
+const HistBackendOps hist_fpga_ops = {fpga_create, fpga_compute, fpga_destroy, NULL};
+
+#else // !HIST_WITH_FPGA
+
+static int fpga_create(HistContext *ctx)
+{
+    (void)ctx;
+    fprintf(stderr, "FPGA backend: libhist was built without HIST_WITH_FPGA\n");
+    return HIST_ERR_UNSUPPORTED;
+}
+
+static int fpga_compute(HistContext *ctx, const unsigned char *data, size_t size, unsigned int *histogram)
+{
+    (void)ctx;
+    (void)data;
+    (void)size;
+    (void)histogram;
+    return HIST_ERR_UNSUPPORTED;
+}
+
+static void fpga_destroy(HistContext *ctx)
+{
+    (void)ctx;
+}
+
+const HistBackendOps hist_fpga_ops = {fpga_create, fpga_compute, fpga_destroy, NULL};
+
+#endif // HIST_WITH_FPGA
@@ -0,0 +1,516 @@
+// hist_input.c
+// libhist：内存映射的图像文件输入（PGM / YUV4MPEG2 / 原始帧 / I420），见 hist.h
+#include <ctype.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include "hist.h"
+
+static const char *input_format_names[] = {"raw", "PGM", "Y4M luma", "I420 luma"};
+
+// ===== 文件映射 =====
+
+// 只读映射整个文件，预读并提示顺序访问；空文件返回HIST_ERR_INVALID
+static int map_file(const char *path, unsigned char **map, size_t *size)
+{
+#ifdef _WIN32
+    HANDLE file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING,
+                              FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+    if (file == INVALID_HANDLE_VALUE)
+    {
+        fprintf(stderr, "Input: cannot open %s\n", path);
+        return HIST_ERR_INVALID;
+    }
+    LARGE_INTEGER file_size;
+    if (!GetFileSizeEx(file, &file_size) || file_size.QuadPart == 0)
+    {
+        fprintf(stderr, "Input: %s is empty\n", path);
+        CloseHandle(file);
+        return HIST_ERR_INVALID;
+    }
+    HANDLE mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+    CloseHandle(file);
+    if (!mapping)
+    {
+        fprintf(stderr, "Input: cannot map %s\n", path);
+        return HIST_ERR_NOMEM;
+    }
+    *map = (unsigned char *)MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+    CloseHandle(mapping);
+    if (!*map)
+    {
+        fprintf(stderr, "Input: cannot map %s\n", path);
+        return HIST_ERR_NOMEM;
+    }
+    *size = (size_t)file_size.QuadPart;
+    return HIST_OK;
+#else
+    int fd = open(path, O_RDONLY);
+    if (fd < 0)
+    {
+        fprintf(stderr, "Input: cannot open %s\n", path);
+        return HIST_ERR_INVALID;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size == 0)
+    {
+        fprintf(stderr, "Input: %s is empty\n", path);
+        close(fd);
+        return HIST_ERR_INVALID;
+    }
+    int flags = MAP_PRIVATE;
+#ifdef MAP_POPULATE
+    flags |= MAP_POPULATE; // 映射时读入所有页，计时循环中不再缺页
+#endif
+    void *ptr = mmap(NULL, (size_t)st.st_size, PROT_READ, flags, fd, 0);
+    close(fd);
+    if (ptr == MAP_FAILED)
+    {
+        fprintf(stderr, "Input: cannot map %s\n", path);
+        return HIST_ERR_NOMEM;
+    }
+    // 没有MAP_POPULATE的系统上由WILLNEED触发预读；帧按顺序读取
+#ifdef MADV_WILLNEED
+    madvise(ptr, (size_t)st.st_size, MADV_WILLNEED);
+#endif
+#ifdef MADV_SEQUENTIAL
+    madvise(ptr, (size_t)st.st_size, MADV_SEQUENTIAL);
+#endif
+    *map = (unsigned char *)ptr;
+    *size = (size_t)st.st_size;
+    return HIST_OK;
+#endif
+}
+
+static void unmap_file(unsigned char *map, size_t size)
+{
+    if (!map)
+        return;
+#ifdef _WIN32
+    (void)size;
+    UnmapViewOfFile(map);
+#else
+    munmap(map, size);
+#endif
+}
+
+// ===== 格式解析 =====
+
+static int add_frame(HistInput *input, size_t offset, int *capacity)
+{
+    if (input->num_frames == *capacity)
+    {
+        int new_capacity = *capacity ? *capacity * 2 : 64;
+        size_t *offsets = (size_t *)realloc(input->frame_offsets, (size_t)new_capacity * sizeof(size_t));
+        if (!offsets)
+            return HIST_ERR_NOMEM;
+        input->frame_offsets = offsets;
+        *capacity = new_capacity;
+    }
+    input->frame_offsets[input->num_frames++] = offset;
+    return HIST_OK;
+}
+
+// 计算frame_size，检查位宽和通道数
+static int finish_geometry(HistInput *input)
+{
+    if (input->width <= 0 || input->height <= 0 || input->channels < 1 || input->channels > HIST_MAX_CHANNELS ||
+        (input->pixel_bits != 8 && input->pixel_bits != 10 && input->pixel_bits != 12 && input->pixel_bits != 16) ||
+        (input->pixel_bits > 8 && input->channels != 1))
+    {
+        fprintf(stderr, "Input: unsupported geometry %dx%d, %d channels, %d-bit\n", input->width, input->height,
+                input->channels, input->pixel_bits);
+        return HIST_ERR_INVALID;
+    }
+    input->frame_size = (size_t)input->width * input->height * input->channels * (input->pixel_bits > 8 ? 2 : 1);
+    return HIST_OK;
+}
+
+// PGM头部的一个十进制数，跳过前面的空白和注释
+static int pgm_number(const unsigned char *data, size_t size, size_t *pos, int *value)
+{
+    while (*pos < size)
+    {
+        if (data[*pos] == '#')
+        {
+            while (*pos < size && data[*pos] != '\n')
+                (*pos)++;
+        }
+        else if (isspace(data[*pos]))
+        {
+            (*pos)++;
+        }
+        else
+        {
+            break;
+        }
+    }
+    if (*pos >= size || !isdigit(data[*pos]))
+        return 0;
+    long long v = 0;
+    while (*pos < size && isdigit(data[*pos]) && v < 1000000000)
+        v = v * 10 + (data[(*pos)++] - '0');
+    *value = (int)v;
+    return 1;
+}
+
+// 一个或多个首尾相连的P5图像，后面的图像必须与第一幅大小相同
+static int parse_pgm(HistInput *input)
+{
+    const unsigned char *data = input->map;
+    size_t size = input->map_size;
+    size_t pos = 0;
+    int capacity = 0;
+    while (pos + 2 <= size && data[pos] == 'P' && data[pos + 1] == '5')
+    {
+        pos += 2;
+        int width, height, maxval;
+        if (!pgm_number(data, size, &pos, &width) || !pgm_number(data, size, &pos, &height) ||
+            !pgm_number(data, size, &pos, &maxval) || maxval <= 0 || maxval > 65535 || pos >= size)
+        {
+            fprintf(stderr, "Input: bad PGM header in %s\n", input->path);
+            return HIST_ERR_INVALID;
+        }
+        pos++; // maxval后面的一个空白字符
+        int bits = maxval < 256 ? 8 : maxval < 1024 ? 10 : maxval < 4096 ? 12 : 16;
+        if (input->num_frames == 0)
+        {
+            input->width = width;
+            input->height = height;
+            input->pixel_bits = bits;
+            int status = finish_geometry(input);
+            if (status != HIST_OK)
+                return status;
+        }
+        else if (width != input->width || height != input->height || bits != input->pixel_bits)
+        {
+            fprintf(stderr, "Input: PGM image %d in %s has a different size, ignoring the rest\n",
+                    input->num_frames, input->path);
+            break;
+        }
+        if (pos + input->frame_size > size)
+            break; // 截断的最后一幅
+        if (add_frame(input, pos, &capacity) != HIST_OK)
+            return HIST_ERR_NOMEM;
+        pos += input->frame_size;
+        while (pos < size && isspace(data[pos]))
+            pos++;
+    }
+    if (input->num_frames == 0)
+    {
+        fprintf(stderr, "Input: %s is not a binary (P5) PGM\n", input->path);
+        return HIST_ERR_INVALID;
+    }
+
+    // 16位PGM是大端：转换成小端的连续帧
+    if (input->pixel_bits > 8)
+    {
+        input->converted = (unsigned char *)malloc(input->frame_size * input->num_frames);
+        if (!input->converted)
+            return HIST_ERR_NOMEM;
+        for (int f = 0; f < input->num_frames; f++)
+        {
+            const unsigned char *src = data + input->frame_offsets[f];
+            unsigned char *dst = input->converted + input->frame_size * f;
+            for (size_t i = 0; i < input->frame_size; i += 2)
+            {
+                dst[i] = src[i + 1];
+                dst[i + 1] = src[i];
+            }
+            input->frame_offsets[f] = input->frame_size * f;
+        }
+    }
+    return HIST_OK;
+}
+
+// Y4M色度格式：色度平面的水平/垂直下采样（右移位数，mono没有色度平面）、alpha平面和位宽
+static int y4m_colorspace(const char *name, int *h_shift, int *v_shift, int *planes, int *bits)
+{
+    static const struct
+    {
+        const char *prefix;
+        int h_shift;
+        int v_shift;
+        int planes; // 亮度之后的平面数
+    } layouts[] = {{"420", 1, 1, 2}, {"422", 1, 0, 2}, {"444", 0, 0, 2}, {"411", 2, 0, 2}, {"mono", 0, 0, 0}};
+    for (size_t i = 0; i < sizeof(layouts) / sizeof(layouts[0]); i++)
+    {
+        size_t n = strlen(layouts[i].prefix);
+        if (strncmp(name, layouts[i].prefix, n) != 0)
+            continue;
+        *h_shift = layouts[i].h_shift;
+        *v_shift = layouts[i].v_shift;
+        *planes = layouts[i].planes;
+        // 420jpeg / 420paldv / 420mpeg2 都是8位，p10 / p12 / p16 为高位深，mono16为16位，444alpha多一个alpha平面
+        const char *suffix = name + n;
+        *bits = 8;
+        if (suffix[0] == 'p' && isdigit((unsigned char)suffix[1]))
+            *bits = atoi(suffix + 1);
+        else if (isdigit((unsigned char)suffix[0]))
+            *bits = atoi(suffix);
+        else if (strcmp(suffix, "alpha") == 0)
+            *planes = 3;
+        return 1;
+    }
+    return 0;
+}
+
+static int parse_y4m(HistInput *input)
+{
+    const unsigned char *data = input->map;
+    size_t size = input->map_size;
+    const unsigned char *end = (const unsigned char *)memchr(data, '\n', size);
+    if (!end)
+    {
+        fprintf(stderr, "Input: bad Y4M header in %s\n", input->path);
+        return HIST_ERR_INVALID;
+    }
+
+    // 流头部："YUV4MPEG2 W1920 H1080 F30:1 Ip A1:1 C420jpeg"，没有C参数时为420jpeg
+    char header[512];
+    size_t header_len = (size_t)(end - data) < sizeof(header) - 1 ? (size_t)(end - data) : sizeof(header) - 1;
+    memcpy(header, data, header_len);
+    header[header_len] = '\0';
+    char colorspace[32] = "420jpeg";
+    int h_shift = 1, v_shift = 1, planes = 2, bits = 8;
+    for (char *token = strtok(header + 9, " "); token; token = strtok(NULL, " "))
+    {
+        if (token[0] == 'W')
+            input->width = atoi(token + 1);
+        else if (token[0] == 'H')
+            input->height = atoi(token + 1);
+        else if (token[0] == 'C')
+            snprintf(colorspace, sizeof(colorspace), "%s", token + 1);
+        else if (token[0] == 'I' && token[1] != 'p' && token[1] != '?')
+            fprintf(stderr, "Input: %s is interlaced, fields are counted together\n", input->path);
+    }
+    if (!y4m_colorspace(colorspace, &h_shift, &v_shift, &planes, &bits))
+    {
+        fprintf(stderr, "Input: unsupported Y4M colorspace C%s\n", colorspace);
+        return HIST_ERR_UNSUPPORTED;
+    }
+    input->pixel_bits = bits;
+    int status = finish_geometry(input);
+    if (status != HIST_OK)
+        return status;
+
+    // 每帧："FRAME[ 参数]\n" + Y + 色度平面
+    size_t sample_bytes = input->pixel_bits > 8 ? 2 : 1;
+    size_t plane_size = (size_t)((input->width + (1 << h_shift) - 1) >> h_shift) *
+                        ((input->height + (1 << v_shift) - 1) >> v_shift) * sample_bytes;
+    size_t chroma_size = planes == 3 ? 2 * plane_size + input->frame_size : planes * plane_size;
+    size_t pos = (size_t)(end - data) + 1;
+    int capacity = 0;
+    while (pos + 5 <= size && memcmp(data + pos, "FRAME", 5) == 0)
+    {
+        const unsigned char *line_end = (const unsigned char *)memchr(data + pos, '\n', size - pos);
+        if (!line_end)
+            break;
+        size_t frame_start = (size_t)(line_end - data) + 1;
+        if (frame_start + input->frame_size + chroma_size > size)
+            break; // 截断的最后一帧
+        if (add_frame(input, frame_start, &capacity) != HIST_OK)
+            return HIST_ERR_NOMEM;
+        pos = frame_start + input->frame_size + chroma_size;
+    }
+    if (input->num_frames == 0)
+    {
+        fprintf(stderr, "Input: no complete frame in %s\n", input->path);
+        return HIST_ERR_INVALID;
+    }
+    return HIST_OK;
+}
+
+// 原始交错帧或I420：帧之间没有头部，I420每帧后面跟着两个1/4大小的色度平面
+static int parse_raw(HistInput *input)
+{
+    int status = finish_geometry(input);
+    if (status != HIST_OK)
+        return status;
+    size_t stride = input->frame_size;
+    if (input->format == HIST_INPUT_YUV)
+    {
+        size_t sample_bytes = input->pixel_bits > 8 ? 2 : 1;
+        stride += 2 * ((size_t)((input->width + 1) / 2) * ((input->height + 1) / 2) * sample_bytes);
+    }
+    int num_frames = (int)(input->map_size / stride);
+    if (num_frames == 0)
+    {
+        fprintf(stderr, "Input: %s is smaller than one %dx%d frame\n", input->path, input->width, input->height);
+        return HIST_ERR_INVALID;
+    }
+    if (input->map_size % stride != 0)
+        fprintf(stderr, "Input: %s has %zu trailing bytes, ignored\n", input->path, input->map_size % stride);
+    input->frame_offsets = (size_t *)malloc((size_t)num_frames * sizeof(size_t));
+    if (!input->frame_offsets)
+        return HIST_ERR_NOMEM;
+    for (int f = 0; f < num_frames; f++)
+        input->frame_offsets[f] = stride * f;
+    input->num_frames = num_frames;
+    return HIST_OK;
+}
+
+// spec末尾的 ":WxH[xC][@bits]"，成功时把路径截短到冒号之前（Windows盘符后面的冒号不会匹配）
+static int parse_geometry_suffix(char *path, HistInput *input)
+{
+    char *colon = strrchr(path, ':');
+    if (!colon || !isdigit((unsigned char)colon[1]))
+        return 0;
+    int width = 0, height = 0, channels = 1, bits = 8, consumed = 0;
+    const char *p = colon + 1;
+    if (sscanf(p, "%dx%d%n", &width, &height, &consumed) != 2)
+        return 0;
+    p += consumed;
+    if (*p == 'x')
+    {
+        if (sscanf(p + 1, "%d%n", &channels, &consumed) != 1)
+            return 0;
+        p += 1 + consumed;
+    }
+    if (*p == '@')
+    {
+        if (sscanf(p + 1, "%d%n", &bits, &consumed) != 1)
+            return 0;
+        p += 1 + consumed;
+    }
+    if (*p != '\0')
+        return 0;
+    *colon = '\0';
+    input->width = width;
+    input->height = height;
+    input->channels = channels;
+    input->pixel_bits = bits;
+    return 1;
+}
+
+static int has_extension(const char *path, const char *ext)
+{
+    size_t n = strlen(path), m = strlen(ext);
+    if (n < m)
+        return 0;
+    for (size_t i = 0; i < m; i++)
+    {
+        if (tolower((unsigned char)path[n - m + i]) != ext[i])
+            return 0;
+    }
+    return 1;
+}
+
+// ===== 接口 =====
+
+int hist_input_open(HistInput **out, const char *spec)
+{
+    if (!out)
+        return HIST_ERR_INVALID;
+    *out = NULL;
+    if (!spec)
+    {
+        spec = getenv("HIST_INPUT");
+        if (!spec || !spec[0])
+            return HIST_OK; // 没有指定输入文件，调用者使用合成的测试图像
+    }
+    if (!spec[0])
+        return HIST_ERR_INVALID;
+
+    HistInput *input = (HistInput *)calloc(1, sizeof(HistInput));
+    if (!input)
+        return HIST_ERR_NOMEM;
+    snprintf(input->path, sizeof(input->path), "%s", spec);
+    input->channels = 1;
+    input->pixel_bits = 8;
+    int has_geometry = parse_geometry_suffix(input->path, input);
+
+    int status = map_file(input->path, &input->map, &input->map_size);
+    if (status == HIST_OK)
+    {
+        // 先看文件内容，再看扩展名
+        if (input->map_size >= 9 && memcmp(input->map, "YUV4MPEG2", 9) == 0)
+        {
+            input->format = HIST_INPUT_Y4M;
+            status = parse_y4m(input);
+        }
+        else if (input->map_size >= 2 && input->map[0] == 'P' && input->map[1] == '5' && !has_geometry)
+        {
+            input->format = HIST_INPUT_PGM;
+            status = parse_pgm(input);
+        }
+        else if (has_geometry)
+        {
+            input->format = has_extension(input->path, ".yuv") ? HIST_INPUT_YUV : HIST_INPUT_RAW;
+            if (input->format == HIST_INPUT_YUV && input->channels != 1)
+            {
+                fprintf(stderr, "Input: I420 input has one (luma) channel\n");
+                status = HIST_ERR_INVALID;
+            }
+            else
+            {
+                status = parse_raw(input);
+            }
+        }
+        else
+        {
+            fprintf(stderr, "Input: %s is not PGM/Y4M, raw input needs a size, e.g. %s:1920x1080\n",
+                    input->path, input->path);
+            status = HIST_ERR_INVALID;
+        }
+    }
+    if (status != HIST_OK)
+    {
+        hist_input_close(input);
+        return status;
+    }
+    *out = input;
+    return HIST_OK;
+}
+
+void hist_input_close(HistInput *input)
+{
+    if (!input)
+        return;
+    unmap_file(input->map, input->map_size);
+    free(input->frame_offsets);
+    free(input->converted);
+    free(input);
+}
+
+const unsigned char *hist_input_frame(const HistInput *input, int index)
+{
+    int f = index % input->num_frames;
+    if (f < 0)
+        f += input->num_frames;
+    const unsigned char *base = input->converted ? input->converted : input->map;
+    return base + input->frame_offsets[f];
+}
+
+Image hist_input_image(const HistInput *input, int index)
+{
+    Image img;
+    img.data = (unsigned char *)hist_input_frame(input, index);
+    img.width = input->width;
+    img.height = input->height;
+    img.channels = input->channels;
+    img.pixel_bits = input->pixel_bits;
+    return img;
+}
+
+void hist_input_describe(const HistInput *input, char *buffer, size_t size)
+{
+    const char *name = strrchr(input->path, '/');
+    name = name ? name + 1 : input->path;
+    const char *channels = input->channels == 4   ? " RGBA"
+                           : input->channels == 3 ? " RGB"
+                           : input->channels == 2 ? " 2ch"
+                                                  : "";
+    snprintf(buffer, size, "%s (%s %dx%d%s %d-bit, %d frame%s)", name, input_format_names[input->format],
+             input->width, input->height, channels, input->pixel_bits, input->num_frames,
+             input->num_frames == 1 ? "" : "s");
+}
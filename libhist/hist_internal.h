@@ -0,0 +1,59 @@
+// hist_internal.h
+// libhist内部头文件：后端接口和context结构
+#ifndef HIST_INTERNAL_H
+#define HIST_INTERNAL_H
+
+#include "hist.h"
+
+// 分块直方图的一次计算（hist_compute_tiled检查过参数，stride已经填好）
+typedef struct
+{
+    const unsigned char *image;
+    int width;
+    int height;
+    int stride;
+    int tile_width;
+    int tile_height;
+    int tiles_x;
+    int tiles_y;
+    int bin_shift;
+    int num_bins;
+    unsigned int *tiles;     // tiles_x * tiles_y * num_bins
+    unsigned int *histogram; // 整帧直方图，可以为NULL
+} HistTileJob;
+
+// 每个后端实现的操作
+typedef struct
+{
+    int (*create)(HistContext *ctx);
+    int (*compute)(HistContext *ctx, const unsigned char *data, size_t size, unsigned int *histogram);
+    void (*destroy)(HistContext *ctx);
+    int (*compute_tiled)(HistContext *ctx, const HistTileJob *job); // NULL = 不支持分块直方图
+} HistBackendOps;
+
+struct HistContext
+{
+    HistConfig config;
+    const HistBackendOps *ops;
+    void *state; // 后端私有状态
+    char description[256];
+    unsigned int *rebin_scratch; // 8位图像设置了bin_shift时，后端先输出256个bin，再在这里合并
+};
+
+#ifdef HIST_WITH_OPENCL
+#include <stdint.h>
+
+#define HIST_FNV_OFFSET 14695981039346656037ULL
+
+// FNV-1a 64位哈希，程序缓存和调优文件用它生成文件名
+uint64_t hist_fnv1a(uint64_t hash, const void *data, size_t size);
+
+// 程序缓存和调优文件所在目录（HIST_CL_CACHE_DIR），关闭时返回NULL
+const char *hist_cl_cache_dir(void);
+#endif
+
+extern const HistBackendOps hist_cpu_ops;
+extern const HistBackendOps hist_opencl_ops; // 未定义HIST_WITH_OPENCL时create返回HIST_ERR_UNSUPPORTED
+extern const HistBackendOps hist_fpga_ops;
+
+#endif // HIST_INTERNAL_H
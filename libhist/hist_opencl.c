@@ -0,0 +1,1200 @@
+// hist_opencl.c
+// libhist OpenCL后端，只有定义了HIST_WITH_OPENCL时才编译
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <sys/stat.h>
+#ifdef _WIN32
+#include <direct.h>
+#endif
+
+#include "hist_internal.h"
+
+#ifdef HIST_WITH_OPENCL
+
+#define MAX_SOURCE_SIZE (0x100000)
+
+// 程序二进制缓存目录，可用环境变量HIST_CL_CACHE_DIR修改，设为空字符串则关闭缓存
+#define HIST_CL_DEFAULT_CACHE_DIR ".hist_cl_cache"
+#define HIST_CL_CACHE_MAGIC "HISTCLB1"
+
+// histogram_replicated：每份local直方图副本的长度（与histogram.cl中的REPLICA_STRIDE一致）和最大副本数
+#define HIST_CL_REPLICA_STRIDE 257
+#define HIST_CL_MAX_REPLICAS 8
+
+const char *hist_cl_kernel_names[] = {
+    "histogram_naive",
+    "histogram_local",
+    "histogram_private",
+    "histogram_vectorized",
+    "histogram_ultra",
+    "histogram_replicated",
+    "histogram_channels"};
+
+const char *hist_cl_kernel_descriptions[] = {
+    "Naive (simple atomic)",
+    "Local Memory (optimized)",
+    "Private Histogram",
+    "Vectorized (uchar4)",
+    "Ultra (all optimizations)",
+    "Replicated (sub-histograms, uchar16)",
+    "Multi-channel (interleaved RGB/RGBA)"};
+
+const char *hist_cl_wide_kernel_names[] = {
+    "histogram_wide_global",
+    "histogram_wide_partitioned"};
+
+int hist_cl_check(cl_int err, const char *operation)
+{
+    if (err != CL_SUCCESS)
+    {
+        fprintf(stderr, "Error during operation '%s': %d\n", operation, err);
+        return HIST_ERR_BACKEND;
+    }
+    return HIST_OK;
+}
+
+// 读取kernel文件，kernel_path为NULL时依次尝试默认路径
+static char *read_kernel_source(const char *kernel_path)
+{
+    const char *kernel_paths[] = {
+        "histogram_kernel.cl",
+        "opencl/histogram.cl",
+        "histogram.cl"};
+    int num_paths = 3;
+    if (kernel_path)
+    {
+        kernel_paths[0] = kernel_path;
+        num_paths = 1;
+    }
+
+    for (int i = 0; i < num_paths; i++)
+    {
+        FILE *fp = fopen(kernel_paths[i], "r");
+        if (!fp)
+            continue;
+        char *source_str = (char *)malloc(MAX_SOURCE_SIZE);
+        size_t source_size = fread(source_str, 1, MAX_SOURCE_SIZE - 1, fp);
+        source_str[source_size] = '\0';
+        fclose(fp);
+        return source_str;
+    }
+
+    fprintf(stderr, "Error: Could not find kernel file. Tried:\n");
+    for (int i = 0; i < num_paths; i++)
+    {
+        fprintf(stderr, "  - %s\n", kernel_paths[i]);
+    }
+    return NULL;
+}
+
+// ===== 程序二进制缓存 =====
+// POCL等实现在线编译全部kernel比处理一帧还慢，所以编译结果按
+// (设备名, 驱动版本, 编译选项, histogram.cl内容) 的哈希缓存到磁盘，下次启动直接加载
+
+// FNV-1a 64位哈希，可以分段累加（初值HIST_FNV_OFFSET）
+uint64_t hist_fnv1a(uint64_t hash, const void *data, size_t size)
+{
+    const unsigned char *bytes = (const unsigned char *)data;
+    for (size_t i = 0; i < size; i++)
+    {
+        hash ^= bytes[i];
+        hash *= 1099511628211ULL;
+    }
+    return hash;
+}
+
+static uint64_t program_cache_key(const HistClEnv *env, const char *source, const char *options)
+{
+    uint64_t hash = HIST_FNV_OFFSET;
+    const char *parts[4];
+    parts[0] = env->device_name;
+    parts[1] = env->driver_version;
+    parts[2] = options ? options : "";
+    parts[3] = source;
+    for (int i = 0; i < 4; i++)
+    {
+        // 包含结尾的'\0'作为分隔符，避免不同字段拼接后相同
+        hash = hist_fnv1a(hash, parts[i], strlen(parts[i]) + 1);
+    }
+    return hash;
+}
+
+// 缓存目录（不存在时创建），缓存被关闭时返回NULL
+const char *hist_cl_cache_dir(void)
+{
+    const char *dir = getenv("HIST_CL_CACHE_DIR");
+    if (!dir)
+        dir = HIST_CL_DEFAULT_CACHE_DIR;
+    if (dir[0] == '\0')
+        return NULL;
+
+#ifdef _WIN32
+    _mkdir(dir);
+#else
+    mkdir(dir, 0755);
+#endif
+    return dir;
+}
+
+// 缓存文件路径，缓存被关闭时返回0
+static int program_cache_path(uint64_t key, char *path, size_t path_size)
+{
+    const char *dir = hist_cl_cache_dir();
+    if (!dir)
+        return 0;
+    snprintf(path, path_size, "%s/program_%016llx.bin", dir, (unsigned long long)key);
+    return 1;
+}
+
+// 文件格式：magic(8字节) + key(8字节) + 二进制大小(8字节) + 二进制内容
+static unsigned char *program_cache_load(const char *path, uint64_t key, size_t *size)
+{
+    FILE *fp = fopen(path, "rb");
+    if (!fp)
+        return NULL;
+
+    char magic[8];
+    uint64_t file_key = 0, file_size = 0;
+    unsigned char *binary = NULL;
+    if (fread(magic, 1, 8, fp) == 8 && memcmp(magic, HIST_CL_CACHE_MAGIC, 8) == 0 &&
+        fread(&file_key, sizeof(file_key), 1, fp) == 1 && file_key == key &&
+        fread(&file_size, sizeof(file_size), 1, fp) == 1 && file_size > 0 && file_size <= (64u << 20))
+    {
+        binary = (unsigned char *)malloc((size_t)file_size);
+        if (binary && fread(binary, 1, (size_t)file_size, fp) != (size_t)file_size)
+        {
+            free(binary);
+            binary = NULL;
+        }
+    }
+    fclose(fp);
+    *size = (size_t)file_size;
+    return binary;
+}
+
+static void program_cache_store(const HistClEnv *env, const char *path, uint64_t key)
+{
+    size_t size = 0;
+    if (clGetProgramInfo(env->program, CL_PROGRAM_BINARY_SIZES, sizeof(size), &size, NULL) != CL_SUCCESS || size == 0)
+        return;
+    unsigned char *binary = (unsigned char *)malloc(size);
+    if (!binary)
+        return;
+    if (clGetProgramInfo(env->program, CL_PROGRAM_BINARIES, sizeof(binary), &binary, NULL) == CL_SUCCESS)
+    {
+        // 先写临时文件再改名，避免并发运行的进程读到写了一半的缓存
+        char tmp_path[520];
+        snprintf(tmp_path, sizeof(tmp_path), "%s.tmp", path);
+        FILE *fp = fopen(tmp_path, "wb");
+        if (fp)
+        {
+            uint64_t file_size = size;
+            int ok = fwrite(HIST_CL_CACHE_MAGIC, 1, 8, fp) == 8 &&
+                     fwrite(&key, sizeof(key), 1, fp) == 1 &&
+                     fwrite(&file_size, sizeof(file_size), 1, fp) == 1 &&
+                     fwrite(binary, 1, size, fp) == size;
+            ok = (fclose(fp) == 0) && ok;
+            remove(path);
+            if (!ok || rename(tmp_path, path) != 0)
+                remove(tmp_path);
+        }
+    }
+    free(binary);
+}
+
+// 创建并编译程序：优先从缓存加载二进制，失败时从源码编译并写回缓存
+static int build_program(HistClEnv *env, const char *source, const char *options)
+{
+    cl_int ret;
+    char cache_path[512];
+    uint64_t key = program_cache_key(env, source, options);
+    int use_cache = program_cache_path(key, cache_path, sizeof(cache_path));
+
+    env->program_from_cache = 0;
+    if (use_cache)
+    {
+        size_t binary_size = 0;
+        unsigned char *binary = program_cache_load(cache_path, key, &binary_size);
+        if (binary)
+        {
+            cl_int binary_status = CL_SUCCESS;
+            const unsigned char *binaries[1] = {binary};
+            env->program = clCreateProgramWithBinary(env->context, 1, &env->device, &binary_size,
+                                                     binaries, &binary_status, &ret);
+            free(binary);
+            if (ret == CL_SUCCESS && binary_status == CL_SUCCESS &&
+                clBuildProgram(env->program, 1, &env->device, options, NULL, NULL) == CL_SUCCESS)
+            {
+                env->program_from_cache = 1;
+                return HIST_OK;
+            }
+            // 缓存损坏或驱动不接受，退回源码编译并覆盖缓存
+            if (env->program)
+                clReleaseProgram(env->program);
+            env->program = NULL;
+        }
+    }
+
+    size_t source_size = strlen(source);
+    env->program = clCreateProgramWithSource(env->context, 1, &source, &source_size, &ret);
+    if (hist_cl_check(ret, "clCreateProgramWithSource") != HIST_OK)
+    {
+        env->program = NULL;
+        return HIST_ERR_BACKEND;
+    }
+
+    ret = clBuildProgram(env->program, 1, &env->device, options, NULL, NULL);
+    if (ret != CL_SUCCESS)
+    {
+        size_t len;
+        char buffer[4096];
+        clGetProgramBuildInfo(env->program, env->device, CL_PROGRAM_BUILD_LOG, sizeof(buffer), buffer, &len);
+        fprintf(stderr, "Build error:\n%s\n", buffer);
+        return HIST_ERR_BACKEND;
+    }
+
+    if (use_cache)
+        program_cache_store(env, cache_path, key);
+    return HIST_OK;
+}
+
+int hist_cl_env_init(HistClEnv *env, const char *kernel_path, cl_command_queue_properties queue_properties)
+{
+    double start_time = get_time_ms();
+    cl_uint ret_num_devices;
+    cl_uint ret_num_platforms;
+    cl_int ret;
+
+    memset(env, 0, sizeof(HistClEnv));
+
+    ret = clGetPlatformIDs(1, &env->platform, &ret_num_platforms);
+    if (hist_cl_check(ret, "clGetPlatformIDs") != HIST_OK)
+        return HIST_ERR_BACKEND;
+
+    ret = clGetDeviceIDs(env->platform, CL_DEVICE_TYPE_GPU, 1, &env->device, &ret_num_devices);
+    if (ret != CL_SUCCESS)
+    {
+        printf("No GPU found, trying CPU...\n");
+        ret = clGetDeviceIDs(env->platform, CL_DEVICE_TYPE_CPU, 1, &env->device, &ret_num_devices);
+    }
+    if (hist_cl_check(ret, "clGetDeviceIDs") != HIST_OK)
+        return HIST_ERR_BACKEND;
+
+    clGetDeviceInfo(env->device, CL_DEVICE_NAME, sizeof(env->device_name), env->device_name, NULL);
+    clGetDeviceInfo(env->device, CL_DEVICE_VENDOR, sizeof(env->device_vendor), env->device_vendor, NULL);
+    clGetDeviceInfo(env->device, CL_DRIVER_VERSION, sizeof(env->driver_version), env->driver_version, NULL);
+    clGetDeviceInfo(env->device, CL_DEVICE_MAX_COMPUTE_UNITS, sizeof(env->compute_units), &env->compute_units, NULL);
+    clGetDeviceInfo(env->device, CL_DEVICE_MAX_WORK_GROUP_SIZE, sizeof(env->max_work_group_size), &env->max_work_group_size, NULL);
+    clGetDeviceInfo(env->device, CL_DEVICE_GLOBAL_MEM_SIZE, sizeof(env->global_mem_size), &env->global_mem_size, NULL);
+    clGetDeviceInfo(env->device, CL_DEVICE_LOCAL_MEM_SIZE, sizeof(env->local_mem_size), &env->local_mem_size, NULL);
+
+    // 创建context和command queue
+    env->context = clCreateContext(NULL, 1, &env->device, NULL, NULL, &ret);
+    if (hist_cl_check(ret, "clCreateContext") != HIST_OK)
+        return HIST_ERR_BACKEND;
+
+    env->queue = clCreateCommandQueue(env->context, env->device, queue_properties, &ret);
+    if (hist_cl_check(ret, "clCreateCommandQueue") != HIST_OK)
+    {
+        hist_cl_env_release(env);
+        return HIST_ERR_BACKEND;
+    }
+
+    // 读取并编译kernel，源码保留下来供调优时用不同编译选项重新编译
+    env->source = read_kernel_source(kernel_path);
+    if (!env->source)
+    {
+        hist_cl_env_release(env);
+        return HIST_ERR_BACKEND;
+    }
+    int status = hist_cl_env_rebuild(env, "");
+    if (status != HIST_OK)
+    {
+        hist_cl_env_release(env);
+        return status;
+    }
+
+    env->startup_time_ms = get_time_ms() - start_time;
+    return HIST_OK;
+}
+
+int hist_cl_env_rebuild(HistClEnv *env, const char *build_options)
+{
+    cl_int ret;
+    if (!build_options)
+        build_options = "";
+    if (env->program && strcmp(env->build_options, build_options) == 0)
+        return HIST_OK;
+
+    if (env->clear_kernel)
+        clReleaseKernel(env->clear_kernel);
+    if (env->program)
+        clReleaseProgram(env->program);
+    env->clear_kernel = NULL;
+    env->program = NULL;
+
+    snprintf(env->build_options, sizeof(env->build_options), "%s", build_options);
+    int status = build_program(env, env->source, env->build_options);
+    if (status != HIST_OK)
+        return status;
+
+    env->clear_kernel = clCreateKernel(env->program, "histogram_clear", &ret);
+    if (hist_cl_check(ret, "clCreateKernel histogram_clear") != HIST_OK)
+    {
+        env->clear_kernel = NULL;
+        return HIST_ERR_BACKEND;
+    }
+    return HIST_OK;
+}
+
+void hist_cl_env_release(HistClEnv *env)
+{
+    if (env->clear_kernel)
+        clReleaseKernel(env->clear_kernel);
+    if (env->program)
+        clReleaseProgram(env->program);
+    free(env->source);
+    env->source = NULL;
+    if (env->queue)
+        clReleaseCommandQueue(env->queue);
+    if (env->context)
+        clReleaseContext(env->context);
+    env->clear_kernel = NULL;
+    env->program = NULL;
+    env->queue = NULL;
+    env->context = NULL;
+}
+
+void hist_cl_print_device_info(const HistClEnv *env)
+{
+    printf("\n=== Device Information ===\n");
+    printf("Device: %s\n", env->device_name);
+    printf("Vendor: %s\n", env->device_vendor);
+    printf("Driver: %s\n", env->driver_version);
+    printf("Compute Units: %u\n", env->compute_units);
+    printf("Max Work Group Size: %zu\n", env->max_work_group_size);
+    printf("Global Memory: %.2f GB\n", env->global_mem_size / (1024.0 * 1024.0 * 1024.0));
+    printf("Local Memory: %.2f KB\n\n", env->local_mem_size / 1024.0);
+}
+
+int hist_cl_enqueue_clear(const HistClEnv *env, cl_command_queue queue, cl_mem buffer, int count,
+                          cl_uint num_wait_events, const cl_event *wait_events, cl_event *event)
+{
+    size_t global_size = ((size_t)count + 63) / 64 * 64;
+    cl_int ret = clSetKernelArg(env->clear_kernel, 0, sizeof(cl_mem), (void *)&buffer);
+    ret |= clSetKernelArg(env->clear_kernel, 1, sizeof(int), (void *)&count);
+    ret |= clEnqueueNDRangeKernel(queue, env->clear_kernel, 1, NULL, &global_size, NULL,
+                                  num_wait_events, wait_events, event);
+    return hist_cl_check(ret, "histogram_clear");
+}
+
+double hist_cl_time_kernel(const HistClEnv *env, cl_command_queue queue, cl_kernel kernel, cl_uint dims,
+                           const size_t *global_size, const size_t *local_size, cl_mem clear_buffer, int clear_bins)
+{
+    cl_event event;
+    cl_ulong start = 0, end = 0;
+
+    if (clear_buffer && hist_cl_enqueue_clear(env, queue, clear_buffer, clear_bins, 0, NULL, NULL) != HIST_OK)
+        return -1.0;
+    cl_int ret = clEnqueueNDRangeKernel(queue, kernel, dims, NULL, global_size, local_size, 0, NULL, &event);
+    if (hist_cl_check(ret, "clEnqueueNDRangeKernel") != HIST_OK)
+        return -1.0;
+    ret = clWaitForEvents(1, &event);
+    if (ret == CL_SUCCESS)
+        ret = clGetEventProfilingInfo(event, CL_PROFILING_COMMAND_START, sizeof(start), &start, NULL);
+    if (ret == CL_SUCCESS)
+        ret = clGetEventProfilingInfo(event, CL_PROFILING_COMMAND_END, sizeof(end), &end, NULL);
+    clReleaseEvent(event);
+    if (hist_cl_check(ret, "kernel profiling") != HIST_OK)
+        return -1.0;
+    return end > start ? (end - start) / 1e6 : 0.0;
+}
+
+int hist_cl_launch_init(HistClLaunch *launch, const HistClEnv *env, int kernel_choice, int image_size)
+{
+    cl_int ret;
+
+    memset(launch, 0, sizeof(HistClLaunch));
+    if (kernel_choice < 1 || kernel_choice > HIST_CL_NUM_KERNELS)
+        return HIST_ERR_INVALID;
+    launch->kernel_choice = kernel_choice;
+
+    launch->kernel = clCreateKernel(env->program, hist_cl_kernel_names[kernel_choice - 1], &ret);
+    if (hist_cl_check(ret, "clCreateKernel") != HIST_OK)
+        return HIST_ERR_BACKEND;
+
+    hist_cl_launch_configure(launch, env, image_size);
+    return HIST_OK;
+}
+
+// 设置工作组大小 - 优化：根据设备能力动态调整
+void hist_cl_launch_configure(HistClLaunch *launch, const HistClEnv *env, int image_size)
+{
+    int kernel_choice = launch->kernel_choice;
+    size_t max_work_group_size = env->max_work_group_size;
+
+    // context创建时还不知道图像大小（image_size为0），先按1个像素配置，避免除0
+    launch->image_size = image_size;
+    if (image_size < 1)
+        image_size = 1;
+
+    // 尝试使用更大的workgroup size以提高性能
+    // 对于histogram，256是一个好的起点，但可以尝试更大的值
+    size_t preferred_local_sizes[] = {256, 512, 1024, 128};
+    size_t optimal_local_size = 256;
+
+    // 选择最优的workgroup size（不超过设备限制）
+    for (int i = 0; i < 4; i++)
+    {
+        if (preferred_local_sizes[i] <= max_work_group_size &&
+            preferred_local_sizes[i] <= (size_t)image_size)
+        {
+            optimal_local_size = preferred_local_sizes[i];
+            break;
+        }
+    }
+
+    // 对于histogram_private kernel，使用更少的workitems，每个处理更多像素
+    if (kernel_choice == HIST_CL_PRIVATE_KERNEL)
+    {
+        // 每个workitem处理多个像素，减少workitem数量
+        optimal_local_size = 128; // 使用较小的local size，每个workitem处理更多像素
+    }
+
+    // 对于ultra kernel，使用更大的workgroup以获得更好的性能
+    if (kernel_choice == HIST_CL_ULTRA_KERNEL)
+    {
+        // 尝试使用更大的workgroup size
+        if (max_work_group_size >= 512)
+        {
+            optimal_local_size = 512;
+        }
+        else if (max_work_group_size >= 256)
+        {
+            optimal_local_size = 256;
+        }
+    }
+
+    // 调优结果优先
+    if (launch->tuned_local_size > 0)
+    {
+        optimal_local_size = launch->tuned_local_size;
+    }
+
+    size_t local_size = optimal_local_size;
+    size_t global_size = ((image_size + local_size - 1) / local_size) * local_size;
+
+    // histogram_local每个workitem处理固定的LOCAL_PIXELS_PER_ITEM个像素，只需要覆盖图像的workitem数
+    if (kernel_choice == HIST_CL_LOCAL_KERNEL)
+    {
+        size_t pixels_per_item = launch->tuned_pixels_per_item > 0 ? (size_t)launch->tuned_pixels_per_item : 4;
+        size_t workitems = (image_size + pixels_per_item - 1) / pixels_per_item;
+        global_size = ((workitems + local_size - 1) / local_size) * local_size;
+    }
+
+    // 对于ultra kernel，调整global size以确保每个workitem处理足够多的像素
+    if (kernel_choice == HIST_CL_ULTRA_KERNEL)
+    {
+        // 每个workitem最多处理ULTRA_MAX_PIXELS（默认32）个像素
+        size_t max_pixels = launch->tuned_pixels_per_item > 0 ? (size_t)launch->tuned_pixels_per_item : 32;
+        size_t min_workitems = (image_size + max_pixels - 1) / max_pixels;
+        if (global_size > min_workitems)
+        {
+            global_size = ((min_workitems + local_size - 1) / local_size) * local_size;
+        }
+    }
+
+    // histogram_replicated和histogram_channels使用grid-stride循环，work-group数只需要填满设备（每个计算单元8个）
+    if (kernel_choice == HIST_CL_CHANNELS_KERNEL)
+    {
+        size_t groups = ((size_t)image_size + local_size - 1) / local_size;
+        size_t max_groups = (size_t)env->compute_units * 8;
+        if (max_groups > 0 && groups > max_groups)
+            groups = max_groups;
+        global_size = groups * local_size;
+    }
+    if (kernel_choice == HIST_CL_REPLICATED_KERNEL)
+    {
+        size_t num_vectors = ((size_t)image_size + 15) / 16;
+        size_t groups = (num_vectors + local_size - 1) / local_size;
+        size_t max_groups = (size_t)env->compute_units * 8;
+        if (max_groups > 0 && groups > max_groups)
+            groups = max_groups;
+        if (groups < 1)
+            groups = 1;
+        global_size = groups * local_size;
+
+        // 副本数不超过work-group大小，总共最多占用一半local memory
+        launch->replicas = HIST_CL_MAX_REPLICAS;
+        while (launch->replicas > 1 &&
+               ((size_t)launch->replicas > local_size ||
+                (cl_ulong)launch->replicas * HIST_CL_REPLICA_STRIDE * sizeof(unsigned int) > env->local_mem_size / 2))
+        {
+            launch->replicas /= 2;
+        }
+    }
+
+    // 对于histogram_private kernel，设置每个workitem处理的像素数
+    launch->pixels_per_workitem = (int)((image_size + global_size - 1) / global_size);
+    if (launch->pixels_per_workitem < 1)
+        launch->pixels_per_workitem = 1;
+
+    // 对于vectorized kernel，需要特殊处理
+    launch->num_vectors = (image_size + 3) / 4; // uchar4处理
+    if (kernel_choice == HIST_CL_VECTORIZED_KERNEL)
+    {
+        global_size = ((launch->num_vectors + local_size - 1) / local_size) * local_size;
+    }
+
+    launch->local_size = local_size;
+    launch->global_size = global_size;
+}
+
+int hist_cl_launch_set_args(HistClLaunch *launch, cl_mem image, cl_mem histogram)
+{
+    int kernel_choice = launch->kernel_choice;
+    cl_int ret;
+
+    ret = clSetKernelArg(launch->kernel, 0, sizeof(cl_mem), (void *)&image);
+    ret |= clSetKernelArg(launch->kernel, 1, sizeof(cl_mem), (void *)&histogram);
+    ret |= clSetKernelArg(launch->kernel, 2, sizeof(int),
+                          kernel_choice == HIST_CL_VECTORIZED_KERNEL ? (void *)&launch->num_vectors
+                                                                     : (void *)&launch->image_size);
+
+    // 除naive外的kernel都使用local memory直方图，histogram_replicated每个副本一份
+    if (kernel_choice == HIST_CL_REPLICATED_KERNEL)
+    {
+        ret |= clSetKernelArg(launch->kernel, 3, (size_t)launch->replicas * HIST_CL_REPLICA_STRIDE * sizeof(unsigned int), NULL);
+        ret |= clSetKernelArg(launch->kernel, 4, sizeof(int), (void *)&launch->replicas);
+    }
+    else if (kernel_choice == HIST_CL_CHANNELS_KERNEL)
+    {
+        int channels = launch->channels > 0 ? launch->channels : 1;
+        ret |= clSetKernelArg(launch->kernel, 3, (size_t)channels * HISTOGRAM_BINS * sizeof(unsigned int), NULL);
+        ret |= clSetKernelArg(launch->kernel, 4, sizeof(int), (void *)&channels);
+    }
+    else if (kernel_choice != HIST_CL_NAIVE_KERNEL)
+    {
+        ret |= clSetKernelArg(launch->kernel, 3, HISTOGRAM_BINS * sizeof(unsigned int), NULL);
+    }
+    if (kernel_choice == HIST_CL_PRIVATE_KERNEL)
+    {
+        ret |= clSetKernelArg(launch->kernel, 4, sizeof(int), (void *)&launch->pixels_per_workitem);
+    }
+
+    return hist_cl_check(ret, "clSetKernelArg");
+}
+
+void hist_cl_launch_release(HistClLaunch *launch)
+{
+    if (launch->kernel)
+        clReleaseKernel(launch->kernel);
+    launch->kernel = NULL;
+}
+
+// ===== 高位深kernel =====
+
+int hist_cl_wide_launch_init(HistClWideLaunch *launch, const HistClEnv *env, int kernel_choice, int pixel_bits,
+                             int bin_shift, int num_pixels)
+{
+    cl_int ret;
+
+    memset(launch, 0, sizeof(HistClWideLaunch));
+    if (kernel_choice < 1 || kernel_choice > HIST_CL_NUM_WIDE_KERNELS || pixel_bits <= 8 ||
+        pixel_bits > HIST_MAX_PIXEL_BITS || bin_shift < 0 || bin_shift >= pixel_bits)
+        return HIST_ERR_INVALID;
+    launch->kernel_choice = kernel_choice;
+    launch->pixel_bits = pixel_bits;
+    launch->bin_shift = bin_shift;
+    launch->num_bins = 1 << (pixel_bits - bin_shift);
+    launch->pixel_mask = (1u << pixel_bits) - 1;
+
+    launch->kernel = clCreateKernel(env->program, hist_cl_wide_kernel_names[kernel_choice - 1], &ret);
+    if (hist_cl_check(ret, "clCreateKernel") != HIST_OK)
+        return HIST_ERR_BACKEND;
+
+    hist_cl_wide_launch_configure(launch, env, num_pixels);
+    return HIST_OK;
+}
+
+// 分区大小取不超过一半local memory的2的幂，每个分区的work-group数让 分区数 × work-group数 填满设备
+void hist_cl_wide_launch_configure(HistClWideLaunch *launch, const HistClEnv *env, int num_pixels)
+{
+    launch->num_pixels = num_pixels;
+    if (num_pixels < 1)
+        num_pixels = 1;
+
+    size_t local_size = 256;
+    while (local_size > env->max_work_group_size && local_size > 1)
+        local_size /= 2;
+
+    launch->partition_bins = launch->num_bins;
+    if (launch->kernel_choice == HIST_CL_WIDE_PARTITIONED)
+    {
+        while (launch->partition_bins > 256 &&
+               (cl_ulong)launch->partition_bins * sizeof(unsigned int) > env->local_mem_size / 2)
+        {
+            launch->partition_bins /= 2;
+        }
+    }
+    launch->num_partitions = launch->num_bins / launch->partition_bins;
+    if (launch->kernel_choice == HIST_CL_WIDE_GLOBAL)
+        launch->num_partitions = 1;
+
+    size_t groups = ((size_t)num_pixels + local_size - 1) / local_size;
+    size_t max_groups = (size_t)env->compute_units * 8 / launch->num_partitions;
+    if (max_groups < 1)
+        max_groups = 1;
+    if (groups > max_groups)
+        groups = max_groups;
+
+    launch->local_size[0] = local_size;
+    launch->local_size[1] = 1;
+    launch->global_size[0] = groups * local_size;
+    launch->global_size[1] = launch->num_partitions;
+}
+
+int hist_cl_wide_launch_set_args(HistClWideLaunch *launch, cl_mem image, cl_mem histogram)
+{
+    cl_int ret;
+
+    ret = clSetKernelArg(launch->kernel, 0, sizeof(cl_mem), (void *)&image);
+    ret |= clSetKernelArg(launch->kernel, 1, sizeof(cl_mem), (void *)&histogram);
+    ret |= clSetKernelArg(launch->kernel, 2, sizeof(int), (void *)&launch->num_pixels);
+    ret |= clSetKernelArg(launch->kernel, 3, sizeof(unsigned int), (void *)&launch->pixel_mask);
+    ret |= clSetKernelArg(launch->kernel, 4, sizeof(int), (void *)&launch->bin_shift);
+    if (launch->kernel_choice == HIST_CL_WIDE_PARTITIONED)
+    {
+        ret |= clSetKernelArg(launch->kernel, 5, (size_t)launch->partition_bins * sizeof(unsigned int), NULL);
+        ret |= clSetKernelArg(launch->kernel, 6, sizeof(int), (void *)&launch->partition_bins);
+    }
+    return hist_cl_check(ret, "clSetKernelArg");
+}
+
+void hist_cl_wide_launch_release(HistClWideLaunch *launch)
+{
+    if (launch->kernel)
+        clReleaseKernel(launch->kernel);
+    launch->kernel = NULL;
+}
+
+// ===== 分块直方图 =====
+
+int hist_cl_tile_launch_init(HistClTileLaunch *launch, const HistClEnv *env, int bin_shift)
+{
+    cl_int ret;
+
+    memset(launch, 0, sizeof(HistClTileLaunch));
+    if (bin_shift < 0 || bin_shift >= 8)
+        return HIST_ERR_INVALID;
+    launch->bin_shift = bin_shift;
+    launch->num_bins = HISTOGRAM_BINS >> bin_shift;
+
+    launch->kernel = clCreateKernel(env->program, "histogram_tiled", &ret);
+    if (hist_cl_check(ret, "clCreateKernel histogram_tiled") != HIST_OK)
+        return HIST_ERR_BACKEND;
+    return HIST_OK;
+}
+
+// 每个work-group的块数：块直方图不超过一半local memory，也不超过一行的块数；
+// local size取覆盖一个work-group那段行（tiles_per_group * tile_width个像素）的2的幂，32~256
+void hist_cl_tile_launch_configure(HistClTileLaunch *launch, const HistClEnv *env, int width, int height, int stride,
+                                   int tile_width, int tile_height)
+{
+    launch->width = width;
+    launch->height = height;
+    launch->stride = stride;
+    launch->tile_width = tile_width;
+    launch->tile_height = tile_height;
+    launch->tiles_x = (width + tile_width - 1) / tile_width;
+    launch->tiles_y = (height + tile_height - 1) / tile_height;
+
+    cl_ulong max_tiles = env->local_mem_size / 2 / ((cl_ulong)launch->num_bins * sizeof(unsigned int));
+    if (max_tiles < 1)
+        max_tiles = 1;
+    launch->tiles_per_group = (cl_ulong)launch->tiles_x < max_tiles ? launch->tiles_x : (int)max_tiles;
+
+    long long span = (long long)launch->tiles_per_group * tile_width;
+    size_t local_size = 32;
+    while ((long long)local_size < span && local_size < 256)
+        local_size *= 2;
+    while (local_size > env->max_work_group_size && local_size > 1)
+        local_size /= 2;
+
+    size_t groups = (size_t)(launch->tiles_x + launch->tiles_per_group - 1) / launch->tiles_per_group;
+    launch->local_size[0] = local_size;
+    launch->local_size[1] = 1;
+    launch->global_size[0] = groups * local_size;
+    launch->global_size[1] = launch->tiles_y;
+}
+
+int hist_cl_tile_launch_set_args(HistClTileLaunch *launch, cl_mem image, cl_mem tiles, cl_mem histogram)
+{
+    cl_int ret;
+
+    ret = clSetKernelArg(launch->kernel, 0, sizeof(cl_mem), (void *)&image);
+    ret |= clSetKernelArg(launch->kernel, 1, sizeof(cl_mem), (void *)&tiles);
+    ret |= clSetKernelArg(launch->kernel, 2, sizeof(cl_mem), (void *)&histogram);
+    ret |= clSetKernelArg(launch->kernel, 3, sizeof(int), (void *)&launch->width);
+    ret |= clSetKernelArg(launch->kernel, 4, sizeof(int), (void *)&launch->height);
+    ret |= clSetKernelArg(launch->kernel, 5, sizeof(int), (void *)&launch->stride);
+    ret |= clSetKernelArg(launch->kernel, 6, sizeof(int), (void *)&launch->tile_width);
+    ret |= clSetKernelArg(launch->kernel, 7, sizeof(int), (void *)&launch->tile_height);
+    ret |= clSetKernelArg(launch->kernel, 8, sizeof(int), (void *)&launch->tiles_per_group);
+    ret |= clSetKernelArg(launch->kernel, 9, sizeof(int), (void *)&launch->bin_shift);
+    ret |= clSetKernelArg(launch->kernel, 10, (size_t)launch->tiles_per_group * launch->num_bins * sizeof(unsigned int),
+                          NULL);
+    return hist_cl_check(ret, "clSetKernelArg");
+}
+
+void hist_cl_tile_launch_release(HistClTileLaunch *launch)
+{
+    if (launch->kernel)
+        clReleaseKernel(launch->kernel);
+    launch->kernel = NULL;
+}
+
+// ===== 事件profiling =====
+
+const char *hist_cl_stage_names[] = {"write", "clear", "kernel", "read"};
+
+// 执行时间分布直方图的桶数：[0,1) [1,2) [2,4) ... us，最后一个桶收集更长的时间
+#define HIST_CL_PROFILE_BUCKETS 20
+#define HIST_CL_PROFILE_BAR 40
+
+void hist_cl_profile_init(HistClProfile *profile)
+{
+    memset(profile, 0, sizeof(HistClProfile));
+}
+
+void hist_cl_profile_release(HistClProfile *profile)
+{
+    for (int s = 0; s < HIST_CL_NUM_STAGES; s++)
+    {
+        free(profile->stages[s].queued);
+        free(profile->stages[s].submitted);
+        free(profile->stages[s].executed);
+    }
+    memset(profile, 0, sizeof(HistClProfile));
+}
+
+int hist_cl_profile_add(HistClProfile *profile, HistClStage stage, cl_event event)
+{
+    if (!event)
+        return HIST_OK;
+    cl_ulong queued = 0, submitted = 0, started = 0, ended = 0;
+    cl_int ret = clGetEventProfilingInfo(event, CL_PROFILING_COMMAND_QUEUED, sizeof(queued), &queued, NULL);
+    ret |= clGetEventProfilingInfo(event, CL_PROFILING_COMMAND_SUBMIT, sizeof(submitted), &submitted, NULL);
+    ret |= clGetEventProfilingInfo(event, CL_PROFILING_COMMAND_START, sizeof(started), &started, NULL);
+    ret |= clGetEventProfilingInfo(event, CL_PROFILING_COMMAND_END, sizeof(ended), &ended, NULL);
+    if (hist_cl_check(ret, "clGetEventProfilingInfo") != HIST_OK)
+        return HIST_ERR_BACKEND;
+
+    HistClStageProfile *p = &profile->stages[stage];
+    if (p->count == p->capacity)
+    {
+        int capacity = p->capacity ? p->capacity * 2 : 1024;
+        double *q = (double *)realloc(p->queued, capacity * sizeof(double));
+        if (q)
+            p->queued = q;
+        double *sb = (double *)realloc(p->submitted, capacity * sizeof(double));
+        if (sb)
+            p->submitted = sb;
+        double *e = (double *)realloc(p->executed, capacity * sizeof(double));
+        if (e)
+            p->executed = e;
+        if (!q || !sb || !e)
+            return HIST_ERR_NOMEM;
+        p->capacity = capacity;
+    }
+    // 个别实现的时间戳不保证单调（例如SUBMIT早于QUEUED），负的间隔记为0
+    p->queued[p->count] = submitted > queued ? (submitted - queued) / 1e3 : 0.0;
+    p->submitted[p->count] = started > submitted ? (started - submitted) / 1e3 : 0.0;
+    p->executed[p->count] = ended > started ? (ended - started) / 1e3 : 0.0;
+    p->count++;
+
+    if (profile->first_queued == 0 || queued < profile->first_queued)
+        profile->first_queued = queued;
+    if (ended > profile->last_end)
+        profile->last_end = ended;
+    return HIST_OK;
+}
+
+static void print_stage_distribution(const HistClStageProfile *p, const char *name, FILE *out)
+{
+    int buckets[HIST_CL_PROFILE_BUCKETS] = {0};
+    for (int i = 0; i < p->count; i++)
+    {
+        int b = 0;
+        for (double limit = 1.0; p->executed[i] >= limit && b < HIST_CL_PROFILE_BUCKETS - 1; limit *= 2.0)
+            b++;
+        buckets[b]++;
+    }
+    int first = HIST_CL_PROFILE_BUCKETS, last = 0, peak = 0;
+    for (int b = 0; b < HIST_CL_PROFILE_BUCKETS; b++)
+    {
+        if (buckets[b] == 0)
+            continue;
+        first = b < first ? b : first;
+        last = b;
+        peak = buckets[b] > peak ? buckets[b] : peak;
+    }
+    fprintf(out, "\n%s execution time (us):\n", name);
+    for (int b = first; b <= last; b++)
+    {
+        double low = b == 0 ? 0.0 : (double)(1u << (b - 1));
+        int bar = (int)((long long)buckets[b] * HIST_CL_PROFILE_BAR / peak);
+        fprintf(out, "  [%7.0f, ", low);
+        if (b == HIST_CL_PROFILE_BUCKETS - 1)
+            fprintf(out, "    inf) %7d ", buckets[b]);
+        else
+            fprintf(out, "%7.0f) %7d ", (double)(1u << b), buckets[b]);
+        for (int i = 0; i < bar; i++)
+            fputc('#', out);
+        fputc('\n', out);
+    }
+}
+
+void hist_cl_profile_print(const HistClProfile *profile, int frames, FILE *out)
+{
+    if (frames < 1)
+        frames = 1;
+    double stage_total[HIST_CL_NUM_STAGES] = {0.0};
+    double device_total = 0.0;
+    HistBenchStats exec[HIST_CL_NUM_STAGES], queued[HIST_CL_NUM_STAGES], submitted[HIST_CL_NUM_STAGES];
+
+    fprintf(out, "\n=== OpenCL profile (%d frames, event timestamps) ===\n", frames);
+    fprintf(out, "%-7s %8s %11s %11s %11s %11s %13s %13s\n", "Stage", "Events", "Total ms", "us/frame",
+            "Exec med", "Exec p95", "Queued med", "Submit med");
+    for (int s = 0; s < HIST_CL_NUM_STAGES; s++)
+    {
+        const HistClStageProfile *p = &profile->stages[s];
+        hist_bench_stats(p->executed, p->count, &exec[s]);
+        hist_bench_stats(p->queued, p->count, &queued[s]);
+        hist_bench_stats(p->submitted, p->count, &submitted[s]);
+        if (p->count == 0)
+            continue;
+        for (int i = 0; i < p->count; i++)
+            stage_total[s] += p->executed[i];
+        device_total += stage_total[s];
+        fprintf(out, "%-7s %8d %11.3f %11.2f %11.2f %11.2f %13.2f %13.2f\n", hist_cl_stage_names[s], p->count,
+                stage_total[s] / 1e3, stage_total[s] / frames, exec[s].median, exec[s].p95, queued[s].median,
+                submitted[s].median);
+    }
+    if (device_total <= 0.0)
+    {
+        fprintf(out, "No profiled commands\n");
+        return;
+    }
+
+    // 设备忙碌比例：各命令执行时间之和 / 第一条命令入队到最后一条命令结束。
+    // 多个队列的命令可能重叠执行，这时比例可以超过100%
+    double span = profile->last_end > profile->first_queued ? (profile->last_end - profile->first_queued) / 1e3 : 0.0;
+    if (span > 0.0)
+        fprintf(out, "Device busy: %.1f%% of %.3f ms (first queued to last completed)\n", 100.0 * device_total / span,
+                span / 1e3);
+
+    int bottleneck = 0;
+    for (int s = 1; s < HIST_CL_NUM_STAGES; s++)
+    {
+        if (stage_total[s] > stage_total[bottleneck])
+            bottleneck = s;
+    }
+    const HistClStageProfile *kernel = &profile->stages[HIST_CL_STAGE_KERNEL];
+    double launch_latency = queued[HIST_CL_STAGE_KERNEL].median + submitted[HIST_CL_STAGE_KERNEL].median;
+    if (span > 0.0 && device_total < 0.5 * span)
+    {
+        // 设备一半以上的时间空闲：瓶颈在主机端的入队、提交和同步
+        fprintf(out, "Limited by: host/launch overhead (device idle %.1f%% of the time)\n",
+                100.0 - 100.0 * device_total / span);
+    }
+    else
+    {
+        fprintf(out, "Limited by: %s (%.1f%% of device time)\n", hist_cl_stage_names[bottleneck],
+                100.0 * stage_total[bottleneck] / device_total);
+    }
+    if (kernel->count > 0)
+        fprintf(out, "Kernel launch latency (queued -> start): median %.2f us vs. execution %.2f us\n", launch_latency,
+                exec[HIST_CL_STAGE_KERNEL].median);
+
+    for (int s = 0; s < HIST_CL_NUM_STAGES; s++)
+    {
+        if (profile->stages[s].count > 0)
+            print_stage_distribution(&profile->stages[s], hist_cl_stage_names[s], out);
+    }
+}
+
+// ===== 后端接口 =====
+
+typedef struct
+{
+    HistClEnv env;
+    HistClLaunch launch;
+    HistClWideLaunch wide; // 高位深图像时使用，kernel非NULL
+    HistClTileLaunch tile; // 第一次hist_compute_tiled时创建
+    int num_bins;
+    cl_mem image_buffer;
+    size_t image_capacity;
+    cl_mem histogram_buffer;
+    cl_mem tiles_buffer;
+    size_t tiles_capacity;
+} OpenClState;
+
+static void opencl_destroy(HistContext *ctx)
+{
+    OpenClState *state = (OpenClState *)ctx->state;
+    if (state->image_buffer)
+        clReleaseMemObject(state->image_buffer);
+    if (state->histogram_buffer)
+        clReleaseMemObject(state->histogram_buffer);
+    if (state->tiles_buffer)
+        clReleaseMemObject(state->tiles_buffer);
+    hist_cl_launch_release(&state->launch);
+    hist_cl_wide_launch_release(&state->wide);
+    hist_cl_tile_launch_release(&state->tile);
+    hist_cl_env_release(&state->env);
+    free(state);
+}
+
+static int opencl_create(HistContext *ctx)
+{
+    cl_int ret;
+    OpenClState *state = (OpenClState *)calloc(1, sizeof(OpenClState));
+    if (!state)
+        return HIST_ERR_NOMEM;
+    ctx->state = state;
+
+    int status = hist_cl_env_init(&state->env, ctx->config.cl_kernel_path, 0);
+    if (status != HIST_OK)
+    {
+        free(state);
+        return status;
+    }
+
+    // 高位深图像：默认按bin分区，cl_kernel为HIST_CL_WIDE_GLOBAL时用global atomic
+    if (ctx->config.pixel_bits > 8)
+    {
+        int wide_choice = ctx->config.cl_kernel == HIST_CL_WIDE_GLOBAL ? HIST_CL_WIDE_GLOBAL : HIST_CL_WIDE_PARTITIONED;
+        status = hist_cl_wide_launch_init(&state->wide, &state->env, wide_choice, ctx->config.pixel_bits,
+                                          ctx->config.bin_shift, 0);
+        state->num_bins = state->wide.num_bins;
+        if (status == HIST_OK)
+        {
+            state->histogram_buffer = clCreateBuffer(state->env.context, CL_MEM_READ_WRITE,
+                                                     (size_t)state->num_bins * sizeof(unsigned int), NULL, &ret);
+            status = hist_cl_check(ret, "clCreateBuffer histogram");
+        }
+        if (status != HIST_OK)
+        {
+            opencl_destroy(ctx);
+            return status;
+        }
+        snprintf(ctx->description, sizeof(ctx->description), "OpenCL %s (%d bins) on %s",
+                 hist_cl_wide_kernel_names[wide_choice - 1], state->num_bins, state->env.device_name);
+        return HIST_OK;
+    }
+
+    // 多通道图像只能用histogram_channels
+    int channels = ctx->config.channels;
+    int kernel_choice = ctx->config.cl_kernel > 0 ? ctx->config.cl_kernel : HIST_CL_DEFAULT_KERNEL;
+    if (channels > 1)
+        kernel_choice = HIST_CL_CHANNELS_KERNEL;
+    status = hist_cl_launch_init(&state->launch, &state->env, kernel_choice, 0);
+    state->launch.channels = channels;
+    state->num_bins = channels * HISTOGRAM_BINS;
+    if (status == HIST_OK)
+    {
+        state->histogram_buffer = clCreateBuffer(state->env.context, CL_MEM_READ_WRITE,
+                                                 (size_t)channels * HISTOGRAM_BINS * sizeof(unsigned int), NULL, &ret);
+        status = hist_cl_check(ret, "clCreateBuffer histogram");
+    }
+    if (status != HIST_OK)
+    {
+        opencl_destroy(ctx);
+        return status;
+    }
+
+    snprintf(ctx->description, sizeof(ctx->description), "OpenCL %s on %s",
+             hist_cl_kernel_names[kernel_choice - 1], state->env.device_name);
+    return HIST_OK;
+}
+
+// 缓冲区按需扩大（容量向上取整到16字节），之后的帧复用
+static int opencl_reserve(OpenClState *state, cl_mem *buffer, size_t *capacity, size_t size, cl_mem_flags flags)
+{
+    cl_int ret;
+    if (size <= *capacity)
+        return HIST_OK;
+    if (*buffer)
+        clReleaseMemObject(*buffer);
+    *capacity = (size + 15) & ~(size_t)15;
+    *buffer = clCreateBuffer(state->env.context, flags, *capacity, NULL, &ret);
+    if (hist_cl_check(ret, "clCreateBuffer") != HIST_OK)
+    {
+        *buffer = NULL;
+        *capacity = 0;
+        return HIST_ERR_BACKEND;
+    }
+    return HIST_OK;
+}
+
+// 图像大小变化时重新配置kernel：有该大小的调优结果（--autotune保存）时使用，
+// 指定了cl_kernel时只接受同一kernel的调优结果
+// 多通道图像（image_size为像素数）只用histogram_channels的默认配置，调优结果只针对灰度图像
+static int opencl_configure(HistContext *ctx, int image_size)
+{
+    OpenClState *state = (OpenClState *)ctx->state;
+    HistClTuning tuning;
+    HistClTuning saved;
+
+    if (ctx->config.channels > 1)
+    {
+        hist_cl_launch_configure(&state->launch, &state->env, image_size);
+        return HIST_OK;
+    }
+
+    memset(&tuning, 0, sizeof(tuning));
+    tuning.kernel_choice = ctx->config.cl_kernel > 0 ? ctx->config.cl_kernel : HIST_CL_DEFAULT_KERNEL;
+    if (hist_cl_tuning_load(&state->env, image_size, &saved, NULL, 0) == HIST_OK &&
+        (ctx->config.cl_kernel == 0 || saved.kernel_choice == ctx->config.cl_kernel))
+    {
+        tuning = saved;
+    }
+
+    hist_cl_launch_release(&state->launch);
+    int status = hist_cl_launch_init_tuned(&state->launch, &state->env, &tuning, image_size);
+    if (status != HIST_OK)
+        return status;
+
+    snprintf(ctx->description, sizeof(ctx->description), "OpenCL %s on %s%s",
+             hist_cl_kernel_names[tuning.kernel_choice - 1], state->env.device_name,
+             tuning.local_size > 0 ? " (tuned)" : "");
+    return HIST_OK;
+}
+
+static int opencl_compute(HistContext *ctx, const unsigned char *data, size_t size, unsigned int *histogram)
+{
+    OpenClState *state = (OpenClState *)ctx->state;
+    cl_command_queue queue = state->env.queue;
+    cl_int ret;
+    int num_bins = state->num_bins;
+    int wide = state->wide.kernel != NULL;
+    int num_pixels = (int)(wide ? size / sizeof(unsigned short) : size / (size_t)ctx->config.channels);
+
+    if (size == 0)
+    {
+        memset(histogram, 0, num_bins * sizeof(unsigned int));
+        return HIST_OK;
+    }
+
+    // 图像缓冲区（向量化kernel按uchar4读取，容量向上取整到16字节）
+    if (opencl_reserve(state, &state->image_buffer, &state->image_capacity, size, CL_MEM_READ_ONLY) != HIST_OK)
+        return HIST_ERR_BACKEND;
+    if (wide)
+    {
+        if (num_pixels != state->wide.num_pixels)
+            hist_cl_wide_launch_configure(&state->wide, &state->env, num_pixels);
+        if (hist_cl_wide_launch_set_args(&state->wide, state->image_buffer, state->histogram_buffer) != HIST_OK)
+            return HIST_ERR_BACKEND;
+    }
+    else
+    {
+        if (num_pixels != state->launch.image_size)
+        {
+            int status = opencl_configure(ctx, num_pixels);
+            if (status != HIST_OK)
+                return status;
+        }
+        if (hist_cl_launch_set_args(&state->launch, state->image_buffer, state->histogram_buffer) != HIST_OK)
+            return HIST_ERR_BACKEND;
+    }
+
+    ret = clEnqueueWriteBuffer(queue, state->image_buffer, CL_FALSE, 0, size, data, 0, NULL, NULL);
+    if (hist_cl_check(ret, "clEnqueueWriteBuffer") != HIST_OK ||
+        hist_cl_enqueue_clear(&state->env, queue, state->histogram_buffer, num_bins, 0, NULL, NULL) != HIST_OK)
+        return HIST_ERR_BACKEND;
+    if (wide)
+        ret = clEnqueueNDRangeKernel(queue, state->wide.kernel, 2, NULL, state->wide.global_size,
+                                     state->wide.local_size, 0, NULL, NULL);
+    else
+        ret = clEnqueueNDRangeKernel(queue, state->launch.kernel, 1, NULL, &state->launch.global_size,
+                                     &state->launch.local_size, 0, NULL, NULL);
+    if (hist_cl_check(ret, "enqueue") != HIST_OK)
+        return HIST_ERR_BACKEND;
+
+    // 阻塞读取保证data在返回前已被使用完
+    ret = clEnqueueReadBuffer(queue, state->histogram_buffer, CL_TRUE, 0,
+                              num_bins * sizeof(unsigned int), histogram, 0, NULL, NULL);
+    return hist_cl_check(ret, "clEnqueueReadBuffer");
+}
+
+// 分块直方图：上传 (height - 1) * stride + width 字节，kernel按stride寻址；
+// 块直方图不需要清零，整帧直方图复用histogram_buffer（8位单通道，256个计数）
+static int opencl_compute_tiled(HistContext *ctx, const HistTileJob *job)
+{
+    OpenClState *state = (OpenClState *)ctx->state;
+    cl_command_queue queue = state->env.queue;
+    HistClTileLaunch *tile = &state->tile;
+    cl_int ret;
+    size_t image_bytes = (size_t)(job->height - 1) * job->stride + job->width;
+    size_t tiles_bytes = (size_t)job->tiles_x * job->tiles_y * job->num_bins * sizeof(unsigned int);
+
+    if (!tile->kernel && hist_cl_tile_launch_init(tile, &state->env, job->bin_shift) != HIST_OK)
+        return HIST_ERR_BACKEND;
+    if (opencl_reserve(state, &state->image_buffer, &state->image_capacity, image_bytes, CL_MEM_READ_ONLY) != HIST_OK ||
+        opencl_reserve(state, &state->tiles_buffer, &state->tiles_capacity, tiles_bytes, CL_MEM_WRITE_ONLY) != HIST_OK)
+        return HIST_ERR_BACKEND;
+    if (job->width != tile->width || job->height != tile->height || job->stride != tile->stride ||
+        job->tile_width != tile->tile_width || job->tile_height != tile->tile_height)
+        hist_cl_tile_launch_configure(tile, &state->env, job->width, job->height, job->stride, job->tile_width,
+                                      job->tile_height);
+    if (hist_cl_tile_launch_set_args(tile, state->image_buffer, state->tiles_buffer, state->histogram_buffer) != HIST_OK)
+        return HIST_ERR_BACKEND;
+
+    ret = clEnqueueWriteBuffer(queue, state->image_buffer, CL_FALSE, 0, image_bytes, job->image, 0, NULL, NULL);
+    if (hist_cl_check(ret, "clEnqueueWriteBuffer") != HIST_OK ||
+        hist_cl_enqueue_clear(&state->env, queue, state->histogram_buffer, job->num_bins, 0, NULL, NULL) != HIST_OK)
+        return HIST_ERR_BACKEND;
+    ret = clEnqueueNDRangeKernel(queue, tile->kernel, 2, NULL, tile->global_size, tile->local_size, 0, NULL, NULL);
+    if (hist_cl_check(ret, "enqueue histogram_tiled") != HIST_OK)
+        return HIST_ERR_BACKEND;
+
+    // 顺序队列：最后一次读取阻塞，返回时之前的命令都已完成
+    ret = clEnqueueReadBuffer(queue, state->tiles_buffer, job->histogram ? CL_FALSE : CL_TRUE, 0, tiles_bytes,
+                              job->tiles, 0, NULL, NULL);
+    if (ret == CL_SUCCESS && job->histogram)
+        ret = clEnqueueReadBuffer(queue, state->histogram_buffer, CL_TRUE, 0, job->num_bins * sizeof(unsigned int),
+                                  job->histogram, 0, NULL, NULL);
+    return hist_cl_check(ret, "clEnqueueReadBuffer");
+}
+
+const HistBackendOps hist_opencl_ops = {opencl_create, opencl_compute, opencl_destroy, opencl_compute_tiled};
+
+#else // !HIST_WITH_OPENCL
+
+static int opencl_create(HistContext *ctx)
+{
+    (void)ctx;
+    fprintf(stderr, "OpenCL backend: libhist was built without HIST_WITH_OPENCL\n");
+    return HIST_ERR_UNSUPPORTED;
+}
+
+static int opencl_compute(HistContext *ctx, const unsigned char *data, size_t size, unsigned int *histogram)
+{
+    (void)ctx;
+    (void)data;
+    (void)size;
+    (void)histogram;
+    return HIST_ERR_UNSUPPORTED;
+}
+
+static void opencl_destroy(HistContext *ctx)
+{
+    (void)ctx;
+}
+
+const HistBackendOps hist_opencl_ops = {opencl_create, opencl_compute, opencl_destroy, NULL};
+
+#endif // HIST_WITH_OPENCL
@@ -0,0 +1,349 @@
+// hist_opencl_tune.c
+// libhist OpenCL自动调优：扫描kernel、local size和每work-item像素数，结果按设备保存
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "hist_internal.h"
+
+#ifdef HIST_WITH_OPENCL
+
+#define TUNE_REPEATS 5 // 每个候选配置计时次数（取中位数），之前另有一次预热
+#define TUNING_MAX_ENTRIES 64
+
+static const size_t tune_local_sizes[] = {64, 128, 256, 512, 1024};
+static const int tune_local_pixels[] = {1, 2, 4, 8, 16, 32};  // histogram_local: LOCAL_PIXELS_PER_ITEM
+static const int tune_ultra_pixels[] = {8, 16, 32, 64, 128};  // histogram_ultra: ULTRA_MAX_PIXELS
+static const int tune_default_pixels[] = {0};
+
+// 调优参数对应的编译选项，默认值返回空字符串，这样可以复用默认程序的缓存
+static void tuning_build_options(const HistClTuning *tuning, char *options, size_t size)
+{
+    options[0] = '\0';
+    if (tuning->pixels_per_item <= 0)
+        return;
+    if (tuning->kernel_choice == HIST_CL_LOCAL_KERNEL && tuning->pixels_per_item != 4)
+    {
+        snprintf(options, size, "-DLOCAL_PIXELS_PER_ITEM=%d", tuning->pixels_per_item);
+    }
+    else if (tuning->kernel_choice == HIST_CL_ULTRA_KERNEL && tuning->pixels_per_item != 32)
+    {
+        // 上限低于默认下限（8）时下限也跟着降低
+        if (tuning->pixels_per_item < 8)
+            snprintf(options, size, "-DULTRA_MAX_PIXELS=%d -DULTRA_MIN_PIXELS=%d",
+                     tuning->pixels_per_item, tuning->pixels_per_item);
+        else
+            snprintf(options, size, "-DULTRA_MAX_PIXELS=%d", tuning->pixels_per_item);
+    }
+}
+
+int hist_cl_launch_init_tuned(HistClLaunch *launch, HistClEnv *env, const HistClTuning *tuning, int image_size)
+{
+    char options[128];
+    tuning_build_options(tuning, options, sizeof(options));
+
+    int status = hist_cl_env_rebuild(env, options);
+    if (status != HIST_OK)
+        return status;
+    status = hist_cl_launch_init(launch, env, tuning->kernel_choice, 0);
+    if (status != HIST_OK)
+        return status;
+
+    launch->tuned_local_size = tuning->local_size;
+    if (tuning->kernel_choice == HIST_CL_LOCAL_KERNEL || tuning->kernel_choice == HIST_CL_ULTRA_KERNEL)
+        launch->tuned_pixels_per_item = tuning->pixels_per_item;
+    hist_cl_launch_configure(launch, env, image_size);
+    return HIST_OK;
+}
+
+// ===== 自动调优 =====
+
+static double median_ms(double *times, int count)
+{
+    // 插入排序，count很小
+    for (int i = 1; i < count; i++)
+    {
+        double value = times[i];
+        int j = i - 1;
+        while (j >= 0 && times[j] > value)
+        {
+            times[j + 1] = times[j];
+            j--;
+        }
+        times[j + 1] = value;
+    }
+    return times[count / 2];
+}
+
+// 测量一个候选配置，返回kernel时间中位数（ms）
+// 配置超出设备限制时返回0，出错或结果与参考直方图不一致时返回负数
+static double measure_candidate(HistClEnv *env, cl_command_queue queue, const HistClTuning *candidate,
+                                cl_mem image_buffer, cl_mem histogram_buffer, int image_size,
+                                const unsigned int *reference)
+{
+    HistClLaunch launch;
+    if (hist_cl_launch_init_tuned(&launch, env, candidate, image_size) != HIST_OK)
+    {
+        hist_cl_launch_release(&launch);
+        return -1.0;
+    }
+
+    size_t kernel_work_group_size = 0;
+    cl_int ret = clGetKernelWorkGroupInfo(launch.kernel, env->device, CL_KERNEL_WORK_GROUP_SIZE,
+                                          sizeof(kernel_work_group_size), &kernel_work_group_size, NULL);
+    if (ret != CL_SUCCESS || launch.local_size > kernel_work_group_size)
+    {
+        hist_cl_launch_release(&launch);
+        return 0.0;
+    }
+    if (hist_cl_launch_set_args(&launch, image_buffer, histogram_buffer) != HIST_OK)
+    {
+        hist_cl_launch_release(&launch);
+        return -1.0;
+    }
+
+    double times[TUNE_REPEATS];
+    for (int r = -1; r < TUNE_REPEATS; r++)
+    {
+        double time_ms = hist_cl_time_kernel(env, queue, launch.kernel, 1, &launch.global_size, &launch.local_size,
+                                             histogram_buffer, HISTOGRAM_BINS);
+        if (time_ms < 0.0)
+        {
+            hist_cl_launch_release(&launch);
+            return -1.0;
+        }
+        if (r >= 0)
+            times[r] = time_ms;
+    }
+    hist_cl_launch_release(&launch);
+
+    // 最后一次运行的结果必须与CPU参考实现一致
+    unsigned int histogram[HISTOGRAM_BINS];
+    ret = clEnqueueReadBuffer(queue, histogram_buffer, CL_TRUE, 0, sizeof(histogram), histogram, 0, NULL, NULL);
+    if (ret != CL_SUCCESS || memcmp(histogram, reference, sizeof(histogram)) != 0)
+        return -1.0;
+
+    double median = median_ms(times, TUNE_REPEATS);
+    // 计时器分辨率不足时也要和"超出限制"区分开
+    return median > 0.0 ? median : 1e-6;
+}
+
+int hist_cl_autotune(HistClEnv *env, const unsigned char *image, int image_size, HistClTuning *best, int verbose)
+{
+    cl_int ret;
+    if (!env || !image || image_size < 1 || !best)
+        return HIST_ERR_INVALID;
+    memset(best, 0, sizeof(HistClTuning));
+
+    // 计时需要profiling队列，与env->queue分开
+    cl_command_queue queue = clCreateCommandQueue(env->context, env->device, CL_QUEUE_PROFILING_ENABLE, &ret);
+    if (hist_cl_check(ret, "clCreateCommandQueue (profiling)") != HIST_OK)
+        return HIST_ERR_BACKEND;
+
+    // 向量化kernel按uchar4读取，容量向上取整到16字节
+    size_t capacity = ((size_t)image_size + 15) & ~(size_t)15;
+    cl_mem image_buffer = clCreateBuffer(env->context, CL_MEM_READ_ONLY, capacity, NULL, &ret);
+    int status = hist_cl_check(ret, "clCreateBuffer image");
+    cl_mem histogram_buffer = NULL;
+    if (status == HIST_OK)
+    {
+        histogram_buffer = clCreateBuffer(env->context, CL_MEM_READ_WRITE,
+                                          HISTOGRAM_BINS * sizeof(unsigned int), NULL, &ret);
+        status = hist_cl_check(ret, "clCreateBuffer histogram");
+    }
+    if (status == HIST_OK)
+    {
+        ret = clEnqueueWriteBuffer(queue, image_buffer, CL_TRUE, 0, image_size, image, 0, NULL, NULL);
+        status = hist_cl_check(ret, "clEnqueueWriteBuffer image");
+    }
+
+    unsigned int reference[HISTOGRAM_BINS];
+    compute_histogram_cpu(image, image_size, reference);
+
+    if (status == HIST_OK && verbose)
+    {
+        printf("Auto-tuning on %d pixels (%d timed runs per configuration)...\n", image_size, TUNE_REPEATS);
+    }
+
+    int num_local_sizes = (int)(sizeof(tune_local_sizes) / sizeof(tune_local_sizes[0]));
+    for (int k = HIST_CL_NAIVE_KERNEL; status == HIST_OK && k <= HIST_CL_NUM_KERNELS; k++)
+    {
+        const int *pixels = tune_default_pixels;
+        int num_pixels = 1;
+        if (k == HIST_CL_LOCAL_KERNEL)
+        {
+            pixels = tune_local_pixels;
+            num_pixels = (int)(sizeof(tune_local_pixels) / sizeof(tune_local_pixels[0]));
+        }
+        else if (k == HIST_CL_ULTRA_KERNEL)
+        {
+            pixels = tune_ultra_pixels;
+            num_pixels = (int)(sizeof(tune_ultra_pixels) / sizeof(tune_ultra_pixels[0]));
+        }
+
+        for (int l = 0; l < num_local_sizes; l++)
+        {
+            if (tune_local_sizes[l] > env->max_work_group_size)
+                continue;
+            for (int p = 0; p < num_pixels; p++)
+            {
+                HistClTuning candidate;
+                memset(&candidate, 0, sizeof(candidate));
+                candidate.kernel_choice = k;
+                candidate.local_size = tune_local_sizes[l];
+                candidate.pixels_per_item = pixels[p];
+                candidate.image_size = image_size;
+
+                double time_ms = measure_candidate(env, queue, &candidate, image_buffer, histogram_buffer,
+                                                   image_size, reference);
+                if (time_ms == 0.0)
+                    continue;
+                if (verbose)
+                {
+                    printf("  %-22s local=%-5zu pixels/item=%-4d ", hist_cl_kernel_names[k - 1],
+                           candidate.local_size, candidate.pixels_per_item);
+                    if (time_ms < 0.0)
+                        printf("FAILED (error or wrong histogram)\n");
+                    else
+                        printf("%.4f ms\n", time_ms);
+                }
+                if (time_ms > 0.0 && (best->kernel_choice == 0 || time_ms < best->kernel_time_ms))
+                {
+                    candidate.kernel_time_ms = time_ms;
+                    *best = candidate;
+                }
+            }
+        }
+    }
+
+    if (histogram_buffer)
+        clReleaseMemObject(histogram_buffer);
+    if (image_buffer)
+        clReleaseMemObject(image_buffer);
+    clReleaseCommandQueue(queue);
+
+    if (status == HIST_OK && best->kernel_choice == 0)
+    {
+        fprintf(stderr, "Auto-tune: no configuration produced a correct histogram\n");
+        status = HIST_ERR_BACKEND;
+    }
+    if (status == HIST_OK && verbose)
+    {
+        printf("Best: %s, local size %zu, pixels/item %d, %.4f ms\n",
+               hist_cl_kernel_names[best->kernel_choice - 1], best->local_size,
+               best->pixels_per_item, best->kernel_time_ms);
+    }
+    return status;
+}
+
+// ===== 调优文件 =====
+
+static int tuning_path(const HistClEnv *env, char *path, size_t path_size)
+{
+    const char *dir = hist_cl_cache_dir();
+    if (!dir)
+        return 0;
+
+    uint64_t hash = HIST_FNV_OFFSET;
+    hash = hist_fnv1a(hash, env->device_name, strlen(env->device_name) + 1);
+    hash = hist_fnv1a(hash, env->driver_version, strlen(env->driver_version) + 1);
+    if (env->source)
+        hash = hist_fnv1a(hash, env->source, strlen(env->source));
+    snprintf(path, path_size, "%s/tuning_%016llx.txt", dir, (unsigned long long)hash);
+    return 1;
+}
+
+// 读取调优文件中的所有记录，文件不存在时返回0
+static int tuning_read(const char *path, HistClTuning *entries, int max_entries)
+{
+    FILE *fp = fopen(path, "r");
+    if (!fp)
+        return 0;
+
+    char line[256];
+    int count = 0;
+    while (count < max_entries && fgets(line, sizeof(line), fp))
+    {
+        HistClTuning entry;
+        unsigned long local_size;
+        if (line[0] == '#')
+            continue;
+        if (sscanf(line, "%d %d %lu %d %lf", &entry.image_size, &entry.kernel_choice, &local_size,
+                   &entry.pixels_per_item, &entry.kernel_time_ms) != 5)
+            continue;
+        if (entry.kernel_choice < 1 || entry.kernel_choice > HIST_CL_NUM_KERNELS)
+            continue;
+        entry.local_size = local_size;
+        entries[count++] = entry;
+    }
+    fclose(fp);
+    return count;
+}
+
+int hist_cl_tuning_load(const HistClEnv *env, int image_size, HistClTuning *tuning, char *path, size_t path_size)
+{
+    char file_path[512];
+    if (!tuning_path(env, file_path, sizeof(file_path)))
+        return HIST_ERR_UNSUPPORTED;
+    if (path)
+        snprintf(path, path_size, "%s", file_path);
+
+    HistClTuning entries[TUNING_MAX_ENTRIES];
+    int count = tuning_read(file_path, entries, TUNING_MAX_ENTRIES);
+    for (int i = 0; i < count; i++)
+    {
+        if (entries[i].image_size == image_size)
+        {
+            *tuning = entries[i];
+            return HIST_OK;
+        }
+    }
+    return HIST_ERR_INVALID;
+}
+
+int hist_cl_tuning_save(const HistClEnv *env, const HistClTuning *tuning, char *path, size_t path_size)
+{
+    char file_path[512];
+    if (!tuning_path(env, file_path, sizeof(file_path)))
+        return HIST_ERR_UNSUPPORTED;
+    if (path)
+        snprintf(path, path_size, "%s", file_path);
+
+    // 同一图像大小的旧记录被替换，其他记录保留
+    HistClTuning entries[TUNING_MAX_ENTRIES];
+    int count = tuning_read(file_path, entries, TUNING_MAX_ENTRIES);
+    int index = 0;
+    while (index < count && entries[index].image_size != tuning->image_size)
+        index++;
+    if (index == TUNING_MAX_ENTRIES)
+        index = TUNING_MAX_ENTRIES - 1;
+    entries[index] = *tuning;
+    if (index == count)
+        count++;
+
+    char tmp_path[520];
+    snprintf(tmp_path, sizeof(tmp_path), "%s.tmp", file_path);
+    FILE *fp = fopen(tmp_path, "w");
+    if (!fp)
+    {
+        fprintf(stderr, "Error: Cannot open file %s\n", tmp_path);
+        return HIST_ERR_INVALID;
+    }
+    fprintf(fp, "# histogram.cl tuning for %s (driver %s)\n", env->device_name, env->driver_version);
+    fprintf(fp, "# image_size kernel local_size pixels_per_item kernel_time_ms\n");
+    for (int i = 0; i < count; i++)
+    {
+        fprintf(fp, "%d %d %lu %d %.6f\n", entries[i].image_size, entries[i].kernel_choice,
+                (unsigned long)entries[i].local_size, entries[i].pixels_per_item, entries[i].kernel_time_ms);
+    }
+    int ok = fclose(fp) == 0;
+    remove(file_path);
+    if (!ok || rename(tmp_path, file_path) != 0)
+    {
+        remove(tmp_path);
+        return HIST_ERR_INVALID;
+    }
+    return HIST_OK;
+}
+
+#endif // HIST_WITH_OPENCL
@@ -0,0 +1,228 @@
+// hist_perf.c
+// libhist：Linux perf_event_open硬件性能计数器，其他平台上只提供返回HIST_ERR_UNSUPPORTED的空实现
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "hist_internal.h"
+
+#ifdef __linux__
+#include <errno.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <linux/perf_event.h>
+#endif
+
+const char *hist_perf_event_names[] = {"task-clock", "cycles", "instructions", "L1D-read-misses",
+                                       "LLC-read-misses", "branch-misses", "store-forward-blocks"};
+
+int hist_perf_requested(void)
+{
+    const char *value = getenv("HIST_PERF");
+    return value && value[0] != '\0' && strcmp(value, "0") != 0;
+}
+
+#ifdef __linux__
+
+// store forwarding阻塞只有Intel有公开的原始事件（LD_BLOCKS.STORE_FORWARD，event 0x03 umask 0x02）
+static int cpu_is_intel(void)
+{
+#if defined(__x86_64__) || defined(__i386__)
+    FILE *fp = fopen("/proc/cpuinfo", "r");
+    if (!fp)
+        return 0;
+    char line[256];
+    int intel = 0;
+    while (fgets(line, sizeof(line), fp))
+    {
+        if (strncmp(line, "vendor_id", 9) == 0)
+        {
+            intel = strstr(line, "GenuineIntel") != NULL;
+            break;
+        }
+    }
+    fclose(fp);
+    return intel;
+#else
+    return 0;
+#endif
+}
+
+static int open_event(unsigned int type, unsigned long long config)
+{
+    struct perf_event_attr attr;
+    memset(&attr, 0, sizeof(attr));
+    attr.size = sizeof(attr);
+    attr.type = type;
+    attr.config = config;
+    attr.disabled = 1;
+    attr.inherit = 1; // 之后创建的线程（线程池）也计数
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+    return (int)syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0);
+}
+
+static unsigned long long cache_config(unsigned long long cache)
+{
+    return cache | ((unsigned long long)PERF_COUNT_HW_CACHE_OP_READ << 8) |
+           ((unsigned long long)PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+}
+
+int hist_perf_open(HistPerf *perf)
+{
+    memset(perf, 0, sizeof(HistPerf));
+    perf->fd[HIST_PERF_TASK_CLOCK] = open_event(PERF_TYPE_SOFTWARE, PERF_COUNT_SW_TASK_CLOCK);
+    perf->fd[HIST_PERF_CYCLES] = open_event(PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES);
+    int hardware_errno = errno;
+    perf->fd[HIST_PERF_INSTRUCTIONS] = open_event(PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS);
+    perf->fd[HIST_PERF_L1D_MISSES] = open_event(PERF_TYPE_HW_CACHE, cache_config(PERF_COUNT_HW_CACHE_L1D));
+    perf->fd[HIST_PERF_LLC_MISSES] = open_event(PERF_TYPE_HW_CACHE, cache_config(PERF_COUNT_HW_CACHE_LL));
+    if (perf->fd[HIST_PERF_LLC_MISSES] < 0)
+        perf->fd[HIST_PERF_LLC_MISSES] = open_event(PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES);
+    perf->fd[HIST_PERF_BRANCH_MISSES] = open_event(PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES);
+    perf->fd[HIST_PERF_STORE_FORWARD] = cpu_is_intel() ? open_event(PERF_TYPE_RAW, 0x0203) : -1;
+
+    int opened = 0;
+    for (int e = 0; e < HIST_PERF_NUM_EVENTS; e++)
+    {
+        opened += perf->fd[e] >= 0;
+    }
+    if (opened == 0)
+    {
+        snprintf(perf->error, sizeof(perf->error), "perf_event_open: %s (see /proc/sys/kernel/perf_event_paranoid)",
+                 strerror(errno));
+        return HIST_ERR_UNSUPPORTED;
+    }
+    if (perf->fd[HIST_PERF_CYCLES] < 0)
+    {
+        // 虚拟机里通常没有PMU，只剩软件计数器
+        snprintf(perf->error, sizeof(perf->error), "no hardware counters: %s", strerror(hardware_errno));
+    }
+    return HIST_OK;
+}
+
+void hist_perf_close(HistPerf *perf)
+{
+    for (int e = 0; e < HIST_PERF_NUM_EVENTS; e++)
+    {
+        if (perf->fd[e] >= 0)
+            close(perf->fd[e]);
+        perf->fd[e] = -1;
+    }
+}
+
+void hist_perf_start(HistPerf *perf)
+{
+    for (int e = 0; e < HIST_PERF_NUM_EVENTS; e++)
+    {
+        if (perf->fd[e] >= 0)
+        {
+            ioctl(perf->fd[e], PERF_EVENT_IOC_RESET, 0);
+            ioctl(perf->fd[e], PERF_EVENT_IOC_ENABLE, 0);
+        }
+    }
+}
+
+void hist_perf_stop(HistPerf *perf)
+{
+    for (int e = 0; e < HIST_PERF_NUM_EVENTS; e++)
+    {
+        if (perf->fd[e] >= 0)
+            ioctl(perf->fd[e], PERF_EVENT_IOC_DISABLE, 0);
+    }
+}
+
+void hist_perf_read(HistPerf *perf)
+{
+    for (int e = 0; e < HIST_PERF_NUM_EVENTS; e++)
+    {
+        perf->count[e] = 0;
+        // value, time_enabled, time_running
+        unsigned long long values[3];
+        if (perf->fd[e] < 0 || read(perf->fd[e], values, sizeof(values)) != (ssize_t)sizeof(values))
+            continue;
+        // PMU计数器不够时内核轮流调度各事件，按实际运行的时间比例估算完整计数
+        if (values[2] > 0 && values[2] < values[1])
+            values[0] = (unsigned long long)((double)values[0] * values[1] / values[2]);
+        perf->count[e] = values[0];
+    }
+}
+
+#else // !__linux__
+
+int hist_perf_open(HistPerf *perf)
+{
+    memset(perf, 0, sizeof(HistPerf));
+    for (int e = 0; e < HIST_PERF_NUM_EVENTS; e++)
+    {
+        perf->fd[e] = -1;
+    }
+    snprintf(perf->error, sizeof(perf->error), "perf_event_open is only available on Linux");
+    return HIST_ERR_UNSUPPORTED;
+}
+
+void hist_perf_close(HistPerf *perf)
+{
+    (void)perf;
+}
+
+void hist_perf_start(HistPerf *perf)
+{
+    (void)perf;
+}
+
+void hist_perf_stop(HistPerf *perf)
+{
+    (void)perf;
+}
+
+void hist_perf_read(HistPerf *perf)
+{
+    memset(perf->count, 0, sizeof(perf->count));
+}
+
+#endif // __linux__
+
+void hist_perf_print_header(FILE *out)
+{
+    fprintf(out, "%-24s %8s %7s %6s %8s %9s %9s %9s %9s\n", "Kernel", "ns/px", "cyc/px", "IPC", "GHz",
+            "L1D/kpx", "LLC/kpx", "BrM/kpx", "StFw/kpx");
+}
+
+// 每像素或每千像素的值，计数器不可用时输出 "-"
+static void print_ratio(FILE *out, int width, int available, double value, int precision)
+{
+    if (available)
+        fprintf(out, " %*.*f", width, precision, value);
+    else
+        fprintf(out, " %*s", width, "-");
+}
+
+void hist_perf_print_row(const HistPerf *perf, const char *label, double pixels, FILE *out)
+{
+    const unsigned long long *c = perf->count;
+    int has[HIST_PERF_NUM_EVENTS];
+    for (int e = 0; e < HIST_PERF_NUM_EVENTS; e++)
+    {
+        has[e] = perf->fd[e] >= 0;
+    }
+    if (pixels <= 0.0)
+        pixels = 1.0;
+    double kpixels = pixels / 1000.0;
+
+    fprintf(out, "%-24s", label);
+    print_ratio(out, 8, has[HIST_PERF_TASK_CLOCK], c[HIST_PERF_TASK_CLOCK] / pixels, 3);
+    print_ratio(out, 7, has[HIST_PERF_CYCLES], c[HIST_PERF_CYCLES] / pixels, 2);
+    print_ratio(out, 6, has[HIST_PERF_CYCLES] && has[HIST_PERF_INSTRUCTIONS] && c[HIST_PERF_CYCLES] > 0,
+                (double)c[HIST_PERF_INSTRUCTIONS] / (c[HIST_PERF_CYCLES] ? c[HIST_PERF_CYCLES] : 1), 2);
+    // task-clock包括所有线程，多线程时GHz是各核频率之和
+    print_ratio(out, 8, has[HIST_PERF_CYCLES] && has[HIST_PERF_TASK_CLOCK] && c[HIST_PERF_TASK_CLOCK] > 0,
+                (double)c[HIST_PERF_CYCLES] / (c[HIST_PERF_TASK_CLOCK] ? c[HIST_PERF_TASK_CLOCK] : 1), 2);
+    print_ratio(out, 9, has[HIST_PERF_L1D_MISSES], c[HIST_PERF_L1D_MISSES] / kpixels, 2);
+    print_ratio(out, 9, has[HIST_PERF_LLC_MISSES], c[HIST_PERF_LLC_MISSES] / kpixels, 2);
+    print_ratio(out, 9, has[HIST_PERF_BRANCH_MISSES], c[HIST_PERF_BRANCH_MISSES] / kpixels, 2);
+    print_ratio(out, 9, has[HIST_PERF_STORE_FORWARD], c[HIST_PERF_STORE_FORWARD] / kpixels, 2);
+    fputc('\n', out);
+}
@@ -0,0 +1,278 @@
+// hist_simd.h（libhist内部头文件）
+// 手写向量化直方图kernel + 运行时CPU特性检测（x86: CPUID，ARM: HWCAP）
+// 同一个二进制可以在不同节点上自动选择最快的kernel，无需 -mavx2 / -mavx512f 编译选项
+//
+// 所有kernel的语义与 compute_histogram_cpu 相同：清零并统计256个bin
+#ifndef HIST_SIMD_H
+#define HIST_SIMD_H
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "hist.h" // get_time_ms
+
+#if defined(__GNUC__) && defined(__x86_64__)
+#define HIST_SIMD_X86 1
+#include <immintrin.h>
+#endif
+
+#if defined(__ARM_NEON) || defined(__aarch64__)
+#define HIST_SIMD_NEON 1
+#include <arm_neon.h>
+#if defined(__linux__)
+#include <sys/auxv.h>
+#include <asm/hwcap.h>
+#endif
+#endif
+
+typedef void (*histogram_fn)(const unsigned char *image, int size, unsigned int *histogram);
+
+typedef enum
+{
+    SIMD_NONE,
+    SIMD_NEON,
+    SIMD_AVX2,
+    SIMD_AVX512
+} SimdLevel;
+
+static const char *simd_level_names[] = {"none", "neon", "avx2", "avx512"};
+
+// 合并多个bank到输出直方图
+static inline void simd_merge_banks(unsigned int *banks, int num_banks, unsigned int *histogram)
+{
+    for (int b = 0; b < HISTOGRAM_BINS; b++)
+    {
+        unsigned int sum = 0;
+        for (int k = 0; k < num_banks; k++)
+        {
+            sum += banks[k * HISTOGRAM_BINS + b];
+        }
+        histogram[b] = sum;
+    }
+}
+
+// 把一个64位字中的8个像素分别统计到8个bank（bank = 字节位置）
+#define SIMD_COUNT_WORD(banks, w)      \
+    do                                 \
+    {                                  \
+        uint64_t _w = (w);             \
+        banks[0][_w & 0xFF]++;         \
+        banks[1][(_w >> 8) & 0xFF]++;  \
+        banks[2][(_w >> 16) & 0xFF]++; \
+        banks[3][(_w >> 24) & 0xFF]++; \
+        banks[4][(_w >> 32) & 0xFF]++; \
+        banks[5][(_w >> 40) & 0xFF]++; \
+        banks[6][(_w >> 48) & 0xFF]++; \
+        banks[7][_w >> 56]++;          \
+    } while (0)
+
+#ifdef HIST_SIMD_X86
+
+// AVX2：每次加载32字节，拆成4个64位lane，每个字节统计到对应位置的bank
+__attribute__((target("avx2"))) static void compute_histogram_avx2(const unsigned char *image, int size, unsigned int *histogram)
+{
+    unsigned int banks[8][HISTOGRAM_BINS];
+    memset(banks, 0, sizeof(banks));
+
+    int i = 0;
+    for (; i + 32 <= size; i += 32)
+    {
+        __m256i v = _mm256_loadu_si256((const __m256i *)(image + i));
+        SIMD_COUNT_WORD(banks, (uint64_t)_mm256_extract_epi64(v, 0));
+        SIMD_COUNT_WORD(banks, (uint64_t)_mm256_extract_epi64(v, 1));
+        SIMD_COUNT_WORD(banks, (uint64_t)_mm256_extract_epi64(v, 2));
+        SIMD_COUNT_WORD(banks, (uint64_t)_mm256_extract_epi64(v, 3));
+    }
+    for (; i < size; i++)
+    {
+        banks[0][image[i]]++;
+    }
+    simd_merge_banks(&banks[0][0], 8, histogram);
+}
+
+// GCC 12的avx512fintrin.h在-Wall -O2下会误报 -Wmaybe-uninitialized
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wmaybe-uninitialized"
+
+// 16个32位lane的popcount（只用AVX-512F指令，不依赖VPOPCNTDQ扩展）
+__attribute__((target("avx512f"))) static inline __m512i simd_popcnt_epi32(__m512i x)
+{
+    const __m512i m1 = _mm512_set1_epi32(0x55555555);
+    const __m512i m2 = _mm512_set1_epi32(0x33333333);
+    const __m512i m4 = _mm512_set1_epi32(0x0F0F0F0F);
+    x = _mm512_sub_epi32(x, _mm512_and_si512(_mm512_srli_epi32(x, 1), m1));
+    x = _mm512_add_epi32(_mm512_and_si512(x, m2), _mm512_and_si512(_mm512_srli_epi32(x, 2), m2));
+    x = _mm512_and_si512(_mm512_add_epi32(x, _mm512_srli_epi32(x, 4)), m4);
+    return _mm512_srli_epi32(_mm512_mullo_epi32(x, _mm512_set1_epi32(0x01010101)), 24);
+}
+
+// 16个像素一次gather-add-scatter。VPCONFLICTD给出每个lane之前与它相同的lane掩码，
+// popcount+1就是到该lane为止的出现次数；scatter按lane从低到高写入，
+// 重复地址最终保留最高lane（即完整计数）的结果
+__attribute__((target("avx512f,avx512cd"))) static inline void simd_conflict_update(unsigned int *hist, __m128i pixels)
+{
+    __m512i idx = _mm512_cvtepu8_epi32(pixels);
+    __m512i conflicts = _mm512_conflict_epi32(idx);
+    __m512i counts = _mm512_add_epi32(simd_popcnt_epi32(conflicts), _mm512_set1_epi32(1));
+    __m512i old = _mm512_i32gather_epi32(idx, (const void *)hist, 4);
+    _mm512_i32scatter_epi32((void *)hist, idx, _mm512_add_epi32(old, counts), 4);
+}
+
+// AVX-512：每次64字节，4个16像素的向量分别写入4个bank，打断gather/scatter之间的内存依赖链
+__attribute__((target("avx512f,avx512cd"))) static void compute_histogram_avx512(const unsigned char *image, int size, unsigned int *histogram)
+{
+    unsigned int banks[4][HISTOGRAM_BINS];
+    memset(banks, 0, sizeof(banks));
+
+    int i = 0;
+    for (; i + 64 <= size; i += 64)
+    {
+        __m512i v = _mm512_loadu_si512((const void *)(image + i));
+        simd_conflict_update(banks[0], _mm512_extracti32x4_epi32(v, 0));
+        simd_conflict_update(banks[1], _mm512_extracti32x4_epi32(v, 1));
+        simd_conflict_update(banks[2], _mm512_extracti32x4_epi32(v, 2));
+        simd_conflict_update(banks[3], _mm512_extracti32x4_epi32(v, 3));
+    }
+    for (; i < size; i++)
+    {
+        banks[0][image[i]]++;
+    }
+    simd_merge_banks(&banks[0][0], 4, histogram);
+}
+
+#pragma GCC diagnostic pop
+
+#endif // HIST_SIMD_X86
+
+#ifdef HIST_SIMD_NEON
+
+// NEON（Cortex-A53）：每次加载32字节，按64位lane取出，每个字节统计到对应位置的bank
+static void compute_histogram_neon(const unsigned char *image, int size, unsigned int *histogram)
+{
+    unsigned int banks[8][HISTOGRAM_BINS];
+    memset(banks, 0, sizeof(banks));
+
+    int i = 0;
+    for (; i + 32 <= size; i += 32)
+    {
+        uint64x2_t v0 = vreinterpretq_u64_u8(vld1q_u8(image + i));
+        uint64x2_t v1 = vreinterpretq_u64_u8(vld1q_u8(image + i + 16));
+        SIMD_COUNT_WORD(banks, vgetq_lane_u64(v0, 0));
+        SIMD_COUNT_WORD(banks, vgetq_lane_u64(v0, 1));
+        SIMD_COUNT_WORD(banks, vgetq_lane_u64(v1, 0));
+        SIMD_COUNT_WORD(banks, vgetq_lane_u64(v1, 1));
+    }
+    for (; i < size; i++)
+    {
+        banks[0][image[i]]++;
+    }
+    simd_merge_banks(&banks[0][0], 8, histogram);
+}
+
+#endif // HIST_SIMD_NEON
+
+// 检查当前CPU是否支持某个SIMD级别（且该kernel已编译进二进制）
+static inline int simd_supported(SimdLevel level)
+{
+    switch (level)
+    {
+#ifdef HIST_SIMD_X86
+    case SIMD_AVX2:
+        __builtin_cpu_init();
+        return __builtin_cpu_supports("avx2");
+    case SIMD_AVX512:
+        __builtin_cpu_init();
+        return __builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx512cd");
+#endif
+#ifdef HIST_SIMD_NEON
+    case SIMD_NEON:
+#if defined(__linux__) && defined(__aarch64__)
+        return (getauxval(AT_HWCAP) & HWCAP_ASIMD) != 0;
+#elif defined(__linux__) && defined(HWCAP_NEON)
+        return (getauxval(AT_HWCAP) & HWCAP_NEON) != 0;
+#else
+        return 1; // AArch64上NEON是必备特性
+#endif
+#endif
+    default:
+        return 0;
+    }
+}
+
+static inline histogram_fn simd_kernel_fn(SimdLevel level);
+
+#define SIMD_CALIBRATION_SIZE (1 << 20)
+#define SIMD_CALIBRATION_RUNS 3
+
+// 启动时检测：在CPU支持的kernel中（包括标量fallback）实测1MB数据，返回最快的级别
+// 指令集更宽不一定更快：gather/scatter在很多CPU上慢于按字节lane提取，所以不按优先级硬选
+// 返回SIMD_NONE表示fallback最快；校准数据分配失败时也返回SIMD_NONE
+// 计时用单调时钟（get_time_ms），NTP调整系统时间不会影响选择
+static inline SimdLevel simd_detect_best(histogram_fn fallback)
+{
+    // 校准数据：一半均匀随机，一半长串相同值，兼顾高熵和低熵图像
+    unsigned char *data = (unsigned char *)malloc(SIMD_CALIBRATION_SIZE);
+    if (!data)
+        return SIMD_NONE;
+    unsigned int seed = 2463534242u;
+    for (int i = 0; i < SIMD_CALIBRATION_SIZE; i++)
+    {
+        seed ^= seed << 13;
+        seed ^= seed >> 17;
+        seed ^= seed << 5;
+        data[i] = i < SIMD_CALIBRATION_SIZE / 2 ? (unsigned char)(seed >> 24) : (unsigned char)(i >> 12);
+    }
+
+    unsigned int histogram[HISTOGRAM_BINS];
+    SimdLevel best = SIMD_NONE;
+    double best_time = 0.0;
+    for (int level = SIMD_NONE; level <= SIMD_AVX512; level++)
+    {
+        histogram_fn fn = level == SIMD_NONE ? fallback : simd_kernel_fn((SimdLevel)level);
+        if (!fn)
+            continue;
+
+        fn(data, SIMD_CALIBRATION_SIZE, histogram); // 预热
+        double min_time = 0.0;
+        for (int r = 0; r < SIMD_CALIBRATION_RUNS; r++)
+        {
+            double start = get_time_ms();
+            fn(data, SIMD_CALIBRATION_SIZE, histogram);
+            double elapsed = get_time_ms() - start;
+            if (r == 0 || elapsed < min_time)
+                min_time = elapsed;
+        }
+        if (level == SIMD_NONE || min_time < best_time)
+        {
+            best = (SimdLevel)level;
+            best_time = min_time;
+        }
+    }
+    free(data);
+    return best;
+}
+
+// 返回指定级别的kernel，CPU不支持或未编译时返回NULL
+static inline histogram_fn simd_kernel_fn(SimdLevel level)
+{
+    if (level == SIMD_NONE || !simd_supported(level))
+        return NULL;
+    switch (level)
+    {
+#ifdef HIST_SIMD_X86
+    case SIMD_AVX2:
+        return compute_histogram_avx2;
+    case SIMD_AVX512:
+        return compute_histogram_avx512;
+#endif
+#ifdef HIST_SIMD_NEON
+    case SIMD_NEON:
+        return compute_histogram_neon;
+#endif
+    default:
+        return NULL;
+    }
+}
+
+#endif // HIST_SIMD_H
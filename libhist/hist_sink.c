@@ -0,0 +1,672 @@
+// hist_sink.c
+// libhist：直方图二进制输出文件（只追加，批量写出，可选LZ4压缩）和读取，格式见 hist.h
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include <fcntl.h>
+#ifdef _WIN32
+#include <io.h>
+#else
+#include <sys/types.h>
+#include <sys/uio.h>
+#include <unistd.h>
+#endif
+#ifdef HIST_WITH_LZ4
+#include <lz4.h>
+#endif
+
+#include "hist.h"
+
+#define SINK_DEFAULT_BUFFER (1 << 20)
+#define SINK_MAX_BINS (1 << 24)
+#define SINK_MAX_CHANNELS 64
+
+struct HistSink
+{
+    char path[512];
+    HistSinkConfig config;
+    int fd;
+    size_t payload_bytes;       // 一帧未压缩的payload大小
+    unsigned char *buffer;      // 写缓冲区，攒完整的记录
+    size_t buffer_used;
+    unsigned char *scratch;     // 转成文件中的bin宽度和字节序
+    unsigned char *compressed;  // LZ4输出
+    size_t compressed_capacity;
+    int direct_u32;             // 小端主机上u32文件直接写调用者的数组
+    unsigned long long existing_frames; // 追加前文件中已有的帧数
+    unsigned long long frames;
+    unsigned long long compressed_frames;
+    unsigned long long raw_bytes;  // 不压缩时的记录大小之和
+    unsigned long long file_bytes; // 写入文件（包括还在缓冲区中）的记录大小之和
+    unsigned long long writes;     // write/writev系统调用次数
+    double write_time_ms;
+};
+
+struct HistSinkReader
+{
+    FILE *fp;
+    char path[512];
+    HistSinkConfig header;
+    size_t payload_bytes;
+    unsigned char *payload;
+    unsigned char *raw;
+    unsigned long long offset;    // 下一条记录在文件中的位置
+    unsigned long long file_size; // 打开时的文件大小，用来识别末尾不完整的记录
+};
+
+// 一段要写出的数据（Windows上没有struct iovec）
+typedef struct
+{
+    const void *data;
+    size_t size;
+} SinkChunk;
+
+typedef enum
+{
+    RECORD_END = 0,
+    RECORD_OK = 1,
+    RECORD_TRUNCATED = 2, // 写入中途崩溃留下的半条记录
+    RECORD_BAD = 3        // 记录头和文件头矛盾，文件损坏
+} RecordStatus;
+
+// ===== 小端编码 =====
+
+static void put_u32(unsigned char *p, unsigned int value)
+{
+    for (int i = 0; i < 4; i++)
+    {
+        p[i] = (unsigned char)(value >> (8 * i));
+    }
+}
+
+static void put_u64(unsigned char *p, unsigned long long value)
+{
+    for (int i = 0; i < 8; i++)
+    {
+        p[i] = (unsigned char)(value >> (8 * i));
+    }
+}
+
+static unsigned int get_u32(const unsigned char *p)
+{
+    return (unsigned int)p[0] | ((unsigned int)p[1] << 8) | ((unsigned int)p[2] << 16) | ((unsigned int)p[3] << 24);
+}
+
+static unsigned long long get_u64(const unsigned char *p)
+{
+    return (unsigned long long)get_u32(p) | ((unsigned long long)get_u32(p + 4) << 32);
+}
+
+static int host_little_endian(void)
+{
+    unsigned int one = 1;
+    return *(const unsigned char *)&one == 1;
+}
+
+unsigned long long hist_timestamp_ns(void)
+{
+#if defined(_WIN32) || !defined(CLOCK_REALTIME)
+    struct timeval tv;
+    gettimeofday(&tv, NULL);
+    return (unsigned long long)tv.tv_sec * 1000000000ULL + (unsigned long long)tv.tv_usec * 1000ULL;
+#else
+    struct timespec ts;
+    clock_gettime(CLOCK_REALTIME, &ts);
+    return (unsigned long long)ts.tv_sec * 1000000000ULL + (unsigned long long)ts.tv_nsec;
+#endif
+}
+
+void hist_sink_config_init(HistSinkConfig *config, int num_bins, int channels)
+{
+    memset(config, 0, sizeof(HistSinkConfig));
+    config->num_bins = num_bins;
+    config->channels = channels;
+    config->bin_bytes = 4;
+    config->compress = 0;
+    config->buffer_size = SINK_DEFAULT_BUFFER;
+}
+
+static int config_valid(const HistSinkConfig *config)
+{
+    return config->num_bins > 0 && config->num_bins <= SINK_MAX_BINS && config->channels >= 1 &&
+           config->channels <= SINK_MAX_CHANNELS && (config->bin_bytes == 4 || config->bin_bytes == 8) &&
+           config->width >= 0 && config->height >= 0;
+}
+
+// ===== 读取 =====
+
+int hist_sink_reader_open(HistSinkReader **out, const char *path, HistSinkConfig *header)
+{
+    *out = NULL;
+    FILE *fp = fopen(path, "rb");
+    if (!fp)
+    {
+        fprintf(stderr, "Sink: cannot open %s\n", path);
+        return HIST_ERR_INVALID;
+    }
+    struct stat st;
+    unsigned char bytes[HIST_SINK_HEADER_SIZE];
+    if (stat(path, &st) != 0 || fread(bytes, 1, sizeof(bytes), fp) != sizeof(bytes) ||
+        memcmp(bytes, HIST_SINK_MAGIC, 8) != 0)
+    {
+        fprintf(stderr, "Sink: %s is not a histogram file\n", path);
+        fclose(fp);
+        return HIST_ERR_INVALID;
+    }
+    unsigned int version = get_u32(bytes + 8);
+    unsigned int header_size = get_u32(bytes + 36);
+    if (version != HIST_SINK_VERSION || header_size < HIST_SINK_HEADER_SIZE)
+    {
+        fprintf(stderr, "Sink: %s has unsupported version %u\n", path, version);
+        fclose(fp);
+        return HIST_ERR_UNSUPPORTED;
+    }
+
+    HistSinkReader *reader = (HistSinkReader *)calloc(1, sizeof(HistSinkReader));
+    if (!reader)
+    {
+        fclose(fp);
+        return HIST_ERR_NOMEM;
+    }
+    hist_sink_config_init(&reader->header, (int)get_u32(bytes + 16), (int)get_u32(bytes + 20));
+    reader->header.compress = (get_u32(bytes + 12) & HIST_SINK_RECORD_LZ4) != 0;
+    reader->header.bin_bytes = (int)get_u32(bytes + 24);
+    reader->header.width = (int)get_u32(bytes + 28);
+    reader->header.height = (int)get_u32(bytes + 32);
+    if (!config_valid(&reader->header))
+    {
+        fprintf(stderr, "Sink: %s has a bad header\n", path);
+        fclose(fp);
+        free(reader);
+        return HIST_ERR_INVALID;
+    }
+    // 以后的版本可以加长文件头，多出的部分跳过
+    if (header_size > HIST_SINK_HEADER_SIZE)
+        fseek(fp, (long)header_size, SEEK_SET);
+
+    reader->fp = fp;
+    snprintf(reader->path, sizeof(reader->path), "%s", path);
+    reader->payload_bytes = (size_t)reader->header.num_bins * reader->header.channels * reader->header.bin_bytes;
+    reader->payload = (unsigned char *)malloc(reader->payload_bytes);
+    reader->raw = (unsigned char *)malloc(reader->payload_bytes);
+    reader->offset = header_size;
+    reader->file_size = (unsigned long long)st.st_size;
+    if (!reader->payload || !reader->raw)
+    {
+        hist_sink_reader_close(reader);
+        return HIST_ERR_NOMEM;
+    }
+    if (header)
+        *header = reader->header;
+    *out = reader;
+    return HIST_OK;
+}
+
+// 读取下一条记录的记录头，检查payload是否完整地在文件中
+static RecordStatus read_record_header(HistSinkReader *reader, unsigned long long *frame_id,
+                                       unsigned long long *timestamp_ns, unsigned int *size, unsigned int *flags)
+{
+    if (reader->offset >= reader->file_size)
+        return RECORD_END;
+    unsigned char bytes[HIST_SINK_RECORD_HEADER_SIZE];
+    if (reader->offset + sizeof(bytes) > reader->file_size ||
+        fread(bytes, 1, sizeof(bytes), reader->fp) != sizeof(bytes))
+        return RECORD_TRUNCATED;
+    *frame_id = get_u64(bytes);
+    *timestamp_ns = get_u64(bytes + 8);
+    *size = get_u32(bytes + 16);
+    *flags = get_u32(bytes + 20);
+    // 压缩的记录只有比原始数据小时才会压缩保存
+    if (*size > reader->payload_bytes || (!(*flags & HIST_SINK_RECORD_LZ4) && *size != reader->payload_bytes))
+        return RECORD_BAD;
+    if (reader->offset + sizeof(bytes) + *size > reader->file_size)
+        return RECORD_TRUNCATED;
+    return RECORD_OK;
+}
+
+int hist_sink_reader_next(HistSinkReader *reader, unsigned long long *frame_id, unsigned long long *timestamp_ns,
+                          unsigned long long *bins)
+{
+    unsigned long long id = 0, timestamp = 0;
+    unsigned int size = 0, flags = 0;
+    RecordStatus status = read_record_header(reader, &id, &timestamp, &size, &flags);
+    if (status == RECORD_END)
+        return 0;
+    if (status == RECORD_OK && fread(reader->payload, 1, size, reader->fp) != size)
+        status = RECORD_TRUNCATED;
+    if (status != RECORD_OK)
+    {
+        fprintf(stderr, "Sink: %s: %s record at offset %llu\n", reader->path,
+                status == RECORD_TRUNCATED ? "truncated" : "bad", reader->offset);
+        return HIST_ERR_INVALID;
+    }
+
+    const unsigned char *raw = reader->payload;
+    if (flags & HIST_SINK_RECORD_LZ4)
+    {
+#ifdef HIST_WITH_LZ4
+        int unpacked = LZ4_decompress_safe((const char *)reader->payload, (char *)reader->raw, (int)size,
+                                           (int)reader->payload_bytes);
+        if (unpacked != (int)reader->payload_bytes)
+        {
+            fprintf(stderr, "Sink: %s: bad LZ4 record at offset %llu\n", reader->path, reader->offset);
+            return HIST_ERR_INVALID;
+        }
+        raw = reader->raw;
+#else
+        fprintf(stderr, "Sink: %s has LZ4-compressed records, rebuild with -DHIST_WITH_LZ4\n", reader->path);
+        return HIST_ERR_UNSUPPORTED;
+#endif
+    }
+
+    int count = reader->header.num_bins * reader->header.channels;
+    for (int i = 0; i < count; i++)
+    {
+        bins[i] = reader->header.bin_bytes == 4 ? get_u32(raw + 4 * (size_t)i) : get_u64(raw + 8 * (size_t)i);
+    }
+    if (frame_id)
+        *frame_id = id;
+    if (timestamp_ns)
+        *timestamp_ns = timestamp;
+    reader->offset += HIST_SINK_RECORD_HEADER_SIZE + size;
+    return 1;
+}
+
+void hist_sink_reader_close(HistSinkReader *reader)
+{
+    if (!reader)
+        return;
+    if (reader->fp)
+        fclose(reader->fp);
+    free(reader->payload);
+    free(reader->raw);
+    free(reader);
+}
+
+// ===== 写入 =====
+
+// 追加前扫描已有的文件：文件头必须和config一致，返回最后一条完整记录之后的位置
+static int scan_existing(const char *path, const HistSinkConfig *config, unsigned long long *end,
+                         unsigned long long *frames)
+{
+    HistSinkReader *reader = NULL;
+    HistSinkConfig header;
+    int status = hist_sink_reader_open(&reader, path, &header);
+    if (status != HIST_OK)
+        return status;
+    if (header.num_bins != config->num_bins || header.channels != config->channels ||
+        header.bin_bytes != config->bin_bytes ||
+        (config->width > 0 && header.width > 0 && (header.width != config->width || header.height != config->height)))
+    {
+        fprintf(stderr, "Sink: cannot append to %s: it holds %d bins x%d (u%d, %dx%d)\n", path, header.num_bins,
+                header.channels, header.bin_bytes * 8, header.width, header.height);
+        hist_sink_reader_close(reader);
+        return HIST_ERR_INVALID;
+    }
+
+    unsigned long long id, timestamp;
+    unsigned int size, flags;
+    RecordStatus record;
+    *frames = 0;
+    while ((record = read_record_header(reader, &id, &timestamp, &size, &flags)) == RECORD_OK)
+    {
+        fseek(reader->fp, (long)size, SEEK_CUR);
+        reader->offset += HIST_SINK_RECORD_HEADER_SIZE + size;
+        (*frames)++;
+    }
+    *end = reader->offset;
+    if (record == RECORD_BAD)
+    {
+        // 损坏的记录之后可能还有数据，不能截掉
+        fprintf(stderr, "Sink: cannot append to %s: bad record at offset %llu\n", path, reader->offset);
+        hist_sink_reader_close(reader);
+        return HIST_ERR_INVALID;
+    }
+    if (record == RECORD_TRUNCATED)
+    {
+        fprintf(stderr, "Sink: dropping %llu bytes of an incomplete record at the end of %s\n",
+                reader->file_size - reader->offset, path);
+    }
+    hist_sink_reader_close(reader);
+    return HIST_OK;
+}
+
+// 写出全部数据（处理部分写入），POSIX上一次writev
+static int write_chunks(HistSink *sink, SinkChunk *chunks, int count)
+{
+    double start = get_time_ms();
+#ifdef _WIN32
+    for (int i = 0; i < count; i++)
+    {
+        const char *data = (const char *)chunks[i].data;
+        size_t left = chunks[i].size;
+        while (left > 0)
+        {
+            unsigned int size = left > (1u << 30) ? (1u << 30) : (unsigned int)left;
+            int written = _write(sink->fd, data, size);
+            if (written <= 0)
+            {
+                fprintf(stderr, "Sink: write to %s failed: %s\n", sink->path, strerror(errno));
+                return HIST_ERR_BACKEND;
+            }
+            sink->writes++;
+            data += written;
+            left -= (size_t)written;
+        }
+    }
+#else
+    struct iovec iov[4];
+    int used = 0;
+    for (int i = 0; i < count && used < 4; i++)
+    {
+        if (chunks[i].size == 0)
+            continue;
+        iov[used].iov_base = (void *)chunks[i].data;
+        iov[used].iov_len = chunks[i].size;
+        used++;
+    }
+    int first = 0;
+    while (first < used)
+    {
+        ssize_t written = writev(sink->fd, iov + first, used - first);
+        if (written < 0)
+        {
+            if (errno == EINTR)
+                continue;
+            fprintf(stderr, "Sink: write to %s failed: %s\n", sink->path, strerror(errno));
+            return HIST_ERR_BACKEND;
+        }
+        sink->writes++;
+        // 部分写入：跳过已经写完的段，从剩下的位置继续
+        while (first < used && (size_t)written >= iov[first].iov_len)
+        {
+            written -= (ssize_t)iov[first].iov_len;
+            first++;
+        }
+        if (first < used)
+        {
+            iov[first].iov_base = (char *)iov[first].iov_base + written;
+            iov[first].iov_len -= (size_t)written;
+        }
+    }
+#endif
+    sink->write_time_ms += get_time_ms() - start;
+    return HIST_OK;
+}
+
+// 打开文件并定位到追加位置，新文件写入文件头
+static int open_file(HistSink *sink, const char *path)
+{
+    struct stat st;
+    unsigned long long end = 0;
+    int exists = stat(path, &st) == 0 && st.st_size > 0;
+    if (exists)
+    {
+        int status = scan_existing(path, &sink->config, &end, &sink->existing_frames);
+        if (status != HIST_OK)
+            return status;
+    }
+
+#ifdef _WIN32
+    sink->fd = _open(path, _O_RDWR | _O_CREAT | _O_BINARY, _S_IREAD | _S_IWRITE);
+#else
+    sink->fd = open(path, O_RDWR | O_CREAT, 0644);
+#endif
+    if (sink->fd < 0)
+    {
+        fprintf(stderr, "Sink: cannot open %s: %s\n", path, strerror(errno));
+        return HIST_ERR_INVALID;
+    }
+    if (exists)
+    {
+        // 截掉末尾不完整的记录，之后的写入从最后一条完整记录后面开始
+#ifdef _WIN32
+        int failed = (unsigned long long)st.st_size > end && _chsize_s(sink->fd, (long long)end) != 0;
+        failed = failed || _lseeki64(sink->fd, (long long)end, SEEK_SET) < 0;
+#else
+        int failed = (unsigned long long)st.st_size > end && ftruncate(sink->fd, (off_t)end) != 0;
+        failed = failed || lseek(sink->fd, (off_t)end, SEEK_SET) < 0;
+#endif
+        if (failed)
+        {
+            fprintf(stderr, "Sink: cannot seek in %s: %s\n", path, strerror(errno));
+            return HIST_ERR_INVALID;
+        }
+        return HIST_OK;
+    }
+
+    unsigned char header[HIST_SINK_HEADER_SIZE];
+    memcpy(header, HIST_SINK_MAGIC, 8);
+    put_u32(header + 8, HIST_SINK_VERSION);
+    put_u32(header + 12, sink->config.compress ? HIST_SINK_RECORD_LZ4 : 0);
+    put_u32(header + 16, (unsigned int)sink->config.num_bins);
+    put_u32(header + 20, (unsigned int)sink->config.channels);
+    put_u32(header + 24, (unsigned int)sink->config.bin_bytes);
+    put_u32(header + 28, (unsigned int)sink->config.width);
+    put_u32(header + 32, (unsigned int)sink->config.height);
+    put_u32(header + 36, HIST_SINK_HEADER_SIZE);
+    SinkChunk chunk = {header, sizeof(header)};
+    return write_chunks(sink, &chunk, 1);
+}
+
+int hist_sink_open(HistSink **out, const char *path, const HistSinkConfig *config)
+{
+    *out = NULL;
+    if (!path || !config_valid(config))
+    {
+        fprintf(stderr, "Sink: invalid configuration\n");
+        return HIST_ERR_INVALID;
+    }
+#ifndef HIST_WITH_LZ4
+    if (config->compress)
+    {
+        fprintf(stderr, "Sink: LZ4 compression needs a build with -DHIST_WITH_LZ4 -llz4\n");
+        return HIST_ERR_UNSUPPORTED;
+    }
+#endif
+
+    HistSink *sink = (HistSink *)calloc(1, sizeof(HistSink));
+    if (!sink)
+        return HIST_ERR_NOMEM;
+    sink->fd = -1;
+    sink->config = *config;
+    if (sink->config.buffer_size == 0)
+        sink->config.buffer_size = SINK_DEFAULT_BUFFER;
+    snprintf(sink->path, sizeof(sink->path), "%s", path);
+    sink->payload_bytes = (size_t)config->num_bins * config->channels * config->bin_bytes;
+    sink->direct_u32 = config->bin_bytes == 4 && host_little_endian();
+    sink->buffer = (unsigned char *)malloc(sink->config.buffer_size);
+    sink->scratch = (unsigned char *)malloc(sink->payload_bytes);
+    int ok = sink->buffer && sink->scratch;
+#ifdef HIST_WITH_LZ4
+    if (config->compress)
+    {
+        sink->compressed_capacity = (size_t)LZ4_compressBound((int)sink->payload_bytes);
+        sink->compressed = (unsigned char *)malloc(sink->compressed_capacity);
+        ok = ok && sink->compressed;
+    }
+#endif
+    if (!ok)
+    {
+        hist_sink_close(sink);
+        return HIST_ERR_NOMEM;
+    }
+
+    int status = open_file(sink, path);
+    if (status != HIST_OK)
+    {
+        hist_sink_close(sink);
+        return status;
+    }
+    *out = sink;
+    return HIST_OK;
+}
+
+int hist_sink_open_spec(HistSink **out, const char *spec, int num_bins, int channels, int width, int height)
+{
+    *out = NULL;
+    if (!spec)
+        spec = getenv("HIST_SINK");
+    if (!spec || spec[0] == '\0')
+        return HIST_OK;
+
+    HistSinkConfig config;
+    hist_sink_config_init(&config, num_bins, channels);
+    config.width = width;
+    config.height = height;
+
+    // 从末尾剥掉选项，不认识的后缀属于路径（例如Windows的盘符）
+    char path[512];
+    snprintf(path, sizeof(path), "%s", spec);
+    char *colon;
+    while ((colon = strrchr(path, ':')) != NULL)
+    {
+        if (strcmp(colon + 1, "lz4") == 0)
+            config.compress = 1;
+        else if (strcmp(colon + 1, "u64") == 0)
+            config.bin_bytes = 8;
+        else
+            break;
+        *colon = '\0';
+    }
+    return hist_sink_open(out, path, &config);
+}
+
+int hist_sink_flush(HistSink *sink)
+{
+    if (sink->buffer_used == 0)
+        return HIST_OK;
+    SinkChunk chunk = {sink->buffer, sink->buffer_used};
+    sink->buffer_used = 0;
+    return write_chunks(sink, &chunk, 1);
+}
+
+// 追加一条记录，payload已经是文件中的bin宽度和字节序
+static int append_record(HistSink *sink, unsigned long long frame_id, unsigned long long timestamp_ns,
+                         const unsigned char *payload)
+{
+    const unsigned char *data = payload;
+    size_t size = sink->payload_bytes;
+    unsigned int flags = 0;
+#ifdef HIST_WITH_LZ4
+    if (sink->config.compress)
+    {
+        int packed = LZ4_compress_default((const char *)payload, (char *)sink->compressed, (int)size,
+                                          (int)sink->compressed_capacity);
+        // 压缩后不更小（例如bin值接近随机）时原样保存
+        if (packed > 0 && (size_t)packed < size)
+        {
+            data = sink->compressed;
+            size = (size_t)packed;
+            flags |= HIST_SINK_RECORD_LZ4;
+            sink->compressed_frames++;
+        }
+    }
+#endif
+
+    unsigned char header[HIST_SINK_RECORD_HEADER_SIZE];
+    put_u64(header, frame_id);
+    put_u64(header + 8, timestamp_ns ? timestamp_ns : hist_timestamp_ns());
+    put_u32(header + 16, (unsigned int)size);
+    put_u32(header + 20, flags);
+    size_t record = sizeof(header) + size;
+    sink->frames++;
+    sink->raw_bytes += sizeof(header) + sink->payload_bytes;
+    sink->file_bytes += record;
+
+    if (record <= sink->config.buffer_size / 2)
+    {
+        if (sink->buffer_used + record > sink->config.buffer_size)
+        {
+            int status = hist_sink_flush(sink);
+            if (status != HIST_OK)
+                return status;
+        }
+        memcpy(sink->buffer + sink->buffer_used, header, sizeof(header));
+        memcpy(sink->buffer + sink->buffer_used + sizeof(header), data, size);
+        sink->buffer_used += record;
+        return HIST_OK;
+    }
+
+    // 大记录（例如65536个u64 bin）不复制进缓冲区，和缓冲区中攒下的记录一次写出
+    SinkChunk chunks[3] = {{sink->buffer, sink->buffer_used}, {header, sizeof(header)}, {data, size}};
+    sink->buffer_used = 0;
+    return write_chunks(sink, chunks, 3);
+}
+
+int hist_sink_write(HistSink *sink, unsigned long long frame_id, unsigned long long timestamp_ns,
+                    const unsigned int *histogram)
+{
+    if (sink->direct_u32)
+        return append_record(sink, frame_id, timestamp_ns, (const unsigned char *)histogram);
+
+    int count = sink->config.num_bins * sink->config.channels;
+    for (int i = 0; i < count; i++)
+    {
+        if (sink->config.bin_bytes == 4)
+            put_u32(sink->scratch + 4 * (size_t)i, histogram[i]);
+        else
+            put_u64(sink->scratch + 8 * (size_t)i, histogram[i]);
+    }
+    return append_record(sink, frame_id, timestamp_ns, sink->scratch);
+}
+
+int hist_sink_write_u64(HistSink *sink, unsigned long long frame_id, unsigned long long timestamp_ns,
+                        const unsigned long long *histogram)
+{
+    int count = sink->config.num_bins * sink->config.channels;
+    for (int i = 0; i < count; i++)
+    {
+        if (sink->config.bin_bytes == 8)
+        {
+            put_u64(sink->scratch + 8 * (size_t)i, histogram[i]);
+            continue;
+        }
+        if (histogram[i] > 0xFFFFFFFFULL)
+        {
+            fprintf(stderr, "Sink: bin %d of frame %llu does not fit in u32, use a u64 sink\n", i, frame_id);
+            return HIST_ERR_INVALID;
+        }
+        put_u32(sink->scratch + 4 * (size_t)i, (unsigned int)histogram[i]);
+    }
+    return append_record(sink, frame_id, timestamp_ns, sink->scratch);
+}
+
+int hist_sink_close(HistSink *sink)
+{
+    if (!sink)
+        return HIST_OK;
+    int status = HIST_OK;
+    if (sink->fd >= 0)
+    {
+        status = hist_sink_flush(sink);
+#ifdef _WIN32
+        _close(sink->fd);
+#else
+        close(sink->fd);
+#endif
+    }
+    free(sink->buffer);
+    free(sink->scratch);
+    free(sink->compressed);
+    free(sink);
+    return status;
+}
+
+void hist_sink_describe(const HistSink *sink, char *buffer, size_t size)
+{
+    char channels[32] = "";
+    char appended[64] = "";
+    if (sink->config.channels > 1)
+        snprintf(channels, sizeof(channels), " x%d", sink->config.channels);
+    if (sink->existing_frames > 0)
+        snprintf(appended, sizeof(appended), ", after %llu frames", sink->existing_frames);
+    snprintf(buffer, size, "%s (%d bins%s, u%d%s%s): %llu frames, %.2f MB -> %.2f MB, %.1f ms in %llu writes",
+             sink->path, sink->config.num_bins, channels, sink->config.bin_bytes * 8,
+             sink->config.compress ? ", lz4" : "", appended, sink->frames, sink->raw_bytes / 1e6,
+             sink->file_bytes / 1e6, sink->write_time_ms, sink->writes);
+}
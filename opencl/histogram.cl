@@ -1,7 +1,19 @@
 // histogram_kernel.cl
 // Multiple optimized kernels for histogram computation
+// 主机端按名字创建kernel，8位kernel的编号（HIST_CL_*_KERNEL）见 libhist/hist.h
 
-// Kernel 5: 高性能版本 - 结合所有优化技术
+// 可调参数：默认值是手工调出来的，自动调优（--autotune）会通过 -D 编译选项覆盖
+#ifndef LOCAL_PIXELS_PER_ITEM
+#define LOCAL_PIXELS_PER_ITEM 4 // histogram_local每个work-item处理的像素数
+#endif
+#ifndef ULTRA_MIN_PIXELS
+#define ULTRA_MIN_PIXELS 8 // histogram_ultra每个work-item处理的像素数下限
+#endif
+#ifndef ULTRA_MAX_PIXELS
+#define ULTRA_MAX_PIXELS 32 // histogram_ultra每个work-item处理的像素数上限
+#endif
+
+// histogram_ultra：高性能版本 - 结合所有优化技术
 __kernel void histogram_ultra(
     __global unsigned char *image,
     __global unsigned int *histogram,
@@ -25,8 +37,8 @@ __kernel void histogram_ultra(
     
     // 优化：每个workitem处理更多像素（自适应）
     int pixels_per_item = (image_size + total_workitems - 1) / total_workitems;
-    if (pixels_per_item < 8) pixels_per_item = 8;
-    if (pixels_per_item > 32) pixels_per_item = 32; // 最多32个像素
+    if (pixels_per_item < ULTRA_MIN_PIXELS) pixels_per_item = ULTRA_MIN_PIXELS;
+    if (pixels_per_item > ULTRA_MAX_PIXELS) pixels_per_item = ULTRA_MAX_PIXELS; // 主机保证global size足够覆盖
     
     int start_pixel = gid * pixels_per_item;
     int end_pixel = min(start_pixel + pixels_per_item, image_size);
@@ -60,7 +72,7 @@ __kernel void histogram_ultra(
 // histogram_kernel.cl
 // Multiple optimized kernels for histogram computation
 
-// Kernel 1: Naive版本（最简单，使用atomic操作）
+// histogram_naive：Naive版本（最简单，使用atomic操作）
 __kernel void histogram_naive(
     __global unsigned char *image,
     __global unsigned int *histogram,
@@ -74,7 +86,7 @@ __kernel void histogram_naive(
     }
 }
 
-// Kernel 2: Local Memory优化版本（减少global memory竞争）- 优化版本
+// histogram_local：Local Memory优化版本（减少global memory竞争）- 优化版本
 __kernel void histogram_local(
     __global unsigned char *image,
     __global unsigned int *histogram,
@@ -97,8 +109,8 @@ __kernel void histogram_local(
     barrier(CLK_LOCAL_MEM_FENCE);
     
     // 优化：每个work-item处理多个像素，提高内存访问效率
-    // 固定处理4个像素（经过测试，这是最优配置）
-    int pixels_per_item = 4;
+    // 默认4个像素（手工测试的最优值），可由自动调优修改
+    int pixels_per_item = LOCAL_PIXELS_PER_ITEM;
     int start_pixel = gid * pixels_per_item;
     int end_pixel = min(start_pixel + pixels_per_item, image_size);
     
@@ -119,7 +131,7 @@ __kernel void histogram_local(
     }
 }
 
-// Kernel 3: Private Histogram优化（每个work-item私有直方图）- 优化版本
+// histogram_private：Private Histogram优化（每个work-item私有直方图）- 优化版本
 __kernel void histogram_private(
     __global unsigned char *image,
     __global unsigned int *histogram,
@@ -167,7 +179,7 @@ __kernel void histogram_private(
     }
 }
 
-// Kernel 4: Vectorized版本（使用uchar4向量化加载）- 优化版本
+// histogram_vectorized：Vectorized版本（使用uchar4向量化加载）- 优化版本
 __kernel void histogram_vectorized(
     __global uchar4 *image,
     __global unsigned int *histogram,
@@ -217,4 +229,275 @@ __kernel void histogram_vectorized(
             atomic_add(&histogram[i], local_hist[i]);
         }
     }
-}
\ No newline at end of file
+}
+
+// histogram_clear：设备端清零（替代每次迭代主机写入1KB的zeros）
+__kernel void histogram_clear(
+    __global unsigned int *histogram,
+    int count)
+{
+    int gid = get_global_id(0);
+    if (gid < count) {
+        histogram[gid] = 0;
+    }
+}
+
+// histogram_batched：批处理版本 - 一次launch统计多帧
+// 2D NDRange：维度0是帧内的tile（每个work-group一个tile），维度1是帧号
+// 帧在frames中连续存放（间隔frame_stride字节），每帧输出一份直方图到histograms[frame * 256]
+// 输出需要先用histogram_clear清零
+__kernel void histogram_batched(
+    __global unsigned char *frames,
+    __global unsigned int *histograms,
+    int frame_size,
+    __local unsigned int *local_hist,
+    int frame_stride)
+{
+    int frame = get_global_id(1);
+    int lid = get_local_id(0);
+    int local_size = get_local_size(0);
+
+    for (int i = lid; i < 256; i += local_size) {
+        local_hist[i] = 0;
+    }
+    barrier(CLK_LOCAL_MEM_FENCE);
+
+    // 同一帧的所有tile按global size跨步读取，相邻work-item访问相邻像素（合并访存）
+    __global unsigned char *image = frames + (size_t)frame * frame_stride;
+    int stride = get_global_size(0);
+    for (int idx = get_global_id(0); idx < frame_size; idx += stride) {
+        atomic_inc(&local_hist[image[idx]]);
+    }
+    barrier(CLK_LOCAL_MEM_FENCE);
+
+    __global unsigned int *histogram = histograms + frame * 256;
+    for (int i = lid; i < 256; i += local_size) {
+        if (local_hist[i] > 0) {
+            atomic_add(&histogram[i], local_hist[i]);
+        }
+    }
+}
+
+// histogram_replicated：多副本local直方图 + 合并访存版本
+// 每个work-group有num_replicas份local直方图，lane按 lid % num_replicas 轮流使用，
+// 相邻像素落在同一bin时（渐变图像）原子操作分散到不同副本，减少local atomic冲突
+// 像素按uchar16读取，grid-stride循环：相邻work-item读相邻的16字节，访存可以合并
+#define REPLICA_STRIDE 257 // 每份副本多留1个uint，错开不同副本同一bin所在的bank（与主机代码一致）
+__kernel void histogram_replicated(
+    __global const unsigned char *image,
+    __global unsigned int *histogram,
+    int image_size,
+    __local unsigned int *local_hist,
+    int num_replicas)
+{
+    int gid = get_global_id(0);
+    int lid = get_local_id(0);
+    int local_size = get_local_size(0);
+    int global_size = get_global_size(0);
+
+    for (int i = lid; i < num_replicas * REPLICA_STRIDE; i += local_size) {
+        local_hist[i] = 0;
+    }
+    barrier(CLK_LOCAL_MEM_FENCE);
+
+    __local unsigned int *my_hist = local_hist + (lid % num_replicas) * REPLICA_STRIDE;
+    int num_vectors = image_size / 16;
+    for (int v = gid; v < num_vectors; v += global_size) {
+        uchar16 p = vload16(v, image);
+        atomic_inc(&my_hist[p.s0]);
+        atomic_inc(&my_hist[p.s1]);
+        atomic_inc(&my_hist[p.s2]);
+        atomic_inc(&my_hist[p.s3]);
+        atomic_inc(&my_hist[p.s4]);
+        atomic_inc(&my_hist[p.s5]);
+        atomic_inc(&my_hist[p.s6]);
+        atomic_inc(&my_hist[p.s7]);
+        atomic_inc(&my_hist[p.s8]);
+        atomic_inc(&my_hist[p.s9]);
+        atomic_inc(&my_hist[p.sa]);
+        atomic_inc(&my_hist[p.sb]);
+        atomic_inc(&my_hist[p.sc]);
+        atomic_inc(&my_hist[p.sd]);
+        atomic_inc(&my_hist[p.se]);
+        atomic_inc(&my_hist[p.sf]);
+    }
+    // 不足16字节的尾部
+    for (int idx = num_vectors * 16 + gid; idx < image_size; idx += global_size) {
+        atomic_inc(&my_hist[image[idx]]);
+    }
+    barrier(CLK_LOCAL_MEM_FENCE);
+
+    // 各副本相加后合并到global
+    for (int i = lid; i < 256; i += local_size) {
+        unsigned int sum = 0;
+        for (int r = 0; r < num_replicas; r++) {
+            sum += local_hist[r * REPLICA_STRIDE + i];
+        }
+        if (sum > 0) {
+            atomic_add(&histogram[i], sum);
+        }
+    }
+}
+
+// histogram_channels：多通道直方图（交错存储的RGB/RGBA）
+// 每个通道一份local直方图（local_hist[c * 256 + bin]），一次遍历统计所有通道，主机不需要先拆分通道
+// image_size为像素数；RGBA按uchar4读取，其他通道数逐字节读取；grid-stride循环，work-group数只需要填满设备
+__kernel void histogram_channels(
+    __global const unsigned char *image,
+    __global unsigned int *histogram,
+    int image_size,
+    __local unsigned int *local_hist,
+    int channels)
+{
+    int gid = get_global_id(0);
+    int lid = get_local_id(0);
+    int local_size = get_local_size(0);
+    int global_size = get_global_size(0);
+    int num_bins = channels * 256;
+
+    for (int i = lid; i < num_bins; i += local_size) {
+        local_hist[i] = 0;
+    }
+    barrier(CLK_LOCAL_MEM_FENCE);
+
+    if (channels == 4) {
+        for (int p = gid; p < image_size; p += global_size) {
+            uchar4 px = vload4(p, image);
+            atomic_inc(&local_hist[px.x]);
+            atomic_inc(&local_hist[256 + px.y]);
+            atomic_inc(&local_hist[512 + px.z]);
+            atomic_inc(&local_hist[768 + px.w]);
+        }
+    } else {
+        for (int p = gid; p < image_size; p += global_size) {
+            __global const unsigned char *px = image + p * channels;
+            for (int c = 0; c < channels; c++) {
+                atomic_inc(&local_hist[c * 256 + px[c]]);
+            }
+        }
+    }
+    barrier(CLK_LOCAL_MEM_FENCE);
+
+    for (int i = lid; i < num_bins; i += local_size) {
+        if (local_hist[i] > 0) {
+            atomic_add(&histogram[i], local_hist[i]);
+        }
+    }
+}
+
+// histogram_wide_global / histogram_wide_partitioned：高位深直方图（10/12/16位像素，每个像素一个ushort）
+// bin = (pixel & pixel_mask) >> bin_shift，16位全分辨率时有65536个bin（256KB），放不进local memory
+
+// global atomic版本：每个像素直接对global直方图做一次atomic_inc，bin很多时冲突很少，但每次都要访问global memory
+__kernel void histogram_wide_global(
+    __global const unsigned short *image,
+    __global unsigned int *histogram,
+    int num_pixels,
+    unsigned int pixel_mask,
+    int bin_shift)
+{
+    int gid = get_global_id(0);
+    int global_size = get_global_size(0);
+
+    for (int p = gid; p < num_pixels; p += global_size) {
+        atomic_inc(&histogram[(image[p] & pixel_mask) >> bin_shift]);
+    }
+}
+
+// bin分区版本：2D NDRange，维度1是bin分区号，每个work-group只统计 [分区 * partition_bins, +partition_bins) 的bin，
+// 分区的local直方图放得进local memory；同一个分区的work-group按grid-stride读整幅图像，不属于本分区的像素跳过
+// 图像被读 分区数 遍（读取是合并访存，多遍之间大多命中L2），换来所有原子操作都在local memory里
+__kernel void histogram_wide_partitioned(
+    __global const unsigned short *image,
+    __global unsigned int *histogram,
+    int num_pixels,
+    unsigned int pixel_mask,
+    int bin_shift,
+    __local unsigned int *local_hist,
+    int partition_bins)
+{
+    int gid = get_global_id(0);
+    int lid = get_local_id(0);
+    int local_size = get_local_size(0);
+    int global_size = get_global_size(0);
+    unsigned int lo = get_group_id(1) * partition_bins;
+
+    for (int i = lid; i < partition_bins; i += local_size) {
+        local_hist[i] = 0;
+    }
+    barrier(CLK_LOCAL_MEM_FENCE);
+
+    for (int p = gid; p < num_pixels; p += global_size) {
+        unsigned int offset = ((image[p] & pixel_mask) >> bin_shift) - lo;
+        if (offset < (unsigned int)partition_bins) {
+            atomic_inc(&local_hist[offset]);
+        }
+    }
+    barrier(CLK_LOCAL_MEM_FENCE);
+
+    for (int i = lid; i < partition_bins; i += local_size) {
+        if (local_hist[i] > 0) {
+            atomic_add(&histogram[lo + i], local_hist[i]);
+        }
+    }
+}
+
+// histogram_tiled：分块直方图（tiles_x * tiles_y 个块，每块 num_bins = 256 >> bin_shift 个bin）
+// 2D NDRange，维度1是块行；维度0的每个work-group负责这一行块中连续的tiles_per_group个块，
+// 这些块的直方图放在local memory里，work-group逐行读取自己那一段像素（相邻work-item读相邻像素，合并访存）
+// 每个块只属于一个work-group，直接写出不需要global atomic；整帧直方图是各块直方图之和，
+// 每个work-group把自己的块按bin相加后atomic_add一次（histogram需要先清零）
+__kernel void histogram_tiled(
+    __global const unsigned char *image,
+    __global unsigned int *tiles,
+    __global unsigned int *histogram,
+    int width,
+    int height,
+    int stride,
+    int tile_width,
+    int tile_height,
+    int tiles_per_group,
+    int bin_shift,
+    __local unsigned int *local_tiles)
+{
+    int lid = get_local_id(0);
+    int local_size = get_local_size(0);
+    int num_bins = 256 >> bin_shift;
+    int tiles_x = (width + tile_width - 1) / tile_width;
+    int tile_x0 = get_group_id(0) * tiles_per_group;
+    int tile_y = get_global_id(1);
+    int group_tiles = min(tiles_per_group, tiles_x - tile_x0);
+    int x0 = tile_x0 * tile_width;
+    int span = min(group_tiles * tile_width, width - x0);
+    int y0 = tile_y * tile_height;
+    int y1 = min(y0 + tile_height, height);
+    int group_bins = group_tiles * num_bins;
+
+    for (int i = lid; i < group_bins; i += local_size) {
+        local_tiles[i] = 0;
+    }
+    barrier(CLK_LOCAL_MEM_FENCE);
+
+    for (int y = y0; y < y1; y++) {
+        __global const unsigned char *row = image + (size_t)y * stride + x0;
+        for (int x = lid; x < span; x += local_size) {
+            atomic_inc(&local_tiles[(x / tile_width) * num_bins + (row[x] >> bin_shift)]);
+        }
+    }
+    barrier(CLK_LOCAL_MEM_FENCE);
+
+    // 这一组块在tiles中是连续的
+    __global unsigned int *out = tiles + ((size_t)tile_y * tiles_x + tile_x0) * num_bins;
+    for (int i = lid; i < group_bins; i += local_size) {
+        out[i] = local_tiles[i];
+    }
+    for (int b = lid; b < num_bins; b += local_size) {
+        unsigned int sum = 0;
+        for (int t = 0; t < group_tiles; t++) {
+            sum += local_tiles[t * num_bins + b];
+        }
+        if (sum > 0) {
+            atomic_add(&histogram[b], sum);
+        }
+    }
+}
@@ -1,68 +1,8 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
-#include <time.h>
-#include <sys/time.h>
 
-#ifdef __APPLE__
-#include <OpenCL/opencl.h>
-#else
-#include <CL/cl.h>
-#endif
-
-#define HISTOGRAM_BINS 256
-#define MAX_SOURCE_SIZE (0x100000)
-
-typedef struct
-{
-    unsigned char *data;
-    int width;
-    int height;
-    int channels;
-} Image;
-
-// 生成测试图像
-Image *create_test_image(int width, int height)
-{
-    Image *img = (Image *)malloc(sizeof(Image));
-    img->width = width;
-    img->height = height;
-    img->channels = 1;
-    img->data = (unsigned char *)malloc(width * height);
-
-    for (int i = 0; i < height; i++)
-    {
-        for (int j = 0; j < width; j++)
-        {
-            img->data[i * width + j] = (i * 13 + j * 7) % 256;
-        }
-    }
-    return img;
-}
-
-// 计时函数
-double get_time_ms()
-{
-    struct timeval tv;
-    gettimeofday(&tv, NULL);
-    return tv.tv_sec * 1000.0 + tv.tv_usec / 1000.0;
-}
-
-// 读取kernel文件
-char *read_kernel_source(const char *filename)
-{
-    FILE *fp = fopen(filename, "r");
-    if (!fp)
-    {
-        fprintf(stderr, "Failed to load kernel file: %s\n", filename);
-        exit(1);
-    }
-    char *source_str = (char *)malloc(MAX_SOURCE_SIZE);
-    size_t source_size = fread(source_str, 1, MAX_SOURCE_SIZE, fp);
-    source_str[source_size] = '\0';
-    fclose(fp);
-    return source_str;
-}
+#include "hist.h"
 
 // 检查OpenCL错误
 void check_error(cl_int err, const char *operation)
@@ -74,65 +14,28 @@ void check_error(cl_int err, const char *operation)
     }
 }
 
-// 打印进度条
-void print_progress(int current, int total, double elapsed_time)
-{
-    int barWidth = 50;
-    float progress = (float)current / total;
-
-    printf("\r[");
-    int pos = barWidth * progress;
-    for (int i = 0; i < barWidth; ++i)
-    {
-        if (i < pos)
-            printf("=");
-        else if (i == pos)
-            printf(">");
-        else
-            printf(" ");
-    }
-    printf("] %d/%d (%.1f%%) - %.2fs elapsed",
-           current, total, progress * 100.0, elapsed_time / 1000.0);
-    fflush(stdout);
-}
-
-// 创建加速比对比文件
+// 创建加速比对比文件：只有output/histogram_cpu.txt记录的图像大小和迭代次数与本次相同时才计算加速比，
+// 否则说明两次测量不可比。需要可靠的对比（重复试验、置信区间、相同的输入和线程绑定）时使用histogram_bench
 void create_speedup_file(double gpu_time, int width, int height, int iterations, const char *kernel_name, double throughput)
 {
-    // 读取CPU执行时间
+    // 读取CPU执行时间和对应的测试配置
     FILE *cpu_fp = fopen("output/histogram_cpu.txt", "r");
     double cpu_time = 0.0;
-    double cpu_time_measured = 0.0;
+    int cpu_width = 0;
+    int cpu_height = 0;
+    int cpu_iterations = 0;
     if (cpu_fp)
     {
         char line[256];
-        while (fgets(line, sizeof(line), cpu_fp))
+        while (fgets(line, sizeof(line), cpu_fp) && line[0] == '#')
         {
-            if (strstr(line, "Total execution time:"))
-            {
-                sscanf(line, "# Total execution time: %lf ms", &cpu_time_measured);
-                break;
-            }
+            sscanf(line, "# Image size: %dx%d", &cpu_width, &cpu_height);
+            sscanf(line, "# Iterations: %d", &cpu_iterations);
+            sscanf(line, "# Total execution time: %lf ms", &cpu_time);
         }
         fclose(cpu_fp);
     }
-
-    // 使用基准CPU时间（系统空闲时的正常值）
-    // 对于3840x2160, 1000次迭代，正常CPU时间约为370-400ms
-    double cpu_time_baseline = 372.03; // 基准值（系统空闲时的测试结果）
-
-    // 判断CPU时间是否异常（如果超过基准值的2倍，认为是系统负载导致的异常）
-    // 或者使用基准值计算真实的加速比
-    if (cpu_time_measured > 0.0 && cpu_time_measured < cpu_time_baseline * 2.0)
-    {
-        // CPU时间正常，使用实际测量值
-        cpu_time = cpu_time_measured;
-    }
-    else
-    {
-        // CPU时间异常高，使用基准值计算真实加速比
-        cpu_time = cpu_time_baseline;
-    }
+    int comparable = cpu_time > 0.0 && cpu_width == width && cpu_height == height && cpu_iterations == iterations;
 
     // 创建加速比文件
     FILE *speedup_fp = fopen("output/speedup_comparison.txt", "w");
@@ -146,20 +49,9 @@ void create_speedup_file(double gpu_time, int width, int height, int iterations,
         fprintf(speedup_fp, "GPU Kernel: %s\n\n", kernel_name);
 
         fprintf(speedup_fp, "## Execution Time\n");
-        if (cpu_time > 0.0)
+        if (comparable)
         {
-            // 显示实际测量值和使用的值
-            if (cpu_time_measured > 0.0 && cpu_time_measured != cpu_time)
-            {
-                fprintf(speedup_fp, "CPU (measured): %.3f ms (%.3f seconds) - System load detected\n",
-                        cpu_time_measured, cpu_time_measured / 1000.0);
-                fprintf(speedup_fp, "CPU (baseline): %.3f ms (%.3f seconds) - Used for speedup calculation\n",
-                        cpu_time, cpu_time / 1000.0);
-            }
-            else
-            {
-                fprintf(speedup_fp, "CPU: %.3f ms (%.3f seconds)\n", cpu_time, cpu_time / 1000.0);
-            }
+            fprintf(speedup_fp, "CPU: %.3f ms (%.3f seconds)\n", cpu_time, cpu_time / 1000.0);
             fprintf(speedup_fp, "GPU: %.3f ms (%.3f seconds)\n\n", gpu_time, gpu_time / 1000.0);
 
             double speedup = cpu_time / gpu_time;
@@ -171,12 +63,9 @@ void create_speedup_file(double gpu_time, int width, int height, int iterations,
             fprintf(speedup_fp, "Time reduction: %.3f ms (%.1f%% improvement)\n", cpu_time - gpu_time, improvement);
             fprintf(speedup_fp, "GPU Throughput: %.2f MPixels/s\n", throughput);
 
-            if (cpu_time_measured > 0.0 && cpu_time_measured != cpu_time)
-            {
-                fprintf(speedup_fp, "\n## Note\n");
-                fprintf(speedup_fp, "The measured CPU time (%.3f ms) was affected by system load.\n", cpu_time_measured);
-                fprintf(speedup_fp, "Speedup calculation uses baseline CPU time (%.3f ms) for accurate comparison.\n", cpu_time);
-            }
+            fprintf(speedup_fp, "\n## Note\n");
+            fprintf(speedup_fp, "Both times are single runs of separate programs; use histogram_bench for repeated,\n");
+            fprintf(speedup_fp, "interleaved trials with confidence intervals.\n");
 
             fprintf(speedup_fp, "\n## Summary\n");
             fprintf(speedup_fp, "The GPU implementation achieves a %.2fx speedup over the CPU implementation.\n", speedup);
@@ -185,7 +74,15 @@ void create_speedup_file(double gpu_time, int width, int height, int iterations,
         else
         {
             fprintf(speedup_fp, "GPU: %.3f ms (%.3f seconds)\n", gpu_time, gpu_time / 1000.0);
-            fprintf(speedup_fp, "CPU: Not available (run histogram_cpu.exe first)\n");
+            if (cpu_time > 0.0)
+            {
+                fprintf(speedup_fp, "CPU: Not comparable (output/histogram_cpu.txt was measured at %dx%d, %d iterations)\n",
+                        cpu_width, cpu_height, cpu_iterations);
+            }
+            else
+            {
+                fprintf(speedup_fp, "CPU: Not available (run histogram_cpu.exe with the same size and iterations first)\n");
+            }
             fprintf(speedup_fp, "GPU Throughput: %.2f MPixels/s\n", throughput);
         }
 
@@ -202,316 +99,1390 @@ int verify_histogram(unsigned int *histogram, int expected_total)
     {
         sum += histogram[i];
     }
-    return (sum == expected_total);
+    return (sum == (unsigned long long)expected_total);
 }
 
-int main(int argc, char **argv)
+// ===== 帧内存：拷贝 / 零拷贝 =====
+// 拷贝模式下帧在普通主机内存中，每次通过clEnqueueWriteBuffer传到设备缓冲区；
+// 零拷贝模式下帧直接分配在设备可以访问的页对齐内存中（CL_MEM_USE_HOST_PTR或粗粒度SVM），
+// 生产者map后写入像素，unmap后kernel原地读取。POCL和集成显卡上没有任何图像数据传输
+
+#define FRAME_ALIGNMENT 4096
+
+typedef enum
 {
-    int width = 3840;
-    int height = 2160;
-    int iterations = 1000;
-    int kernel_choice = 2; // 默认使用local memory版本
+    MEM_COPY,
+    MEM_HOST_PTR,
+    MEM_SVM
+} MemMode;
+
+static const char *mem_mode_names[] = {
+    "copy (clEnqueueWriteBuffer)",
+    "zero-copy (CL_MEM_USE_HOST_PTR)",
+    "zero-copy (coarse-grained SVM)"};
+
+typedef struct
+{
+    MemMode mode;
+    size_t size;         // 向上取整到FRAME_ALIGNMENT
+    unsigned char *host; // 帧数据所在的主机内存
+    cl_mem buffer;       // MEM_HOST_PTR模式下包装host的设备缓冲区
+} FrameMemory;
+
+// 主机和设备之间实际传输的字节数（map/unmap在零拷贝模式下不产生传输，不计入）
+static unsigned long long bytes_to_device = 0;
+static unsigned long long bytes_from_device = 0;
+
+// --profile时非NULL：所有计时循环的队列都带CL_QUEUE_PROFILING_ENABLE，每条写入、清零、kernel和回读的事件都记录在这里
+static HistClProfile *cl_profile = NULL;
+static cl_command_queue_properties profile_queue_flag(void)
+{
+    return cl_profile ? CL_QUEUE_PROFILING_ENABLE : 0;
+}
+
+// 记录并释放一个已完成的事件
+static void profile_event(HistClStage stage, cl_event event)
+{
+    hist_cl_profile_add(cl_profile, stage, event);
+    clReleaseEvent(event);
+}
 
-    if (argc >= 3)
+// HIST_SINK设置时非NULL：每帧回读的直方图追加到这个二进制文件（常驻模式只回读最后一帧）
+static HistSink *frame_sink = NULL;
+
+// 追加一帧结果，写入失败后关闭，不再写
+static void sink_frame(unsigned long long frame_id, const unsigned int *histogram)
+{
+    if (frame_sink && hist_sink_write(frame_sink, frame_id, 0, histogram) != HIST_OK)
     {
-        width = atoi(argv[1]);
-        height = atoi(argv[2]);
+        hist_sink_close(frame_sink);
+        frame_sink = NULL;
     }
-    if (argc >= 4)
+}
+
+// 检查SVM是否可用，不可用时退回CL_MEM_USE_HOST_PTR
+static MemMode check_mem_mode(const HistClEnv *env, MemMode mode)
+{
+    if (mode == MEM_SVM)
     {
-        iterations = atoi(argv[3]);
+#ifdef CL_VERSION_2_0
+        cl_device_svm_capabilities caps = 0;
+        if (clGetDeviceInfo(env->device, CL_DEVICE_SVM_CAPABILITIES, sizeof(caps), &caps, NULL) == CL_SUCCESS &&
+            (caps & CL_DEVICE_SVM_COARSE_GRAIN_BUFFER))
+        {
+            return MEM_SVM;
+        }
+#endif
+        printf("Warning: device does not support coarse-grained SVM, using CL_MEM_USE_HOST_PTR\n");
+        return MEM_HOST_PTR;
     }
-    if (argc >= 5)
+    if (mode == MEM_HOST_PTR)
     {
-        kernel_choice = atoi(argv[4]);
+        cl_bool unified = CL_FALSE;
+        clGetDeviceInfo(env->device, CL_DEVICE_HOST_UNIFIED_MEMORY, sizeof(unified), &unified, NULL);
+        if (!unified)
+        {
+            printf("Note: device memory is not unified with host memory, the driver may still copy frames\n");
+        }
     }
+    return mode;
+}
 
-    printf("=== OpenCL GPU Histogram Computation ===\n");
-    printf("Image size: %dx%d (%.2f MP)\n", width, height, (width * height) / 1e6);
-    printf("Iterations: %d\n", iterations);
+static void frame_alloc(FrameMemory *frame, const HistClEnv *env, MemMode mode, size_t size)
+{
+    cl_int ret;
+    memset(frame, 0, sizeof(FrameMemory));
+    frame->mode = mode;
+    frame->size = (size + FRAME_ALIGNMENT - 1) / FRAME_ALIGNMENT * FRAME_ALIGNMENT;
 
-    long long total_pixels = (long long)width * height;
-    double total_data = (total_pixels * iterations) / (1024.0 * 1024.0 * 1024.0);
-    printf("Total data to process: %.2f GB\n\n", total_data);
+#ifdef CL_VERSION_2_0
+    if (mode == MEM_SVM)
+    {
+        frame->host = (unsigned char *)clSVMAlloc(env->context, CL_MEM_READ_ONLY, frame->size, FRAME_ALIGNMENT);
+        if (!frame->host)
+        {
+            fprintf(stderr, "Error: clSVMAlloc failed\n");
+            exit(1);
+        }
+        return;
+    }
+#endif
 
-    // 创建测试图像
-    printf("Generating test image...\n");
-    Image *img = create_test_image(width, height);
-    int image_size = width * height;
+    frame->host = (unsigned char *)hist_aligned_alloc(frame->size, FRAME_ALIGNMENT);
+    if (!frame->host)
+    {
+        fprintf(stderr, "Error: cannot allocate frame memory\n");
+        exit(1);
+    }
+    memset(frame->host, 0, frame->size);
+    if (mode == MEM_HOST_PTR)
+    {
+        frame->buffer = clCreateBuffer(env->context, CL_MEM_READ_ONLY | CL_MEM_USE_HOST_PTR,
+                                       frame->size, frame->host, &ret);
+        check_error(ret, "clCreateBuffer (CL_MEM_USE_HOST_PTR)");
+    }
+}
 
-    // OpenCL初始化
-    printf("Initializing OpenCL...\n");
-    cl_platform_id platform_id = NULL;
-    cl_device_id device_id = NULL;
-    cl_uint ret_num_devices;
-    cl_uint ret_num_platforms;
+static void frame_release(FrameMemory *frame, const HistClEnv *env)
+{
+#ifdef CL_VERSION_2_0
+    if (frame->mode == MEM_SVM)
+    {
+        clSVMFree(env->context, frame->host);
+        return;
+    }
+#endif
+    (void)env;
+    if (frame->buffer)
+        clReleaseMemObject(frame->buffer);
+    hist_aligned_free(frame->host);
+}
+
+// 生产者写入一帧像素；零拷贝模式下先map拿到所有权，写完unmap交还设备
+static void frame_write(FrameMemory *frame, cl_command_queue queue, const unsigned char *pixels, size_t size)
+{
+    cl_int ret = CL_SUCCESS;
+    if (frame->mode == MEM_COPY)
+    {
+        memcpy(frame->host, pixels, size);
+        return;
+    }
+#ifdef CL_VERSION_2_0
+    if (frame->mode == MEM_SVM)
+    {
+        ret = clEnqueueSVMMap(queue, CL_TRUE, CL_MAP_WRITE_INVALIDATE_REGION, frame->host, frame->size, 0, NULL, NULL);
+        check_error(ret, "clEnqueueSVMMap");
+        memcpy(frame->host, pixels, size);
+        ret = clEnqueueSVMUnmap(queue, frame->host, 0, NULL, NULL);
+        check_error(ret, "clEnqueueSVMUnmap");
+        return;
+    }
+#endif
+    unsigned char *mapped = (unsigned char *)clEnqueueMapBuffer(queue, frame->buffer, CL_TRUE, CL_MAP_WRITE_INVALIDATE_REGION,
+                                                                0, frame->size, 0, NULL, NULL, &ret);
+    check_error(ret, "clEnqueueMapBuffer");
+    memcpy(mapped, pixels, size);
+    ret = clEnqueueUnmapMemObject(queue, frame->buffer, mapped, 0, NULL, NULL);
+    check_error(ret, "clEnqueueUnmapMemObject");
+}
+
+// 零拷贝模式下把帧绑定为kernel的图像参数（第0个参数）
+static void frame_set_kernel_arg(const FrameMemory *frame, cl_kernel kernel)
+{
     cl_int ret;
+#ifdef CL_VERSION_2_0
+    if (frame->mode == MEM_SVM)
+    {
+        ret = clSetKernelArgSVMPointer(kernel, 0, frame->host);
+        check_error(ret, "clSetKernelArgSVMPointer");
+        return;
+    }
+#endif
+    ret = clSetKernelArg(kernel, 0, sizeof(cl_mem), (void *)&frame->buffer);
+    check_error(ret, "clSetKernelArg image");
+}
 
-    ret = clGetPlatformIDs(1, &platform_id, &ret_num_platforms);
-    check_error(ret, "clGetPlatformIDs");
+// ===== 流式模式 =====
+// 每次迭代都上传一帧新图像，N个slot组成环形队列：第k帧的上传、kernel和结果回读
+// 与其他slot上的帧重叠执行，测量的是端到端的持续帧率，而不是驻留在显存中的重复计算
 
-    ret = clGetDeviceIDs(platform_id, CL_DEVICE_TYPE_GPU, 1, &device_id, &ret_num_devices);
-    if (ret != CL_SUCCESS)
+#define STREAM_MAX_DEPTH 8
+#define STREAM_HOST_FRAMES 4 // 轮流上传的不同主机帧，避免每次上传同一块内存
+
+typedef struct
+{
+    cl_command_queue queue; // 顺序队列模式下每个slot一个队列；乱序模式下共享
+    HistClLaunch launch;
+    cl_mem image_buffer;
+    cl_mem histogram_buffer;
+    cl_event read_event;
+    cl_event stage_events[HIST_CL_STAGE_READ]; // --profile时保留的上传、清零和kernel事件，在retire时记录
+    unsigned int histogram[HISTOGRAM_BINS];
+    int frame;    // 正在处理的主机帧号，-1表示空闲
+    int sequence; // 这一帧的迭代序号，写入HIST_SINK时作为帧号
+} StreamSlot;
+
+// 等待slot上一帧的结果并与CPU参考结果比较，返回不一致的帧数（0或1）
+static int stream_retire(StreamSlot *slot, unsigned int expected[][HISTOGRAM_BINS])
+{
+    if (slot->frame < 0)
+        return 0;
+    check_error(clWaitForEvents(1, &slot->read_event), "clWaitForEvents");
+    if (cl_profile)
     {
-        printf("No GPU found, trying CPU...\n");
-        ret = clGetDeviceIDs(platform_id, CL_DEVICE_TYPE_CPU, 1, &device_id, &ret_num_devices);
+        // 回读依赖kernel，kernel依赖上传和清零，回读完成时这些事件都已结束
+        for (int stage = 0; stage < HIST_CL_STAGE_READ; stage++)
+        {
+            if (slot->stage_events[stage])
+                profile_event((HistClStage)stage, slot->stage_events[stage]);
+            slot->stage_events[stage] = NULL;
+        }
+        hist_cl_profile_add(cl_profile, HIST_CL_STAGE_READ, slot->read_event);
     }
-    check_error(ret, "clGetDeviceIDs");
+    clReleaseEvent(slot->read_event);
+    int mismatch = memcmp(slot->histogram, expected[slot->frame], sizeof(slot->histogram)) != 0;
+    sink_frame((unsigned long long)slot->sequence, slot->histogram);
+    slot->frame = -1;
+    return mismatch;
+}
 
-    // 打印设备信息
-    char device_name[128];
-    char device_vendor[128];
-    cl_uint compute_units;
-    size_t max_work_group_size;
-    cl_ulong global_mem_size;
-    cl_ulong local_mem_size;
+// 流式运行iterations帧，返回总时间(ms)，最后一帧的结果写入histogram。
+// input非NULL时主机帧取输入文件的前几帧（不足STREAM_HOST_FRAMES帧时循环使用）
+double run_streaming(HistClEnv *env, const HistClTuning *tuning, const HistInput *input, Image *img,
+                     int iterations, int depth, int out_of_order, MemMode mem_mode, unsigned int *histogram)
+{
+    int image_size = img->width * img->height;
+    cl_int ret;
 
-    clGetDeviceInfo(device_id, CL_DEVICE_NAME, sizeof(device_name), device_name, NULL);
-    clGetDeviceInfo(device_id, CL_DEVICE_VENDOR, sizeof(device_vendor), device_vendor, NULL);
-    clGetDeviceInfo(device_id, CL_DEVICE_MAX_COMPUTE_UNITS, sizeof(compute_units), &compute_units, NULL);
-    clGetDeviceInfo(device_id, CL_DEVICE_MAX_WORK_GROUP_SIZE, sizeof(max_work_group_size), &max_work_group_size, NULL);
-    clGetDeviceInfo(device_id, CL_DEVICE_GLOBAL_MEM_SIZE, sizeof(global_mem_size), &global_mem_size, NULL);
-    clGetDeviceInfo(device_id, CL_DEVICE_LOCAL_MEM_SIZE, sizeof(local_mem_size), &local_mem_size, NULL);
+    // 主机帧：在测试图像基础上平移像素值，每帧直方图不同，可以检测帧之间的串扰
+    FrameMemory frames[STREAM_HOST_FRAMES];
+    unsigned int(*expected)[HISTOGRAM_BINS] = (unsigned int(*)[HISTOGRAM_BINS])malloc(
+        STREAM_HOST_FRAMES * sizeof(*expected));
+    unsigned char *pixels = (unsigned char *)malloc(image_size);
+    for (int f = 0; f < STREAM_HOST_FRAMES; f++)
+    {
+        const unsigned char *frame = pixels;
+        if (input)
+        {
+            frame = hist_input_frame(input, f);
+        }
+        else
+        {
+            for (int i = 0; i < image_size; i++)
+            {
+                pixels[i] = (unsigned char)(img->data[i] + f * 37);
+            }
+        }
+        compute_histogram_cpu(frame, image_size, expected[f]);
+        frame_alloc(&frames[f], env, mem_mode, image_size);
+        frame_write(&frames[f], env->queue, frame, image_size);
+    }
+    free(pixels);
 
-    printf("\n=== Device Information ===\n");
-    printf("Device: %s\n", device_name);
-    printf("Vendor: %s\n", device_vendor);
-    printf("Compute Units: %u\n", compute_units);
-    printf("Max Work Group Size: %zu\n", max_work_group_size);
-    printf("Global Memory: %.2f GB\n", global_mem_size / (1024.0 * 1024.0 * 1024.0));
-    printf("Local Memory: %.2f KB\n\n", local_mem_size / 1024.0);
+    cl_command_queue shared_queue = NULL;
+    if (out_of_order)
+    {
+        shared_queue = clCreateCommandQueue(env->context, env->device,
+                                            CL_QUEUE_OUT_OF_ORDER_EXEC_MODE_ENABLE | profile_queue_flag(), &ret);
+        check_error(ret, "clCreateCommandQueue (out-of-order)");
+    }
 
-    // 创建context和command queue
-    cl_context context = clCreateContext(NULL, 1, &device_id, NULL, NULL, &ret);
-    check_error(ret, "clCreateContext");
+    // 每个slot有自己的kernel对象，kernel参数各自绑定，不需要每帧重新设置
+    StreamSlot slots[STREAM_MAX_DEPTH];
+    for (int s = 0; s < depth; s++)
+    {
+        StreamSlot *slot = &slots[s];
+        memset(slot, 0, sizeof(StreamSlot));
+        slot->frame = -1;
+        if (out_of_order)
+        {
+            slot->queue = shared_queue;
+        }
+        else
+        {
+            slot->queue = clCreateCommandQueue(env->context, env->device, profile_queue_flag(), &ret);
+            check_error(ret, "clCreateCommandQueue");
+        }
+        if (hist_cl_launch_init_tuned(&slot->launch, env, tuning, image_size) != HIST_OK)
+        {
+            exit(1);
+        }
+        // 拷贝模式下每个slot有自己的设备图像缓冲区；零拷贝模式下kernel直接读取主机帧
+        if (mem_mode == MEM_COPY)
+        {
+            // 容量向上取整到16字节，vectorized kernel按uchar4读取
+            slot->image_buffer = clCreateBuffer(env->context, CL_MEM_READ_ONLY, (image_size + 15) & ~15, NULL, &ret);
+            check_error(ret, "clCreateBuffer image");
+        }
+        slot->histogram_buffer = clCreateBuffer(env->context, CL_MEM_READ_WRITE,
+                                                HISTOGRAM_BINS * sizeof(unsigned int), NULL, &ret);
+        check_error(ret, "clCreateBuffer histogram");
+        if (hist_cl_launch_set_args(&slot->launch, slot->image_buffer, slot->histogram_buffer) != HIST_OK)
+        {
+            exit(1);
+        }
+    }
+    // 零拷贝帧由生产者在计时开始前准备好，等它们对设备可见
+    clFinish(env->queue);
 
-    cl_command_queue command_queue = clCreateCommandQueue(context, device_id, 0, &ret);
-    check_error(ret, "clCreateCommandQueue");
+    int mismatches = 0;
+    double start_time = get_time_ms();
+    double last_update = start_time;
 
-    // 读取并编译kernel
-    printf("Loading and compiling kernels...\n");
-    // 尝试多个路径查找kernel文件
-    char *kernel_source = NULL;
-    const char *kernel_paths[] = {
-        "histogram_kernel.cl",
-        "opencl/histogram.cl",
-        "histogram.cl"};
-    for (int i = 0; i < 3; i++)
+    for (int iter = 0; iter < iterations; iter++)
     {
-        FILE *test_fp = fopen(kernel_paths[i], "r");
-        if (test_fp)
+        StreamSlot *slot = &slots[iter % depth];
+
+        // slot被复用前，先取回它上一帧的结果
+        mismatches += stream_retire(slot, expected);
+        // 倒序轮换，保证最后一帧是原始测试图像（第0帧），输出文件可以直接和CPU结果对比
+        slot->frame = (iterations - 1 - iter) % STREAM_HOST_FRAMES;
+        slot->sequence = iter;
+
+        // 上传 -> 清零 -> kernel -> 回读，用事件串起依赖（乱序队列必需，顺序队列也无害）
+        // 零拷贝模式下没有上传，只需把这一帧绑定到kernel
+        FrameMemory *frame = &frames[slot->frame];
+        // 每条命令入队成功后才记录它的事件，依赖列表和stage_events中不会有未初始化的事件
+        cl_event upload_events[2];
+        cl_uint num_upload_events = 0;
+        cl_event event;
+        cl_event kernel_event;
+        if (mem_mode == MEM_COPY)
         {
-            fclose(test_fp);
-            kernel_source = read_kernel_source(kernel_paths[i]);
-            break;
+            ret = clEnqueueWriteBuffer(slot->queue, slot->image_buffer, CL_FALSE, 0, image_size, frame->host, 0,
+                                       NULL, &event);
+            check_error(ret, "clEnqueueWriteBuffer (stream)");
+            upload_events[num_upload_events++] = event;
+            bytes_to_device += image_size;
+        }
+        else
+        {
+            frame_set_kernel_arg(frame, slot->launch.kernel);
+        }
+        if (hist_cl_enqueue_clear(env, slot->queue, slot->histogram_buffer, HISTOGRAM_BINS, 0, NULL, &event) !=
+            HIST_OK)
+        {
+            exit(1);
+        }
+        upload_events[num_upload_events++] = event;
+        ret = clEnqueueNDRangeKernel(slot->queue, slot->launch.kernel, 1, NULL, &slot->launch.global_size,
+                                     &slot->launch.local_size, num_upload_events, upload_events, &kernel_event);
+        check_error(ret, "clEnqueueNDRangeKernel (stream)");
+        ret = clEnqueueReadBuffer(slot->queue, slot->histogram_buffer, CL_FALSE, 0,
+                                  HISTOGRAM_BINS * sizeof(unsigned int), slot->histogram, 1, &kernel_event,
+                                  &slot->read_event);
+        check_error(ret, "clEnqueueReadBuffer (stream)");
+        bytes_from_device += HISTOGRAM_BINS * sizeof(unsigned int);
+        if (cl_profile)
+        {
+            slot->stage_events[HIST_CL_STAGE_WRITE] = mem_mode == MEM_COPY ? upload_events[0] : NULL;
+            slot->stage_events[HIST_CL_STAGE_CLEAR] = upload_events[num_upload_events - 1];
+            slot->stage_events[HIST_CL_STAGE_KERNEL] = kernel_event;
+        }
+        else
+        {
+            for (cl_uint e = 0; e < num_upload_events; e++)
+            {
+                clReleaseEvent(upload_events[e]);
+            }
+            clReleaseEvent(kernel_event);
+        }
+        clFlush(slot->queue);
+
+        double current_time = get_time_ms();
+        if (current_time - last_update > 100 || iter == iterations - 1)
+        {
+            print_progress(iter + 1, iterations, current_time - start_time);
+            last_update = current_time;
         }
     }
-    if (!kernel_source)
+
+    // 排空流水线，最后一帧的结果作为输出
+    int last_slot = (iterations - 1) % depth;
+    for (int s = 0; s < depth; s++)
     {
-        fprintf(stderr, "Error: Could not find kernel file. Tried:\n");
-        for (int i = 0; i < 3; i++)
+        int idx = (last_slot + 1 + s) % depth; // 按提交顺序取回
+        mismatches += stream_retire(&slots[idx], expected);
+        if (idx == last_slot)
         {
-            fprintf(stderr, "  - %s\n", kernel_paths[i]);
+            memcpy(histogram, slots[idx].histogram, sizeof(slots[idx].histogram));
         }
-        exit(1);
     }
-    size_t source_size = strlen(kernel_source);
+    double total_time = get_time_ms() - start_time;
+
+    printf("\n\nStreaming: %d slots, %s, %d host frames\n", depth,
+           out_of_order ? "one out-of-order queue" : "one in-order queue per slot", STREAM_HOST_FRAMES);
+    printf("Frames per second (end-to-end): %.2f\n", iterations / (total_time / 1000.0));
+    if (mismatches > 0)
+    {
+        printf("✗ %d frames differ from the CPU reference!\n", mismatches);
+    }
+    else
+    {
+        printf("✓ All %d frames match the CPU reference\n", iterations);
+    }
+
+    for (int s = 0; s < depth; s++)
+    {
+        if (slots[s].image_buffer)
+            clReleaseMemObject(slots[s].image_buffer);
+        clReleaseMemObject(slots[s].histogram_buffer);
+        hist_cl_launch_release(&slots[s].launch);
+        if (!out_of_order)
+            clReleaseCommandQueue(slots[s].queue);
+    }
+    if (shared_queue)
+        clReleaseCommandQueue(shared_queue);
+    for (int f = 0; f < STREAM_HOST_FRAMES; f++)
+    {
+        frame_release(&frames[f], env);
+    }
+    free(expected);
+    return total_time;
+}
+
+// ===== 批处理模式 =====
+// 一次launch统计batch帧：2D NDRange（帧内tile, 帧号），每帧一份直方图连续输出。
+// 每批只需要一次设备端清零、一次kernel和一次回读，小图像时launch开销被batch帧摊薄
 
-    cl_program program = clCreateProgramWithSource(context, 1, (const char **)&kernel_source,
-                                                   (const size_t *)&source_size, &ret);
-    check_error(ret, "clCreateProgramWithSource");
+#define BATCH_PIXELS_PER_ITEM 32
 
-    ret = clBuildProgram(program, 1, &device_id, NULL, NULL, NULL);
-    if (ret != CL_SUCCESS)
+// 批处理运行iterations帧（iterations是batch的整数倍），返回总时间(ms)，最后一帧的结果写入histogram
+double run_batched(HistClEnv *env, Image *img, int iterations, int batch, unsigned int *histogram)
+{
+    int image_size = img->width * img->height;
+    int frame_stride = (image_size + 63) & ~63; // 每帧起始地址按64字节对齐
+    cl_int ret;
+
+    // 第f帧像素值平移f*37：37与256互素，256帧各不相同，直方图是基准直方图的循环移位
+    unsigned int base[HISTOGRAM_BINS];
+    compute_histogram_cpu(img->data, image_size, base);
+    unsigned char *frames = (unsigned char *)calloc((size_t)frame_stride * batch, 1);
+    if (!frames)
     {
-        size_t len;
-        char buffer[4096];
-        clGetProgramBuildInfo(program, device_id, CL_PROGRAM_BUILD_LOG, sizeof(buffer), buffer, &len);
-        fprintf(stderr, "Build error:\n%s\n", buffer);
+        fprintf(stderr, "Error: cannot allocate %d frames\n", batch);
         exit(1);
     }
+    for (int f = 0; f < batch; f++)
+    {
+        unsigned char *frame = frames + (size_t)f * frame_stride;
+        for (int i = 0; i < image_size; i++)
+        {
+            frame[i] = (unsigned char)(img->data[i] + f * 37);
+        }
+    }
+
+    size_t frames_bytes = (size_t)frame_stride * batch;
+    size_t histograms_bytes = (size_t)batch * HISTOGRAM_BINS * sizeof(unsigned int);
+    cl_mem frames_buffer = clCreateBuffer(env->context, CL_MEM_READ_ONLY | CL_MEM_COPY_HOST_PTR,
+                                          frames_bytes, frames, &ret);
+    check_error(ret, "clCreateBuffer frames");
+    bytes_to_device += frames_bytes;
+    cl_mem histograms_buffer = clCreateBuffer(env->context, CL_MEM_READ_WRITE, histograms_bytes, NULL, &ret);
+    check_error(ret, "clCreateBuffer histograms");
+
+    cl_kernel kernel = clCreateKernel(env->program, "histogram_batched", &ret);
+    check_error(ret, "clCreateKernel histogram_batched");
+
+    // 每个work-group是一个tile，每个work-item大约处理BATCH_PIXELS_PER_ITEM个像素
+    size_t local_size[2] = {256, 1};
+    if (local_size[0] > env->max_work_group_size)
+        local_size[0] = env->max_work_group_size;
+    size_t tiles = (image_size + local_size[0] * BATCH_PIXELS_PER_ITEM - 1) / (local_size[0] * BATCH_PIXELS_PER_ITEM);
+    size_t global_size[2] = {tiles * local_size[0], (size_t)batch};
+
+    ret = clSetKernelArg(kernel, 0, sizeof(cl_mem), (void *)&frames_buffer);
+    ret |= clSetKernelArg(kernel, 1, sizeof(cl_mem), (void *)&histograms_buffer);
+    ret |= clSetKernelArg(kernel, 2, sizeof(int), (void *)&image_size);
+    ret |= clSetKernelArg(kernel, 3, HISTOGRAM_BINS * sizeof(unsigned int), NULL);
+    ret |= clSetKernelArg(kernel, 4, sizeof(int), (void *)&frame_stride);
+    check_error(ret, "clSetKernelArg histogram_batched");
 
-    // 选择kernel
-    const char *kernel_names[] = {
-        "histogram_naive",
-        "histogram_local",
-        "histogram_private",
-        "histogram_vectorized",
-        "histogram_ultra"}; // 新增高性能版本
+    printf("Batch: %d frames per launch, %zu tiles x %zu work-items per frame\n", batch, tiles, local_size[0]);
 
-    const char *kernel_descriptions[] = {
-        "Naive (simple atomic)",
-        "Local Memory (optimized)",
-        "Private Histogram",
-        "Vectorized (uchar4)",
-        "Ultra (all optimizations)"}; // 新增高性能版本
+    unsigned int *results = (unsigned int *)malloc(histograms_bytes);
+    int num_batches = iterations / batch;
+    int mismatches = 0;
+    double start_time = get_time_ms();
+    double last_update = start_time;
 
-    if (kernel_choice < 1 || kernel_choice > 5)
+    for (int b = 0; b < num_batches; b++)
     {
-        kernel_choice = 5; // 默认使用ultra版本（最优）
+        // 一次清零 + 一次kernel + 一次回读处理batch帧
+        cl_event events[3] = {NULL, NULL, NULL}; // 只在--profile时请求
+        if (hist_cl_enqueue_clear(env, env->queue, histograms_buffer, batch * HISTOGRAM_BINS, 0, NULL,
+                                  cl_profile ? &events[0] : NULL) != HIST_OK)
+        {
+            exit(1);
+        }
+        ret = clEnqueueNDRangeKernel(env->queue, kernel, 2, NULL, global_size, local_size, 0, NULL,
+                                     cl_profile ? &events[1] : NULL);
+        check_error(ret, "clEnqueueNDRangeKernel histogram_batched");
+        ret = clEnqueueReadBuffer(env->queue, histograms_buffer, CL_TRUE, 0, histograms_bytes, results, 0, NULL,
+                                  cl_profile ? &events[2] : NULL);
+        check_error(ret, "clEnqueueReadBuffer histograms");
+        bytes_from_device += histograms_bytes;
+        if (cl_profile)
+        {
+            profile_event(HIST_CL_STAGE_CLEAR, events[0]);
+            profile_event(HIST_CL_STAGE_KERNEL, events[1]);
+            profile_event(HIST_CL_STAGE_READ, events[2]);
+        }
+
+        for (int f = 0; f < batch; f++)
+        {
+            const unsigned int *hist = results + (size_t)f * HISTOGRAM_BINS;
+            sink_frame((unsigned long long)b * batch + f, hist);
+            int shift = (f * 37) & 255;
+            for (int i = 0; i < HISTOGRAM_BINS; i++)
+            {
+                if (hist[(i + shift) & 255] != base[i])
+                {
+                    mismatches++;
+                    break;
+                }
+            }
+        }
+
+        double current_time = get_time_ms();
+        if (current_time - last_update > 100 || b == num_batches - 1)
+        {
+            print_progress((b + 1) * batch, iterations, current_time - start_time);
+            last_update = current_time;
+        }
     }
+    double total_time = get_time_ms() - start_time;
 
-    printf("Using kernel: %s\n", kernel_descriptions[kernel_choice - 1]);
+    // 每批的第0帧是原始测试图像
+    memcpy(histogram, results, HISTOGRAM_BINS * sizeof(unsigned int));
 
-    cl_kernel kernel = clCreateKernel(program, kernel_names[kernel_choice - 1], &ret);
-    check_error(ret, "clCreateKernel");
+    printf("\n\nBatched: %d launches + %d readbacks for %d frames (%.3f launches per frame)\n",
+           2 * num_batches, num_batches, iterations, 2.0 * num_batches / iterations);
+    printf("Frames per second: %.2f\n", iterations / (total_time / 1000.0));
+    if (mismatches > 0)
+    {
+        printf("✗ %d frames differ from the CPU reference!\n", mismatches);
+    }
+    else
+    {
+        printf("✓ All %d frames match the CPU reference\n", iterations);
+    }
 
-    // 创建缓冲区 - 优化：使用CL_MEM_COPY_HOST_PTR避免额外传输
-    cl_mem image_buffer = clCreateBuffer(context, CL_MEM_READ_ONLY | CL_MEM_COPY_HOST_PTR,
-                                         image_size * sizeof(unsigned char), img->data, &ret);
-    check_error(ret, "clCreateBuffer image");
+    clReleaseKernel(kernel);
+    clReleaseMemObject(frames_buffer);
+    clReleaseMemObject(histograms_buffer);
+    free(results);
+    free(frames);
+    return total_time;
+}
+
+// ===== 不同图像分布下的kernel对比 =====
+
+#define COMPARE_CONFIGS 4
+
+// 用profiling事件只测kernel时间，比较local atomic冲突的影响：
+// 渐变/常数图像中相邻像素落在同一bin，单份local直方图上的atomic会串行化，多副本kernel把它们分散开
+void report_pattern_comparison(HistClEnv *env, int width, int height, int iterations)
+{
+    int compare_iterations = iterations / 10;
+    if (compare_iterations < 1)
+        compare_iterations = 1;
+    int image_size = width * height;
+    cl_int ret;
 
-    cl_mem histogram_buffer = clCreateBuffer(context, CL_MEM_READ_WRITE,
+    cl_command_queue queue = clCreateCommandQueue(env->context, env->device, CL_QUEUE_PROFILING_ENABLE, &ret);
+    check_error(ret, "clCreateCommandQueue (profiling)");
+    cl_mem image_buffer = clCreateBuffer(env->context, CL_MEM_READ_ONLY, (image_size + 15) & ~15, NULL, &ret);
+    check_error(ret, "clCreateBuffer image");
+    cl_mem histogram_buffer = clCreateBuffer(env->context, CL_MEM_READ_WRITE,
                                              HISTOGRAM_BINS * sizeof(unsigned int), NULL, &ret);
     check_error(ret, "clCreateBuffer histogram");
 
-    // 优化：图像数据已经在创建buffer时传输，不需要额外写入
+    // histogram_replicated分别用1份和默认份数的副本，区分合并访存和多副本各自的收益
+    const int kernels[COMPARE_CONFIGS] = {HIST_CL_LOCAL_KERNEL, HIST_CL_ULTRA_KERNEL, HIST_CL_REPLICATED_KERNEL,
+                                         HIST_CL_REPLICATED_KERNEL};
+    const int replicas[COMPARE_CONFIGS] = {0, 0, 1, 0};
+    HistClLaunch launches[COMPARE_CONFIGS];
+    HistClTuning defaults;
+    memset(&defaults, 0, sizeof(defaults));
+    for (int c = 0; c < COMPARE_CONFIGS; c++)
+    {
+        defaults.kernel_choice = kernels[c];
+        if (hist_cl_launch_init_tuned(&launches[c], env, &defaults, image_size) != HIST_OK)
+        {
+            exit(1);
+        }
+        if (replicas[c] > 0)
+            launches[c].replicas = replicas[c];
+        if (hist_cl_launch_set_args(&launches[c], image_buffer, histogram_buffer) != HIST_OK)
+        {
+            exit(1);
+        }
+    }
 
-    // 设置kernel参数和工作组大小 - 优化：根据设备能力动态调整
-    size_t local_size = 256;
-    // 尝试使用更大的workgroup size以提高性能
-    // 对于histogram，256是一个好的起点，但可以尝试更大的值
-    size_t preferred_local_sizes[] = {256, 512, 1024, 128};
-    size_t optimal_local_size = 256;
+    printf("\n=== Kernel vs. Image Pattern (%d iterations per point, kernel time only) ===\n", compare_iterations);
+    printf("Pattern    Kernel                   Time/iter(ms)  MPixels/s   Speedup\n");
 
-    // 选择最优的workgroup size（不超过设备限制）
-    for (int i = 0; i < 4; i++)
+    unsigned int reference[HISTOGRAM_BINS];
+    unsigned int histogram[HISTOGRAM_BINS];
+    for (int p = PATTERN_UNIFORM; p <= PATTERN_CONSTANT; p++)
     {
-        if (preferred_local_sizes[i] <= max_work_group_size &&
-            preferred_local_sizes[i] <= image_size)
+        Image *img = create_test_image_pattern(width, height, (ImagePattern)p);
+        compute_histogram_cpu(img->data, image_size, reference);
+        ret = clEnqueueWriteBuffer(queue, image_buffer, CL_TRUE, 0, image_size, img->data, 0, NULL, NULL);
+        check_error(ret, "clEnqueueWriteBuffer");
+
+        double base_time = 0.0;
+        for (int c = 0; c < COMPARE_CONFIGS; c++)
         {
-            optimal_local_size = preferred_local_sizes[i];
-            break;
+            HistClLaunch *launch = &launches[c];
+            double elapsed = 0.0;
+            for (int iter = -1; iter < compare_iterations; iter++) // 第一次为预热
+            {
+                double time_ms = hist_cl_time_kernel(env, queue, launch->kernel, 1, &launch->global_size,
+                                                     &launch->local_size, histogram_buffer, HISTOGRAM_BINS);
+                if (time_ms < 0.0)
+                    exit(1);
+                if (iter >= 0)
+                    elapsed += time_ms;
+            }
+            ret = clEnqueueReadBuffer(queue, histogram_buffer, CL_TRUE, 0, sizeof(histogram), histogram, 0, NULL, NULL);
+            check_error(ret, "clEnqueueReadBuffer");
+            if (c == 0)
+                base_time = elapsed;
+
+            char label[64];
+            if (launch->kernel_choice == HIST_CL_REPLICATED_KERNEL)
+                snprintf(label, sizeof(label), "%s x%d", hist_cl_kernel_names[HIST_CL_REPLICATED_KERNEL - 1],
+                         launch->replicas);
+            else
+                snprintf(label, sizeof(label), "%s", hist_cl_kernel_names[launch->kernel_choice - 1]);
+            printf("%-9s  %-23s  %13.3f  %9.2f  %7.2fx%s\n",
+                   pattern_names[p], label, elapsed / compare_iterations,
+                   ((long long)image_size * compare_iterations / 1e6) / (elapsed / 1000.0),
+                   base_time / elapsed,
+                   memcmp(histogram, reference, sizeof(histogram)) == 0 ? "" : "  ✗ INCORRECT");
         }
+
+        free_image(img);
     }
 
-    // 对于histogram_private kernel，使用更少的workitems，每个处理更多像素
-    if (kernel_choice == 3)
+    for (int c = 0; c < COMPARE_CONFIGS; c++)
     {
-        // 每个workitem处理多个像素，减少workitem数量
-        optimal_local_size = 128; // 使用较小的local size，每个workitem处理更多像素
+        hist_cl_launch_release(&launches[c]);
     }
+    clReleaseMemObject(image_buffer);
+    clReleaseMemObject(histogram_buffer);
+    clReleaseCommandQueue(queue);
+}
+
+// ===== 多通道图像 =====
+
+// 交错的RGB/RGBA图像：histogram_channels一次遍历统计所有通道，
+// 对比主机先拆成单通道平面、每个平面再跑一次histogram_local（kernel时间 + 主机拆分时间）
+void report_channel_comparison(HistClEnv *env, int width, int height, int channels, int iterations)
+{
+    int compare_iterations = iterations / 10;
+    if (compare_iterations < 1)
+        compare_iterations = 1;
+    int num_pixels = width * height;
+    size_t image_bytes = (size_t)num_pixels * channels;
+    int num_bins = channels * HISTOGRAM_BINS;
+    cl_int ret;
+
+    Image *img = create_test_image_channels(width, height, channels);
+    unsigned int *reference = (unsigned int *)malloc(num_bins * sizeof(unsigned int));
+    unsigned int *histogram = (unsigned int *)malloc(num_bins * sizeof(unsigned int));
+    unsigned char *plane = (unsigned char *)malloc((size_t)num_pixels);
+    compute_histogram_cpu_channels(img->data, num_pixels, channels, reference);
+
+    cl_command_queue queue = clCreateCommandQueue(env->context, env->device, CL_QUEUE_PROFILING_ENABLE, &ret);
+    check_error(ret, "clCreateCommandQueue (profiling)");
+    cl_mem image_buffer = clCreateBuffer(env->context, CL_MEM_READ_ONLY, (image_bytes + 15) & ~(size_t)15, NULL, &ret);
+    check_error(ret, "clCreateBuffer image");
+    cl_mem histogram_buffer = clCreateBuffer(env->context, CL_MEM_READ_WRITE,
+                                             num_bins * sizeof(unsigned int), NULL, &ret);
+    check_error(ret, "clCreateBuffer histogram");
+    ret = clEnqueueWriteBuffer(queue, image_buffer, CL_TRUE, 0, image_bytes, img->data, 0, NULL, NULL);
+    check_error(ret, "clEnqueueWriteBuffer");
 
-    // 对于ultra kernel，使用更大的workgroup以获得更好的性能
-    if (kernel_choice == 5)
+    HistClLaunch interleaved;
+    HistClLaunch planar;
+    if (hist_cl_launch_init(&interleaved, env, HIST_CL_CHANNELS_KERNEL, num_pixels) != HIST_OK ||
+        hist_cl_launch_init(&planar, env, HIST_CL_LOCAL_KERNEL, num_pixels) != HIST_OK)
     {
-        // 尝试使用更大的workgroup size
-        if (max_work_group_size >= 512)
+        exit(1);
+    }
+    interleaved.channels = channels;
+    if (hist_cl_launch_set_args(&interleaved, image_buffer, histogram_buffer) != HIST_OK)
+    {
+        exit(1);
+    }
+
+    printf("\n=== %d-Channel Interleaved Image (%d iterations, kernel time + host deinterleave) ===\n",
+           channels, compare_iterations);
+    printf("Method                          Time/iter(ms)  MPixels/s   Speedup\n");
+
+    // 一次遍历：histogram_channels直接读交错数据
+    double one_pass = 0.0;
+    for (int iter = -1; iter < compare_iterations; iter++) // 第一次为预热
+    {
+        double time_ms = hist_cl_time_kernel(env, queue, interleaved.kernel, 1, &interleaved.global_size,
+                                             &interleaved.local_size, histogram_buffer, num_bins);
+        if (time_ms < 0.0)
+            exit(1);
+        if (iter >= 0)
+            one_pass += time_ms;
+    }
+    ret = clEnqueueReadBuffer(queue, histogram_buffer, CL_TRUE, 0, num_bins * sizeof(unsigned int), histogram,
+                              0, NULL, NULL);
+    check_error(ret, "clEnqueueReadBuffer");
+    int one_pass_correct = memcmp(histogram, reference, num_bins * sizeof(unsigned int)) == 0;
+
+    // 拆分通道：每个通道拆成一个平面上传，再用单通道kernel统计
+    cl_mem plane_buffer = clCreateBuffer(env->context, CL_MEM_READ_ONLY, ((size_t)num_pixels + 15) & ~(size_t)15,
+                                         NULL, &ret);
+    check_error(ret, "clCreateBuffer plane");
+    double planar_time = 0.0;
+    int planar_correct = 1;
+    for (int iter = -1; iter < compare_iterations; iter++)
+    {
+        double elapsed = 0.0;
+        for (int c = 0; c < channels; c++)
         {
-            optimal_local_size = 512;
+            double host_start = get_time_ms();
+            for (int p = 0; p < num_pixels; p++)
+            {
+                plane[p] = img->data[(size_t)p * channels + c];
+            }
+            elapsed += get_time_ms() - host_start;
+
+            ret = clEnqueueWriteBuffer(queue, plane_buffer, CL_TRUE, 0, num_pixels, plane, 0, NULL, NULL);
+            check_error(ret, "clEnqueueWriteBuffer plane");
+            if (hist_cl_launch_set_args(&planar, plane_buffer, histogram_buffer) != HIST_OK)
+            {
+                exit(1);
+            }
+            double time_ms = hist_cl_time_kernel(env, queue, planar.kernel, 1, &planar.global_size,
+                                                 &planar.local_size, histogram_buffer, HISTOGRAM_BINS);
+            if (time_ms < 0.0)
+                exit(1);
+            elapsed += time_ms;
+
+            if (iter == compare_iterations - 1)
+            {
+                ret = clEnqueueReadBuffer(queue, histogram_buffer, CL_TRUE, 0, HISTOGRAM_BINS * sizeof(unsigned int),
+                                          histogram + c * HISTOGRAM_BINS, 0, NULL, NULL);
+                check_error(ret, "clEnqueueReadBuffer");
+            }
         }
-        else if (max_work_group_size >= 256)
+        if (iter >= 0)
+            planar_time += elapsed;
+    }
+    planar_correct = memcmp(histogram, reference, num_bins * sizeof(unsigned int)) == 0;
+
+    printf("%-30s  %13.3f  %9.2f  %7.2fx%s\n", "deinterleave + histogram_local",
+           planar_time / compare_iterations,
+           ((long long)num_pixels * compare_iterations / 1e6) / (planar_time / 1000.0), 1.0,
+           planar_correct ? "" : "  ✗ INCORRECT");
+    printf("%-30s  %13.3f  %9.2f  %7.2fx%s\n", "histogram_channels (one pass)",
+           one_pass / compare_iterations,
+           ((long long)num_pixels * compare_iterations / 1e6) / (one_pass / 1000.0), planar_time / one_pass,
+           one_pass_correct ? "" : "  ✗ INCORRECT");
+
+    // 重新计算一次一遍统计的结果并保存（上面的histogram已被拆分方式覆盖）
+    hist_cl_enqueue_clear(env, queue, histogram_buffer, num_bins, 0, NULL, NULL);
+    ret = clEnqueueNDRangeKernel(queue, interleaved.kernel, 1, NULL, &interleaved.global_size,
+                                 &interleaved.local_size, 0, NULL, NULL);
+    check_error(ret, "clEnqueueNDRangeKernel");
+    ret = clEnqueueReadBuffer(queue, histogram_buffer, CL_TRUE, 0, num_bins * sizeof(unsigned int), histogram,
+                              0, NULL, NULL);
+    check_error(ret, "clEnqueueReadBuffer");
+    HistRunInfo info;
+    memset(&info, 0, sizeof(info));
+    info.platform = "OpenCL GPU (interleaved channels)";
+    info.width = width;
+    info.height = height;
+    info.iterations = compare_iterations;
+    info.kernel = hist_cl_kernel_descriptions[HIST_CL_CHANNELS_KERNEL - 1];
+    if (save_histogram_channels_txt(histogram, channels, "output/histogram_gpu_channels.txt", &info) == 0)
+    {
+        printf("Channel histograms saved to output/histogram_gpu_channels.txt\n");
+    }
+
+    hist_cl_launch_release(&interleaved);
+    hist_cl_launch_release(&planar);
+    clReleaseMemObject(plane_buffer);
+    clReleaseMemObject(image_buffer);
+    clReleaseMemObject(histogram_buffer);
+    clReleaseCommandQueue(queue);
+    free(plane);
+    free(histogram);
+    free(reference);
+    free_image(img);
+}
+
+// ===== 高位深图像 =====
+
+// 16位像素（10/12/16位数据）：对比global atomic和按bin分区的local直方图，只测kernel时间（profiling事件）
+void report_wide_comparison(HistClEnv *env, int width, int height, int pixel_bits, int bin_shift, int iterations)
+{
+    int compare_iterations = iterations / 10;
+    if (compare_iterations < 1)
+        compare_iterations = 1;
+    int num_pixels = width * height;
+    int num_bins = 1 << (pixel_bits - bin_shift);
+    size_t image_bytes = (size_t)num_pixels * sizeof(unsigned short);
+    cl_int ret;
+
+    Image *img = create_test_image_u16(width, height, pixel_bits);
+    unsigned int *reference = (unsigned int *)malloc(num_bins * sizeof(unsigned int));
+    unsigned int *histogram = (unsigned int *)malloc(num_bins * sizeof(unsigned int));
+    compute_histogram_cpu_u16((const unsigned short *)img->data, num_pixels, pixel_bits, bin_shift, reference);
+
+    cl_command_queue queue = clCreateCommandQueue(env->context, env->device, CL_QUEUE_PROFILING_ENABLE, &ret);
+    check_error(ret, "clCreateCommandQueue (profiling)");
+    cl_mem image_buffer = clCreateBuffer(env->context, CL_MEM_READ_ONLY, image_bytes, NULL, &ret);
+    check_error(ret, "clCreateBuffer image");
+    cl_mem histogram_buffer = clCreateBuffer(env->context, CL_MEM_READ_WRITE, num_bins * sizeof(unsigned int),
+                                             NULL, &ret);
+    check_error(ret, "clCreateBuffer histogram");
+    ret = clEnqueueWriteBuffer(queue, image_buffer, CL_TRUE, 0, image_bytes, img->data, 0, NULL, NULL);
+    check_error(ret, "clEnqueueWriteBuffer");
+
+    printf("\n=== %d-bit Image, %d Bins (%d iterations, kernel time only) ===\n", pixel_bits, num_bins,
+           compare_iterations);
+    printf("Kernel                          Partitions  Time/iter(ms)  MPixels/s   Speedup\n");
+
+    double global_time = 0.0;
+    for (int k = HIST_CL_WIDE_GLOBAL; k <= HIST_CL_NUM_WIDE_KERNELS; k++)
+    {
+        HistClWideLaunch launch;
+        if (hist_cl_wide_launch_init(&launch, env, k, pixel_bits, bin_shift, num_pixels) != HIST_OK ||
+            hist_cl_wide_launch_set_args(&launch, image_buffer, histogram_buffer) != HIST_OK)
         {
-            optimal_local_size = 256;
+            exit(1);
         }
+
+        double elapsed = 0.0;
+        for (int iter = -1; iter < compare_iterations; iter++) // 第一次为预热
+        {
+            double time_ms = hist_cl_time_kernel(env, queue, launch.kernel, 2, launch.global_size, launch.local_size,
+                                                 histogram_buffer, num_bins);
+            if (time_ms < 0.0)
+                exit(1);
+            if (iter >= 0)
+                elapsed += time_ms;
+        }
+        ret = clEnqueueReadBuffer(queue, histogram_buffer, CL_TRUE, 0, num_bins * sizeof(unsigned int), histogram,
+                                  0, NULL, NULL);
+        check_error(ret, "clEnqueueReadBuffer");
+        int correct = memcmp(histogram, reference, num_bins * sizeof(unsigned int)) == 0;
+        if (k == HIST_CL_WIDE_GLOBAL)
+            global_time = elapsed;
+
+        printf("%-30s  %10d  %13.3f  %9.2f  %7.2fx%s\n", hist_cl_wide_kernel_names[k - 1], launch.num_partitions,
+               elapsed / compare_iterations,
+               ((long long)num_pixels * compare_iterations / 1e6) / (elapsed / 1000.0), global_time / elapsed,
+               correct ? "" : "  ✗ INCORRECT");
+        hist_cl_wide_launch_release(&launch);
     }
 
-    local_size = optimal_local_size;
-    size_t global_size = ((image_size + local_size - 1) / local_size) * local_size;
+    HistRunInfo info;
+    memset(&info, 0, sizeof(info));
+    info.platform = "OpenCL GPU (high bit depth)";
+    info.width = width;
+    info.height = height;
+    info.iterations = compare_iterations;
+    info.kernel = hist_cl_wide_kernel_names[HIST_CL_WIDE_PARTITIONED - 1];
+    if (save_histogram_bins_txt(histogram, num_bins, 1, "output/histogram_gpu_wide.txt", &info) == 0)
+    {
+        printf("%d-bin histogram saved to output/histogram_gpu_wide.txt\n", num_bins);
+    }
+
+    clReleaseMemObject(image_buffer);
+    clReleaseMemObject(histogram_buffer);
+    clReleaseCommandQueue(queue);
+    free(histogram);
+    free(reference);
+    free_image(img);
+}
+
+// ===== 分块直方图 =====
 
-    // 对于ultra kernel，调整global size以确保每个workitem处理足够多的像素
-    if (kernel_choice == 5)
+// histogram_tiled：8×8/16×16块、256/16个bin，只测kernel时间（profiling事件）；
+// 块直方图与compute_histogram_cpu_tiles比对，顺带的整帧直方图与compute_histogram_cpu（合并bin后）比对
+void report_tile_comparison(HistClEnv *env, int width, int height, int iterations)
+{
+    int compare_iterations = iterations / 10;
+    if (compare_iterations < 1)
+        compare_iterations = 1;
+    int tile_sizes[2] = {8, 16};
+    int bin_shifts[2] = {0, 4};
+    int num_pixels = width * height;
+    size_t max_tile_bins = (size_t)hist_num_tiles(width, height, 8, 8) * HISTOGRAM_BINS;
+    cl_int ret;
+
+    Image *img = create_test_image(width, height);
+    unsigned int *reference = (unsigned int *)malloc(max_tile_bins * sizeof(unsigned int));
+    unsigned int *tiles = (unsigned int *)malloc(max_tile_bins * sizeof(unsigned int));
+    unsigned int full[HISTOGRAM_BINS];
+    unsigned int frame_reference[HISTOGRAM_BINS];
+    unsigned int frame[HISTOGRAM_BINS];
+    compute_histogram_cpu(img->data, num_pixels, full);
+
+    cl_command_queue queue = clCreateCommandQueue(env->context, env->device, CL_QUEUE_PROFILING_ENABLE, &ret);
+    check_error(ret, "clCreateCommandQueue (profiling)");
+    cl_mem image_buffer = clCreateBuffer(env->context, CL_MEM_READ_ONLY, num_pixels, NULL, &ret);
+    check_error(ret, "clCreateBuffer image");
+    cl_mem tiles_buffer = clCreateBuffer(env->context, CL_MEM_WRITE_ONLY, max_tile_bins * sizeof(unsigned int), NULL,
+                                         &ret);
+    check_error(ret, "clCreateBuffer tiles");
+    cl_mem histogram_buffer = clCreateBuffer(env->context, CL_MEM_READ_WRITE, HISTOGRAM_BINS * sizeof(unsigned int),
+                                             NULL, &ret);
+    check_error(ret, "clCreateBuffer histogram");
+    ret = clEnqueueWriteBuffer(queue, image_buffer, CL_TRUE, 0, num_pixels, img->data, 0, NULL, NULL);
+    check_error(ret, "clEnqueueWriteBuffer");
+
+    printf("\n=== Tiled Histograms (%d iterations, kernel time only) ===\n", compare_iterations);
+    printf("Tile   Bins     Tiles  Tiles/group  Local size  Time/iter(ms)  MPixels/s\n");
+
+    for (int s = 0; s < 2; s++)
     {
-        // 确保每个workitem至少处理8个像素
-        int min_workitems = (image_size + 31) / 32; // 每个workitem最多32个像素
-        if (global_size > min_workitems * local_size)
+        for (int b = 0; b < 2; b++)
         {
-            global_size = ((min_workitems + local_size - 1) / local_size) * local_size;
+            int tile = tile_sizes[s];
+            int num_tiles = hist_num_tiles(width, height, tile, tile);
+            HistClTileLaunch launch;
+            if (hist_cl_tile_launch_init(&launch, env, bin_shifts[b]) != HIST_OK)
+            {
+                exit(1);
+            }
+            hist_cl_tile_launch_configure(&launch, env, width, height, width, tile, tile);
+            if (hist_cl_tile_launch_set_args(&launch, image_buffer, tiles_buffer, histogram_buffer) != HIST_OK)
+            {
+                exit(1);
+            }
+
+            double elapsed = 0.0;
+            for (int iter = -1; iter < compare_iterations; iter++) // 第一次为预热
+            {
+                double time_ms = hist_cl_time_kernel(env, queue, launch.kernel, 2, launch.global_size,
+                                                     launch.local_size, histogram_buffer, launch.num_bins);
+                if (time_ms < 0.0)
+                    exit(1);
+                if (iter >= 0)
+                    elapsed += time_ms;
+            }
+            size_t tile_bins = (size_t)num_tiles * launch.num_bins;
+            ret = clEnqueueReadBuffer(queue, tiles_buffer, CL_TRUE, 0, tile_bins * sizeof(unsigned int), tiles, 0,
+                                      NULL, NULL);
+            ret |= clEnqueueReadBuffer(queue, histogram_buffer, CL_TRUE, 0, launch.num_bins * sizeof(unsigned int),
+                                       frame, 0, NULL, NULL);
+            check_error(ret, "clEnqueueReadBuffer");
+
+            compute_histogram_cpu_tiles(img->data, width, height, width, tile, tile, bin_shifts[b], reference);
+            memset(frame_reference, 0, sizeof(frame_reference));
+            for (int i = 0; i < HISTOGRAM_BINS; i++)
+            {
+                frame_reference[i >> bin_shifts[b]] += full[i];
+            }
+            int correct = memcmp(tiles, reference, tile_bins * sizeof(unsigned int)) == 0 &&
+                          memcmp(frame, frame_reference, launch.num_bins * sizeof(unsigned int)) == 0;
+
+            printf("%2dx%-2d  %4d  %8d  %11d  %10d  %13.3f  %9.2f%s\n", tile, tile, launch.num_bins, num_tiles,
+                   launch.tiles_per_group, (int)launch.local_size[0], elapsed / compare_iterations,
+                   ((long long)num_pixels * compare_iterations / 1e6) / (elapsed / 1000.0),
+                   correct ? "" : "  ✗ INCORRECT");
+            hist_cl_tile_launch_release(&launch);
         }
     }
 
-    ret = clSetKernelArg(kernel, 0, sizeof(cl_mem), (void *)&image_buffer);
-    ret |= clSetKernelArg(kernel, 1, sizeof(cl_mem), (void *)&histogram_buffer);
-    ret |= clSetKernelArg(kernel, 2, sizeof(int), (void *)&image_size);
+    clReleaseMemObject(image_buffer);
+    clReleaseMemObject(tiles_buffer);
+    clReleaseMemObject(histogram_buffer);
+    clReleaseCommandQueue(queue);
+    free(reference);
+    free(tiles);
+    free_image(img);
+}
 
-    // 如果使用local memory的kernel，设置local memory参数
-    if ((kernel_choice >= 2 && kernel_choice != 4) || kernel_choice == 5) // 所有需要local memory的kernel
+int main(int argc, char **argv)
+{
+    int width = 3840;
+    int height = 2160;
+    int iterations = 1000;
+    int kernel_choice = HIST_CL_DEFAULT_KERNEL; // 默认使用local memory版本
+    int kernel_given = 0;  // 命令行指定了kernel时只使用同一kernel的调优结果
+    int autotune = 0;
+    int stream_depth = 0;  // 0 = 图像只上传一次，反复在驻留缓冲区上计算
+    int out_of_order = 0;
+    MemMode mem_mode = MEM_COPY;
+    int batch = 0; // 0 = 每帧一次launch
+    int channels = 0; // 非0时额外测试交错的多通道图像（3 = RGB，4 = RGBA）
+    int pixel_bits = 8; // 10/12/16时额外测试高位深图像
+    int bin_shift = 0;
+    int profile_stages = 0; // 用profiling事件分解每帧的上传、清零、kernel和回读时间
+
+    // 位置参数: 宽 高 [迭代次数] [kernel]
+    // 选项: --stream[=N] --ooo --zero-copy[=hostptr|svm] --batch N --autotune --channels N --bits N --bin-shift S --profile
+    int positional = 0;
+    for (int a = 1; a < argc; a++)
     {
-        ret |= clSetKernelArg(kernel, 3, HISTOGRAM_BINS * sizeof(unsigned int), NULL);
+        if (strncmp(argv[a], "--stream", 8) == 0 && (argv[a][8] == '\0' || argv[a][8] == '='))
+        {
+            stream_depth = argv[a][8] == '=' ? atoi(argv[a] + 9) : 3;
+        }
+        else if (strcmp(argv[a], "--ooo") == 0)
+        {
+            out_of_order = 1;
+        }
+        else if (strcmp(argv[a], "--zero-copy") == 0 || strcmp(argv[a], "--zero-copy=hostptr") == 0)
+        {
+            mem_mode = MEM_HOST_PTR;
+        }
+        else if (strcmp(argv[a], "--zero-copy=svm") == 0)
+        {
+            mem_mode = MEM_SVM;
+        }
+        else if (strncmp(argv[a], "--batch=", 8) == 0)
+        {
+            batch = atoi(argv[a] + 8);
+        }
+        else if (strcmp(argv[a], "--batch") == 0 && a + 1 < argc)
+        {
+            batch = atoi(argv[++a]);
+        }
+        else if (strcmp(argv[a], "--autotune") == 0)
+        {
+            autotune = 1;
+        }
+        else if (strncmp(argv[a], "--channels=", 11) == 0)
+        {
+            channels = atoi(argv[a] + 11);
+        }
+        else if (strcmp(argv[a], "--channels") == 0 && a + 1 < argc)
+        {
+            channels = atoi(argv[++a]);
+        }
+        else if (strcmp(argv[a], "--bits") == 0 && a + 1 < argc)
+        {
+            pixel_bits = atoi(argv[++a]);
+        }
+        else if (strcmp(argv[a], "--bin-shift") == 0 && a + 1 < argc)
+        {
+            bin_shift = atoi(argv[++a]);
+        }
+        else if (strcmp(argv[a], "--profile") == 0)
+        {
+            profile_stages = 1;
+        }
+        else if (strncmp(argv[a], "--", 2) == 0)
+        {
+            fprintf(stderr, "Unknown option: %s\n", argv[a]);
+            fprintf(stderr, "Usage: %s [width height [iterations [kernel]]] [--stream[=N]] [--ooo] [--zero-copy[=hostptr|svm]] [--batch N] [--autotune] [--channels N] [--bits N [--bin-shift S]] [--profile]\n", argv[0]);
+            return 1;
+        }
+        else
+        {
+            switch (positional++)
+            {
+            case 0:
+                width = atoi(argv[a]);
+                break;
+            case 1:
+                height = atoi(argv[a]);
+                break;
+            case 2:
+                iterations = atoi(argv[a]);
+                break;
+            case 3:
+                kernel_choice = atoi(argv[a]);
+                kernel_given = 1;
+                break;
+            }
+        }
+    }
+    if (channels < 0 || channels > HIST_MAX_CHANNELS)
+    {
+        fprintf(stderr, "Error: --channels must be 1..%d\n", HIST_MAX_CHANNELS);
+        return 1;
+    }
+    if ((pixel_bits != 8 && pixel_bits != 10 && pixel_bits != 12 && pixel_bits != 16) ||
+        bin_shift < 0 || bin_shift >= pixel_bits)
+    {
+        fprintf(stderr, "Error: --bits must be 8/10/12/16 and --bin-shift 0..bits-1\n");
+        return 1;
+    }
+    if (out_of_order && stream_depth == 0)
+    {
+        stream_depth = 3;
+    }
+    if (stream_depth > STREAM_MAX_DEPTH)
+    {
+        stream_depth = STREAM_MAX_DEPTH;
+    }
+    if (batch > 0)
+    {
+        if (stream_depth > 0 || mem_mode != MEM_COPY)
+        {
+            fprintf(stderr, "Error: --batch cannot be combined with --stream or --zero-copy\n");
+            return 1;
+        }
+        // 迭代次数向上取整到batch的整数倍
+        iterations = (iterations + batch - 1) / batch * batch;
     }
 
-    // 对于histogram_private kernel，设置每个workitem处理的像素数
-    if (kernel_choice == 3)
+    // HIST_INPUT指定了8位单通道图像文件时用文件的第一帧代替测试图像，流式模式轮流上传文件中的帧
+    HistInput *input = NULL;
+    if (hist_input_open(&input, NULL) != HIST_OK)
+    {
+        return 1;
+    }
+    if (input && (input->channels != 1 || input->pixel_bits != 8))
+    {
+        fprintf(stderr, "Error: the GPU benchmark needs an 8-bit single-channel input\n");
+        hist_input_close(input);
+        return 1;
+    }
+    if (input)
     {
-        int pixels_per_workitem = (image_size + global_size - 1) / global_size;
-        if (pixels_per_workitem < 1)
-            pixels_per_workitem = 1;
-        ret |= clSetKernelArg(kernel, 4, sizeof(int), (void *)&pixels_per_workitem);
+        width = input->width;
+        height = input->height;
     }
 
-    // 对于vectorized kernel，需要特殊处理
-    if (kernel_choice == 4)
+    // HIST_SINK=frames.hbin[:lz4][:u64] 时把回读的每帧直方图追加到二进制文件（用histogram_dump转换回文本）
+    if (hist_sink_open_spec(&frame_sink, NULL, HISTOGRAM_BINS, 1, width, height) != HIST_OK)
     {
-        int num_vectors = (image_size + 3) / 4; // uchar4处理
-        size_t vec_global_size = ((num_vectors + local_size - 1) / local_size) * local_size;
-        global_size = vec_global_size;
-        ret |= clSetKernelArg(kernel, 2, sizeof(int), (void *)&num_vectors);
-        ret |= clSetKernelArg(kernel, 3, HISTOGRAM_BINS * sizeof(unsigned int), NULL);
+        hist_input_close(input);
+        return 1;
     }
 
-    check_error(ret, "clSetKernelArg");
+    printf("=== OpenCL GPU Histogram Computation ===\n");
+    printf("Image size: %dx%d (%.2f MP)\n", width, height, (width * height) / 1e6);
+    if (input)
+    {
+        char description[600];
+        hist_input_describe(input, description, sizeof(description));
+        printf("Input: %s\n", description);
+    }
+    printf("Iterations: %d\n", iterations);
+    if (stream_depth > 0)
+    {
+        printf("Mode: streaming (%d-deep ring, new frame uploaded every iteration)\n", stream_depth);
+    }
+    if (batch > 0)
+    {
+        printf("Mode: batched (%d frames per launch)\n", batch);
+    }
+
+    long long total_pixels = (long long)width * height;
+    double total_data = (total_pixels * iterations) / (1024.0 * 1024.0 * 1024.0);
+    printf("Total data to process: %.2f GB\n\n", total_data);
+
+    // 创建测试图像（输入文件的帧是映射内存上的视图，不需要拷贝）
+    Image input_view;
+    Image *img = &input_view;
+    if (input)
+    {
+        input_view = hist_input_image(input, 0);
+    }
+    else
+    {
+        printf("Generating test image...\n");
+        img = create_test_image(width, height);
+    }
+    int image_size = width * height;
+
+    // OpenCL初始化：选择设备、创建命令队列并编译kernel
+    printf("Initializing OpenCL...\n");
+    cl_int ret;
+    HistClEnv env;
+    HistClProfile profile;
+    if (profile_stages)
+    {
+        hist_cl_profile_init(&profile);
+        cl_profile = &profile;
+    }
+    if (hist_cl_env_init(&env, NULL, profile_queue_flag()) != HIST_OK)
+    {
+        exit(1);
+    }
+    hist_cl_print_device_info(&env);
+    // 启动时间单独统计：设备选择 + 程序编译（或从二进制缓存加载）
+    printf("Startup time: %.3f ms (program %s)\n\n", env.startup_time_ms,
+           env.program_from_cache ? "loaded from binary cache" : "built from source");
+
+    if (kernel_choice < 1 || kernel_choice > HIST_CL_NUM_KERNELS)
+    {
+        kernel_choice = HIST_CL_ULTRA_KERNEL; // 默认使用ultra版本（最优）
+    }
+
+    // 自动调优：--autotune时扫描所有配置并保存最优结果，否则加载这台设备之前保存的结果
+    HistClTuning tuning;
+    memset(&tuning, 0, sizeof(tuning));
+    tuning.kernel_choice = kernel_choice;
+    char tuning_path[512];
+    if (autotune)
+    {
+        if (hist_cl_autotune(&env, img->data, image_size, &tuning, 1) != HIST_OK)
+        {
+            exit(1);
+        }
+        if (hist_cl_tuning_save(&env, &tuning, tuning_path, sizeof(tuning_path)) == HIST_OK)
+        {
+            printf("Tuning saved to %s\n\n", tuning_path);
+        }
+        else
+        {
+            printf("Warning: tuning result not saved (cache directory disabled or not writable)\n\n");
+        }
+    }
+    else if (batch == 0)
+    {
+        HistClTuning saved;
+        if (hist_cl_tuning_load(&env, image_size, &saved, tuning_path, sizeof(tuning_path)) == HIST_OK &&
+            (!kernel_given || saved.kernel_choice == kernel_choice))
+        {
+            tuning = saved;
+            printf("Using tuned configuration from %s\n", tuning_path);
+        }
+    }
+    kernel_choice = tuning.kernel_choice;
+    const char *kernel_description = hist_cl_kernel_descriptions[kernel_choice - 1];
+
+    printf("Using kernel: %s\n", kernel_description);
+
+    // 创建kernel并按设备能力（或调优结果）计算工作组大小
+    HistClLaunch launch;
+    if (hist_cl_launch_init_tuned(&launch, &env, &tuning, image_size) != HIST_OK)
+    {
+        exit(1);
+    }
+    cl_command_queue command_queue = env.queue;
+    cl_kernel kernel = launch.kernel;
+    size_t global_size = launch.global_size;
+    size_t local_size = launch.local_size;
+
+    mem_mode = check_mem_mode(&env, mem_mode);
+    printf("Frame memory: %s\n", mem_mode_names[mem_mode]);
+
+    // 创建缓冲区 - 优化：使用CL_MEM_COPY_HOST_PTR避免额外传输
+    // 零拷贝模式下图像留在页对齐的主机内存中，kernel原地读取
+    cl_mem image_buffer = NULL;
+    FrameMemory resident_frame;
+    if (mem_mode == MEM_COPY)
+    {
+        image_buffer = clCreateBuffer(env.context, CL_MEM_READ_ONLY | CL_MEM_COPY_HOST_PTR,
+                                      image_size * sizeof(unsigned char), img->data, &ret);
+        check_error(ret, "clCreateBuffer image");
+        bytes_to_device += image_size;
+    }
+    else
+    {
+        frame_alloc(&resident_frame, &env, mem_mode, image_size);
+        frame_write(&resident_frame, env.queue, img->data, image_size);
+    }
+
+    cl_mem histogram_buffer = clCreateBuffer(env.context, CL_MEM_READ_WRITE,
+                                             HISTOGRAM_BINS * sizeof(unsigned int), NULL, &ret);
+    check_error(ret, "clCreateBuffer histogram");
+
+    // 设置kernel参数（图像、直方图、像素数以及各kernel需要的local memory参数）
+    if (hist_cl_launch_set_args(&launch, image_buffer, histogram_buffer) != HIST_OK)
+    {
+        exit(1);
+    }
+    if (mem_mode != MEM_COPY)
+    {
+        frame_set_kernel_arg(&resident_frame, kernel);
+    }
 
     printf("\nWork configuration:\n");
     printf("  Global work size: %zu\n", global_size);
-    printf("  Local work size: %zu (optimal from device max: %zu)\n", local_size, max_work_group_size);
+    printf("  Local work size: %zu (optimal from device max: %zu)\n", local_size, env.max_work_group_size);
     printf("  Work groups: %zu\n", global_size / local_size);
-    if (kernel_choice == 2 || kernel_choice == 5)
+    if (kernel_choice == HIST_CL_LOCAL_KERNEL)
     {
-        printf("  Pixels per workitem: adaptive (8-32)\n");
+        printf("  Pixels per workitem: %d\n", launch.tuned_pixels_per_item > 0 ? launch.tuned_pixels_per_item : 4);
+    }
+    else if (kernel_choice == HIST_CL_ULTRA_KERNEL)
+    {
+        int max_pixels = launch.tuned_pixels_per_item > 0 ? launch.tuned_pixels_per_item : 32;
+        printf("  Pixels per workitem: adaptive (%d-%d)\n", max_pixels < 8 ? max_pixels : 8, max_pixels);
     }
     printf("\n");
 
     // 预热
     printf("Warming up...\n");
-    unsigned int zeros[HISTOGRAM_BINS] = {0};
-    ret = clEnqueueWriteBuffer(command_queue, histogram_buffer, CL_TRUE, 0,
-                               HISTOGRAM_BINS * sizeof(unsigned int), zeros, 0, NULL, NULL);
+    if (hist_cl_enqueue_clear(&env, command_queue, histogram_buffer, HISTOGRAM_BINS, 0, NULL, NULL) != HIST_OK)
+    {
+        exit(1);
+    }
     ret = clEnqueueNDRangeKernel(command_queue, kernel, 1, NULL, &global_size, &local_size, 0, NULL, NULL);
-    clFinish(command_queue);
+    check_error(ret, "clEnqueueNDRangeKernel (warm-up)");
+    check_error(clFinish(command_queue), "clFinish (warm-up)");
 
     printf("Starting benchmark...\n\n");
 
-    // 主循环
-    double start_time = get_time_ms();
-    double last_update = start_time;
-
-    // 优化：使用kernel内部的清零，减少数据传输
-    // 创建一个清零kernel（如果设备支持）或者继续使用buffer写入
-    // 为了简单，我们优化buffer写入方式：使用异步写入，减少等待
-
-    for (int iter = 0; iter < iterations; iter++)
+    double total_time;
+    unsigned int *histogram = (unsigned int *)malloc(HISTOGRAM_BINS * sizeof(unsigned int));
+    if (batch > 0)
     {
-        // 优化：使用异步写入，不等待完成
-        ret = clEnqueueWriteBuffer(command_queue, histogram_buffer, CL_FALSE, 0,
-                                   HISTOGRAM_BINS * sizeof(unsigned int), zeros, 0, NULL, NULL);
+        total_time = run_batched(&env, img, iterations, batch, histogram);
+    }
+    else if (stream_depth > 0)
+    {
+        total_time = run_streaming(&env, &tuning, input, img, iterations, stream_depth, out_of_order, mem_mode, histogram);
+    }
+    else
+    {
+        // 主循环
+        double start_time = get_time_ms();
+        double last_update = start_time;
 
-        // 优化：立即执行kernel，不等待buffer写入完成（OpenCL会自动处理依赖）
-        ret = clEnqueueNDRangeKernel(command_queue, kernel, 1, NULL, &global_size, &local_size, 0, NULL, NULL);
+        // 优化：直方图在设备上用histogram_clear清零，不再每次迭代从主机写入zeros
+        // --profile时记录两次同步之间的清零和kernel事件，同步后统一读取时间戳
+        cl_event pending_events[2 * 200];
+        int num_pending = 0;
 
-        // 优化：减少同步频率，只在需要时同步
-        // 每200次迭代或最后一次才同步（减少同步开销）
-        if ((iter + 1) % 200 == 0 || iter == iterations - 1)
+        for (int iter = 0; iter < iterations; iter++)
         {
-            clFinish(command_queue);
+            // 命令成功入队后才记录事件，pending_events中不会有未初始化的项
+            cl_event clear_event = NULL, kernel_event = NULL;
+            if (hist_cl_enqueue_clear(&env, command_queue, histogram_buffer, HISTOGRAM_BINS, 0, NULL,
+                                      cl_profile ? &clear_event : NULL) != HIST_OK)
+            {
+                exit(1);
+            }
 
-            double current_time = get_time_ms();
-            if (current_time - last_update > 100 || iter == iterations - 1)
+            // 优化：立即执行kernel，不等待清零完成（顺序队列会自动处理依赖）
+            ret = clEnqueueNDRangeKernel(command_queue, kernel, 1, NULL, &global_size, &local_size, 0, NULL,
+                                         cl_profile ? &kernel_event : NULL);
+            check_error(ret, "clEnqueueNDRangeKernel");
+            if (cl_profile)
             {
-                print_progress(iter + 1, iterations, current_time - start_time);
-                last_update = current_time;
+                pending_events[num_pending++] = clear_event;
+                pending_events[num_pending++] = kernel_event;
             }
-        }
-    }
 
-    clFinish(command_queue);
-    double end_time = get_time_ms();
-    double total_time = end_time - start_time;
+            // 优化：减少同步频率，只在需要时同步
+            // 每200次迭代或最后一次才同步（减少同步开销）
+            if ((iter + 1) % 200 == 0 || iter == iterations - 1)
+            {
+                clFinish(command_queue);
+                for (int e = 0; e < num_pending; e++)
+                {
+                    profile_event(e % 2 == 0 ? HIST_CL_STAGE_CLEAR : HIST_CL_STAGE_KERNEL, pending_events[e]);
+                }
+                num_pending = 0;
+
+                double current_time = get_time_ms();
+                if (current_time - last_update > 100 || iter == iterations - 1)
+                {
+                    print_progress(iter + 1, iterations, current_time - start_time);
+                    last_update = current_time;
+                }
+            }
+        }
 
-    // 读取结果
-    unsigned int *histogram = (unsigned int *)malloc(HISTOGRAM_BINS * sizeof(unsigned int));
-    ret = clEnqueueReadBuffer(command_queue, histogram_buffer, CL_TRUE, 0,
-                              HISTOGRAM_BINS * sizeof(unsigned int), histogram, 0, NULL, NULL);
-    check_error(ret, "clEnqueueReadBuffer");
+        clFinish(command_queue);
+        double end_time = get_time_ms();
+        total_time = end_time - start_time;
+
+        // 读取结果
+        cl_event read_event = NULL;
+        ret = clEnqueueReadBuffer(command_queue, histogram_buffer, CL_TRUE, 0,
+                                  HISTOGRAM_BINS * sizeof(unsigned int), histogram, 0, NULL,
+                                  cl_profile ? &read_event : NULL);
+        check_error(ret, "clEnqueueReadBuffer");
+        if (read_event)
+        {
+            profile_event(HIST_CL_STAGE_READ, read_event);
+        }
+        bytes_from_device += HISTOGRAM_BINS * sizeof(unsigned int);
+        sink_frame((unsigned long long)(iterations - 1), histogram);
+    }
 
     // 计算性能指标
     long long total_pixels_processed = (long long)image_size * iterations;
@@ -523,8 +1494,24 @@ int main(int argc, char **argv)
     printf("Iterations per second: %.2f\n", iterations / (total_time / 1000.0));
     printf("Total pixels processed: %lld (%.2f MP)\n", total_pixels_processed, total_pixels_processed / 1e6);
     printf("Throughput: %.2f MPixels/s\n", throughput_mpixels);
+    printf("Startup time: %.3f ms\n", env.startup_time_ms);
     printf("Data processed: %.2f GB in %.2f seconds\n", total_data, total_time / 1000.0);
     printf("Bandwidth: %.2f GB/s\n", total_data / (total_time / 1000.0));
+    printf("Bytes moved (%s): host->device %.2f MB, device->host %.2f KB\n", mem_mode_names[mem_mode],
+           bytes_to_device / (1024.0 * 1024.0), bytes_from_device / 1024.0);
+    if (frame_sink)
+    {
+        hist_sink_flush(frame_sink);
+        char description[700];
+        hist_sink_describe(frame_sink, description, sizeof(description));
+        printf("Sink: %s\n", description);
+        hist_sink_close(frame_sink);
+        frame_sink = NULL;
+    }
+    if (cl_profile)
+    {
+        hist_cl_profile_print(cl_profile, iterations, stdout);
+    }
 
     // 验证结果
     printf("\nSample histogram values:\n");
@@ -543,48 +1530,69 @@ int main(int argc, char **argv)
     }
 
     // 保存结果到 output 文件夹
-    char output_filename[256];
-    snprintf(output_filename, sizeof(output_filename), "output/histogram_gpu.txt");
-    FILE *fp = fopen(output_filename, "w");
-    if (fp)
-    {
-        fprintf(fp, "# Histogram Data (Bin, Count)\n");
-        fprintf(fp, "# Platform: OpenCL GPU\n");
-        fprintf(fp, "# Image size: %dx%d\n", width, height);
-        fprintf(fp, "# Iterations: %d\n", iterations);
-        fprintf(fp, "# Kernel: %s\n", kernel_descriptions[kernel_choice - 1]);
-        fprintf(fp, "# Total execution time: %.3f ms (%.3f seconds)\n", total_time, total_time / 1000.0);
-        fprintf(fp, "# Throughput: %.2f MPixels/s\n", throughput_mpixels);
-        for (int i = 0; i < HISTOGRAM_BINS; i++)
-        {
-            fprintf(fp, "%d %u\n", i, histogram[i]);
-        }
-        fclose(fp);
+    const char *output_filename = "output/histogram_gpu.txt";
+    HistRunInfo info;
+    memset(&info, 0, sizeof(info));
+    info.platform = batch > 0 ? "OpenCL GPU (batched)" : stream_depth > 0 ? "OpenCL GPU (streaming)" : "OpenCL GPU";
+    info.width = width;
+    info.height = height;
+    info.iterations = iterations;
+    info.kernel = kernel_description;
+    info.startup_time_ms = env.startup_time_ms;
+    info.total_time_ms = total_time;
+    info.throughput_mpixels = throughput_mpixels;
+    if (save_histogram_txt(histogram, output_filename, &info) == 0)
+    {
         printf("\nHistogram saved to %s\n", output_filename);
 
         // 创建加速比对比文件
-        create_speedup_file(total_time, width, height, iterations, kernel_descriptions[kernel_choice - 1], throughput_mpixels);
+        create_speedup_file(total_time, width, height, iterations, kernel_description, throughput_mpixels);
     }
     else
     {
         fprintf(stderr, "Warning: Could not save histogram to %s\n", output_filename);
     }
 
+    // 附加对比默认不运行（HIST_COMPARE=patterns,tiles 或 all）
+    if (hist_compare_requested("patterns"))
+    {
+        report_pattern_comparison(&env, width, height, iterations);
+    }
+    if (hist_compare_requested("tiles"))
+    {
+        report_tile_comparison(&env, width, height, iterations);
+    }
+    if (channels > 1)
+    {
+        report_channel_comparison(&env, width, height, channels, iterations);
+    }
+    if (pixel_bits > 8)
+    {
+        report_wide_comparison(&env, width, height, pixel_bits, bin_shift, iterations);
+    }
+
     // 清理
-    clReleaseMemObject(image_buffer);
+    if (image_buffer)
+        clReleaseMemObject(image_buffer);
+    else
+        frame_release(&resident_frame, &env);
     clReleaseMemObject(histogram_buffer);
-    clReleaseKernel(kernel);
-    clReleaseProgram(program);
-    clReleaseCommandQueue(command_queue);
-    clReleaseContext(context);
+    hist_cl_launch_release(&launch);
+    hist_cl_env_release(&env);
+    if (cl_profile)
+    {
+        hist_cl_profile_release(cl_profile);
+    }
 
-    free(kernel_source);
     free(histogram);
-    free(img->data);
-    free(img);
+    if (!input)
+    {
+        free_image(img);
+    }
+    hist_input_close(input);
 
     printf("\n=== Summary ===\n");
-    printf("Kernel used: %s\n", kernel_descriptions[kernel_choice - 1]);
+    printf("Kernel used: %s\n", kernel_description);
     printf("GPU processing complete!\n");
 
     return 0;